@@ -26,6 +26,10 @@ Sub Process_Globals
 	Public SERVICE_UUID As String 		= "6E400001-B5A3-F393-E0A9-E50E24DCCA9E"	' UART
 	Public CHAR_UUID_TX As String 		= "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"	' Transmit
 	Public CHAR_UUID_RX As String 		= "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"	' Receive Flags read,notify,write
+
+	' Transport frames (reserved DeviceID 0x00)
+	Public TRANSPORT_MARKER As Byte		= 0x00
+	Public TRANSPORT_BATCH As Byte		= 0x01										' [00][01][Len][Frame...]...
 #End Region
 
 #Region Device IDs
@@ -30,6 +30,19 @@ Public Sub Parse(data() As Byte)
 	End If
 	Log($"[BLEParser.Parse] data=${Convert.HexFromBytes(data)}"$)
 
+	' Batch notification [00][01][Len][Frame...]... > parse each frame
+	If data(0) = BLEConstants.TRANSPORT_MARKER And data(1) = BLEConstants.TRANSPORT_BATCH Then
+		Dim i As Int = 2
+		Do While i < data.Length
+			Dim length As Int = Bit.And(data(i), 0xFF)
+			Dim frame(length) As Byte
+			Bit.ArrayCopy(data, i + 1, frame, 0, length)
+			Parse(frame)
+			i = i + 1 + length
+		Loop
+		Return
+	End If
+
 	Dim devid As Byte = data(0)
 
 	Select devid
@@ -2,6 +2,7 @@ import asyncio
 from bleak import BleakClient, BleakScanner
 from PySide6.QtCore import QObject, Signal
 from .ble_constants import *
+from .ble_parser import segment_message, sequence_frame
 
 class BLEManager(QObject):
     notificationReceived = Signal(bytes)
@@ -10,6 +11,8 @@ class BLEManager(QObject):
         super().__init__()
         self.client: BleakClient | None = None
         self.connected = False
+        self._msg_id = 0
+        self._seq = 0
 
     async def connect(self):
         if self.connected:
@@ -28,6 +31,7 @@ class BLEManager(QObject):
         self.client = BleakClient(device.address)
         await self.client.connect()
         self.connected = True
+        self._seq = 0
         print("[ble_manager.connect][I] connected.")
 
         try:
@@ -57,4 +61,28 @@ class BLEManager(QObject):
             return
 
         msg = bytes([device_id, cmd]) + payload
-        await self.client.write_gatt_char(CHAR_UUID_TX, msg)
+
+        # Messages larger than the ATT payload are sent as segments
+        capacity = self.client.mtu_size - 3
+        self._msg_id = (self._msg_id + 1) & 0xFF
+        for frame in segment_message(msg, capacity, self._msg_id):
+            await self.client.write_gatt_char(CHAR_UUID_TX, frame)
+
+    async def send_stream(self, device_id: int, cmd: int, payload: bytes = b""):
+        """
+        Send a frame as write without response, e.g. for slider values.
+        The frame is wrapped with a rolling sequence number so the server can
+        count dropped writes. Frames too large for one write use send().
+        """
+        if not self.connected:
+            print("[ble_manager.send_stream][E] Not connected.")
+            return
+
+        msg = bytes([device_id, cmd]) + payload
+        if len(msg) + 3 > self.client.mtu_size - 3:
+            await self.send(device_id, cmd, payload)
+            return
+
+        frame = sequence_frame(msg, self._seq)
+        self._seq = (self._seq + 1) & 0xFF
+        await self.client.write_gatt_char(CHAR_UUID_TX, frame, response=False)
@@ -8,7 +8,125 @@ Parses BLE notifications based on the protocol:
 Returns a standardized dict suitable for GUI update.
 """
 
-from typing import Optional
+import time
+from typing import List, Optional
+
+# Transport frames use the reserved device id 0x00 (see docs/BLE_NOTES.md)
+TRANSPORT_MARKER = 0x00
+TRANSPORT_BATCH = 0x01
+TRANSPORT_SEGMENT = 0x02
+TRANSPORT_SEQUENCED = 0x03
+TRANSPORT_ACK = 0x04
+
+# Segment frame [0x00, 0x02, flags, msg_id, seq, chunk...]
+SEG_FLAG_START = 0x80
+SEG_FLAG_END = 0x40
+SEG_HEADER_SIZE = 5
+
+
+def segment_message(data: bytes, capacity: int, msg_id: int) -> List[bytes]:
+    """
+    Split a message into segment frames of at most capacity bytes.
+    Messages that fit into one frame are returned unchanged.
+    """
+    if len(data) <= capacity:
+        return [data]
+
+    chunk = capacity - SEG_HEADER_SIZE
+    parts = [data[i:i + chunk] for i in range(0, len(data), chunk)]
+    frames = []
+    for seq, part in enumerate(parts):
+        flags = (SEG_FLAG_START if seq == 0 else 0) | (SEG_FLAG_END if seq == len(parts) - 1 else 0)
+        frames.append(bytes([TRANSPORT_MARKER, TRANSPORT_SEGMENT, flags, msg_id & 0xFF, seq]) + part)
+    return frames
+
+
+def sequence_frame(frame: bytes, seq: int) -> bytes:
+    """
+    Wrap a frame for write without response: [0x00, 0x03, seq, frame...].
+    The server uses the rolling seq to detect dropped writes.
+    """
+    return bytes([TRANSPORT_MARKER, TRANSPORT_SEQUENCED, seq & 0xFF]) + frame
+
+
+def parse_ack(data: bytes) -> Optional[dict]:
+    """
+    Parse a batched ACK notification [0x00, 0x04, last_seq, received, dropped].
+    Returns None if data is not an ACK.
+    """
+    if len(data) < 5 or data[0] != TRANSPORT_MARKER or data[1] != TRANSPORT_ACK:
+        return None
+    return {"device": "transport", "ack": data[2], "received": data[3], "dropped": data[4]}
+
+
+class SegmentReassembler:
+    """
+    Reassemble segment frames into messages.
+    A partial message is discarded on a sequence error or after timeout seconds.
+    """
+
+    def __init__(self, timeout: float = 0.5):
+        self.timeout = timeout
+        self._buffer = bytearray()
+        self._msg_id = None
+        self._next_seq = 0
+        self._started = 0.0
+
+    def feed(self, frame: bytes) -> Optional[bytes]:
+        """Feed one segment frame. Returns the message when complete."""
+        flags, msg_id, seq = frame[2], frame[3], frame[4]
+        now = time.monotonic()
+
+        if flags & SEG_FLAG_START:
+            self._buffer = bytearray()
+            self._msg_id = msg_id
+            self._next_seq = 0
+            self._started = now
+        elif self._msg_id != msg_id or seq != self._next_seq or now - self._started > self.timeout:
+            self._msg_id = None
+            return None
+
+        self._buffer += frame[SEG_HEADER_SIZE:]
+        self._next_seq += 1
+
+        if flags & SEG_FLAG_END:
+            self._msg_id = None
+            return bytes(self._buffer)
+        return None
+
+
+_reassembler = SegmentReassembler()
+
+
+def split_notification(data: bytes) -> List[bytes]:
+    """
+    Split a raw BLE notification into device frames.
+
+    A batch notification [0x00, 0x01, len, frame..., len, frame...] holds
+    several frames. A segment notification [0x00, 0x02, ...] yields the
+    reassembled frame once the last segment arrived. Any other notification
+    is a single frame.
+
+    Args:
+        data (bytes): Raw BLE notification
+
+    Returns:
+        list: Device frames [device_id, command_id, payload...]
+    """
+    if len(data) >= SEG_HEADER_SIZE and data[0] == TRANSPORT_MARKER and data[1] == TRANSPORT_SEGMENT:
+        message = _reassembler.feed(data)
+        return [message] if message is not None else []
+
+    if len(data) < 2 or data[0] != TRANSPORT_MARKER or data[1] != TRANSPORT_BATCH:
+        return [data]
+
+    frames = []
+    i = 2
+    while i < len(data):
+        length = data[i]
+        frames.append(data[i + 1:i + 1 + length])
+        i += 1 + length
+    return frames
 
 
 def parse_notification(data: bytes) -> Optional[dict]:
@@ -28,6 +146,10 @@ def parse_notification(data: bytes) -> Optional[dict]:
     if not data or len(data) < 2:
         return None
 
+    ack = parse_ack(data)
+    if ack:
+        return ack
+
     device_id = data[0]
     command_id = data[1]
     payload = data[2:]
@@ -0,0 +1,223 @@
+# payload_codec.py
+"""
+MQTT Payload Decoder for HomeKit32 Python Client
+
+Topics can be published as JSON (default), CBOR (RFC 8949) or MessagePack,
+see MQTTTopics.FormatTopicTable in the firmware and docs/MQTT_NOTES.md.
+The payload is always a flat map with the one-letter keys of the JSON payload.
+
+The format is detected from the first byte (MQTT 3.1.1 has no content type):
+'{' JSON, 0xA0-0xBB CBOR map, 0x80-0x8F / 0xDE / 0xDF MessagePack map.
+
+Numbers with a fraction are sent as float32 and rounded to 7 significant
+digits here, so 21.5 decodes as 21.5 and not 21.5000001.
+
+Usage:
+    from mqtt.payload_codec import decode_payload
+    data = decode_payload(msg.payload)      # {"t": 21.5, "h": 45.2}
+
+Command line, decodes hex lines "<name> <format> <hex>" as written by
+firmware/b4r/bench/rPayloadCodec (codec_bench --hex):
+    python3 -m mqtt.payload_codec < payloads.txt
+"""
+
+import json
+import math
+import struct
+import sys
+from typing import Any, Tuple
+
+FORMAT_JSON = 0
+FORMAT_CBOR = 1
+FORMAT_MSGPACK = 2
+
+FORMAT_NAMES = {FORMAT_JSON: "json", FORMAT_CBOR: "cbor", FORMAT_MSGPACK: "msgpack"}
+
+
+def detect_format(payload: bytes) -> int:
+    """
+    Format of a payload from its first byte, FORMAT_JSON if not a binary map.
+    """
+    if not payload:
+        return FORMAT_JSON
+    b = payload[0]
+    if 0xA0 <= b <= 0xBB:
+        return FORMAT_CBOR
+    if 0x80 <= b <= 0x8F or b in (0xDE, 0xDF):
+        return FORMAT_MSGPACK
+    return FORMAT_JSON
+
+
+def round_float32(value: float) -> float:
+    """
+    Round a float32 value to the 7 significant digits it carries.
+    """
+    if value == 0 or math.isnan(value) or math.isinf(value):
+        return value
+    return float(f"{value:.7g}")
+
+
+def _cbor_value(data: bytes, pos: int) -> Tuple[Any, int]:
+    """
+    Decode one CBOR item at pos, return (value, next pos).
+    """
+    ib = data[pos]
+    pos += 1
+    major, info = ib >> 5, ib & 0x1F
+
+    if major == 7:
+        if info == 20:
+            return False, pos
+        if info == 21:
+            return True, pos
+        if info in (22, 23):
+            return None, pos
+        if info == 25:
+            return struct.unpack(">e", data[pos:pos + 2])[0], pos + 2
+        if info == 26:
+            return round_float32(struct.unpack(">f", data[pos:pos + 4])[0]), pos + 4
+        if info == 27:
+            return struct.unpack(">d", data[pos:pos + 8])[0], pos + 8
+        raise ValueError(f"CBOR simple value {info} not supported")
+
+    if info < 24:
+        arg = info
+    elif info <= 27:
+        size = 1 << (info - 24)
+        arg = int.from_bytes(data[pos:pos + size], "big")
+        pos += size
+    else:
+        raise ValueError("CBOR indefinite length not supported")
+
+    if major == 0:
+        return arg, pos
+    if major == 1:
+        return -1 - arg, pos
+    if major == 2:
+        return data[pos:pos + arg], pos + arg
+    if major == 3:
+        return data[pos:pos + arg].decode("utf-8"), pos + arg
+    if major == 4:
+        items = []
+        for _ in range(arg):
+            item, pos = _cbor_value(data, pos)
+            items.append(item)
+        return items, pos
+    if major == 5:
+        result = {}
+        for _ in range(arg):
+            key, pos = _cbor_value(data, pos)
+            result[key], pos = _cbor_value(data, pos)
+        return result, pos
+    # major 6: tag, decode the tagged item
+    return _cbor_value(data, pos)
+
+
+def _msgpack_value(data: bytes, pos: int) -> Tuple[Any, int]:
+    """
+    Decode one MessagePack item at pos, return (value, next pos).
+    """
+    b = data[pos]
+    pos += 1
+
+    if b <= 0x7F:
+        return b, pos
+    if b >= 0xE0:
+        return b - 0x100, pos
+    if 0xA0 <= b <= 0xBF:
+        n = b & 0x1F
+        return data[pos:pos + n].decode("utf-8"), pos + n
+    if 0x80 <= b <= 0x8F:
+        return _msgpack_map(data, pos, b & 0x0F)
+    if 0x90 <= b <= 0x9F:
+        return _msgpack_array(data, pos, b & 0x0F)
+
+    if b == 0xC0:
+        return None, pos
+    if b == 0xC2:
+        return False, pos
+    if b == 0xC3:
+        return True, pos
+    if b == 0xCA:
+        return round_float32(struct.unpack(">f", data[pos:pos + 4])[0]), pos + 4
+    if b == 0xCB:
+        return struct.unpack(">d", data[pos:pos + 8])[0], pos + 8
+
+    ints = {0xCC: ">B", 0xCD: ">H", 0xCE: ">I", 0xCF: ">Q", 0xD0: ">b", 0xD1: ">h", 0xD2: ">i", 0xD3: ">q"}
+    if b in ints:
+        size = struct.calcsize(ints[b])
+        return struct.unpack(ints[b], data[pos:pos + size])[0], pos + size
+
+    lengths = {0xD9: 1, 0xDA: 2, 0xDB: 4, 0xC4: 1, 0xC5: 2, 0xC6: 4}
+    if b in lengths:
+        size = lengths[b]
+        n = int.from_bytes(data[pos:pos + size], "big")
+        pos += size
+        raw = data[pos:pos + n]
+        return (raw if 0xC4 <= b <= 0xC6 else raw.decode("utf-8")), pos + n
+    if b in (0xDC, 0xDD, 0xDE, 0xDF):
+        size = 2 if b in (0xDC, 0xDE) else 4
+        n = int.from_bytes(data[pos:pos + size], "big")
+        pos += size
+        return (_msgpack_array if b in (0xDC, 0xDD) else _msgpack_map)(data, pos, n)
+    raise ValueError(f"MessagePack type 0x{b:02X} not supported")
+
+
+def _msgpack_map(data: bytes, pos: int, count: int) -> Tuple[dict, int]:
+    result = {}
+    for _ in range(count):
+        key, pos = _msgpack_value(data, pos)
+        result[key], pos = _msgpack_value(data, pos)
+    return result, pos
+
+
+def _msgpack_array(data: bytes, pos: int, count: int) -> Tuple[list, int]:
+    items = []
+    for _ in range(count):
+        item, pos = _msgpack_value(data, pos)
+        items.append(item)
+    return items, pos
+
+
+def decode_payload(payload: bytes) -> Any:
+    """
+    Decode a JSON, CBOR or MessagePack payload.
+    Raises ValueError if the payload is invalid or has trailing bytes.
+    """
+    fmt = detect_format(payload)
+    if fmt == FORMAT_JSON:
+        return json.loads(payload.decode("utf-8"))
+    try:
+        value, pos = (_cbor_value if fmt == FORMAT_CBOR else _msgpack_value)(payload, 0)
+    except (IndexError, struct.error, UnicodeDecodeError) as e:
+        raise ValueError(f"Truncated or invalid {FORMAT_NAMES[fmt]} payload") from e
+    if pos != len(payload):
+        raise ValueError(f"{len(payload) - pos} trailing bytes after the {FORMAT_NAMES[fmt]} payload")
+    return value
+
+
+def main() -> int:
+    """
+    Decode hex payload lines "<name> <format> <hex>" and check that the
+    binary formats decode to the JSON payload of the same name.
+    """
+    expected = {}
+    failures = 0
+    for line in sys.stdin:
+        parts = line.split()
+        if len(parts) != 3:
+            continue
+        name, fmt, hexdata = parts
+        value = decode_payload(bytes.fromhex(hexdata))
+        if fmt == "json":
+            expected[name] = value
+        elif name in expected and value != expected[name]:
+            print(f"MISMATCH {name} {fmt}: {value} != {expected[name]}")
+            failures += 1
+        print(f"{name:12} {fmt:8} {value}")
+    print("ok" if failures == 0 else f"{failures} mismatches")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -11,7 +11,7 @@ from hmi.tile_button import TileButton
 from hmi.tile_readout import TileReadOut
 from hmi.tile_utils import log
 from hmi.tile_utils import TILE_SIZE_DEFAULT
-from ble.ble_parser import parse_notification  # <-- import parser
+from ble.ble_parser import parse_notification, split_notification  # <-- import parser
 
 class MainWindow(QMainWindow):
     def __init__(self, ble_manager):
@@ -140,12 +140,13 @@ class MainWindow(QMainWindow):
         # Log raw BLE bytes
         log(f"BLE Raw notification: {data.hex().upper()}", self.log_text)
 
-        # Parse into structured dict
-        parsed = parse_notification(data)
+        # Parse each frame into structured dict (a notification may hold a batch)
+        for frame in split_notification(data):
+            parsed = parse_notification(frame)
 
-        # Forward parsed data to GUI
-        if parsed:
-            self.on_ble_notification(parsed)
+            # Forward parsed data to GUI
+            if parsed:
+                self.on_ble_notification(parsed)
 
     def on_ble_notification(self, data: dict):
         """
@@ -12,7 +12,7 @@ Version=4
 '				UART service & characteristics.
 ' Date:         2025-12-06
 ' Author:       Robert W.W. Linn (c) 2025 MIT
-' Dependencies: rWiFiManager, rBLEServer, rGlobalStoreEx
+' Dependencies: rWiFiManager, rBLEServer, rCommandQueue
 ' Description:	Communication layer for message routing via MQTT.
 ' ================================================================
 #End Region
@@ -44,11 +44,33 @@ Private Sub Process_Globals
 	Public CMD_SET_VALUE As Byte 		= 0x03
 	Public CMD_GET_VALUE As Byte 		= 0x04
 	Public CMD_CUSTOM_ACTION As Byte	= 0x05
+	Public CMD_ERROR As Byte			= 0x06
 	
 	' BLE ESP32 Plus BLE Peripheral + GATT Server
 	Private BLE_SERVER_NAME As String 	= "HomeKit32"	'ignore
 	Private BLEServer As BLEServer						'ignore
-	Private MTUSize As UInt = BLEServer.MTU_SIZE_MIN	'ignore
+	' Preferred ATT MTU: 247 gives 244-byte notifications and 239-byte segment chunks in one LL packet
+	Private MTUSize As UInt = BLEServer.MTU_SIZE_DLE	'ignore
+
+	' TX coalescing flush deadline in ms. 0 = every Write is a notification.
+	' If > 0, frames are packed into batch notifications [00][01][Len][Frame...] (see BLE_NOTES).
+	Private TX_FLUSH_DEADLINE_MS As UInt = 0			'ignore
+
+	' Link profile requested after connect (connection interval, latency, timeout, DLE, 2M PHY).
+	' LINK_PROFILE_LOW_LATENCY for fastest servo response, LINK_PROFILE_LOW_POWER for battery clients.
+	Private LINK_PROFILE As Byte = BLEServer.LINK_PROFILE_BALANCED	'ignore
+
+	' Batched ACK interval in ms for sequenced writes without response [00][03][Seq][Frame...].
+	' 0 = no ACK. If > 0, one ACK [00][04][LastSeq][Received][Dropped] is notified per interval.
+	Private ACK_INTERVAL_MS As UInt = 0					'ignore
+
+	' Connectionless telemetry: interval in ms to update the BTHome v2 record in the advertisement.
+	' 0 = off. If > 0, passive listeners receive DHT11, moisture, gas and PIR states without connecting.
+	Private TELEMETRY_INTERVAL_MS As UInt = 0			'ignore
+
+	' Device service with one characteristic per DeviceID (6E4001<ID>-...) next to the UART service.
+	' Clients enabling only some characteristics (e.g. DHT11) receive only those frames.
+	Private DEVICE_CHARACTERISTICS As Boolean = False	'ignore
 End Sub
 
 #if BLE
@@ -56,16 +78,104 @@ End Sub
 ' Initializes BLE
 Public Sub Initialize
 	Log("[CommBLE.Initialize]")
+	' Set before Initialize so advertising carries the preferred interval of the profile
+	BLEServer.LinkProfile = LINK_PROFILE
+	If DEVICE_CHARACTERISTICS Then AddDeviceCharacteristics
 	BLEServer.Initialize(BLE_SERVER_NAME, "BLEServer_NewData", "BLEServer_Error", MTUSize)
-	Log("[CommBLE.Initialize] Done, mtusize=", MTUSize)
+	BLEServer.TxFlushDeadline = TX_FLUSH_DEADLINE_MS
+	BLEServer.AckInterval = ACK_INTERVAL_MS
+	BLEServer.TelemetryInterval = TELEMETRY_INTERVAL_MS
+	Log("[CommBLE.Initialize] Done, mtusize=", MTUSize, ", txflushdeadline=", TX_FLUSH_DEADLINE_MS, ", linkprofile=", LINK_PROFILE)
+	LogFootprint
+End Sub
+
+' AddDeviceCharacteristics
+' Registers one device characteristic per device, must be called before BLEServer.Initialize.
+' The unused buttons have no characteristic.
+Private Sub AddDeviceCharacteristics
+	Dim devices() As Byte = Array As Byte(DEV_YELLOW_LED, DEV_RGB_LED, DEV_SERVO_DOOR, DEV_SERVO_WINDOW, _
+		DEV_BUZZER, DEV_FAN, DEV_DHT11, DEV_GAS_SENSOR, DEV_MOISTURE, DEV_LCD1602, DEV_PIR_SENSOR, DEV_RFID, DEV_SYSTEM)
+	For Each dev As Byte In devices
+		BLEServer.AddDeviceCharacteristic(dev)
+	Next
+	Log("[CommBLE.AddDeviceCharacteristics] count=", BLEServer.DeviceCharacteristicCount)
+End Sub
+
+#Region Telemetry
+' TelemetryClimate
+' Set the DHT11 temperature and humidity of the advertised telemetry record.
+' Parameters:
+'	temp Float - Temperature in C
+'	hum Float - Humidity in %
+Public Sub TelemetryClimate(temp As Float, hum As Float)
+	BLEServer.SetTelemetryClimate(temp, hum)
+End Sub
+
+' TelemetryMoisture
+' Set the moisture of the advertised telemetry record.
+' Parameters:
+'	percent Float - Moisture 0-100%
+Public Sub TelemetryMoisture(percent As Float)
+	BLEServer.SetTelemetryMoisture(percent)
+End Sub
+
+' TelemetryGas
+' Set the gas sensor state of the advertised telemetry record.
+' Parameters:
+'	detected Boolean - True if gas is detected
+Public Sub TelemetryGas(detected As Boolean)
+	BLEServer.SetTelemetryGas(detected)
+End Sub
+
+' TelemetryMotion
+' Set the PIR sensor state of the advertised telemetry record.
+' Parameters:
+'	detected Boolean - True if motion is detected
+Public Sub TelemetryMotion(detected As Boolean)
+	BLEServer.SetTelemetryMotion(detected)
+End Sub
+#End Region
+
+' LogRxSeqStats
+' Logs the sequenced frames (write without response) received and dropped.
+Public Sub LogRxSeqStats
+	Log("[CommBLE.LogRxSeqStats] frames=", BLEServer.RxSeqFrameCount, _
+		", dropped=", BLEServer.RxSeqDropCount, _
+		", ackinterval=", BLEServer.AckInterval)
+End Sub
+
+' LogLink
+' Logs the link values negotiated with the connected client.
+' Interval in 1.25 ms units, timeout in ms, data length in octets, phy 1=1M 2=2M.
+Public Sub LogLink
+	Log("[CommBLE.LogLink] profile=", BLEServer.LinkProfile, _
+		", interval=", BLEServer.LinkInterval, _
+		", latency=", BLEServer.LinkLatency, _
+		", timeout=", BLEServer.LinkTimeout, _
+		", datalength=", BLEServer.LinkDataLength, _
+		", phy=", BLEServer.LinkPhy)
+End Sub
+
+' LogFootprint
+' Logs the BLE stack in use with init duration and free heap after Initialize.
+' Used to compare the Bluedroid and NimBLE backends (see docs/BLE_NOTES.md).
+Public Sub LogFootprint
+	Dim backend As String = "Bluedroid"
+	If BLEServer.Backend == BLEServer.BACKEND_NIMBLE Then backend = "NimBLE"
+	Log("[CommBLE.LogFootprint] backend=", backend, _
+		", initms=", BLEServer.InitDuration, _
+		", freeheap=", BLEServer.FreeHeapAfterInit)
 End Sub
 
 ' Handle new data received from connected client.
+' Raised from the main loop by the BLEServer RX frame ring, one call per frame.
 ' Data format: [DeviceID][Command][Payload...]
 ' Parameters:
 ' 	buffer - Byte array holding the data send by the client
 Private Sub BLEServer_NewData(buffer() As Byte)
-	Log("[CommBLE.BLEServer_NewData] buffer HEX=", Convert.BytesToHex(buffer))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "CommBLE.NewData", buffer)
+	#End If
 
 	' Check buffer lenght. Expect at least 2.
 	If buffer.Length < 2 Then Return
@@ -73,11 +183,9 @@ Private Sub BLEServer_NewData(buffer() As Byte)
 	' Get the device id	
 	Dim idx As Byte = buffer(0)
 		
-	' Store the payload in the global store buffer
-	GlobalStoreHandler.Put(buffer)
-	
-	' Dispatch to handler (slightly delayed to avoid blocking)
-	CallSubPlus("BLEDispatch", 50, idx)
+	' Queue the frame with the sender connection id, dispatched from the main loop by GlobalStoreHandler.
+	' A full queue rejects the frame and sends a SYSTEM error frame to the sender (see WriteError).
+	GlobalStoreHandler.Put(GlobalStoreHandler.SOURCE_BLE, idx, BLEServer.LastConnId, buffer)
 End Sub
 
  'Handle BLE server error.
@@ -93,10 +201,21 @@ Private Sub BLEServer_Error(code As Byte)
 			Log("[CommBLE.BLEServer_Error][ERROR] Write failed: No valid characteristic.")
 		Case BLEServer.ERROR_EMPTY_DATA
 			Log("[CommBLE.BLEServer_Error][ERROR] Write failed: No data.")
+		Case BLEServer.ERROR_RX_OVERFLOW
+			Log("[CommBLE.BLEServer_Error][ERROR] RX ring full, frames dropped=", BLEServer.RxOverflowCount, ", highwater=", BLEServer.RxHighWater)
+		Case BLEServer.ERROR_REASSEMBLY
+			Log("[CommBLE.BLEServer_Error][ERROR] Segmented message discarded, errors=", BLEServer.RxReassemblyErrors)
+		Case BLEServer.ERROR_MESSAGE_TOO_LARGE
+			Log("[CommBLE.BLEServer_Error][ERROR] Write failed: Message exceeds 255 segments.")
+		Case BLEServer.ERROR_INVALID_LINK_PROFILE
+			Log("[CommBLE.BLEServer_Error][ERROR] Invalid link profile.")
+		Case BLEServer.ERROR_INVALID_DEVICE_CHARACTERISTIC
+			Log("[CommBLE.BLEServer_Error][ERROR] Device characteristic not added (after Initialize, 0x00, duplicate or table full).")
 	End Select
 End Sub
 
-' Write data to the connected client.
+' Write data to all connected clients that enabled notifications.
+' The frame may be coalesced with other frames, see TX_FLUSH_DEADLINE_MS.
 ' Parameters:
 ' 	data - Byte array containing data fo the connected client
 Public Sub BLEServer_Write(data() As Byte)
@@ -104,54 +223,71 @@ Public Sub BLEServer_Write(data() As Byte)
 		Log("[ERROR][CommBLE.BLEServer_Write] No data.")
 		Return
 	End If
-	Log("[CommBLE.BLEServer_Write] data=", Convert.ByteConv.HexFromBytes(data))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "CommBLE.Write", data)
+	#End If
 	BLEServer.Write(data)
 End Sub
 
-' Dispatch BLE message to the relevant device handler.
-' [DeviceID][CommandID][Data...]
-' Notes:
-'	Buttons not used - see MenuHandler
+' Write data to all connected clients without coalescing.
 ' Parameters:
-'	deviceid - Byte Device ID as defined in the constants.
-Private Sub BLEDispatch(deviceid As Byte)
-	Log("[CommBLE.BLEDispatch] deviceid=",deviceid)
-	Select deviceid
-		Case 0
-			' Reserved
-		Case DEV_YELLOW_LED
-			DevYellowLed.ProcessBLE(GlobalStoreHandler.Index)
-		Case DEV_RGB_LED
-			DevRGBLed.ProcessBLE(GlobalStoreHandler.Index)
-		Case DEV_BUTTON_LEFT
-			' DevButtons.BtnLeftAction(GlobalStoreHandler.Index)
-		Case DEV_BUTTON_RIGHT
-			' DevButtons.BtnRightAction(GlobalStoreHandler.Index)
-		Case DEV_SERVO_DOOR
-			DevServoDoor.ProcessBLE(GlobalStoreHandler.Index)
-		Case DEV_SERVO_WINDOW
-			DevServoWindow.ProcessBLE(GlobalStoreHandler.Index)
-		Case DEV_BUZZER
-			DevBuzzer.ProcessBLE(GlobalStoreHandler.Index)
-		Case DEV_FAN
-			DevFan.ProcessBLE(GlobalStoreHandler.Index)
-		Case DEV_DHT11
-			DevDHT11.ProcessBLE(GlobalStoreHandler.Index)
-		Case DEV_GAS_SENSOR
-			DevGasSensor.ProcessBLE(GlobalStoreHandler.Index)
-		Case DEV_MOISTURE
-			DevMoisture.ProcessBLE(GlobalStoreHandler.Index)
-		Case DEV_LCD1602
-			DevLCD1602.ProcessBLE(GlobalStoreHandler.Index)
-		Case DEV_PIR_SENSOR
-			DevPIRSensor.ProcessBLE(GlobalStoreHandler.Index)
-		Case DEV_RFID
-			DevRFID.ProcessBLE(GlobalStoreHandler.Index)
-		Case DEV_SYSTEM
-			DevSystem.ProcessBLE(GlobalStoreHandler.Index)
-		Case Else
-			'
-	End Select
+' 	data - Byte array containing data fo the connected client
+Public Sub BLEServer_WriteImmediate(data() As Byte)
+	If data == Null Then
+		Log("[ERROR][CommBLE.BLEServer_WriteImmediate] No data.")
+		Return
+	End If
+	BLEServer.WriteImmediate(data)
+End Sub
+
+' Write data to the client that sent the command being dispatched only.
+' Other connected clients (e.g. wall HMI and phone) do not receive it.
+' Parameters:
+' 	data - Byte array containing data for the requesting client
+Public Sub BLEServer_WriteReply(data() As Byte)
+	If data == Null Then
+		Log("[ERROR][CommBLE.BLEServer_WriteReply] No data.")
+		Return
+	End If
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "CommBLE.WriteReply", data)
+	Main.Logger.Value(Main.Logger.LEVEL_DEBUG, "CommBLE.ReplyConnId", GlobalStoreHandler.CommandContext)
+	#End If
+	BLEServer.WriteTo(GlobalStoreHandler.CommandContext, data)
+End Sub
+
+' Write a SYSTEM error frame to the client that sent the rejected frame.
+' Frame: [FF][06][Code][DeviceID] (see BLE_NOTES SYSTEM).
+' Parameters:
+'	code - Command queue error code
+'	deviceid - Device ID of the rejected frame
+Public Sub WriteError(code As Byte, deviceid As Byte)
+	BLEServer.WriteTo(BLEServer.LastConnId, Array As Byte(DEV_SYSTEM, CMD_ERROR, code, deviceid))
+End Sub
+
+' Log the connected clients with their notify subscription and notification counters.
+Public Sub LogConnections
+	Log("[CommBLE.LogConnections] connections=", BLEServer.ConnectionCount, "/", BLEServer.MAX_CONNECTIONS)
+	For i = 0 To BLEServer.MAX_CONNECTIONS - 1
+		Dim connid As UInt = BLEServer.ConnIdAt(i)
+		If connid <> BLEServer.CONN_ID_ALL Then
+			Log("[CommBLE.LogConnections] connid=", connid, _
+				", subscribed=", BLEServer.IsSubscribed(connid), _
+				", sent=", BLEServer.NotifySentCount(connid), _
+				", dropped=", BLEServer.NotifyDroppedCount(connid))
+		End If
+	Next
+	If BLEServer.DeviceCharacteristicCount > 0 Then
+		Log("[CommBLE.LogConnections] devicecharacteristics=", BLEServer.DeviceCharacteristicCount, _
+			", devicenotified=", BLEServer.DeviceNotifyCount)
+	End If
+End Sub
+
+' Log the TX coalescing statistics.
+Public Sub LogTxStats
+	Log("[CommBLE.LogTxStats] mtu=", BLEServer.NegotiatedMTU, _
+		", flushes=", BLEServer.TxFlushCount, ", frames=", BLEServer.TxFrameCount, _
+		", lastframes=", BLEServer.TxLastFlushFrames, ", lastbytes=", BLEServer.TxLastFlushBytes)
 End Sub
 #End Region
 
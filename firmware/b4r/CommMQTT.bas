@@ -11,13 +11,16 @@ Version=4
 ' Brief:        Handle MQTT communication.
 ' Date:         2025-11-12
 ' Author:       Robert W.W. Linn (c) 2025 MIT
-' Dependencies: rWiFiManager, rMQTT, rGlobalStoreEx
+' Dependencies: rWiFiManager, rMqttConnector, rCommandQueue
 ' Description:	Communication layer for message routing via MQTT.
+'				The connection is brought up in the background (MQTTClient.Link_Step),
+'				the main loop and the local buttons (MenuHandler) are never blocked.
 ' ================================================================
 #End Region
 
 Private Sub Process_Globals
-
+	' Connection error shown on the LCD, cleared when ready
+	Private LinkErrorShown As Boolean = False
 End Sub
 
 ' Initialize
@@ -25,43 +28,13 @@ End Sub
 Public Sub Initialize
 	Log("[CommMQTT.Initialize][I] Starting MQTT communication...")
 
-	' 1. Connect to WiFi
-	WiFiMgr.Connected = WiFiMgr.Connect
-	If Not(WiFiMgr.Connected) Then
-		Log("[CommMQTT.Initialize][E] WiFi connection failed")
-		DevLCD1602.ClearBottomRow
-		DevLCD1602.WriteAt(0, DevLCD1602.LCD_ROW_BOTTOM, "ERR: WiFi")
-		Return
-	End If
+	' Register the generic command topic handler (see GlobalStoreHandler.Registry)
+	GlobalStoreHandler.Registry.RegisterMQTT(MQTTTopics.GetTopicIndex(MQTTTopics.TOPIC_COMMAND), "ProcessMQTT")
 
-	' 2. Connect to MQTT broker
+	' Start the connection state machine: WiFi > broker > subscriptions (see MQTTClient.Link_Step)
 	MQTTClient.Initialize(MQTTClient.ID, WiFiMgr.Client.Stream)
-	MQTTClient.Connect(0)
-	Delay(MQTTClient.DELAY_AFTER_TASK)
-
-	' 3. Subscribe to topics after connecting (see MQTTTopics)
-	If MQTTClient.Connected Then
-		MQTTClient.Subscribe(Array As String(MQTTTopics.TOPIC_COMMAND, _
-											 MQTTTopics.TOPIC_YELLOW_LED_SET, _
-											 MQTTTopics.TOPIC_RGB_LED_SET, _ 
-											 MQTTTopics.TOPIC_BUTTON_LEFT_ACTION, _ 
-											 MQTTTopics.TOPIC_BUTTON_RIGHT_ACTION, _ 
-											 MQTTTopics.TOPIC_SERVO_DOOR_SET, _ 
-											 MQTTTopics.TOPIC_SERVO_WINDOW_SET, _ 
-											 MQTTTopics.TOPIC_BUZZER_SET, _ 
-											 MQTTTopics.TOPIC_FAN_SET, _ 
-											 MQTTTopics.TOPIC_DHT11_GET, _ 
-											 MQTTTopics.TOPIC_GAS_SENSOR_GET, _ 
-											 MQTTTopics.TOPIC_MOISTURE_GET, _ 
-											 MQTTTopics.TOPIC_LCD_SET))
-		Delay(MQTTClient.DELAY_AFTER_TASK)
-		Log("[CommMQTT.Initialize][I] MQTT connected and topics subscribed")
-	Else
-		Log("[CommMQTT.Initialize][E] MQTT broker connection failed")
-		DevLCD1602.ClearBottomRow
-		DevLCD1602.WriteAt(0, DevLCD1602.LCD_ROW_BOTTOM, "ERR: MQTT")
-	End If
-	Log("[CommMQTT.Initialize] Done")
+	WiFiMgr.Begin
+	Log("[CommMQTT.Initialize] Done, connecting in the background")
 End Sub
 
 #Region MQTT Events
@@ -70,52 +43,41 @@ Public Sub MQTT_MessageArrived(topic As String, payload() As Byte)
 	' Get the topic index from the topic table
 	Dim idx As Byte = MQTTTopics.GetTopicIndex(topic)
 
-	' Check if topic index found
+	' Check if topic index found, wildcard subscriptions also deliver topics without handler
 	If idx == MQTTTopics.TOPIC_NOT_FOUND Then
 		Log("[CommMQTT.MQTT_MessageArrived][E] Unknown topic: ", topic)
+		Return
 	End If
 
-	' Store the payload in the global store buffer
-	GlobalStoreHandler.Put(payload)
-
-	' Dispatch to handler (slightly delayed to avoid blocking)
-	CallSubPlus("MQTTDispatch", 50, idx)
+	' Queue the payload, dispatched from the main loop by GlobalStoreHandler
+	Dim queued As Boolean = GlobalStoreHandler.Put(GlobalStoreHandler.SOURCE_MQTT, idx, 0, payload)
 	
-	Log("[CommMQTT.MQTT_MessageArrived][I] topic=",topic, ", index=", idx, ", payload=",payload, ", storeindex=", GlobalStoreHandler.Index)
+	Log("[CommMQTT.MQTT_MessageArrived][I] topic=",topic, ", index=", idx, ", payload=",payload, ", queued=", queued)
+End Sub
+
+' Show the connection errors on the LCD bottom row, called by MQTTClient.Link_StateChanged.
+' Parameters:
+'	state - MqttConnector state
+Public Sub LinkStateChanged(state As Byte)
+	If state = MQTTClient.Link.STATE_BACKOFF And Not(LinkErrorShown) Then
+		DevLCD1602.ClearBottomRow
+		DevLCD1602.WriteAt(0, DevLCD1602.LCD_ROW_BOTTOM, IIf(WiFiMgr.Connected, "ERR: MQTT", "ERR: WiFi"))
+		LinkErrorShown = True
+	Else If state = MQTTClient.Link.STATE_READY And LinkErrorShown Then
+		DevLCD1602.ClearBottomRow
+		LinkErrorShown = False
+	End If
 End Sub
 
-' Dispatch MQTT message to the relevant device handler.
-' Ensure to align with the MQTTTopics TopicTable.
-Private Sub MQTTDispatch(topicindex As Byte)
-	#If MQTT
-	Select topicindex
-		Case 0
-			ProcessMQTT(GlobalStoreHandler.Index)
-		Case 1
-			DevYellowLed.ProcessMQTT(GlobalStoreHandler.Index)
-		Case 2
-			DevRGBLed.ProcessMQTT(GlobalStoreHandler.Index)
-		Case 3
-			' DevButtons.BtnLeftAction(GlobalStoreHandler.Index)
-		Case 4
-			' DevButtons.BtnRightAction(GlobalStoreHandler.Index)
-		Case 5
-			DevServoDoor.ProcessMQTT(GlobalStoreHandler.Index)
-		Case 6
-			DevServoWindow.ProcessMQTT(GlobalStoreHandler.Index)
-		Case 7
-			DevBuzzer.ProcessMQTT(GlobalStoreHandler.Index)
-		Case 8
-			DevFan.ProcessMQTT(GlobalStoreHandler.Index)
-		Case 9
-			DevDHT11.ProcessMQTT(GlobalStoreHandler.Index)
-		Case 10
-		Case 11
-			DevMoisture.ProcessMQTT(GlobalStoreHandler.Index)
-		Case 12
-			DevLCD1602.ProcessMQTT(GlobalStoreHandler.Index)
-	End Select
-	#End If
+' Publish a command queue error for a rejected message to TOPIC_SYSTEM_ERROR.
+' Parameters:
+'	code - Command queue error code
+'	topicindex - Topic index of the rejected message
+Public Sub PublishError(code As Byte, topicindex As Byte)
+	MQTTTopics.TemplateSystemError.SetText("M", "queue")
+	MQTTTopics.TemplateSystemError.SetLong("C", code)
+	MQTTTopics.TemplateSystemError.SetLong("I", topicindex)
+	MQTTClient.PublishTemplate(MQTTTopics.TOPIC_SYSTEM_ERROR, MQTTTopics.TemplateSystemError, True)
 End Sub
 #End Region
 
@@ -129,7 +91,8 @@ Public Sub ProcessMQTT(storeindex As Byte)
 	Log("[DeviceHandlers.SetCommand] storeindex=", storeindex, ", payload=", payload)
 
 	' Det the key device
-	Dim device() As Byte = MQTTClient.GetTextFromKey(payload, MQTTTopics.KEY_DEVICE)
+	MQTTClient.ParsePayload(payload)
+	Dim device() As Byte = MQTTClient.Json.GetText(MQTTTopics.KEY_DEVICE)
 	Log("[DeviceHandlers.SetCommand] device=", Convert.ByteConv.StringFromBytes(device))
 	
 '	' Select the device
@@ -11,23 +11,18 @@ Version=4
 ' Brief:       	Handle all buttons press & released.
 ' Date:        	2025-11-12
 ' Author:      	Robert W.B. Linn (c) 2025 MIT
-' Dependencies: rGlobalStoreEx.b4x
+' Dependencies: rGlobalStoreEx.b4x, rGpioInput
 ' Description:	Handles various button state changes.
 ' Hardware:		https://wiki.keyestudio.com/Ks0029_keyestudio_Digital_Push_Button
 ' ================================================================
 #End Region
 
 Private Sub Process_Globals
-	Private DEBOUNCE_MS As UInt = 800
-
-	Private BtnLeft As Pin
-	Private BtnRight As Pin
-	
-	' Firsttime flag to avoid button state change for state true (released)
-	Private BtnLeftFirstTime As Boolean = True
-	Private BtnRightFirstTime As Boolean = True
-	Private BtnLeftLastChange As ULong = 0
-	Private BtnRightLastChange As ULong = 0
+	' Contact bounce: edges less than DEBOUNCE_US apart are one press or release
+	Private DEBOUNCE_US As ULong = 30000
+
+	Private BtnLeft As GpioInput
+	Private BtnRight As GpioInput
 End Sub
 
 ' Initialize
@@ -36,33 +31,23 @@ End Sub
 '   btnleftpinnr - GPIO pin number
 '   btnrightpinnr - GPIO pin number
 Public Sub Initialize(btnleftpinnr As Byte, btnrightpinnr As Byte)
-	BtnLeft.Initialize(DeviceMgr.BTN_LEFT_PIN, BtnLeft.MODE_INPUT)
+	' Buttons state change events (not raised for the state at start)
+	BtnLeft.Initialize(DeviceMgr.BTN_LEFT_PIN, BtnLeft.MODE_INPUT, "BtnLeft_StateChanged")
+	BtnLeft.DebounceMicros = DEBOUNCE_US
 	Log("[DevButtons.Initialize][I] BtnLeft OK, pin=", btnleftpinnr)
-	BtnRight.Initialize(DeviceMgr.BTN_RIGHT_PIN, BtnRight.MODE_INPUT)
+	BtnRight.Initialize(DeviceMgr.BTN_RIGHT_PIN, BtnRight.MODE_INPUT, "BtnRight_StateChanged")
+	BtnRight.DebounceMicros = DEBOUNCE_US
 	Log("[DevButtons.Initialize][I] BtnRight OK, pin=", btnrightpinnr)
-
-	' Add buttons state change listen
-	BtnLeft.AddListener("BtnLeft_StateChanged")
-	BtnRight.AddListener("BtnRight_StateChanged")
 End Sub
 
 #Region BUTTONEVENTS
 ' Handle button state changes: Pressed=state 0; Released=state 1
-' Use FirstTime flag to avoid handling buttom state 1
+' The states are debounced by GpioInput, one event per press and per release
 
 ' Log the btn left state change.
 Private Sub BtnLeft_StateChanged(state As Boolean)
 	Dim payload As String
 
-	If BtnLeftFirstTime Then
-		BtnLeftFirstTime = Not(BtnLeftFirstTime)
-		Return
-	End If
-
-	' Debounce: ignore changes faster than NNN ms
-	If (Millis - BtnLeftLastChange) < DEBOUNCE_MS Then Return
-	BtnLeftLastChange = Millis
-
 	Log("[DevButtons.BtnLeft_StateChanged] state=",state)
 
 	If state Then
@@ -78,15 +63,6 @@ End Sub
 Private Sub BtnRight_StateChanged(state As Boolean)
 	Dim payload As String
 
-	If BtnRightFirstTime Then
-		BtnRightFirstTime = Not(BtnRightFirstTime)
-		Return
-	End If
-
-	' Debounce: ignore changes faster than NNN ms
-	If (Millis - BtnRightLastChange) < DEBOUNCE_MS Then Return
-	BtnRightLastChange = Millis
-
 	Log("[DevButtons.BtnRight_StateChanged] state=", state)
 
 	If state == False Then
@@ -29,6 +29,14 @@ End Sub
 Public Sub Initialize(pinnr As Byte)
 	Buzzer.Initialize(pinnr)
 	Log("[DevBuzzer.Initialize][I] OK, pin=", pinnr)
+
+	' Register the transport handlers (see GlobalStoreHandler.Registry)
+	#If BLE
+	GlobalStoreHandler.Registry.RegisterBLE(CommBLE.DEV_BUZZER, "ProcessBLE")
+	#End If
+	#If MQTT
+	GlobalStoreHandler.Registry.RegisterMQTT(MQTTTopics.GetTopicIndex(MQTTTopics.TOPIC_BUZZER_SET), "ProcessMQTT")
+	#End If
 End Sub
 
 ' ------------------------------------------------
@@ -69,10 +77,11 @@ Public Sub ProcessMQTT(storeindex As Byte)
 	Log("[DevBuzzer.ProcessMQTT] storeindex=", storeindex, ", payload=", payload)
 
 	' Get the tone and duration
-	Dim tone As Double = MQTTClient.GetNumberFromKey(payload, MQTTTopics.KEY_TONE)
-	Dim duration As Double = MQTTClient.GetNumberFromKey(payload, MQTTTopics.KEY_DURATION)
-	Dim alarm As Double = MQTTClient.GetNumberFromKey(payload, MQTTTopics.KEY_ALARM)
-	Dim repeats As Double = MQTTClient.GetNumberFromKey(payload, MQTTTopics.KEY_REPEATS)
+	MQTTClient.ParsePayload(payload)
+	Dim tone As Double = MQTTClient.Json.GetDouble(MQTTTopics.KEY_TONE, -1)
+	Dim duration As Double = MQTTClient.Json.GetDouble(MQTTTopics.KEY_DURATION, -1)
+	Dim alarm As Double = MQTTClient.Json.GetDouble(MQTTTopics.KEY_ALARM, -1)
+	Dim repeats As Double = MQTTClient.Json.GetDouble(MQTTTopics.KEY_REPEATS, -1)
 	Log("[DevBuzzer.Set] tone=", tone, ", duration=", duration, ", alarm=", alarm, ", repeats=", repeats)
 	
 	' If no alarm melody then play tone
@@ -129,7 +138,9 @@ Public Sub ProcessBLE(storeindex As Byte)
 	If Not(IsEnabled) Then Return
 	
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
-	Log("[DevBuzzer.ProcessBLE] storeindex=", storeindex, ", payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevBuzzer.ProcessBLE", payload)
+	#End If
 	' [DevBuzzer.ProcessBLE] storeindex=1, payload=
 	
 	' Get the command and the value
@@ -165,7 +176,9 @@ End Sub
 Public Sub WriteToBLE(command As Byte, state As Boolean)
 	Dim payload() As Byte = Array As Byte(CommBLE.DEV_BUZZER, command, Convert.BoolToByte(state))
 	CommBLE.BLEServer_Write(payload)
-	Log("[DevBuzzer.WriteToBLE] payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevBuzzer.WriteToBLE", payload)
+	#End If
 End Sub
 #End Region
 #End If
@@ -11,14 +11,27 @@ Version=4
 ' Brief:        Reads sensor temperature & humidity values (event or on-demand).
 ' Date:         2025-11-13
 ' Author:       Robert W.B. Linn (c) 2025 MIT
-' Dependencies: rGlobalStoreEx, rDHTESP
+' Dependencies: rGlobalStoreEx, rESP32DHT, rSensorFilter, rScheduler
 ' Description:	Temperature & humidity values retrieval via callback event or direct read.
+'				The sensor is read without blocking (rESP32DHT capture backend): the edges are
+'				captured by an ISR and decoded on the main loop, interrupts stay enabled.
+'				Temperature / Humidity return the values of the last read.
+'				The event is raised when a filtered value leaves its deadband (a reading toggling
+'				between two degrees raises no event), at least every 5 minutes.
 ' Hardware:		https://https://wiki.keyestudio.com/Ks0034_keyestudio_DHT11_Temperature_and_Humidity_Sensor
 ' ================================================================
 #End Region
 
 Private Sub Process_Globals
 	Private Sensor As ESP32DHT
+
+	' Event filter: median of 3 reads (1 s each), DHT11 resolution 1 C / 1 %
+	Private FILTER_MEDIAN As Byte			= 3
+	Private TEMPERATURE_DEADBAND As Double	= 1
+	Private HUMIDITY_DEADBAND As Double		= 2
+	Private DEADBAND_HYSTERESIS As Double	= 1
+	Private EVENT_MIN_INTERVAL As ULong		= 5000
+	Private EVENT_MAX_INTERVAL As ULong		= 300000
 End Sub
 
 ' Initialize
@@ -27,7 +40,21 @@ End Sub
 '   pinnr - GPIO pin number (Analog)
 Public Sub Initialize(pinnr As Byte)
 	Sensor.Initialize(Sensor.DHT11, pinnr, "Sensor_StateChanged")
-	Log("[DevDHT11.Initialize][I] OK, pin=", pinnr)
+	Sensor.SetFilter(Sensor.CHANNEL_TEMPERATURE, FILTER_MEDIAN, 1)
+	Sensor.SetFilter(Sensor.CHANNEL_HUMIDITY, FILTER_MEDIAN, 1)
+	Sensor.SetDeadband(Sensor.CHANNEL_TEMPERATURE, TEMPERATURE_DEADBAND, 0, DEADBAND_HYSTERESIS)
+	Sensor.SetDeadband(Sensor.CHANNEL_HUMIDITY, HUMIDITY_DEADBAND, 0, DEADBAND_HYSTERESIS)
+	Sensor.MinInterval = EVENT_MIN_INTERVAL
+	Sensor.MaxInterval = EVENT_MAX_INTERVAL
+	Log("[DevDHT11.Initialize][I] OK, pin=", pinnr, ", backend=", Sensor.Backend)
+
+	' Register the transport handlers (see GlobalStoreHandler.Registry)
+	#If BLE
+	GlobalStoreHandler.Registry.RegisterBLE(CommBLE.DEV_DHT11, "ProcessBLE")
+	#End If
+	#If MQTT
+	GlobalStoreHandler.Registry.RegisterMQTT(MQTTTopics.GetTopicIndex(MQTTTopics.TOPIC_DHT11_GET), "ProcessMQTT")
+	#End If
 End Sub
 
 #Region Device Control
@@ -50,6 +77,7 @@ Private Sub Sensor_StateChanged(temp As Float, hum As Float)
 
 	#If BLE
 	WriteToBLE(temp, hum)
+	CommBLE.TelemetryClimate(temp, hum)
 	#End If
 End Sub
 
@@ -126,15 +154,17 @@ End Sub
 '	temp - Temperature
 '	hum - Humidity
 Private Sub PublishToMQTT(temp As Float, hum As Float)
-	Dim t As String = temp
-	Dim h As String = hum
-	Dim payload() As Byte = Convert.ReplaceString(MQTTTopics.PAYLOAD_DHT11_STATUS, "#T", t)
-	payload = Convert.ReplaceString(payload, "#H", h)
-	
+	' Failed reads (NaN) are published as null
+	MQTTClient.Snapshot.SetFloat(MQTTTopics.SNAPSHOT_TEMPERATURE, temp)
+	MQTTClient.Snapshot.SetFloat(MQTTTopics.SNAPSHOT_HUMIDITY, hum)
+	MQTTTopics.TemplateDHT11Status.SetFloat("T", temp, 1)
+	MQTTTopics.TemplateDHT11Status.SetFloat("H", hum, 1)
+
 	' Publish
-	MQTTClient.Publish(Array As String(MQTTTopics.TOPIC_DHT11_STATUS), _
-					   Array As String(Convert.ByteConv.StringFromBytes(payload)))
-	Log("[DevDHT11.PublishToMQTT][I] json=", payload)
+	MQTTClient.PublishTemplate(MQTTTopics.TOPIC_DHT11_STATUS, MQTTTopics.TemplateDHT11Status, True)
+	#If LOG_DEBUG
+	Main.Logger.Value(Main.Logger.LEVEL_DEBUG, "DevDHT11.PublishToMQTT t", temp)
+	#End If
 End Sub
 #End Region
 #End If
@@ -154,7 +184,9 @@ End Sub
 '   storeindex - Index of the global store buffer.
 Public Sub ProcessBLE(storeindex As Byte)
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
-	Log("[DevDHT11.ProcessBLE] storeindex=", storeindex, ", payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevDHT11.ProcessBLE", payload)
+	#End If
 
 	' Get the command and the value
 	Dim command As Byte = payload(1)
@@ -190,7 +222,9 @@ Public Sub WriteToBLE(temp As Float, hum As Float)
 	data(1) = h
 	Dim payload() As Byte = Array As Byte(CommBLE.DEV_DHT11, CommBLE.CMD_GET_VALUE, data(0), data(1))
 	CommBLE.BLEServer_Write(payload)
-	Log("[DevDHT11.WriteToBLE] t=", t, ", h=", h, ", payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevDHT11.WriteToBLE", payload)
+	#End If
 	' [DevDHT11.WriteToBLE] t=19, h=61, payload=0904133D
 End Sub
 #End Region
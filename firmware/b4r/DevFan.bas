@@ -39,6 +39,14 @@ Public Sub Initialize(directionpinnr As Byte, speedpinnr As Byte)
 	SpeedPin.Initialize(speedpinnr, SpeedPin.MODE_OUTPUT)
 	
 	Log("[DevFan.Initialize][I] OK, directionpin=", directionpinnr, ", speedpin=", speedpinnr)
+
+	' Register the transport handlers (see GlobalStoreHandler.Registry)
+	#If BLE
+	GlobalStoreHandler.Registry.RegisterBLE(CommBLE.DEV_FAN, "ProcessBLE")
+	#End If
+	#If MQTT
+	GlobalStoreHandler.Registry.RegisterMQTT(MQTTTopics.GetTopicIndex(MQTTTopics.TOPIC_FAN_SET), "ProcessMQTT")
+	#End If
 End Sub
 
 ' ------------------------------------------------
@@ -61,6 +69,9 @@ Public Sub Set(state As Boolean)
 		SpeedPin.analogWrite(0)
 		IsRotating = False
 	End If
+	#If MQTT
+	MQTTClient.Snapshot.SetLong(MQTTTopics.SNAPSHOT_FAN, IIf(state, 255, 0))
+	#End If
 	Log("[DevFan.Set] state=", state)
 End Sub
 
@@ -98,7 +109,8 @@ End Sub
 Public Sub ProcessMQTT(storeindex As Byte)
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
 
-	Dim Speed As Double = MQTTClient.GetNumberFromKey(payload, MQTTTopics.KEY_STATE)
+	MQTTClient.ParsePayload(payload)
+	Dim Speed As Double = MQTTClient.Json.GetDouble(MQTTTopics.KEY_STATE, -1)
 	Log("[DevFan.ProcessMQTT] storeindex=", storeindex, ", payload=", payload, ", speed=", Speed)
 
 	If Speed < 0 Or Speed > 1023 Then Return	' Safety check
@@ -111,11 +123,11 @@ Public Sub ProcessMQTT(storeindex As Byte)
 	End If
 	SpeedPin.analogWrite(Round(Speed))
 
-	Dim speedstr As String = Speed
-	Dim payload() As Byte = Convert.ReplaceString(MQTTTopics.PAYLOAD_FAN_STATUS, "#S", speedstr)
-	MQTTClient.Publish(Array As String(MQTTTopics.TOPIC_FAN_STATUS), _
-					   Array As String(Convert.ByteConv.StringFromBytes(payload)))
-	Log("[DevFan.ProcessMQTT][I] json=", Convert.ByteConv.StringFromBytes(payload))
+	' Publish the applied speed
+	MQTTClient.Snapshot.SetLong(MQTTTopics.SNAPSHOT_FAN, Round(Speed))
+	MQTTTopics.TemplateFanStatus.SetLong("S", Round(Speed))
+	MQTTClient.PublishTemplate(MQTTTopics.TOPIC_FAN_STATUS, MQTTTopics.TemplateFanStatus, True)
+	Log("[DevFan.ProcessMQTT][I] speed=", Round(Speed))
 End Sub
 
 #End Region
@@ -154,7 +166,9 @@ End Sub
 '   storeindex - Index of the global store buffer.
 Public Sub ProcessBLE(storeindex As Byte)
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
-	Log("[DevFan.ProcessBLE] storeindex=", storeindex, ", payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevFan.ProcessBLE", payload)
+	#End If
 	' [DevFan.ProcessBLE] storeindex=1, payload=0803FF
 	Dim command As Byte = payload(1)
 	Select command
@@ -178,7 +192,9 @@ End Sub
 Public Sub WriteToBLE(command As Byte, value As Byte)
 	Dim payload() As Byte = Array As Byte(CommBLE.DEV_FAN, command, value)
 	CommBLE.BLEServer_Write(payload)
-	Log("[DevFan.WriteToBLE] payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevFan.WriteToBLE", payload)
+	#End If
 End Sub
 #End Region
 #End If
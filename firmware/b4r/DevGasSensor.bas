@@ -11,7 +11,7 @@ Version=4
 ' Brief:       	Handles the Keyestudio analog gas sensor (digital read mode).
 ' Date:        	2025-11-13
 ' Author:      	Robert W.B. Linn (c) 2025 MIT
-' Dependencies:	rGlobalStoreEx, rMQTT
+' Dependencies:	rGlobalStoreEx, rMQTT, rGpioInput
 ' Description:	Reads the gas detection state (digital 0/1) and publishes it via MQTT.
 '				The analog gas sensor is used as a digital detector:
 '     			- LOW (0)  > gas detected
@@ -21,48 +21,47 @@ Version=4
 #End Region
 
 Private Sub Process_Globals
-	Private Sensor As Pin
-	Private PrevState As Boolean = False
-	Private FirstTime As Boolean = True
+	' Edges less than DEBOUNCE_US apart are one change (comparator chatter at the threshold)
+	Private DEBOUNCE_US As ULong = 100000
+
+	Private Sensor As GpioInput
 End Sub
 
 ' Initialize
-' Initializes the gas sensor pin and attaches a listener.
+' Initializes the gas sensor pin and attaches the edge interrupt.
 ' Parameters:
 '   pinnr - GPIO pin number (digital input)
 Public Sub Initialize(pinnr As Byte)
-	Sensor.Initialize(pinnr, Sensor.MODE_INPUT)
-	Sensor.AddListener("Sensor_StateChanged")
+	Sensor.Initialize(pinnr, Sensor.MODE_INPUT, "Sensor_StateChanged")
+	Sensor.DebounceMicros = DEBOUNCE_US
 	Log("[DevGasSensor.Initialize][I] OK, pin=", pinnr)
+
+	' Register the transport handlers (see GlobalStoreHandler.Registry)
+	#If BLE
+	GlobalStoreHandler.Registry.RegisterBLE(CommBLE.DEV_GAS_SENSOR, "ProcessBLE")
+	#End If
 End Sub
 
 #Region Device Control
 ' Sensor_StateChanged
-' Sensor listener event for state changes.
+' Sensor event for debounced state changes (raised once per change, not at start).
 ' Publishes MQTT/BLE status:
 '   {"s":"detected"} when gas is detected
 '   {"s":"clear"} when air is clear
 '   0A 02 00 when gas is detected
 '   0A 02 01 when air is clear
 Sub Sensor_StateChanged(state As Boolean)
-	If FirstTime Then
-		FirstTime = False
-		Return
-	End If
-	
-	Log("[DevGasSensor.State_Changed] state=", state, ", prev=", PrevState)
+	Log("[DevGasSensor.State_Changed] state=", state, ", glitches=", Sensor.GlitchCount)
 
-	If state <> PrevState Then
-		#If MQTT
-		PublishToMQTT(state)
-		#End If
-		
-		#If BLE
-		WriteToBLE(state)
-		#End If
-		
-		PrevState = state
-	End If
+	#If MQTT
+	PublishToMQTT(state)
+	#End If
+	
+	#If BLE
+	WriteToBLE(state)
+	' Sensor output is low when gas is detected
+	CommBLE.TelemetryGas(Not(state))
+	#End If
 End Sub
 
 ' Get
@@ -74,7 +73,7 @@ End Sub
 Public Sub Get(storeindex As Byte) As Boolean
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
 	Log("[DevGasSensor.Get] storeindex=", storeindex, ", payload=", payload)
-	Dim State As Boolean = Sensor.DigitalRead
+	Dim State As Boolean = Sensor.State
 	Log("[DevGasSensor.Get] state=", State)
 	Return State
 End Sub
@@ -84,7 +83,7 @@ End Sub
 ' Returns:
 '   Boolean - True if gas detected, False otherwise
 Public Sub Detected As Boolean
-	Dim state As Boolean = Sensor.DigitalRead
+	Dim state As Boolean = Sensor.State
 	Log("[DevGasSensor.Detected] state=", state)
 	Return state
 End Sub
@@ -100,6 +99,8 @@ End Sub
 ' Parameters:
 '	state - Sensor state 
 Private Sub PublishToMQTT(state As Boolean)
+	' Sensor output is low when gas is detected
+	MQTTClient.Snapshot.SetLong(MQTTTopics.SNAPSHOT_GAS, IIf(state, 0, 1))
 	Dim topic() As String = Array As String(MQTTTopics.TOPIC_GAS_SENSOR_STATUS)
 	Dim payload() As String
 		
@@ -132,12 +133,14 @@ End Sub
 '   storeindex - Index of the global store buffer.
 Public Sub ProcessBLE(storeindex As Byte)
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
-	Log("[DevMoisture.ProcessBLE] storeindex=", storeindex, ", payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevGasSensor.ProcessBLE", payload)
+	#End If
 
 	Dim command As Byte = payload(1)
 	Select command
 		Case CommBLE.CMD_GET_STATE
-			WriteToBLE(Sensor.DigitalRead)
+			WriteToBLE(Sensor.State)
 	End Select
 End Sub
 
@@ -148,7 +151,9 @@ End Sub
 Public Sub WriteToBLE(state As Boolean)
 	Dim payload() As Byte = Array As Byte(CommBLE.DEV_GAS_SENSOR, CommBLE.CMD_GET_VALUE, Convert.BoolToByte(state))
 	CommBLE.BLEServer_Write(payload)
-	Log("[DevGasSensor.WriteToBLE] payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevGasSensor.WriteToBLE", payload)
+	#End If
 End Sub
 #End Region
 #End If
@@ -50,6 +50,14 @@ Public Sub Initialize(address As Byte)
 	' Clear display
 	Lcd.Clear
 	Log("[DevLCD1602.Initialize][I] OK, address=", Convert.OneByteToHex(address), ", cols=", LCD_COLS, ", rows=", LCD_ROWS)
+
+	' Register the transport handlers (see GlobalStoreHandler.Registry)
+	#If BLE
+	GlobalStoreHandler.Registry.RegisterBLE(CommBLE.DEV_LCD1602, "ProcessBLE")
+	#End If
+	#If MQTT
+	GlobalStoreHandler.Registry.RegisterMQTT(MQTTTopics.GetTopicIndex(MQTTTopics.TOPIC_LCD_SET), "ProcessMQTT")
+	#End If
 End Sub
 
 ' ------------------------------------------------
@@ -112,10 +120,11 @@ Public Sub ProcessMQTT(storeindex As Byte)
 
 	' Get the keys from {"c":0-15,"r":0-1,"t":"string","x":0-1}
 	' If no col or row given, set 0 as default
-	Dim col As Int = IIf(MQTTClient.GetNumberFromKey(payload, "c") == -1, 0, MQTTClient.GetNumberFromKey(payload, "c"))
-	Dim row As Int = IIf(MQTTClient.GetNumberFromKey(payload, "r") == -1, 0, MQTTClient.GetNumberFromKey(payload, "r"))
-	Dim text() As Byte = MQTTClient.GetTextFromKey(payload, "t")
-	Dim clr As Int = MQTTClient.GetNumberFromKey(payload, "x")
+	MQTTClient.ParsePayload(payload)
+	Dim col As Int = MQTTClient.Json.GetLong("c", 0)
+	Dim row As Int = MQTTClient.Json.GetLong("r", 0)
+	Dim text() As Byte = MQTTClient.Json.GetText("t")
+	Dim clr As Int = MQTTClient.Json.GetLong("x", 0)
 	Log("[DevLCD1602.ProcessMQTT] col=",col, ", row=", row, ", text=", text, ", clear=",clr)
 
 	' Clear the display
@@ -176,11 +185,14 @@ Public Sub ProcessBLE(storeindex As Byte)
 	Dim MIN_PAYLOAD_LEN As Byte = 3
 	Dim MIN_PAYLOAD_LEN_SET_VALUE As Byte = 6	' At least 1 character = ID CMD Row Col Len Char
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
-	Log("[DevLCD1602.ProcessBLE][I] storeindex=", storeindex, ", payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevLCD1602.ProcessBLE", payload)
+	#End If
 	
 	' Check payload length - must be 3 min, like for clear display: 0x0C 0x05 0x01
 	If payload.Length < MIN_PAYLOAD_LEN Then
-		Log("[DevLCD1602.ProcessBLE][E] Invalid payload length, expect min ", MIN_PAYLOAD_LEN, " bytes, payload=", Convert.BytesToHex(payload))
+		' Invalid payload length, expect min MIN_PAYLOAD_LEN bytes
+		Main.Logger.Frame(Main.Logger.LEVEL_ERROR, "DevLCD1602.ProcessBLE", payload)
 		Return
 	End If
 	
@@ -192,7 +204,8 @@ Public Sub ProcessBLE(storeindex As Byte)
 		' Write Text
 		' Check payload length
 		If payload.Length < MIN_PAYLOAD_LEN_SET_VALUE Then
-			Log("[DevLCD1602.ProcessBLE][E] Command SET VALUE Invalid payload length, expect min ", MIN_PAYLOAD_LEN_SET_VALUE, " bytes, payload=", Convert.BytesToHex(payload))
+			' Command SET VALUE invalid payload length, expect min MIN_PAYLOAD_LEN_SET_VALUE bytes
+			Main.Logger.Frame(Main.Logger.LEVEL_ERROR, "DevLCD1602.SetValue", payload)
 			Return
 		End If
 		' Get row 0x00 - 0x01
@@ -11,8 +11,11 @@ Version=4
 ' Brief:        Reads moisture sensor value (event or on-demand).
 ' Date:         2025-11-14
 ' Author:       Robert W.B. Linn (c) 2025 MIT
-' Dependencies: rGlobalStoreEx
+' Dependencies: rGlobalStoreEx, rMoistureSensor, rSensorFilter, rADCService, rScheduler
 ' Description:	Moisture value retrieval via callback event or direct read.
+'				The event is raised when the filtered value leaves the deadband (ADC noise
+'				alone raises no event, BLE notify or LCD redraw), at least every 5 minutes.
+'				The value is read from the ADC service (DeviceMgr.ADC, 64 samples averaged).
 '				Raw reading: on a microcontroller ADC, typically 0–1023 (Arduino) or 0–4095 (ESP32 ADC 12-bit).
 ' Hardware: 	https://wiki.keyestudio.com/Ks0203_keyestudio_Steam_Sensor
 ' ================================================================
@@ -20,6 +23,15 @@ Version=4
 
 Private Sub Process_Globals
 	Private Sensor As MoistureSensor
+
+	' Event filter: median of 5 reads (500 ms each), EMA, deadband 40 counts or 2 %
+	Private FILTER_MEDIAN As Byte			= 5
+	Private FILTER_ALPHA As Double			= 0.3
+	Private DEADBAND_ABSOLUTE As Double		= 40
+	Private DEADBAND_RELATIVE As Double		= 0.02
+	Private DEADBAND_HYSTERESIS As Double	= 20
+	Private EVENT_MIN_INTERVAL As ULong		= 2000
+	Private EVENT_MAX_INTERVAL As ULong		= 300000
 End Sub
 
 ' Initialize
@@ -28,7 +40,19 @@ End Sub
 '   pinnr - GPIO pin number (analog input)
 Public Sub Initialize(pinnr As Byte)
 	Sensor.Initialize(pinnr, "Moisture_Detected")
+	Sensor.SetFilter(FILTER_MEDIAN, FILTER_ALPHA)
+	Sensor.SetDeadband(DEADBAND_ABSOLUTE, DEADBAND_RELATIVE, DEADBAND_HYSTERESIS)
+	Sensor.MinInterval = EVENT_MIN_INTERVAL
+	Sensor.MaxInterval = EVENT_MAX_INTERVAL
 	Log("[DevMoisture.Initialize][I] OK, pin=", pinnr)
+
+	' Register the transport handlers (see GlobalStoreHandler.Registry)
+	#If BLE
+	GlobalStoreHandler.Registry.RegisterBLE(CommBLE.DEV_MOISTURE, "ProcessBLE")
+	#End If
+	#If MQTT
+	GlobalStoreHandler.Registry.RegisterMQTT(MQTTTopics.GetTopicIndex(MQTTTopics.TOPIC_MOISTURE_GET), "ProcessMQTT")
+	#End If
 End Sub
 
 #Region Device Control
@@ -57,6 +81,7 @@ Sub Moisture_Detected(value As Int)
 
 	#If BLE
 	WriteToBLE(value)
+	CommBLE.TelemetryMoisture(value * 100 / Sensor.MAX_VALUE)
 	#End If
 End Sub
 
@@ -115,11 +140,12 @@ End Sub
 ' Parameters
 '	value - Moisture value.
 Private Sub PublishToMQTT(value As Int)
-	Dim s As String = value
-	Dim payload() As Byte = Convert.ReplaceString(MQTTTopics.PAYLOAD_MOISTURE_STATUS, "#S", s)
-	MQTTClient.Publish(Array As String(MQTTTopics.TOPIC_MOISTURE_STATUS), _
-					   Array As String(Convert.ByteConv.StringFromBytes(payload)))
-	Log("[DevMoisture.PublishToMQTT][I] json=", Convert.ByteConv.StringFromBytes(payload))
+	MQTTClient.Snapshot.SetLong(MQTTTopics.SNAPSHOT_MOISTURE, value)
+	MQTTTopics.TemplateMoistureStatus.SetLong("S", value)
+	MQTTClient.PublishTemplate(MQTTTopics.TOPIC_MOISTURE_STATUS, MQTTTopics.TemplateMoistureStatus, True)
+	#If LOG_DEBUG
+	Main.Logger.Value(Main.Logger.LEVEL_DEBUG, "DevMoisture.PublishToMQTT", value)
+	#End If
 End Sub
 #End Region
 #End If
@@ -138,7 +164,9 @@ End Sub
 '   storeindex - Index of the global store buffer.
 Public Sub ProcessBLE(storeindex As Byte)
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
-	Log("[DevMoisture.ProcessBLE] storeindex=", storeindex, ", payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevMoisture.ProcessBLE", payload)
+	#End If
 
 	Dim command As Byte = payload(1)
 	Select command
@@ -163,7 +191,9 @@ Public Sub WriteToBLE(value As UInt)
 	Dim data() As Byte = Convert.UIntToBytes(value)
 	Dim payload() As Byte = Array As Byte(CommBLE.DEV_MOISTURE, CommBLE.CMD_GET_VALUE, data(0), data(1))
 	CommBLE.BLEServer_Write(payload)
-	Log("[DevMoisture.WriteToBLE] payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevMoisture.WriteToBLE", payload)
+	#End If
 End Sub
 #End Region
 #End If
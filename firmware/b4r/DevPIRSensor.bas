@@ -9,36 +9,40 @@ Version=4
 ' File:         DevPIRSensor.bas
 ' Project:      make-homekit32
 ' Brief:        Read and handle the PIR (Passive Infrared) sensor.
-' Note:			Sensor Pin AddListener State: True (HIGH)=Clear, False (LOW)=Detected
+' Note:			Sensor GpioInput State: True (HIGH)=Clear, False (LOW)=Detected
 '				Output Delay Time (High Level): About 2.3 to 3 Seconds
 '				Clear: Sensor Output Indicator LED OFF
 '				Detected: Sensor Output Indicator LED ON
 ' Date:         2025-11-29
 ' Author:       Robert W.W. Linn (c) 2025 MIT
-' Dependencies: rGlobalStoreEx, rMQTT
+' Dependencies: rGlobalStoreEx, rMQTT, rGpioInput
 ' Description:	Motion detection with event callback logic.
 ' Hardware: 	https://wiki.keyestudio.com/Ks0052_keyestudio_PIR_Motion_Sensor
 ' ================================================================
 #End Region
 
 Private Sub Process_Globals
-	Private DEBOUNCE_MS As UInt = 800
+	' Edges less than DEBOUNCE_US apart are one change (the PIR output is a clean pulse)
+	Private DEBOUNCE_US As ULong = 50000
 	
-	Private Sensor As Pin
+	Private Sensor As GpioInput
 	Private IsEnabled As Boolean = True
-	Private PrevState As Boolean = False
-	Private LastChange As ULong = 0
 End Sub
 
 ' Initialize
-' Initializes the PIR sensor pin and attaches a listener.
+' Initializes the PIR sensor pin and attaches the edge interrupt.
+' A pulse during a long handler (e.g. PlayAlarm) is still raised, with the time of its edges.
 ' Parameters:
 '   pinnr - GPIO pin number (digital input)
 Public Sub Initialize(pinnr As Byte)
-	Sensor.Initialize(pinnr, Sensor.MODE_INPUT)
-	' Add a listener to detect motion
-	Sensor.AddListener("Sensor_StateChanged")
+	Sensor.Initialize(pinnr, Sensor.MODE_INPUT, "Sensor_StateChanged")
+	Sensor.DebounceMicros = DEBOUNCE_US
 	Log("[DevPIRSensor.Initialize][I] OK, pin=", pinnr)
+
+	' Register the transport handlers (see GlobalStoreHandler.Registry)
+	#If BLE
+	GlobalStoreHandler.Registry.RegisterBLE(CommBLE.DEV_PIR_SENSOR, "ProcessBLE")
+	#End If
 End Sub
 
 ' ------------------------------------------------
@@ -55,7 +59,7 @@ Public Sub Get(storeindex As Byte) As Boolean
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
 	Log("[DevPIRSensor.Get] storeindex=", storeindex, ", payload=", payload)
 
-	Dim State As Boolean = Sensor.DigitalRead
+	Dim State As Boolean = Sensor.State
 	Log("[DevPIRSensor.Get] state=", State)
 	Return State
 End Sub
@@ -70,7 +74,7 @@ Public Sub Enabled(state As Boolean)
 End Sub
 
 ' State_Changed
-' Sensor listener event for state changes.
+' Sensor event for debounced state changes (raised once per change).
 ' Publishes MQTT status as JSON payload:
 '   {"s":"detected"} when motion is detected
 '   {"s":"clear"} when motion is clear
@@ -78,33 +82,27 @@ Sub Sensor_StateChanged(state As Boolean)
 	If Not(IsEnabled) Then Return
 	Dim detected As Boolean
 	
-	' Debounce: ignore changes faster than NNN ms
-	If (Millis - LastChange) < DEBOUNCE_MS Then Return
-	LastChange = Millis
-	
-	Log("[DevPIRSensor.State_Changed] state=", state, ", prev=", PrevState)
+	Log("[DevPIRSensor.State_Changed] state=", state, ", us=", Sensor.ChangedMicros, ", duration=", Sensor.Duration)
 
-	If state <> PrevState Then
-		
-		DevLCD1602.Clear
-		DevLCD1602.WriteAt(0, 0, "Motion")
-		If Not(state) Then
-			detected = True
-			DevLCD1602.WriteAt(0, 1, "Detected")
-		Else
-			detected = False
-			DevLCD1602.WriteAt(0, 1, "Clear")
-		End If
-		
-		#If MQTT
-		PublishToMQTT(detected)
-		#End If
-		
-		#If BLE
-		WriteToBLE(CommBLE.CMD_GET_STATE, detected)
-		#End If
-		PrevState = state
+	DevLCD1602.Clear
+	DevLCD1602.WriteAt(0, 0, "Motion")
+	If Not(state) Then
+		detected = True
+		DevLCD1602.WriteAt(0, 1, "Detected")
+	Else
+		detected = False
+		DevLCD1602.WriteAt(0, 1, "Clear")
 	End If
+	
+	#If MQTT
+	MQTTClient.Snapshot.SetLong(MQTTTopics.SNAPSHOT_MOTION, IIf(detected, 1, 0))
+	PublishToMQTT(detected)
+	#End If
+	
+	#If BLE
+	WriteToBLE(CommBLE.CMD_GET_STATE, detected)
+	CommBLE.TelemetryMotion(detected)
+	#End If
 End Sub
 #End Region
 
@@ -156,7 +154,9 @@ End Sub
 '   storeindex - Index of the global store buffer.
 Public Sub ProcessBLE(storeindex As Byte)
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
-	Log("[DevPIRSensor.ProcessBLE] storeindex=", storeindex, ", payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevPIRSensor.ProcessBLE", payload)
+	#End If
 
 	Dim command As Byte = payload(1)
 	Select command
@@ -181,7 +181,9 @@ End Sub
 Public Sub WriteToBLE(command As Byte, state As Boolean)
 	Dim payload() As Byte = Array As Byte(CommBLE.DEV_PIR_SENSOR, command, Convert.BoolToByte(state))
 	CommBLE.BLEServer_Write(payload)
-	Log("[DevPIRSensor.WriteToBLE] payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevPIRSensor.WriteToBLE", payload)
+	#End If
 End Sub
 #End Region
 #End If
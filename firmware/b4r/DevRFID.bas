@@ -11,7 +11,7 @@ Version=4
 ' Brief:        Handles RFID card scanning and reporting.
 ' Date:         2025-11-13
 ' Author:       Robert W.W. Linn (c) 2025 MIT
-' Dependencies: rGlobalStoreEx, rMFRC522Mifare_I2C
+' Dependencies: rGlobalStoreEx, rMFRC522Mifare_I2C, rScheduler
 ' Description:	Reads card UID and sector/block data.
 '				The last read tag data is stored in the global store slot 4.
 '				This is a special slot.
@@ -39,6 +39,11 @@ Public Sub Initialize(address As Byte)
 	' ---------- RFID Mifare handled via I2C bus with default address.
 	Rfid.Initialize(address, "RFID_CardPresent")
 	Log("[DevRFID.Initialize][I] OK, address=", Convert.OneByteToHex(address))
+
+	' Register the transport handlers (see GlobalStoreHandler.Registry)
+	#If BLE
+	GlobalStoreHandler.Registry.RegisterBLE(CommBLE.DEV_RFID, "ProcessBLE")
+	#End If
 End Sub
 
 ' ------------------------------------------------
@@ -107,16 +112,11 @@ End Sub
 '	data - data containing 2 bytes for group and command
 Private Sub PublishToMQTT(uid() As Byte, data() As Byte)
 	' MQTT Publish
-	Dim payload() As Byte = MQTTTopics.PAYLOAD_RFID_STATUS
-	payload = Convert.ReplaceString(payload, "#U", Convert.ByteConv.HexFromBytes(uid).GetBytes)
-	Dim group As String = data(0)
-	payload = Convert.ReplaceString(payload, "#G", group.GetBytes)
-	Dim command As String = data(1)
-	payload = Convert.ReplaceString(payload, "#C", command.GetBytes)
-	MQTTClient.Publish(Array As String(MQTTTopics. TOPIC_RFID_STATUS), _
-								   Array As String(Convert.ByteConv.StringFromBytes(payload)))
-	Log("[DevRFID.PublishToMQTT][I] json=", payload)
-	' [DevRFID.PublishToMQTT][I] json={"u":"8C4B71C1","g":2,"c":4}
+	' {"u":"8C4B71C1","g":2,"c":4}
+	MQTTTopics.TemplateRFIDStatus.SetHex("U", uid)
+	MQTTTopics.TemplateRFIDStatus.SetLong("G", data(0))
+	MQTTTopics.TemplateRFIDStatus.SetLong("C", data(1))
+	MQTTClient.PublishTemplate(MQTTTopics.TOPIC_RFID_STATUS, MQTTTopics.TemplateRFIDStatus, True)
 				
 	' Depending command, an action can be taken to do something in the house.
 
@@ -142,13 +142,15 @@ End Sub
 '   storeindex - Index of the global store buffer.
 Public Sub ProcessBLE(storeindex As Byte)
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
-	Log("[DevRFID.ProcessBLE] storeindex=", storeindex, ", payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevRFID.ProcessBLE", payload)
+	#End If
 	' [DevRFID.ProcessBLE] storeindex=1, payload=0E04
 
 	Dim command As Byte = payload(1)
 	Select command
 		Case CommBLE.CMD_GET_VALUE
-			Dim data() As Byte = GlobalStoreHandler.GetSlot(4)
+			Dim data() As Byte = GlobalStoreHandler.GetSlot(GlobalStoreHandler.SLOT_RFID)
 			WriteToBLE(Null, data)
 	End Select
 End Sub
@@ -220,7 +222,9 @@ Public Sub WriteToBLE(uid() As Byte, data() As Byte)
 	Next
 
 	Log("[DevRFID.WriteToBLE] Final idx=", idx, ", ArrayLen=", carddata.Length)
-	Log("[DevRFID.WriteToBLE] Payload=", Convert.BytesToHex(carddata))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevRFID.WriteToBLE", carddata)
+	#End If
 
 	'--------------------------------------------------------
 	' 6) Send to BLE client
@@ -34,6 +34,14 @@ Public Sub Initialize(pinnr As Byte)
 	' Show cleared pixels
 	RGBLed.Show
 	Log("[DevRGBLed.Initialize][I] OK, pin=", pinnr, ", pixels=", RGB_LED_PIXEL_COUNT, ", type=", RGB_LED_TYPE, ", pixels cleared")
+
+	' Register the transport handlers (see GlobalStoreHandler.Registry)
+	#If BLE
+	GlobalStoreHandler.Registry.RegisterBLE(CommBLE.DEV_RGB_LED, "ProcessBLE")
+	#End If
+	#If MQTT
+	GlobalStoreHandler.Registry.RegisterMQTT(MQTTTopics.GetTopicIndex(MQTTTopics.TOPIC_RGB_LED_SET), "ProcessMQTT")
+	#End If
 End Sub
 
 ' ------------------------------------------------
@@ -45,6 +53,9 @@ End Sub
 Public Sub Clear
 	RGBLed.Clear
 	RGBLed.Show
+	#If MQTT
+	MQTTClient.Snapshot.SetLong(MQTTTopics.SNAPSHOT_RGB_LED, 0)
+	#End If
 	Log("[DevRGBLed.Clear] OK")
 End Sub
 
@@ -114,16 +125,18 @@ Public Sub ProcessMQTT(storeindex As Byte)
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
 	Log("[DevRGBLed.ProcessMQTT] storeindex=", storeindex, ", payload=", payload)
 
+	MQTTClient.ParsePayload(payload)
+
 	' If no index given, set 0 as default
-	Dim index As Byte = IIf(MQTTClient.GetNumberFromKey(payload, "i") == -1, 0, MQTTClient.GetNumberFromKey(payload, "i"))
+	Dim index As Byte = MQTTClient.Json.GetLong(MQTTTopics.KEY_INDEX, 0)
 
 	' If not color given, set 0 as default
-	Dim red As Byte = IIf(MQTTClient.GetNumberFromKey(payload, "r") == -1, 0, MQTTClient.GetNumberFromKey(payload, "r"))
-	Dim green As Byte = IIf(MQTTClient.GetNumberFromKey(payload, "g") == -1, 0, MQTTClient.GetNumberFromKey(payload, "g"))
-	Dim blue As Byte = IIf(MQTTClient.GetNumberFromKey(payload, "b") == -1, 0, MQTTClient.GetNumberFromKey(payload, "b"))
+	Dim red As Byte = MQTTClient.Json.GetLong(MQTTTopics.KEY_RED, 0)
+	Dim green As Byte = MQTTClient.Json.GetLong(MQTTTopics.KEY_GREEN, 0)
+	Dim blue As Byte = MQTTClient.Json.GetLong(MQTTTopics.KEY_BLUE, 0)
 
 	' Clear as default (1)
-	Dim clearpixels As Byte = IIf(MQTTClient.GetNumberFromKey(payload, "x") == -1, 1, MQTTClient.GetNumberFromKey(payload, "x"))
+	Dim clearpixels As Byte = MQTTClient.Json.GetLong("x", 1)
 
 	' Clear the pixels
 	If clearpixels == 1 Then Clear
@@ -133,6 +146,7 @@ Public Sub ProcessMQTT(storeindex As Byte)
 	RGBLed.Show
 
 	' Publish the state as always true
+	MQTTClient.Snapshot.SetLong(MQTTTopics.SNAPSHOT_RGB_LED, 1)
 	MQTTClient.PublishDeviceState(MQTTTopics.TOPIC_RGB_LED_STATUS, True)
 
 	Log("[DevRGBLed.ProcessMQTT] index=", index, ", red=",red, ", green=", green, ", blue=", blue, ", clear=", clearpixels)
@@ -179,7 +193,9 @@ End Sub
 '   storeindex - Index of the global store buffer.
 Public Sub ProcessBLE(storeindex As Byte)
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
-	Log("[DevRGBLed.ProcessBLE] storeindex=", storeindex, ", payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevRGBLed.ProcessBLE", payload)
+	#End If
 	' [DevRGBLed.ProcessBLE] storeindex=0, payload=0201010000FF01
 	
 	Dim command As Byte = payload(1)
@@ -42,6 +42,14 @@ Public Sub Initialize(pinnr As Byte)
 	ServoPin.Initialize(pinnr, ServoPin.MODE_OUTPUT)
 	Servo.AttachToTimer(pinnr, TIMER_SLOT)
 	Log("[DevServoWindow.Initialize][I] OK, pin=", pinnr, ", timerslot=", TIMER_SLOT)
+
+	' Register the transport handlers (see GlobalStoreHandler.Registry)
+	#If BLE
+	GlobalStoreHandler.Registry.RegisterBLE(CommBLE.DEV_SERVO_WINDOW, "ProcessBLE")
+	#End If
+	#If MQTT
+	GlobalStoreHandler.Registry.RegisterMQTT(MQTTTopics.GetTopicIndex(MQTTTopics.TOPIC_SERVO_WINDOW_SET), "ProcessMQTT")
+	#End If
 End Sub
 
 ' ------------------------------------------------
@@ -61,6 +69,7 @@ Public Sub Set(action As Byte)
 	ServoState = action
 	
 	#If MQTT
+	MQTTClient.Snapshot.SetLong(MQTTTopics.SNAPSHOT_SERVO_WINDOW, action)
 	' Confirm position after small delay
 	CallSubPlus("ConfirmMQTT", MOVE_DELAY, action)
 	#End if
@@ -87,7 +96,8 @@ Public Sub ProcessMQTT(storeindex As Byte)
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
 	Log("[DevServoWindow.ProcessMQTT] storeindex=", storeindex, ", payload=", payload)
 	
-	Dim action() As Byte = MQTTClient.GetTextFromKey(payload, MQTTTopics.KEY_ACTION)
+	MQTTClient.ParsePayload(payload)
+	Dim action() As Byte = MQTTClient.Json.GetText(MQTTTopics.KEY_ACTION)
 	Dim actionstr As String = Convert.ByteConv.StringFromBytes(action)
 
 	If actionstr == MQTTTopics.ACTION_OPEN Then
@@ -143,7 +153,9 @@ End Sub
 '   storeindex - Index of the global store buffer.
 Public Sub ProcessBLE(storeindex As Byte)
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
-	Log("[DevServoWindow.ProcessBLE] storeindex=", storeindex, ", payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevServoWindow.ProcessBLE", payload)
+	#End If
 
 	Dim command As Byte = payload(1)
 	Select command
@@ -163,7 +175,9 @@ End Sub
 Public Sub WriteToBLE(command As Byte, state As Byte)
 	Dim payload() As Byte = Array As Byte(CommBLE.DEV_SERVO_WINDOW, command, state)
 	CommBLE.BLEServer_Write(payload)
-	Log("[DevServoDoor.WriteToBLE] payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevServoWindow.WriteToBLE", payload)
+	#End If
 End Sub
 #End Region
 #End If
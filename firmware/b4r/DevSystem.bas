@@ -29,6 +29,11 @@ End Sub
 Public Sub Initialize
 	mEventsEnabled = False
 	Log("[DevSystem.Initialize][I] OK")
+
+	' Register the transport handlers (see GlobalStoreHandler.Registry)
+	#If BLE
+	GlobalStoreHandler.Registry.RegisterBLE(CommBLE.DEV_SYSTEM, "ProcessBLE")
+	#End If
 End Sub
 
 ' ------------------------------------------------
@@ -48,7 +53,8 @@ Public Sub ProcessMQTT(storeindex As Byte)
 
 	' Command to enable events using key "e".
 	' Get the keys from {"e":0 | 1}. If -1 then key not found.
-	action = MQTTClient.GetNumberFromKey(payload, "e")
+	MQTTClient.ParsePayload(payload)
+	action = MQTTClient.Json.GetLong("e", -1)
 	If action > -1 Then
 		Log("[DevSystem.ProcessMQTT] command=enableevents, action=",action)
 		Select action
@@ -89,7 +95,9 @@ End Sub
 '   storeindex - Index of the global store buffer.
 Public Sub ProcessBLE(storeindex As Byte)
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
-	Log("[DevSystem.ProcessBLE][I] storeindex=", storeindex, ", payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevSystem.ProcessBLE", payload)
+	#End If
 
 	' Check if 3 bytes
 	If payload.Length < 3 Then
@@ -29,6 +29,14 @@ Public Sub Initialize(pinnr As Byte)
 	YellowLed.Initialize(pinnr, YellowLed.MODE_OUTPUT)
 	YellowLed.DigitalWrite(False)
 	Log("[DevYellowLed.Initialize][I] OK, pin=", pinnr)
+
+	' Register the transport handlers (see GlobalStoreHandler.Registry)
+	#If BLE
+	GlobalStoreHandler.Registry.RegisterBLE(CommBLE.DEV_YELLOW_LED, "ProcessBLE")
+	#End If
+	#If MQTT
+	GlobalStoreHandler.Registry.RegisterMQTT(MQTTTopics.GetTopicIndex(MQTTTopics.TOPIC_YELLOW_LED_SET), "ProcessMQTT")
+	#End If
 End Sub
 
 ' ------------------------------------------------
@@ -51,6 +59,9 @@ End Sub
 '   state - Boolean.
 Public Sub Set(state As Boolean)
 	YellowLed.DigitalWrite(state)
+	#If MQTT
+	MQTTClient.Snapshot.SetLong(MQTTTopics.SNAPSHOT_YELLOW_LED, IIf(state, 1, 0))
+	#End If
 End Sub
 
 ' SetPWM
@@ -59,6 +70,9 @@ End Sub
 '   value - UInt 0-255
 Public Sub SetPWM(value As UInt)
 	YellowLed.AnalogWrite(value)
+	#If MQTT
+	MQTTClient.Snapshot.SetLong(MQTTTopics.SNAPSHOT_YELLOW_LED, value)
+	#End If
 End Sub
 
 ' Toggle
@@ -84,25 +98,23 @@ Public Sub ProcessMQTT(storeindex As Byte)
 	Log("[DevYellowLed.ProcessMQTT] storeindex=", storeindex, ", payload=", payload)
 
 	' Get the state on or off
-	Dim state() As Byte = MQTTClient.GetTextFromKey(payload, MQTTTopics.KEY_STATE)
+	MQTTClient.ParsePayload(payload)
+	Dim state() As Byte = MQTTClient.Json.GetText(MQTTTopics.KEY_STATE)
 	' Log("[YellowLed.Set] state=", Convert.ByteConv.StringFromBytes(state))
 	
 	' Turn the yellow led on or off or brightness (PWM pins only)
 	If state == MQTTTopics.STATE_ON Then
 		Set(True)
-		MQTTClient.Publish(Array As String(MQTTTopics.TOPIC_YELLOW_LED_STATUS), _
-					   	   Array As String(Convert.ByteConv.StringFromBytes(MQTTTopics.PAYLOAD_YELLOW_LED_ON)))
+		MQTTClient.PublishBytes(MQTTTopics.TOPIC_YELLOW_LED_STATUS, MQTTTopics.PAYLOAD_YELLOW_LED_ON, True)
 	else if state == MQTTTopics.STATE_OFF Then
 		Set(False)
-		MQTTClient.Publish(Array As String(MQTTTopics.TOPIC_YELLOW_LED_STATUS), _
-					   	   Array As String(Convert.ByteConv.StringFromBytes(MQTTTopics.PAYLOAD_YELLOW_LED_OFF)))
+		MQTTClient.PublishBytes(MQTTTopics.TOPIC_YELLOW_LED_STATUS, MQTTTopics.PAYLOAD_YELLOW_LED_OFF, True)
 	Else
 		' This is only supported for PWM pins
 		' Cast string to uint
 		Dim value As UInt = Convert.UIntFromString(state)
 		SetPWM(value)
-		MQTTClient.Publish(Array As String(MQTTTopics.TOPIC_YELLOW_LED_STATUS), _
-					   	   Array As String(Convert.ByteConv.StringFromBytes(state)))
+		MQTTClient.PublishBytes(MQTTTopics.TOPIC_YELLOW_LED_STATUS, state, True)
 	End If
 End Sub
 #End Region
@@ -133,7 +145,9 @@ End Sub
 '   storeindex - Index of the global store buffer.
 Public Sub ProcessBLE(storeindex As Byte)
 	Dim payload() As Byte = GlobalStoreHandler.GetSlot(storeindex)
-	Log("[DevYellowLed.ProcessBLE] storeindex=", storeindex, ", payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevYellowLed.ProcessBLE", payload)
+	#End If
 	' [DevYellowLed.ProcessBLE] storeindex=1, payload=010101
 	
 	Dim command As Byte = payload(1)
@@ -155,7 +169,9 @@ End Sub
 Public Sub WriteToBLE(command As Byte, state As Byte)
 	Dim payload() As Byte = Array As Byte(CommBLE.DEV_YELLOW_LED, command, state)
 	CommBLE.BLEServer_Write(payload)
-	Log("[DevYellowLed.WriteToBLE] payload=", Convert.BytesToHex(payload))
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "DevYellowLed.WriteToBLE", payload)
+	#End If
 End Sub
 #End Region
 #End If
@@ -36,6 +36,17 @@ Private Sub Process_Globals
 	' ===== Moisture Sensor (Analog) =====
 	Public MOISTURE_SENSOR_PIN As Int = 34
 
+	' ===== ADC Service (continuous sampling, ADC1 pins 32-39) =====
+	' 20 kHz over all channels, 64 samples per value
+	Public ADC As ADCService
+	Private ADC_SAMPLE_RATE As ULong	= 20000
+	Private ADC_OVERSAMPLE As UInt		= 64
+
+	' ===== Scheduler (sensor reads as timed jobs) =====
+	' Without a due job the main loop sleeps up to 2 ms (BLE and MQTT wait at most this long)
+	Public Scheduler As Scheduler
+	Private SCHEDULER_IDLE_SLEEP_MAX As ULong	= 2
+
 	' ===== Gas Sensor (Analog) =====
 	Public GAS_SENSOR_PIN As Int = 23
 
@@ -71,6 +82,16 @@ Public Sub Initialize
 	DevServoDoor.Initialize(SERVO_DOOR_PIN)
 	DevServoWindow.Initialize(SERVO_WINDOW_PIN)
 
+	' Sensor reads run as scheduler jobs, started before the sensors
+	Scheduler.Initialize
+	Scheduler.IdleSleepMax = SCHEDULER_IDLE_SLEEP_MAX
+
+	' Analog sensors are sampled in the background, the moisture sensor reads the latest value.
+	' The gas sensor uses its digital output, its analog output would need an ADC1 pin (AddChannel).
+	ADC.Initialize(ADC_SAMPLE_RATE, ADC_OVERSAMPLE)
+	ADC.AddChannel(MOISTURE_SENSOR_PIN)
+	If Not(ADC.Start) Then Log("[DeviceMgr.Initialize][W] ADC service not started, analogRead is used")
+
 	' Sensors
 	DevMoisture.Initialize(MOISTURE_SENSOR_PIN)
 	DevDHT11.Initialize(DHT11_PIN)
@@ -8,106 +8,199 @@ Version=4
 ' ================================================================
 ' File:        	GlobalStoreHandler.bas
 ' Project:     	make-homekit32
-' Brief:       	Global store handler for MQTT payload buffering.
+' Brief:       	Command queue for received BLE and MQTT payloads.
 ' Date:        	2025-11-09
 ' Author:      	Robert W.B. Linn (c) 2025 MIT
-' Dependencies: rGlobalStoreEx.b4x
+' Dependencies: rCommandQueue, rDeviceRegistry, rGlobalStoreEx.b4x
 '
 ' Description:
-'   Handles a simple circular buffer (round-robin) of byte arrays.
-'   Each slot stores the latest MQTT payloads for inspection or reuse.
-'	Three slots are used with index 0,1,2.
+'   Received BLE frames and MQTT payloads are copied into a bounded
+'   FIFO command queue (rCommandQueue) with their device id or topic index
+'   and arrival time. The queue dispatches them in arrival order from the
+'   main loop through the device registry (rDeviceRegistry): each device
+'	module registers its ProcessBLE / ProcessMQTT sub against its device id
+'	and topic index in Initialize, routing is a direct table lookup.
+'	A burst can no longer overwrite a payload before its handler ran:
+'	a full queue rejects the newest command and notifies the sender
+'	(QUEUE_POLICY, or drops the oldest one).
+'	Slot 4 of the global store is kept for the RFID card data.
 '
 ' Usage:
-'   Call SetIndex to advance the slot index.
-'   Call GetSlot(index) to retrieve a specific slot.
-'	Call Put to set data into a slot.
+'	Call Put(source, id, context, data) to queue a received payload.
+'   Call GetSlot(SLOT_COMMAND) in a handler to get the payload being dispatched.
+'	Call LogStats to log the queue counters, LogDispatchStats for the per-handler
+'	calls and execution times.
 '
 ' ================================================================
 #End Region
 
 #Region Declarations
 Private Sub Process_Globals
-	' Global store index control
-	Public Index As Byte = 0
+	' Command queue
+	Private Queue As CommandQueue
 	
-	' Number of slots used = 3 with index 0,1,2
-	Private Const MIN_INDEX As Byte = 0
-	Private Const MAX_INDEX As Byte = 2
+	' Device handlers for BLE device ids and MQTT topic indices
+	Public Registry As DeviceRegistry
+	
+	' Queue depth, 1 to Queue.DEPTH_MAX (16). Payloads up to Queue.PAYLOAD_SIZE (1024) bytes, the largest
+	' reassembled BLE message; larger payloads are rejected with ERROR_PAYLOAD_TOO_LARGE. Waiting payloads
+	' share Queue.POOL_SIZE (2048) bytes, a full pool counts as a full queue.
+	Private QUEUE_DEPTH As Byte = 8
+	
+	' Full-queue policy: POLICY_REJECT_NEWEST notifies the sender, POLICY_DROP_OLDEST drops silently.
+	Private QUEUE_POLICY As Byte = Queue.POLICY_REJECT_NEWEST	'ignore
+
+	' Slot of the payload being dispatched and the RFID slot
+	Public Const SLOT_COMMAND As Byte = 0
+	Public Const SLOT_RFID As Byte = 4
+	
+	' Command sources
+	Public SOURCE_BLE As Byte = Queue.SOURCE_BLE
+	Public SOURCE_MQTT As Byte = Queue.SOURCE_MQTT
 End Sub
 #End Region
 
 #Region GlobalStore
 ' Initialize
-' Initialize the global store handler. Set debug flag.
+' Initialize the device registry, the command queue and the global store (RFID slot).
+' Must be called before the device modules register their handlers.
 Public Sub Initialize
 	GlobalStoreEx.Debug = False
-End Sub
-
-' SetIndex
-' Advances Index in a circular fashion (minindex → maxindex → minindex).
-Public Sub SetIndex
-	Index = Index + 1
-	If Index > MAX_INDEX Then
-		Index = MIN_INDEX
-	End If
+	Registry.Initialize("Registry_Error")
+	Queue.Initialize(QUEUE_DEPTH, "Queue_Command", "Queue_Error")
+	Queue.Policy = QUEUE_POLICY
+	Log("[GlobalStoreHandler.Initialize] depth=", Queue.Depth, ", policy=", Queue.Policy, ", payloadsize=", Queue.PAYLOAD_SIZE)
 End Sub
 
 ' GetSlot
-' Returns a reference to the requested slot (as byte array).
+' Returns the payload of the command being dispatched or the RFID slot (as byte array).
 ' Parameters:
-' 	idx - Index range: 0–4
+' 	idx - SLOT_COMMAND or SLOT_RFID
 ' Returns:
 '	Null if index is invalid.
 Public Sub GetSlot(idx As Byte) As Byte()
 	Select idx
-		Case 0
-			Return GlobalStoreEx.Slot0
-		Case 1
-			Return GlobalStoreEx.Slot1
-		Case 2
-			Return GlobalStoreEx.Slot2
-		Case 3
-			Return GlobalStoreEx.Slot3
-		Case 4
+		Case SLOT_COMMAND
+			Return Queue.Payload
+		Case SLOT_RFID
 			Return GlobalStoreEx.Slot4
 		Case Else
 			Return Null
 	End Select
 End Sub
 
+' CommandContext
+' Returns the context of the command being dispatched, for BLE the connection id of the sender.
+Public Sub CommandContext As UInt
+	Return Queue.Context
+End Sub
+
 ' Put
-' Put data into the next slot (round-robin)
+' Queue a received payload for dispatch from the main loop.
 ' Parameters:
+'	source - SOURCE_BLE or SOURCE_MQTT
+'	id - Device id (BLE) or topic index (MQTT)
+'	context - BLE connection id of the sender, 0 for MQTT
 ' 	data - Byte array
-Public Sub Put(data() As Byte)
-	' Set the next global store index (slot to use)
-	SetIndex
-	
-	' Put the data into the slot
-	GlobalStoreEx.Put(Index, data)
-
-	Log("[GlobalStoreHandler.Put][I] ", _
-	    "slot=", Index, ", bufferlength=", GlobalStoreEx.BufferLength, ", Max=", GlobalStoreEx.BUFFER_SIZE, _
-		", data size=", data.Length, ", hex=", Convert.BytesToHex(data))
-
-'	Log("[GlobalStoreHandler.Put][I] ", _
-'	    "slot=", Index, ", bufferlength=", GlobalStoreEx.BufferLength, ", Max=", GlobalStoreEx.BUFFER_SIZE, _
-'		", data size=", data.Length, ", hex=", Convert.BytesToHex(data), ", string=", Convert.BytesToString(data))
+' Returns:
+'	False if the queue rejected the payload (the sender has been notified).
+Public Sub Put(source As Byte, id As Byte, context As UInt, data() As Byte) As Boolean
+	#If LOG_DEBUG
+	Main.Logger.Value(Main.Logger.LEVEL_DEBUG, "GlobalStoreHandler.id", id)
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "GlobalStoreHandler.Put", data)
+	#End If
+	Return Queue.Push(source, id, context, data)
 End Sub
 
 ' PutSlot4
 ' Put data into the slot 4.
 ' This is a special slot that can be used for RFID.
-' Use GetSlot(4) to get the data.
+' Use GetSlot(SLOT_RFID) to get the data.
 ' Parameters:
 ' 	data - Byte array
 Public Sub PutSlot4(data() As Byte)
-	Dim idx As Byte = 4
-	GlobalStoreEx.Put(idx, data)
+	GlobalStoreEx.Put(SLOT_RFID, data)
+
+	#If LOG_DEBUG
+	Main.Logger.Frame(Main.Logger.LEVEL_DEBUG, "GlobalStoreHandler.Slot4", data)
+	#End If
+End Sub
 
-	Log("[GlobalStoreHandler.Put][I] ", _
-	    "slot=", idx, ", bufferlength=", GlobalStoreEx.BufferLength, ", Max=", GlobalStoreEx.BUFFER_SIZE, _
-		", data size=", data.Length, ", hex=", Convert.BytesToHex(data))
+' LogStats
+' Logs the queue counters: waiting, high-water, drops and queueing latency in us.
+Public Sub LogStats
+	Log("[GlobalStoreHandler.LogStats] count=", Queue.Count, "/", Queue.Depth, _
+		", highwater=", Queue.HighWater, _
+		", pushed=", Queue.PushedCount, ", dispatched=", Queue.DispatchedCount, ", dropped=", Queue.DroppedCount, _
+		", latencyus last=", Queue.LatencyLast, ", max=", Queue.LatencyMax, ", avg=", Queue.LatencyAvg)
+End Sub
+
+' LogDispatchStats
+' Logs per registered handler the calls and execution time (total ms, average and max us).
+Public Sub LogDispatchStats
+	Log("[GlobalStoreHandler.LogDispatchStats] handlers=", Registry.HandlerCount, "/", Registry.MAX_HANDLERS, ", misses=", Registry.MissCount)
+	For i = 0 To Registry.HandlerCount - 1
+		Dim kind As String = "BLE"
+		If Registry.HandlerKind(i) == Registry.KIND_MQTT Then kind = "MQTT"
+		Log("[GlobalStoreHandler.LogDispatchStats] ", kind, " id=", Registry.HandlerKey(i), _
+			", calls=", Registry.HandlerCalls(i), ", totalms=", Registry.HandlerTimeMs(i), _
+			", avgus=", Registry.HandlerAvgUs(i), ", maxus=", Registry.HandlerMaxUs(i))
+	Next
+End Sub
+#End Region
+
+#Region Queue Events
+' Dispatch a queued command to the handler registered for its device id or topic index.
+' Raised from the main loop, the payload is valid until the sub returns.
+' Parameters:
+'	source - SOURCE_BLE or SOURCE_MQTT
+'	id - Device id (BLE) or topic index (MQTT)
+Private Sub Queue_Command(source As Byte, id As Byte)
+	Dim dispatched As Boolean
+	If source == SOURCE_BLE Then
+		dispatched = Registry.DispatchBLE(id, SLOT_COMMAND)
+	Else
+		dispatched = Registry.DispatchMQTT(id, SLOT_COMMAND)
+	End If
+	If Not(dispatched) Then
+		Log("[GlobalStoreHandler.Queue_Command][W] No handler, source=", source, ", id=", id)
+	End If
+End Sub
+
+' Handle queue errors.
+' A rejected command is reported to its sender (BLE system error frame or MQTT error topic).
+' Parameters:
+'	code - Queue error code
+Private Sub Queue_Error(code As Byte)
+	Select code
+		Case Queue.ERROR_QUEUE_FULL, Queue.ERROR_PAYLOAD_TOO_LARGE
+			Log("[GlobalStoreHandler.Queue_Error][E] code=", code, ", source=", Queue.LastDroppedSource, ", id=", Queue.LastDroppedId, ", dropped=", Queue.DroppedCount)
+			Select Queue.LastDroppedSource
+				Case SOURCE_BLE
+					#If BLE
+					CommBLE.WriteError(code, Queue.LastDroppedId)
+					#End If
+				Case SOURCE_MQTT
+					#If MQTT
+					CommMQTT.PublishError(code, Queue.LastDroppedId)
+					#End If
+			End Select
+		Case Queue.ERROR_INVALID_DEPTH
+			Log("[GlobalStoreHandler.Queue_Error][E] Invalid QUEUE_DEPTH, DEPTH_MAX is used.")
+	End Select
+End Sub
+
+' Handle device registry errors (raised during the device module Initialize).
+' Parameters:
+'	code - Registry error code
+Private Sub Registry_Error(code As Byte)
+	Select code
+		Case Registry.ERROR_TABLE_FULL
+			Log("[GlobalStoreHandler.Registry_Error][E] Handler table full, MAX_HANDLERS=", Registry.MAX_HANDLERS)
+		Case Registry.ERROR_DUPLICATE
+			Log("[GlobalStoreHandler.Registry_Error][E] Device id or topic index already registered.")
+		Case Registry.ERROR_INVALID_KEY
+			Log("[GlobalStoreHandler.Registry_Error][E] Invalid device id (0x00) or topic not in MQTTTopics.TopicTable.")
+	End Select
 End Sub
 #End Region
@@ -12,7 +12,19 @@ Version=4
 ' Date:			2025-11-04
 ' Author:		Robert W.B. Linn (c) 2025 MIT
 ' MQTT:			Credentials defines as process_globals (change accordingly).
-' Dependencies:	rMQTT, rConvert
+' Outbound:		Publishes go through a store-and-forward queue (rOutbox): while the broker
+'				is unreachable messages are kept in RAM (optional flash spill) and replayed
+'				in order after the reconnect. Queue stats: TOPIC_SYSTEM_INFO.
+' Connection:	Non-blocking state machine (rMqttConnector): WiFi > TCP > CONNACK > SUBSCRIBE > READY.
+'				Each state runs one short step per main loop pass, failures wait a jittered
+'				exponential backoff (1 s doubling up to 60 s). The device pollers keep running.
+'				The connector also sends CONNECT and SUBSCRIBE, receives the messages and owns the keepalive.
+' Format:		Per-topic payload format (rPayloadCodec): JSON, CBOR or MessagePack, see
+'				MQTTTopics.FormatTopicTable. Received payloads are detected (ParsePayload).
+' Snapshot:		The devices set their state in the home state snapshot (rStateSnapshot),
+'				published retained to TOPIC_SNAPSHOT on change and periodically.
+'				Per-device status topics can be switched off (MQTTTopics.DeviceTopics).
+' Dependencies:	rMqttConnector, rMqttStream, rOutbox, rPayloadTemplate, rPayloadCodec, rStateSnapshot, rConvert, rJsonIndex
 ' ================================================================
 #End Region
 
@@ -27,7 +39,12 @@ Private Sub Process_Globals
 	Type TMQTTMessage(topic As String, payload As String)
 
 	' MQTT
-	Private MQTT As MqttClient
+	' Publishes are written by the zero-copy publisher directly to the socket stream
+	Private Publisher As MqttStream
+	' Store-and-forward queue of the publishes, replayed after a reconnect
+	Private OutQueue As Outbox
+	Private OUTQUEUE_DEPTH As Byte		= 16
+	Private LastReplayCount As ULong	= 0
 
 	Public ID As String 				= "homekit32"
 
@@ -37,70 +54,109 @@ Private Sub Process_Globals
 	Private BROKER_IP () As Byte 		= Array As Byte(NNN,NNN,NNN,NNN)
 	Private BROKER_PORT As UInt 		= 1883
 
-	Private RETRIES As Byte				= 5
-	Private RetryCounter As Byte		= 0
+	' Connection state machine and MQTT session (CONNECT, SUBSCRIBE, receive, keepalive), started by WiFiMgr.Begin
+	Public Link As MqttConnector
+	' Topics subscribed per main loop pass in the SUBSCRIBE state
+	Private SUBSCRIBE_BATCH As Byte		= 4
+	Private SubscribeIndex As Byte		= 0
 
-	Public DELAY_AFTER_TASK As ULong	= 250
 	Public Connected As Boolean			= False
 
-	' JSON Parser
-	Private QUOTEARRAY() As Byte 		= """"
-	Private LastIndex As Int 			= 0			'ignore
+	' JSON tokenizer, parse a payload once then read the fields (see ParsePayload)
+	Public Json As JsonIndex
+	' Payload format per topic, JSON unless set from MQTTTopics.FormatTopicTable
+	Public Codec As PayloadCodec
+	' Last-known state of all devices, fields MQTTTopics.SNAPSHOT_...
+	Public Snapshot As StateSnapshot
 End Sub
 
 ' Initialize module.
 ' TODO: Consider enhancing with parameter username As String, password As String, ip() As Byte, port As UInt.
 Public Sub Initialize(CLIENTID As String, stream As Stream)
-	MQTT.Initialize(stream, BROKER_IP, BROKER_PORT, CLIENTID, "MQTT_MessageArrived", "MQTT_Disconnected")
-End Sub
+	Publisher.Initialize(stream)
+	Link.Initialize(stream, BROKER_IP, BROKER_PORT, "Link_StateChanged", "Link_Step", "Link_MessageArrived")
+	Link.SetClient(CLIENTID, USERNAME, PASSWORD)
+
+	Codec.Initialize
+	If MQTTTopics.FormatTopicFormat <> Codec.FORMAT_JSON Then
+		For Each topic As String In MQTTTopics.FormatTopicTable
+			Codec.SetTopicFormat(topic, MQTTTopics.FormatTopicFormat)
+		Next
+	End If
 
-#Region MQTT
-' Check if connected to mqtt. if not, then try again after 1 sec.
-' This sub can not return true or false, because used by callsubplus. Therefor global connected.
-' unused - Mandatory parameter as used for the callsubplus retry
-Public Sub Connect(tag As Byte)
-	Dim mqttopt As MqttConnectOptions
-	mqttopt.Initialize(USERNAME, PASSWORD)
-
-	Connected = MQTT.Connect2(mqttopt)
-
-	If Connected = False Then
-		' Log("[MQTTClient.Connect][ERROR] Trying to connect again...Retry #", MQTTRetryCounter)
-		Log("[MQTTClient.Connect][W] Trying to connect again...Retry #", RetryCounter)
-		RetryCounter = RetryCounter + 1
-		If RetryCounter <= RETRIES Then
-			CallSubPlus("Connect", 10000, 0)
-			Return 'False
-		Else
-			Log("[MQTTClient.Connect][E] Can not connect to the broker.")
-			Return 'False
+	Snapshot.Initialize("Snapshot_Due")
+	For i = 0 To MQTTTopics.SnapshotKeys.Length - 1
+		If Snapshot.Add(MQTTTopics.SnapshotKeys(i), MQTTTopics.SnapshotDecimals(i)) = Snapshot.INVALID_FIELD Then
+			Log("[MQTTClient.Initialize][E] Snapshot field not added, key=", MQTTTopics.SnapshotKeys(i))
 		End If
+	Next
+	Snapshot.Interval = MQTTTopics.SNAPSHOT_INTERVAL
+	Snapshot.Holdoff = MQTTTopics.SNAPSHOT_HOLDOFF
+	' Sensors read every few seconds go out with the next snapshot
+	Snapshot.SetFieldHoldoff(MQTTTopics.SNAPSHOT_TEMPERATURE, MQTTTopics.SNAPSHOT_SENSOR_HOLDOFF)
+	Snapshot.SetFieldHoldoff(MQTTTopics.SNAPSHOT_HUMIDITY, MQTTTopics.SNAPSHOT_SENSOR_HOLDOFF)
+	Snapshot.SetFieldHoldoff(MQTTTopics.SNAPSHOT_MOISTURE, MQTTTopics.SNAPSHOT_SENSOR_HOLDOFF)
+
+	OutQueue.Initialize(Publisher, OUTQUEUE_DEPTH, "OutQueue_Replayed")
+	For Each topic As String In MQTTTopics.LatestOnlyTable
+		OutQueue.AddLatestOnly(topic)
+	Next
+	' Flash spill requires #DefineExtra: #define ROUTBOX_FLASH
+	If OutQueue.EnableFlash Then
+		Log("[MQTTClient.Initialize][I] Outbound queue flash spill enabled, pending=", OutQueue.FlashCount)
 	End If
-	
-	' MQTT connected. Reset the retrycounter
-	RetryCounter = 0
-	Log("[MQTTClient.Connect][I] OK")
-	Delay(500)
-
-	Return 'True
 End Sub
 
-' MQTT disconnected.
-' If the server is nor reachable, then MQTT is disconnected.
-' After 5 seconds, retry to connect again.
-Private Sub MQTT_Disconnected
-	Log("[MQTTClient.MQTT_Disconnected][W] Disconnected > start retrying.")
-	Connected = False
-	MQTT.Close
+#Region MQTT
+' Connection step, raised once per main loop pass in the SUBSCRIBE state
+' (CONNECT and the CONNACK wait are handled by the connector, timeout Link.ConnackTimeout).
+' Subscribe the next SUBSCRIBE_BATCH topics of MQTTTopics.SubscribeTable, Link.Advance when all are done.
+' A failed subscribe write has already failed the link (backoff).
+Private Sub Link_Step(state As Byte)
+	If state <> Link.STATE_SUBSCRIBE Then Return
+	' Wildcard subscriptions, e.g. homekit32/home1/+/set, routed by MQTTTopics.GetTopicIndex
+	Dim count As Byte = 0
+	Do While SubscribeIndex < MQTTTopics.SubscribeTable.Length And count < SUBSCRIBE_BATCH
+		If Link.Subscribe(MQTTTopics.SubscribeTable(SubscribeIndex), 1) = False Then
+			Log("[MQTTClient.Link_Step][W] Subscribe failed, topic=", MQTTTopics.SubscribeTable(SubscribeIndex))
+			Link.Fail
+			Return
+		End If
+		SubscribeIndex = SubscribeIndex + 1
+		count = count + 1
+	Loop
+	If SubscribeIndex = MQTTTopics.SubscribeTable.Length Then Link.Advance
+End Sub
 
-	' Retry MQTT connection after delay (e.g. 10 seconds)
-	CallSubPlus("Connect", 10000, 0)
+' Connection state changed.
+' SUBSCRIBE: the CONNACK was received, the session is up.
+' READY: replay the messages queued while disconnected, the info is published when done (OutQueue_Replayed).
+' BACKOFF: the connection is down, publishes are queued until READY.
+Private Sub Link_StateChanged(state As Byte)
+	WiFiMgr.Connected = Link.WiFiConnected
+	If state = Link.STATE_SUBSCRIBE Then
+		Connected = True
+		SubscribeIndex = 0
+	Else If state = Link.STATE_READY Then
+		Log("[MQTTClient.Link_StateChanged][I] OK, ms=", Link.LastConnectTime, ", subscribed=", SubscribeIndex)
+		Dim backlog As Boolean = OutQueue.Count > 0 Or OutQueue.FlashCount > 0
+		OutQueue.Connected = True
+		If Not(backlog) Then PublishSystemInfo
+		' Refresh the retained snapshot after the reconnect
+		Snapshot.Request
+	Else If state = Link.STATE_BACKOFF Then
+		Log("[MQTTClient.Link_StateChanged][W] Retry in ms=", Link.LastDelay, ", attempt=", Link.Attempts, ", wifi=", WiFiMgr.Connected, _
+			", connack=", Link.ConnackCode, ", missedpings=", Link.MissedPingCount)
+		OutQueue.Connected = False
+		Connected = False
+	End If
+	CommMQTT.LinkStateChanged(state)
 End Sub
 
-' Handle MQTT Message arrived.
-' IMPORTANT: In main the event must be created MQTT_MessageArrived(topic, payload)
-Private Sub MQTT_MessageArrived(Topic As String, Payload() As Byte)
-	' Log("[MQTT_MessageArrived] Topic=", Topic, ", Payload=", Payload)
+' Handle MQTT Message arrived, raised by the connector for each received PUBLISH (QoS 1 is acknowledged).
+' The topic and payload are valid during the call only.
+Private Sub Link_MessageArrived(Topic As String, Payload() As Byte)
+	' Log("[Link_MessageArrived] Topic=", Topic, ", Payload=", Payload)
 	CommMQTT.MQTT_MessageArrived(Topic, Payload)
 End Sub
 
@@ -114,26 +170,23 @@ Public Sub Subscribe(topics() As String)
 
 	' Loop over the topics and add
 	For Each Topic As String In topics
-		MQTT.Subscribe(Topic, 1)		
+		If Link.Subscribe(Topic, 1) = False Then
+			Log("[MQTTClient.Subscribe][E] Subscribe failed, topic=", Topic)
+			Return
+		End If
 	Next
 End Sub
 
 ' Publish sensor values to the MQTT broker
 ' messages - Array with messages.
+' Messages published while not connected are queued and replayed after the reconnect.
 Public Sub Publish(topics() As String, payloads() As String)
-	' Leave if not connected
-	If Not(Connected) Then
-		Log("[MQTTClient.Publish][E] MQTT is not connected.")
-		Return
-	End If
-
 	For i = 0 To topics.Length - 1
 		If LOGGING Then 
 			Log("[MQTTClient.Publish][I] topic=", topics(i), ", payload=", payloads(i))
 		End If
-		PublishChunked(topics(i), payloads(i).GetBytes, True)
-		' HINT
-		' Publish2 can be used if payload length < 128		
+		' GetBytes shares the memory of the string, no copy
+		PublishBytes(topics(i), payloads(i).GetBytes, True)
 	Next
 	'If LOGGING Then Log("[MQTTMod Publish] Done")
 End Sub
@@ -154,141 +207,206 @@ Public Sub Remove(topics() As String)
 		If LOGGING Then
 			Log("[MQTTClient.Remove][I] topic=", topics(i))
 		End If
-		MQTT.Publish2(topics(i), b, True)
+		Publisher.Publish(topics(i), b, True)
 	Next
 	Log("[MQTTClient.Remove][I]  Done")
 End Sub
 
-' Sends a large MQTT message in chunks
+' Publish a payload byte array, written to the socket without copying.
+' If not connected or older messages are waiting, the message is queued (copied).
+' A JSON payload of a CBOR or MessagePack topic is transcoded first (Codec).
 ' Parameters:
 '   topic - the topic string (e.g. "homeassistant/sensor/xyz/config")
 '   payload() - the payload as a byte array
 '   retain - whether to retain the message on the broker
-Private Sub PublishChunked(topic As String, payload() As Byte, retain As Boolean)
-	Dim length As Int = payload.Length
-	Dim result As Boolean
-	Dim CHUNK_SIZE As Int = 32
-	Dim buffer(CHUNK_SIZE) As Byte
+Public Sub PublishBytes(topic As String, payload() As Byte, retain As Boolean)
+	If DeviceTopicSuppressed(topic) Then Return
+	Dim format As Byte = Codec.TopicFormat(topic)
+	If format <> Codec.FORMAT_JSON And payload.Length > 0 Then
+		PublishEncoded(topic, Codec.Transcode(payload, format), retain)
+	Else
+		PublishEncoded(topic, payload, retain)
+	End If
+End Sub
 
+' Publish a payload already in the format of the topic.
+Private Sub PublishEncoded(topic As String, payload() As Byte, retain As Boolean)
+	If OutQueue.Publish(topic, payload, retain) = False Then
+		If OutQueue.LastError = OutQueue.ERROR_PAYLOAD_TOO_LARGE Then
+			' Only stored up to OutQueue.TOPIC_SIZE / PAYLOAD_SIZE, sent directly when connected and nothing is queued
+			Log("[MQTTClient.PublishEncoded][E] Too large to queue, topic=", topic, ", length=", payload.Length, ", max=", OutQueue.PAYLOAD_SIZE)
+		Else
+			Log("[MQTTClient.PublishEncoded][E] Dropped, queue full, topic=", topic)
+		End If
+		Return
+	End If
 	If LOGGING Then
-		Log("[MQTTClient.PublishChunked][I] topic=", topic)
+		Log("[MQTTClient.PublishEncoded][I] topic=", topic, ", length=", payload.Length, _
+			", us=", Publisher.LastDuration, ", b4rstack=", Publisher.B4RStack, ", nativefree=", Publisher.StackFree)
 	End If
+End Sub
 
-	If MQTT.BeginPublish(topic, length, retain) = False Then
-		Log("[MQTTClient.PublishChunked][E] BeginPublish failed.")
+' Render a precompiled payload template in the format of the topic and publish it,
+' see MQTTTopics.Template... The fields must be set before, e.g. template.SetLong("S", 1).
+' Parameters:
+'   topic - the topic string
+'   template - the payload template
+'   retain - whether to retain the message on the broker
+Public Sub PublishTemplate(topic As String, template As PayloadTemplate, retain As Boolean)
+	If DeviceTopicSuppressed(topic) Then Return
+	Dim payload() As Byte = template.RenderAs(Codec.TopicFormat(topic))
+	If payload.Length = 0 Then
+		Log("[MQTTClient.PublishTemplate][E] Payload exceeds the template buffer, topic=", topic)
 		Return
 	End If
+	PublishEncoded(topic, payload, retain)
+End Sub
 
-	Dim i As Int
-	Do While i < length
-		Dim remaining As Int = length - i
-		Dim thisChunkSize As Int = Min(CHUNK_SIZE, remaining)
-
-		' Copy this chunk into the buffer
-		For j = 0 To thisChunkSize - 1
-			buffer(j) = payload(i + j)
-		Next
+' Publish a payload given in parts, e.g. template text and values,
+' without joining them first. Each part is written to the socket directly.
+' Parameters:
+'   topic - the topic string
+'   parts() - the payload parts
+'   retain - whether to retain the message on the broker
+' Example:
+' MQTTClient.PublishParts(topic, Array As String("{""m"":", value, "}"), True)
+Public Sub PublishParts(topic As String, parts() As String, retain As Boolean)
+	If DeviceTopicSuppressed(topic) Then Return
+	' Queued messages keep the order, the parts are joined for the queue.
+	' Binary topics are joined and transcoded.
+	If Not(Connected) Or OutQueue.Count > 0 Or OutQueue.FlashCount > 0 Or Codec.TopicFormat(topic) <> Codec.FORMAT_JSON Then
+		PublishBytes(topic, JoinStrings(parts).GetBytes, retain)
+		Return
+	End If
 
-		' Create an exact-size array to pass
-		Dim actualChunk(thisChunkSize) As Byte
-		For j = 0 To thisChunkSize - 1
-			actualChunk(j) = buffer(j)
-		Next
+	Dim length As ULong = 0
+	For Each part As String In parts
+		length = length + part.Length
+	Next
 
-		result = MQTT.WriteChunk(actualChunk)
-		If result = False Then
-			Log("[MQTTClient.PublishChunked][E] WriteChunk failed at offset ", i)
-			MQTT.EndPublish
-			Return
-		End If
+	' A failed publish closes the socket, the connector reconnects (Link_StateChanged).
+	If Publisher.Begin(topic, length, retain) = False Then
+		Log("[MQTTClient.PublishParts][E] Begin failed, topic=", topic)
+		Return
+	End If
+	For Each part As String In parts
+		Publisher.Write(part.GetBytes)
+	Next
+	If Publisher.EndPublish = False Then
+		Log("[MQTTClient.PublishParts][E] Write failed, topic=", topic)
+	End If
+End Sub
 
-		i = i + thisChunkSize
-	Loop
+' True if the topic is a per-device status topic and these are switched off,
+' the state is published with the snapshot only (MQTTTopics.DeviceTopics).
+Private Sub DeviceTopicSuppressed(topic As String) As Boolean
+	If MQTTTopics.DeviceTopics Then Return False
+	For Each t As String In MQTTTopics.SnapshotTopicTable
+		If t = topic Then Return True
+	Next
+	Return False
+End Sub
 
-	result = MQTT.EndPublish
-	If LOGGING Then 
-		Log("[MQTTClient.PublishChunked][I] result=", result)
+' Snapshot due: on change, periodically or after the reconnect (Snapshot.Request).
+' Rendered in the format of TOPIC_SNAPSHOT and published retained.
+' Parameters:
+'	changed - Bitmap of the changed fields, bit n is MQTTTopics.SnapshotKeys(n)
+Private Sub Snapshot_Due(changed As ULong)
+	Dim payload() As Byte = Snapshot.Render(Codec.TopicFormat(MQTTTopics.TOPIC_SNAPSHOT))
+	If payload.Length = 0 Then
+		Log("[MQTTClient.Snapshot_Due][E] Snapshot exceeds the buffer, fields=", Snapshot.FieldCount)
+		Return
 	End If
+	If LOGGING Then
+		Log("[MQTTClient.Snapshot_Due][I] seq=", Snapshot.Sequence, ", changed=", changed, ", length=", payload.Length)
+	End If
+	PublishEncoded(MQTTTopics.TOPIC_SNAPSHOT, payload, True)
+End Sub
+
+' Publish the uptime and the outbound queue counters to TOPIC_SYSTEM_INFO.
+' {"u":uptime s,"q":queued RAM,"f":queued flash,"w":high-water,"x":dropped,"k":compacted,"n":last replay messages,"r":last replay ms}
+Public Sub PublishSystemInfo
+	MQTTTopics.TemplateSystemInfo.SetLong("U", Millis / 1000)
+	MQTTTopics.TemplateSystemInfo.SetLong("Q", OutQueue.Count)
+	MQTTTopics.TemplateSystemInfo.SetLong("F", OutQueue.FlashCount)
+	MQTTTopics.TemplateSystemInfo.SetLong("W", OutQueue.HighWater)
+	MQTTTopics.TemplateSystemInfo.SetLong("X", OutQueue.DroppedCount)
+	MQTTTopics.TemplateSystemInfo.SetLong("K", OutQueue.CompactedCount)
+	MQTTTopics.TemplateSystemInfo.SetLong("N", LastReplayCount)
+	MQTTTopics.TemplateSystemInfo.SetLong("R", OutQueue.LastReplayTime)
+	PublishTemplate(MQTTTopics.TOPIC_SYSTEM_INFO, MQTTTopics.TemplateSystemInfo, True)
+End Sub
+
+' Replay after reconnect done.
+' Parameters:
+'	count - Number of messages replayed
+Private Sub OutQueue_Replayed(count As ULong)
+	LastReplayCount = count
+	Log("[MQTTClient.OutQueue_Replayed][I] messages=", count, ", ms=", OutQueue.LastReplayTime, ", dropped=", OutQueue.DroppedCount, _
+		", oversize=", OutQueue.OversizeCount)
+	PublishSystemInfo
+End Sub
+
+' Log the publish counters and the stack usage per publish.
+' B4R stack: stack buffer in use when publishing (#StackBufferSize),
+' native free: lowest free stack of the main loop task.
+Public Sub LogPublishStats
+	Log("[MQTTClient.LogPublishStats][I] published=", Publisher.PublishCount, _
+		", errors=", Publisher.ErrorCount, _
+		", bytes=", Publisher.BytesSent, _
+		", writes=", Publisher.WriteCalls, _
+		", lastus=", Publisher.LastDuration)
+	Log("[MQTTClient.LogPublishStats][I] b4rstack=", Publisher.B4RStack, _
+		", b4rstackmax=", Publisher.B4RStackMax, _
+		", nativefree=", Publisher.StackFree)
+	Log("[MQTTClient.LogPublishStats][I] encoded=", Codec.EncodeCount, _
+		", json=", Codec.FailCount, _
+		", jsonbytes=", Codec.JsonBytes, _
+		", encodedbytes=", Codec.EncodedBytes)
+	Log("[MQTTClient.LogPublishStats][I] snapshots=", Snapshot.SnapshotCount, _
+		", changes=", Snapshot.ChangeCount, _
+		", overflow=", Snapshot.OverflowCount, _
+		", snapshotbytes=", Snapshot.LastLength)
 End Sub
 
 ' Publish the state of a device after f.e. an operation.
 ' state - True or False
 ' Returns JSON string {"s":0-1}
 Public Sub PublishDeviceState(topic As String, state As Boolean)
-	Dim statestr As String
-	If state Then
-		statestr = "1"
-	Else
-		statestr = "0"
-	End If
-	Dim payload() As Byte = Convert.ReplaceString(MQTTTopics.PAYLOAD_STATE, "#S", statestr)
-	Publish(Array As String(topic), _ 
-			Array As String(Convert.ByteConv.StringFromBytes(payload)))
+	MQTTTopics.TemplateState.SetLong("S", IIf(state, 1, 0))
+	PublishTemplate(topic, MQTTTopics.TemplateState, True)
 End Sub
 #End Region
 
 #Region JSON GETTER
 
+' Parse a payload once into MQTTClient.Json, then read typed fields with
+' Json.GetLong / GetDouble / GetText. The payload must stay valid while reading.
+' JSON objects, CBOR maps and MessagePack maps are accepted (detected from the first byte).
+' Returns False if the payload is not an object/map (all fields missing).
+' Example:
+' MQTTClient.ParsePayload(payload)
+' Dim red As Byte = MQTTClient.Json.GetLong("r", 0)
+Public Sub ParsePayload (json() As Byte) As Boolean
+	If Json.ParseAuto(json) Then Return True
+	Log("[MQTTClient.ParsePayload][E] Invalid payload (format ", Json.Format, ") at position ", Json.ErrorPosition)
+	Return False
+End Sub
+
 ' JSON Get Text Value from Key.
-' Note: Can not handle if the text is not enclosed between "".
-' Returns array as Byte.
+' Parses the payload for a single key, use ParsePayload to read several keys.
+' Returns the text (empty if key not found).
 Public Sub GetTextFromKey (json() As Byte, jsonkey() As Byte) As Byte()
-	Dim MAXSIZE As Int = 20
-	Dim buffer(MAXSIZE) As Byte
-	
-	GetTextValueFromKey(json, jsonkey, 0, buffer, MAXSIZE)
-	' Log("[MQTTClient.GetTextFromKey] jsonkey=",jsonkey,",buffer=", buffer)
-	' [MQTTClient.GetTextFromKey] jsonkey=state,buffer=on
-	Return buffer
+	Json.Parse(json)
+	Return Json.GetText(Convert.ByteConv.StringFromBytes(jsonkey))
 End Sub
 
 ' JSON Get Number Value from Key.
-' Note: Can not handle if the value in enclosed between "". 
-' Return double.
+' Parses the payload for a single key, use ParsePayload to read several keys.
+' Returns the number, -1 if key not found.
 Public Sub GetNumberFromKey (json() As Byte, jsonkey() As Byte) As Double
-	Return GetNumberValueFromKey(json, jsonkey, 0)
-End Sub
-
-' JSON Get Text Value from Key   
-' Dim MaxSize As Int = 20
-' Dim buffer(MaxSize) As Byte
-' GetTextValueFromKey(jsontext, "get_status", 0, buffer, MaxSize)
-Private Sub GetTextValueFromKey (json() As Byte, Key() As Byte, StartIndex As Int, ResultBuffer() As Byte, MaxLength As UInt)	'ignore
-	Dim qkey() As Byte = JoinBytes(Array(QUOTEARRAY, Key, QUOTEARRAY))
-	Dim i As Int = Convert.ByteConv.IndexOf2(json, qkey, StartIndex)
-	If i = -1 Then
-		Convert.ByteConv.ArrayCopy(Array As Byte(), ResultBuffer)
-		Return
-	End If
-	Dim i1 As Int = Convert.ByteConv.IndexOf2(json, QUOTEARRAY, i + qkey.Length + 1)
-	Dim i2 As Int = Convert.ByteConv.IndexOf2(json, QUOTEARRAY, i1 + 1)
-	Convert.ByteConv.ArrayCopy(Convert.ByteConv.SubString2(json, i1 + 1, Min(i2, i1 + 1 + MaxLength)), ResultBuffer)
-	LastIndex = i2
-End Sub
-
-' JSON Get Number Value from Key. If key not found, -1 is returned.
-' Dim MaxSize As Int = 20
-' Dim buffer(MaxSize) As Byte
-' Log(GetNumberValueFromKey(jsontext, "value", 0))
-' Log(GetNumberValueFromKey(jsontext, "value", LastIndex)) 'second value
-Private Sub GetNumberValueFromKey (json() As Byte, Key() As Byte, StartIndex As Int) As Double	'ignore
-	Dim qkey() As Byte = JoinBytes(Array(QUOTEARRAY, Key, QUOTEARRAY))
-	Dim i As Int = Convert.ByteConv.IndexOf2(json, qkey, StartIndex)
-	If i = -1 Then Return -1
-	Dim colon As Int = Convert.ByteConv.IndexOf2(json, ":", i + qkey.Length)
-	Dim i2 As Int = 0
-	For Each c As String In Array As String(",", "}", "]")
-		i2 = Convert.ByteConv.IndexOf2(json, c, colon + 1)
-		If i2 <> -1 Then
-			Exit
-		End If
-	Next
-	Dim res() As Byte = Convert.ByteConv.SubString2(json, colon + 1, i2)
-	LastIndex = i2 + 1
-	res = Convert.ByteConv.Trim(res)
-	Dim s As String = Convert.ByteConv.StringFromBytes(res)
-	Dim value As Double = s
-	Return value
+	Json.Parse(json)
+	Return Json.GetDouble(Convert.ByteConv.StringFromBytes(jsonkey), -1)
 End Sub
 #End Region
 
@@ -47,7 +47,13 @@ Version=4
 '				| ip       |   p      |   #P        | "p":"N.N.N.N"  |
 '				| fan speed|   v      |   #V        | "v":50         |
 '				| events   |   e      |   #S        | "e":0 | 1      |
-' Dependencies:	n/a
+'				Outgoing payloads with placeholders are precompiled once in Initialize
+'				(Template...) and rendered typed, e.g. TemplateDHT11Status.SetFloat("T", t, 1).
+'				Topics in FormatTopicTable are published as CBOR or MessagePack maps with
+'				the same keys (FormatTopicFormat), all other topics as JSON.
+'				The state of all devices is also published as one retained snapshot
+'				(TOPIC_SNAPSHOT), the per-device status topics are optional (DeviceTopics).
+' Dependencies:	rTopicRouter, rPayloadTemplate
 ' ================================================================
 #End Region
 
@@ -270,18 +276,65 @@ Private Sub Process_Globals
 	' Example: {"e":1}
 	Public TOPIC_SYSTEM_INFO As String 					= "homekit32/home1/system/info"
 	' Example: {"u":123456, "a":"192.168.1.55"} holding uptime, ip address
+	Public PAYLOAD_SYSTEM_INFO As String				= "{""u"":#U,""q"":#Q,""f"":#F,""w"":#W,""x"":#X,""k"":#K,""n"":#N,""r"":#R}"
+	' Example: {"u":3600,"q":0,"f":0,"w":5,"x":0,"k":3,"n":5,"r":40} uptime (s) and outbound queue:
+	' queued in RAM, queued in flash, high-water, dropped, compacted, last replay messages and time (ms)
 
 	'==============================
 	' System Info / Debug / Error
 	'==============================
 	Public TOPIC_SYSTEM_ERROR As String 				= "homekit32/home1/error"
 	' Example: {"m":"sensor timeout" }
+	Public PAYLOAD_SYSTEM_ERROR As String				= "{""m"":""#M"",""c"":#C,""i"":#I}"
+	' Example: {"m":"queue","c":1,"i":5} command queue error code and topic index of the rejected message
+
+	'==============================
+	' Home State Snapshot
+	' One retained message with the last-known state of all devices (MQTTClient.Snapshot, rStateSnapshot).
+	' Published on change (after SNAPSHOT_HOLDOFF, DHT11/moisture after SNAPSHOT_SENSOR_HOLDOFF)
+	' and every SNAPSHOT_INTERVAL ms.
+	' seq: sequence number (restarts at 1 after a reboot), chg: bit n set if SnapshotKeys(n) changed.
+	' Unknown states (not yet reported) are null.
+	'==============================
+	Public TOPIC_SNAPSHOT As String 					= "homekit32/home1/snapshot"
+	' Example: {"seq":42,"chg":96,"led":1,"rgb":0,"dr":0,"wn":1,"fan":0,"t":21.5,"h":45.0,"m":1874,"gas":0,"pir":1}
+	' Field indexes, same order as SnapshotKeys
+	Public SNAPSHOT_YELLOW_LED As Byte					= 0		' 0 off, 1 on, or the PWM value
+	Public SNAPSHOT_RGB_LED As Byte						= 1		' 0 cleared, 1 set
+	Public SNAPSHOT_SERVO_DOOR As Byte					= 2		' 0 closed, 1 open
+	Public SNAPSHOT_SERVO_WINDOW As Byte				= 3		' 0 closed, 1 open
+	Public SNAPSHOT_FAN As Byte							= 4		' Speed 0-1023 (255 = on)
+	Public SNAPSHOT_TEMPERATURE As Byte					= 5		' Celsius, 1 decimal
+	Public SNAPSHOT_HUMIDITY As Byte					= 6		' %, 1 decimal
+	Public SNAPSHOT_MOISTURE As Byte					= 7		' Analog value
+	Public SNAPSHOT_GAS As Byte							= 8		' 1 detected
+	Public SNAPSHOT_MOTION As Byte						= 9		' 1 detected
+	Public SnapshotKeys() As String = Array As String("led", "rgb", "dr", "wn", "fan", "t", "h", "m", "gas", "pir")
+	Public SnapshotDecimals() As Byte = Array As Byte(0, 0, 0, 0, 0, 1, 1, 0, 0, 0)
+	Public SNAPSHOT_INTERVAL As ULong					= 60000
+	Public SNAPSHOT_HOLDOFF As ULong					= 1000
+	Public SNAPSHOT_SENSOR_HOLDOFF As ULong				= 30000
+
+	' Per-device status topics. False: the SnapshotTopicTable topics are not published,
+	' the snapshot carries their state (one message instead of one per device).
+	Public DeviceTopics As Boolean = True
+	Public SnapshotTopicTable() As String = Array As String( _
+		TOPIC_YELLOW_LED_STATUS, _
+		TOPIC_RGB_LED_STATUS, _
+		TOPIC_SERVO_DOOR_STATUS, _
+		TOPIC_SERVO_WINDOW_STATUS, _
+		TOPIC_FAN_STATUS, _
+		TOPIC_DHT11_STATUS, _
+		TOPIC_MOISTURE_STATUS, _
+		TOPIC_GAS_SENSOR_STATUS, _
+		TOPIC_PIR_SENSOR_STATUS)
 
 	'==============================
 	' Global Topics Table
 	'==============================
 
-	' Define all topics in the same order as handler subs.
+	' Define all subscribed topics. The device modules register their ProcessMQTT
+	' against GetTopicIndex(topic), the order is free.
 	' Max number of topics is 254
 	Public TopicTable() As String = Array As String( _ 
 		TOPIC_COMMAND, _ 
@@ -300,15 +353,117 @@ Private Sub Process_Globals
 
 	' Max number of topics is 254 > 255 is used in case topic not found
 	Public TOPIC_NOT_FOUND As Byte = 255
+
+	'==============================
+	' Subscriptions
+	' One wildcard subscription per action instead of one per topic.
+	' Received topics are routed to the TopicTable index by the topic router (prefix trie).
+	'==============================
+	Public TOPIC_SUBSCRIBE_SET As String				= "homekit32/home1/+/set"
+	Public TOPIC_SUBSCRIBE_GET As String				= "homekit32/home1/+/get"
+	Public TOPIC_SUBSCRIBE_ACTION As String				= "homekit32/home1/+/action"
+	Public SubscribeTable() As String = Array As String( _
+		TOPIC_COMMAND, _
+		TOPIC_SUBSCRIBE_SET, _
+		TOPIC_SUBSCRIBE_GET, _
+		TOPIC_SUBSCRIBE_ACTION)
+
+	'==============================
+	' Latest-only Topics
+	' State topics of which only the latest message is replayed after a broker outage.
+	' Event topics (rfid, gas, motion, buttons, error) are replayed completely.
+	'==============================
+	Public LatestOnlyTable() As String = Array As String( _
+		TOPIC_YELLOW_LED_STATUS, _
+		TOPIC_RGB_LED_STATUS, _
+		TOPIC_SERVO_DOOR_STATUS, _
+		TOPIC_SERVO_WINDOW_STATUS, _
+		TOPIC_BUZZER_STATUS, _
+		TOPIC_FAN_STATUS, _
+		TOPIC_DHT11_STATUS, _
+		TOPIC_MOISTURE_STATUS, _
+		TOPIC_LCD_STATUS, _
+		TOPIC_SYSTEM_STATUS, _
+		TOPIC_SYSTEM_INFO, _
+		TOPIC_SNAPSHOT)
+
+	'==============================
+	' Payload Format
+	' Binary format of the FormatTopicTable topics: 0 JSON (default), 1 CBOR, 2 MessagePack.
+	' High-rate sensor topics only, the consumers must decode the format
+	' (Python: clients/python/hk32gui/mqtt/payload_codec.py). See MQTTClient.Codec.
+	'==============================
+	Public FormatTopicFormat As Byte = 0
+	Public FormatTopicTable() As String = Array As String( _
+		TOPIC_DHT11_STATUS, _
+		TOPIC_MOISTURE_STATUS, _
+		TOPIC_SYSTEM_INFO)
+
+	' Topic router, TopicTable topics with their index as route id
+	Private Router As TopicRouter
+
+	'==============================
+	' Payload Templates
+	' Precompiled in Initialize, see PublishTemplate in MQTTClient.
+	'==============================
+	Public TemplateState As PayloadTemplate
+	Public TemplateFanStatus As PayloadTemplate
+	Public TemplateDHT11Status As PayloadTemplate
+	Public TemplateMoistureStatus As PayloadTemplate
+	Public TemplateRFIDStatus As PayloadTemplate
+	Public TemplateSystemError As PayloadTemplate
+	Public TemplateSystemInfo As PayloadTemplate
+End Sub
+
+' Initialize
+' Builds the topic router from the TopicTable.
+' Must be called before GetTopicIndex (device module registration).
+Public Sub Initialize
+	Router.Initialize("Router_Error")
+	For i = 0 To TopicTable.Length - 1
+		Router.Add(TopicTable(i), i)
+	Next
+	Log("[MQTTTopics.Initialize][I] topics=", TopicTable.Length, ", nodes=", Router.NodeCount, "/", Router.MAX_NODES, ", textbytes=", Router.TextUsed)
+
+	' Parse the payload templates once
+	InitTemplate(TemplateState, PAYLOAD_STATE)
+	InitTemplate(TemplateFanStatus, PAYLOAD_FAN_STATUS)
+	InitTemplate(TemplateDHT11Status, PAYLOAD_DHT11_STATUS)
+	InitTemplate(TemplateMoistureStatus, PAYLOAD_MOISTURE_STATUS)
+	InitTemplate(TemplateRFIDStatus, PAYLOAD_RFID_STATUS)
+	InitTemplate(TemplateSystemError, PAYLOAD_SYSTEM_ERROR)
+	InitTemplate(TemplateSystemInfo, PAYLOAD_SYSTEM_INFO)
+End Sub
+
+' Parse a payload template into its segments.
+' Parameters:
+'	template - Template object
+'	payload - Payload with #X placeholders
+Private Sub InitTemplate(template As PayloadTemplate, payload As String)
+	If template.Initialize(payload) = False Then
+		Log("[MQTTTopics.InitTemplate][E] Template error ", template.Error, ": ", payload)
+	End If
 End Sub
 
 ' Get the topic index for a topic.
+' Matched by the topic router in O(topic length).
 ' Returns index found or 255 if not found
 Public Sub GetTopicIndex(topic As String) As Byte
-	For i = 0 To TopicTable.Length - 1
-		If topic = TopicTable(i) Then 
-			Return i
-		End If
-	Next
-	Return 255
+	Return Router.Match(topic)
+End Sub
+
+' Handle topic router errors.
+' Parameters:
+'	code - Router error code
+Private Sub Router_Error(code As Byte)
+	Select code
+		Case Router.ERROR_NODES_FULL, Router.ERROR_TEXT_FULL
+			Log("[MQTTTopics.Router_Error][E] Router pool full, increase RTOPICROUTER_MAX_NODES / RTOPICROUTER_TEXT_SIZE.")
+		Case Router.ERROR_INVALID_FILTER
+			Log("[MQTTTopics.Router_Error][E] Invalid topic filter.")
+		Case Router.ERROR_DUPLICATE
+			Log("[MQTTTopics.Router_Error][E] Duplicate topic in TopicTable.")
+		Case Router.ERROR_TOPIC_TOO_LONG
+			Log("[MQTTTopics.Router_Error][E] Received topic too long.")
+	End Select
 End Sub
@@ -11,7 +11,7 @@ Version=4
 ' Brief:       	Handle menus using buttons left & right 
 ' Date:        	2025-11-12
 ' Author:      	Robert W.B. Linn (c) 2025 MIT
-' Dependencies: rGlobalStoreEx.b4x
+' Dependencies: rGlobalStoreEx.b4x, rGpioInput
 ' Description:	Butten left to select a menu item.
 '				Button right to set the state of the selected menu item.
 ' Hardware:		https://wiki.keyestudio.com/Ks0029_keyestudio_Digital_Push_Button
@@ -19,16 +19,11 @@ Version=4
 #End Region
 
 Private Sub Process_Globals
-	Private DEBOUNCE_MS As UInt = 500
+	' Contact bounce: edges less than DEBOUNCE_US apart are one press or release
+	Private DEBOUNCE_US As ULong = 30000
 
-	Private BtnLeft As Pin
-	Private BtnRight As Pin
-	
-	' Firsttime flag to avoid button state change for state true (released)
-	Private BtnLeftFirstTime As Boolean = True
-	Private BtnRightFirstTime As Boolean = True
-	Private BtnLeftLastChange As ULong = 1
-	Private BtnRightLastChange As ULong = 1
+	Private BtnLeft As GpioInput
+	Private BtnRight As GpioInput
 	
 	' Menu Items
 	Private MENU_LED=0, MENU_DHT11=1, MENU_EVENTS=2, MENU_Info=3 As Byte
@@ -43,34 +38,23 @@ End Sub
 '   btnleftpinnr - GPIO pin number
 '   btnrightpinnr - GPIO pin number
 Public Sub Initialize(btnleftpinnr As Byte, btnrightpinnr As Byte)
-	BtnLeft.Initialize(DeviceMgr.BTN_LEFT_PIN, BtnLeft.MODE_INPUT)
-	BtnRight.Initialize(DeviceMgr.BTN_RIGHT_PIN, BtnRight.MODE_INPUT)
-
-	' Add buttons state change listen
-	BtnLeft.AddListener("BtnLeft_StateChanged")
-	BtnRight.AddListener("BtnRight_StateChanged")
+	' Buttons state change events (not raised for the state at start)
+	BtnLeft.Initialize(DeviceMgr.BTN_LEFT_PIN, BtnLeft.MODE_INPUT, "BtnLeft_StateChanged")
+	BtnLeft.DebounceMicros = DEBOUNCE_US
+	BtnRight.Initialize(DeviceMgr.BTN_RIGHT_PIN, BtnRight.MODE_INPUT, "BtnRight_StateChanged")
+	BtnRight.DebounceMicros = DEBOUNCE_US
 
 	Log("[MenuHandler.Initialize][I] BtnLeft OK, pin=", btnleftpinnr, ", BtnRight OK, pin=", btnrightpinnr)
 End Sub
 
 #Region ButtonEvents
 ' Handle button state changes: Pressed=state 0; Released=state 1
-' Use FirstTime flag to avoid handling buttom state 1
+' The states are debounced by GpioInput, one event per press and per release
 
 ' BtnLeft_StateChanged
 ' Menu item selection.
 '	state Boolean - Left button state. False is button pressed.
 Private Sub BtnLeft_StateChanged(state As Boolean)
-	' Do nothing if first time
-	If BtnLeftFirstTime Then
-		BtnLeftFirstTime = Not(BtnLeftFirstTime)
-		Return
-	End If
-
-	' Debounce: ignore changes faster than NNN ms
-	If (Millis - BtnLeftLastChange) < DEBOUNCE_MS Then Return
-	BtnLeftLastChange = Millis
-
 	' Log("[MenuHandler.BtnLeft_StateChanged] state=",state)
 
 	' Button is pressed
@@ -88,16 +72,6 @@ End Sub
 ' Menu item action
 '	state Boolean - Right button state. False is button pressed.
 Private Sub BtnRight_StateChanged(state As Boolean)
-	' Do nothing if first time
-	If BtnRightFirstTime Then
-		BtnRightFirstTime = Not(BtnRightFirstTime)
-		Return
-	End If
-
-	' Debounce: ignore changes faster than NNN ms
-	If (Millis - BtnRightLastChange) < DEBOUNCE_MS Then Return
-	BtnRightLastChange = Millis
-
 	' Log("[MenuHandler.BtnRight_StateChanged] state=",state)
 
 	If Not(state) Then
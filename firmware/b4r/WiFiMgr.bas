@@ -10,13 +10,12 @@ Version=4
 ' Project:		make-homekit32
 ' Brief:		WiFi methods.
 ' 				Credentials defines as process_globals (change accordingly).
-' 				There is a 15 seconds timeout in the synchronous Connect methods.
-'				- This is implemented in the library code (rESP8266WiFi.cpp - line 33 - 41).
-' 				- There is no similar timeout in the async method. It simply polls the connection state.
+'				Begin does not wait: the association is polled by the MQTT connection
+'				state machine (MQTTClient.Link), which retries with a jittered backoff.
 ' Date:			2025-11-08
 ' Author:		Robert W.B. Linn (c) 2025 MIT
 ' MQTT:			n/a
-' Dependencies:	rESP8266WiFi
+' Dependencies:	rESP8266WiFi, rMqttConnector
 ' ================================================================
 #End Region
 
@@ -27,29 +26,21 @@ Private Sub Process_Globals
 	' WiFi
 	Private SSID As String		= "***"
 	Private Password As String	= "***"
-	Private WiFi As ESP8266WiFi
 	
 	' Public vars
 	Public Connected As Boolean	= False
 	Public Client As WiFiSocket
 End Sub
 
-' Connect to the WiFi network
-' Return Boolean
-' Retval True connected
-' Retval False connection failed
-Public Sub Connect As Boolean
+' Begin
+' Starts the WiFi association and the MQTT connection state machine, returns at once.
+' The progress is reported by MQTTClient.Link_StateChanged, Connected is updated there.
+Public Sub Begin
 	' Disable WiFi sleep to ensure stable timing (important for servos)
 	RunNative("DisableWifiSleep", Null)
-	
-	
-	If WiFi.Connect2(SSID, Password) Then
-		Log("[WiFiMgr.Connect][I] OK, ip=", WiFi.LocalIp)
-		Return True
-	Else
-		Log("[WiFiMgr.Connect][E] Can not connect to the network.")
-		Return False
-	End If
+
+	MQTTClient.Link.Start(SSID, Password)
+	Log("[WiFiMgr.Begin][I] Associating, ssid=", SSID)
 End Sub
 
 #If C
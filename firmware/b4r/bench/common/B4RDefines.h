@@ -0,0 +1,74 @@
+/**
+ * @file B4RDefines.h
+ * @brief Minimal host stand-in for the B4R runtime header, shared by the Linux tests and benchmarks.
+ *
+ * Build with -I../common. Only the types and calls used by the libraries under test.
+ * Globals are inline so translation units that do not use them compile without warnings.
+ */
+
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t Byte;
+typedef uint16_t UInt;
+typedef int32_t Long;
+typedef uint32_t ULong;
+typedef double Double;
+
+/** Time, defined by each test (virtual clock). */
+uint32_t millis();
+uint32_t micros();
+
+/** Arduino Stream subset used by rMqttConnector and rMqttStream. */
+class Stream {
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int availableForWrite() { return 0; }
+    virtual size_t write(const uint8_t* data, size_t length) = 0;
+    virtual ~Stream() {}
+};
+
+namespace B4R {
+    struct B4RString {
+        const char* data;
+        uint16_t getLength() { return (uint16_t)strlen(data); }
+        void wrap(const char* text) { data = text; }
+    };
+    struct ArrayByte {
+        void* data;
+        uint16_t length;
+    };
+    struct B4RStream {
+        Stream* wrappedStream;
+    };
+    /** One object per type: the callers read it before the next one is created. */
+    template <typename T> T* StackObject() {
+        static T object;
+        return &object;
+    }
+    struct StackMemory {
+        static inline UInt cp = 0;
+        static ArrayByte* ReturnArrayOnStack(ArrayByte* arr, void* data) {
+            static char buffer[256];
+            memcpy(buffer, data, arr->length);
+            arr->data = buffer;
+            return arr;
+        }
+    };
+    union FunctionUnion {
+        void (*PollerFunction)(void*);
+    };
+    struct Pollers {
+        void (*function)(void*) = nullptr;
+        void* object = nullptr;
+        void add(FunctionUnion fu, void* o) { function = fu.PollerFunction; object = o; }
+        void run() { if (function) function(object); }
+    };
+    inline Pollers pollers;
+}
+
+#define CreateStackMemoryObject(T) (B4R::StackObject<T>())
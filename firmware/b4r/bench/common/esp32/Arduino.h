@@ -0,0 +1,34 @@
+/**
+ * @file Arduino.h
+ * @brief Declarations-only stand-in for the Arduino-ESP32 core, for syntax checks of the ESP32 branches.
+ *
+ * Build with -DESP32 -DARDUINO -I../common/esp32 -fsyntax-only. Nothing here links or runs.
+ * Only the calls used by the libraries under check.
+ */
+
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define IRAM_ATTR
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define CHANGE 0x03
+#define HIGH 0x1
+#define LOW 0x0
+
+uint32_t millis();
+uint32_t micros();
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+uint16_t analogRead(uint8_t pin);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+void attachInterruptArg(uint8_t pin, void (*handler)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+// FreeRTOS, included by the core
+unsigned int uxTaskGetStackHighWaterMark(void* task);
@@ -0,0 +1,35 @@
+/**
+ * @file WiFi.h
+ * @brief Declarations-only stand-in for the Arduino-ESP32 WiFi library (syntax checks).
+ *
+ * Stream comes from the B4R stub in ../common.
+ */
+
+#pragma once
+#include "Arduino.h"
+#include "B4RDefines.h"
+
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1 } wifi_mode_t;
+
+class WiFiClient : public Stream {
+public:
+    WiFiClient();
+    WiFiClient(int fd);
+    int available() override;
+    int read() override;
+    int availableForWrite() override;
+    size_t write(const uint8_t* data, size_t length) override;
+    uint8_t connected();
+    void stop();
+};
+
+class WiFiClass {
+public:
+    wl_status_t status();
+    bool mode(wifi_mode_t mode);
+    bool disconnect();
+    wl_status_t begin(const char* ssid, const char* password);
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,17 @@
+/**
+ * @file gpio.h
+ * @brief Declarations-only stand-in for the ESP-IDF GPIO driver (syntax checks).
+ */
+
+#pragma once
+#include "esp_timer.h"
+
+typedef enum { GPIO_NUM_0 = 0 } gpio_num_t;
+typedef enum {
+    GPIO_MODE_INPUT = 1,
+    GPIO_MODE_OUTPUT = 2,
+    GPIO_MODE_INPUT_OUTPUT = 3
+} gpio_mode_t;
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level);
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode);
@@ -0,0 +1,9 @@
+/**
+ * @file esp_random.h
+ * @brief Declarations-only stand-in for the ESP-IDF hardware RNG (syntax checks).
+ */
+
+#pragma once
+#include <stdint.h>
+
+uint32_t esp_random();
@@ -0,0 +1,20 @@
+/**
+ * @file sockets.h
+ * @brief Declarations-only stand-in for the lwIP socket API (syntax checks), on the host socket types.
+ */
+
+#pragma once
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+int lwip_socket(int domain, int type, int protocol);
+int lwip_connect(int s, const struct sockaddr* name, socklen_t namelen);
+int lwip_close(int s);
+int lwip_fcntl(int s, int cmd, int val);
+int lwip_select(int maxfdp1, fd_set* readset, fd_set* writeset, fd_set* exceptset, struct timeval* timeout);
+int lwip_getsockopt(int s, int level, int optname, void* optval, socklen_t* optlen);
+int lwip_setsockopt(int s, int level, int optname, const void* optval, socklen_t optlen);
@@ -0,0 +1,217 @@
+/**
+ * @file adc_math_test.cpp
+ * @brief Linux test: rADCService decimation, DMA frame parsing and calibration table
+ * against synthetic sample streams.
+ *
+ * Build and run from bench/rADCService:
+ *   g++ -O2 -std=c++17 -I../../libs/rADCService adc_math_test.cpp ../../libs/rADCService/ADCDecimator.cpp \
+ *       -o /tmp/adc_math_test
+ *   /tmp/adc_math_test
+ *
+ * The streams model the ADC: an input voltage plus gaussian noise, quantized
+ * to 12 bits. The oversampled mean must come closer to the input than one
+ * sample, the calibration table must follow the curve it was built from.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "ADCDecimator.h"
+
+static int failures = 0;
+
+static void Check(bool ok, const char* what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static uint16_t Quantize(double code) {
+    long c = lround(code);
+    return (uint16_t)(c < 0 ? 0 : c > 4095 ? 4095 : c);
+}
+
+// Factor setup: power of two, limits
+static void Factors() {
+    ADCDecimator d;
+    const uint16_t in[] = { 0, 1, 3, 4, 63, 64, 100, 1024, 5000 };
+    const uint16_t out[] = { 1, 1, 2, 4, 32, 64, 64, 1024, 1024 };
+    for (int i = 0; i < 9; i++) {
+        d.setup(in[i]);
+        Check(d.getFactor() == out[i], "factor");
+    }
+    // Constant input: exact, one value per block
+    d.setup(16);
+    int blocks = 0;
+    for (int i = 0; i < 160; i++) blocks += d.add(1234);
+    Check(blocks == 10 && d.count == 10 && d.raw == 1234 && d.oversampled == 1234 * 16, "constant");
+    // Full scale does not overflow
+    d.setup(1024);
+    for (int i = 0; i < 1024; i++) d.add(4095);
+    Check(d.raw == 4095 && d.oversampled == 4095 * 16, "full scale");
+    // Rounding of the mean: 3 x 10 + 11 = 10.25 -> raw 10, Q4 164
+    d.setup(4);
+    d.add(10); d.add(10); d.add(10); d.add(11);
+    Check(d.raw == 10 && d.oversampled == 164, "rounding");
+}
+
+// Noise dithers the quantization: the oversampled mean resolves fractions of a code
+static void Dither() {
+    std::mt19937 rng(3);
+    std::normal_distribution<double> noise(0, 2.0);
+    const uint16_t factors[] = { 1, 4, 16, 64, 256 };
+    printf("%-8s %-12s %-12s\n", "factor", "rms raw", "rms oversampled");
+    double previous = 1e9;
+    for (uint16_t factor : factors) {
+        ADCDecimator d;
+        d.setup(factor);
+        double errRaw = 0, errQ4 = 0;
+        int n = 0;
+        for (int k = 0; k < 400; k++) {
+            double input = 500 + k * 8.37;     // Between codes
+            for (int i = 0; i < factor; i++) d.add(Quantize(input + noise(rng)));
+            errRaw += (d.raw - input) * (d.raw - input);
+            errQ4 += (d.oversampled / 16.0 - input) * (d.oversampled / 16.0 - input);
+            n++;
+        }
+        double rmsRaw = sqrt(errRaw / n), rmsQ4 = sqrt(errQ4 / n);
+        printf("%-8u %-12.3f %-12.3f\n", factor, rmsRaw, rmsQ4);
+        // Noise 2 codes: the error falls with sqrt(factor), down to the 1/16 code step
+        Check(rmsQ4 < previous, "oversampling gain");
+        Check(rmsQ4 < 2.0 / sqrt((double)factor) * 1.3 + 0.05, "oversampling error");
+        previous = rmsQ4;
+    }
+}
+
+// Sine through the decimator: values follow the signal with the block delay
+static void Sine() {
+    std::mt19937 rng(5);
+    std::normal_distribution<double> noise(0, 3.0);
+    const double rate = 20000, hz = 1.0;
+    ADCDecimator d;
+    d.setup(64);
+    double worst = 0;
+    for (int i = 0; i < 40000; i++) {
+        double t = i / rate;
+        if (d.add(Quantize(2048 + 1500 * sin(2 * M_PI * hz * t) + noise(rng)))) {
+            // Block mean is the signal at the block center
+            double center = (i - 31.5) / rate;
+            double expect = 2048 + 1500 * sin(2 * M_PI * hz * center);
+            worst = fmax(worst, fabs(d.oversampled / 16.0 - expect));
+        }
+    }
+    printf("sine 1 Hz, factor 64: worst error %.3f codes over %u values\n", worst, d.count);
+    Check(d.count == 40000 / 64 && worst < 2.0, "sine");
+}
+
+// Interleaved DMA frames of two channels, unknown channel ignored
+static void Frames() {
+    ADCDecimator a, b;
+    a.setup(8);
+    b.setup(8);
+    ADCDecimator* byChannel[16] = {};
+    byChannel[6] = &a;   // GPIO 34
+    byChannel[0] = &b;   // GPIO 36
+    std::vector<uint8_t> frame;
+    for (int i = 0; i < 64; i++) {
+        uint8_t channel = (i % 3 == 2) ? 3 : (i & 1) ? 0 : 6;
+        uint16_t data = channel == 6 ? 1000 + (i & 3) : channel == 0 ? 3000 : 77;
+        uint16_t word = (uint16_t)((channel << 12) | data);
+        frame.push_back(word & 0xFF);
+        frame.push_back(word >> 8);
+    }
+    // Odd length: the half sample is ignored
+    frame.push_back(0x12);
+    uint32_t fed = ADCFeedType1(frame.data(), (uint32_t)frame.size(), byChannel);
+    Check(fed == 64 - 21, "frame samples");
+    Check(a.count >= 1 && b.count >= 1 && b.raw == 3000 && a.raw >= 1000 && a.raw <= 1003, "frame channels");
+    Check(ADC1ChannelOfPin(34) == 6 && ADC1ChannelOfPin(36) == 0 && ADC1ChannelOfPin(23) == 255, "pins");
+}
+
+// eFuse line fitting of the ESP32: mV = raw * coeff_a / 65536 + coeff_b (12 dB)
+static uint32_t LineFitting(uint32_t raw, void*) {
+    return (uint32_t)((raw * 53500u + 32768) / 65536 + 142);
+}
+
+// Nonlinear curve: the flattening of the ESP32 ADC above ~2.5 V at 12 dB
+static uint32_t Knee(uint32_t raw, void*) {
+    double mv = 142 + raw * 0.8163;
+    if (raw > 3000) mv += (raw - 3000) * (raw - 3000) * 0.00025;
+    return (uint32_t)lround(mv);
+}
+
+static void Calibration() {
+    ADCCalibration cal;
+    cal.build(LineFitting, nullptr);
+    int worst = 0;
+    for (uint32_t raw = 0; raw < 4096; raw++) {
+        worst = std::max(worst, abs((int)cal.millivolts((uint16_t)raw) - (int)LineFitting(raw, nullptr)));
+    }
+    printf("calibration line fitting: worst %d mV\n", worst);
+    Check(worst <= 1, "line fitting");
+
+    cal.build(Knee, nullptr);
+    worst = 0;
+    for (uint32_t raw = 0; raw < 4096; raw++) {
+        worst = std::max(worst, abs((int)cal.millivolts((uint16_t)raw) - (int)Knee(raw, nullptr)));
+    }
+    printf("calibration knee: worst %d mV\n", worst);
+    Check(worst <= 2, "knee");
+
+    // Oversampled values: monotonic, equal to millivolts on whole codes
+    uint32_t last = 0;
+    bool monotonic = true, whole = true;
+    for (uint32_t q4 = 0; q4 <= 4095 * 16; q4++) {
+        uint32_t uv = cal.microvolts((uint16_t)q4);
+        if (uv < last) monotonic = false;
+        last = uv;
+        if ((q4 & 15) == 0 && abs((int)((uv + 500) / 1000) - (int)cal.millivolts((uint16_t)(q4 >> 4))) > 1) whole = false;
+    }
+    Check(monotonic, "microvolts monotonic");
+    Check(whole, "microvolts whole codes");
+
+    // Nominal table: the former analogRead conversion, 4095 = 3.3 V
+    cal.linear(3300);
+    Check(cal.millivolts(0) == 0 && cal.millivolts(4095) == 3300 && abs((int)cal.millivolts(2048) - 1650) <= 1, "linear");
+}
+
+// Cost of the poller per sample and of a read
+static void Timing() {
+    std::vector<uint8_t> frame(256);
+    for (size_t i = 0; i < frame.size(); i += 2) {
+        uint16_t word = (uint16_t)((6 << 12) | (2000 + (i & 15)));
+        frame[i] = word & 0xFF;
+        frame[i + 1] = word >> 8;
+    }
+    ADCDecimator d;
+    d.setup(64);
+    ADCDecimator* byChannel[16] = {};
+    byChannel[6] = &d;
+    ADCCalibration cal;
+    cal.build(LineFitting, nullptr);
+    const int frames = 200000;
+    auto t0 = std::chrono::steady_clock::now();
+    uint32_t fed = 0;
+    for (int i = 0; i < frames; i++) fed += ADCFeedType1(frame.data(), (uint32_t)frame.size(), byChannel);
+    auto t1 = std::chrono::steady_clock::now();
+    volatile uint32_t sink = 0;
+    for (int i = 0; i < frames; i++) sink += cal.microvolts((uint16_t)(d.oversampled + (i & 7)));
+    auto t2 = std::chrono::steady_clock::now();
+    double feedNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / fed;
+    double readNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / frames;
+    printf("host: feed %.2f ns/sample, calibrated read %.2f ns\n", feedNs, readNs);
+}
+
+int main() {
+    Factors();
+    Dither();
+    Sine();
+    Frames();
+    Calibration();
+    Timing();
+    printf("adc math: %s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file segment_loopback_test.cpp
+ * @brief Linux test: rBLEServer segmentation and reassembly over the loopback transport.
+ *
+ * Build and run from bench/rBLEServer:
+ *   g++ -O2 -std=c++17 -I../../libs/rBLEServer segment_loopback_test.cpp -o /tmp/segment_loopback_test
+ *   /tmp/segment_loopback_test
+ *
+ * Round trip of every message length at MTU 23, 185, 247 and 512, sequence errors
+ * (lost, repeated and foreign segments), the reassembly timeout, and frames and
+ * bytes on the air per MTU for the message sizes of the app.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "BLESegmenter.h"
+
+using namespace B4R;
+
+static int failures = 0;
+
+static void Check(bool ok, const std::string& what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+static const uint16_t MTUS[] = { 23, 185, 247, 512 };
+
+static std::vector<uint8_t> Message(uint16_t length, uint8_t seed) {
+    std::vector<uint8_t> m(length);
+    for (uint16_t i = 0; i < length; i++) m[i] = (uint8_t)(i * 31 + seed);
+    return m;
+}
+
+// Every length up to the reassembly buffer at every MTU
+static void RoundTrip() {
+    for (uint16_t mtu : MTUS) {
+        BLELoopbackTransport link;
+        link.mtu = mtu;
+        bool ok = true;
+        for (uint16_t length = 0; length <= RBLESERVER_REASSEMBLY_SIZE && ok; length++) {
+            std::vector<uint8_t> m = Message(length, (uint8_t)length);
+            uint16_t count = BLESegmenter::SegmentCount(length, mtu - 3);
+            if (count == 0) {
+                // More than 255 segments: rejected by the segmenter
+                ok = !link.Send(m.data(), length);
+                continue;
+            }
+            ok = link.Send(m.data(), length)
+                && link.reassembler.MessageLength() == length
+                && memcmp(link.reassembler.Message(), m.data(), length) == 0;
+        }
+        Check(ok, "round trip mtu " + std::to_string(mtu));
+        Check(link.reassembler.errorCount == 0, "round trip errors mtu " + std::to_string(mtu));
+    }
+    // Larger than the reassembly buffer
+    BLELoopbackTransport link;
+    link.mtu = 247;
+    std::vector<uint8_t> m = Message(RBLESERVER_REASSEMBLY_SIZE + 1, 1);
+    Check(!link.Send(m.data(), (uint16_t)m.size()) && link.reassembler.errorCount == 1, "too large");
+}
+
+// Collect the segment frames of a message
+struct Frames {
+    std::vector<std::vector<uint8_t>> list;
+    static bool Add(void* context, const uint8_t* data, uint16_t length) {
+        ((Frames*)context)->list.emplace_back(data, data + length);
+        return true;
+    }
+};
+
+static uint8_t Feed(BLEReassembler& r, const std::vector<uint8_t>& f, uint32_t now) {
+    return r.Feed(f.data(), (uint16_t)f.size(), now);
+}
+
+static void SequenceErrors() {
+    BLESegmenter segmenter;
+    std::vector<uint8_t> m = Message(60, 7);
+    Frames a, b;
+    segmenter.Segment(m.data(), 60, 20, Frames::Add, &a);     // 4 segments of 15
+    segmenter.Segment(m.data(), 60, 20, Frames::Add, &b);     // Next message id
+    Check(a.list.size() == 4 && a.list[0][3] != b.list[0][3], "segments and message id");
+
+    // Lost segment
+    BLEReassembler r;
+    Feed(r, a.list[0], 0);
+    Feed(r, a.list[1], 0);
+    Check(Feed(r, a.list[3], 0) == BLEReassembler::RESULT_ERROR && !r.IsActive(), "lost segment");
+
+    // Repeated segment
+    Feed(r, a.list[0], 0);
+    Feed(r, a.list[1], 0);
+    Check(Feed(r, a.list[1], 0) == BLEReassembler::RESULT_ERROR, "repeated segment");
+
+    // Segment of another message
+    Feed(r, a.list[0], 0);
+    Check(Feed(r, b.list[1], 0) == BLEReassembler::RESULT_ERROR, "foreign segment");
+
+    // Continuation without start
+    Check(Feed(r, a.list[2], 0) == BLEReassembler::RESULT_ERROR, "no start");
+
+    // A new start replaces the partial message, which counts as error
+    uint32_t errors = r.errorCount;
+    Feed(r, a.list[0], 0);
+    Feed(r, a.list[1], 0);
+    uint8_t result = 0;
+    for (auto& f : b.list) result = Feed(r, f, 0);
+    Check(result == BLEReassembler::RESULT_COMPLETE && r.errorCount == errors + 1, "restart");
+    Check(r.MessageLength() == 60 && memcmp(r.Message(), m.data(), 60) == 0, "restart message");
+
+    // Not a segment frame
+    const uint8_t plain[] = { 0x09, 0x04, 0x13, 0x39, 0x00 };
+    Check(r.Feed(plain, sizeof(plain), 0) == BLEReassembler::RESULT_ERROR, "plain frame");
+    Check(r.errorCount == errors + 2 && r.completedCount == 1, "error count");
+}
+
+static void Timeout() {
+    BLESegmenter segmenter;
+    std::vector<uint8_t> m = Message(40, 3);
+    Frames a;
+    segmenter.Segment(m.data(), 40, 20, Frames::Add, &a);
+    BLEReassembler r;
+    r.timeoutMs = 500;
+    Feed(r, a.list[0], 1000);
+    Check(!r.CheckTimeout(1499) && r.IsActive(), "timeout not yet");
+    Check(r.CheckTimeout(1500) && !r.IsActive() && r.timeoutCount == 1, "timeout");
+    Check(Feed(r, a.list[1], 1500) == BLEReassembler::RESULT_ERROR, "segment after timeout");
+
+    // Timeout across the 32-bit millis wrap
+    Feed(r, a.list[0], 0xFFFFFF00);
+    Check(!r.CheckTimeout(0x00000010), "wrap not yet");
+    Check(r.CheckTimeout(0x00000100) && r.timeoutCount == 2, "wrap timeout");
+
+    // Complete in time
+    uint8_t result = 0;
+    for (auto& f : a.list) result = Feed(r, f, 2000);
+    Check(result == BLEReassembler::RESULT_COMPLETE && !r.CheckTimeout(9000), "in time");
+}
+
+// Frames and LL bytes (ATT 3 + L2CAP 4 header per notification) per message and MTU
+static void Throughput() {
+    const uint16_t sizes[] = { 26, 128, 512, 1024 };
+    printf("%8s", "bytes");
+    for (uint16_t mtu : MTUS) printf("  mtu %3u frames/LL bytes", mtu);
+    printf("\n");
+    for (uint16_t size : sizes) {
+        printf("%8u", size);
+        for (uint16_t mtu : MTUS) {
+            BLELoopbackTransport link;
+            link.mtu = mtu;
+            std::vector<uint8_t> m = Message(size, 9);
+            link.Send(m.data(), size);
+            printf("   %11u /%9u", link.framesSent, link.bytesSent + link.framesSent * 7);
+        }
+        printf("\n");
+    }
+    Check(BLESegmenter::SegmentCount(1024, 20) == 69 && BLESegmenter::SegmentCount(1024, 244) == 5, "segment counts");
+
+    // Host speed of segment + reassemble
+    for (uint16_t mtu : MTUS) {
+        BLELoopbackTransport link;
+        link.mtu = mtu;
+        std::vector<uint8_t> m = Message(1024, 5);
+        const int runs = 20000;
+        auto t0 = std::chrono::steady_clock::now();
+        int ok = 0;
+        for (int i = 0; i < runs; i++) ok += link.Send(m.data(), 1024);
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        printf("mtu %3u: %.0f MB/s segment + reassemble\n", mtu, runs * 1024.0 / s / 1e6);
+        Check(ok == runs, "speed runs");
+    }
+}
+
+int main() {
+    RoundTrip();
+    SequenceErrors();
+    Timeout();
+    Throughput();
+    printf("segment loopback: %s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
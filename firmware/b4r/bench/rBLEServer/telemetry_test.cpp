@@ -0,0 +1,151 @@
+/**
+ * @file telemetry_test.cpp
+ * @brief Linux test: rBLEServer BTHome v2 telemetry record, encode and decode.
+ *
+ * Build and run from bench/rBLEServer:
+ *   g++ -O2 -std=c++17 -I../../libs/rBLEServer telemetry_test.cpp -o /tmp/telemetry_test
+ *   /tmp/telemetry_test
+ *
+ * Round trip of every combination of objects with random values, the packet id
+ * per change, the byte layout of a known record and the records Decode rejects.
+ */
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include "BLETelemetry.h"
+
+using namespace B4R;
+
+static int failures = 0;
+
+static void Check(bool ok, const std::string& what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+static bool Same(const TelemetryValues& a, const TelemetryValues& b) {
+    if (a.present != b.present || a.packetId != b.packetId) return false;
+    if ((a.present & BLETelemetry::VALUE_TEMPERATURE) && a.temperature != b.temperature) return false;
+    if ((a.present & BLETelemetry::VALUE_HUMIDITY) && a.humidity != b.humidity) return false;
+    if ((a.present & BLETelemetry::VALUE_MOISTURE) && a.moisture != b.moisture) return false;
+    if ((a.present & BLETelemetry::VALUE_GAS) && a.gas != b.gas) return false;
+    if ((a.present & BLETelemetry::VALUE_MOTION) && a.motion != b.motion) return false;
+    return true;
+}
+
+// Every subset of the five objects, random values including the limits
+static void RoundTrip() {
+    std::mt19937 rng(8);
+    int records = 0;
+    for (uint8_t mask = 0; mask < 32; mask++) {
+        for (int i = 0; i < 2000; i++) {
+            BLETelemetry t;
+            int16_t temperature = i == 0 ? -32768 : i == 1 ? 32767 : (int16_t)rng();
+            uint16_t humidity = i == 0 ? 0 : i == 1 ? 65535 : (uint16_t)rng();
+            if (mask & BLETelemetry::VALUE_TEMPERATURE) t.SetTemperature(temperature);
+            if (mask & BLETelemetry::VALUE_HUMIDITY) t.SetHumidity(humidity);
+            if (mask & BLETelemetry::VALUE_MOISTURE) t.SetMoisture((uint16_t)rng());
+            if (mask & BLETelemetry::VALUE_GAS) t.SetGas(rng() & 1);
+            if (mask & BLETelemetry::VALUE_MOTION) t.SetMotion(rng() & 1);
+
+            uint8_t record[BLETelemetry::RECORD_SIZE_MAX];
+            uint8_t length = t.Encode(record);
+            TelemetryValues out;
+            bool ok = length <= BLETelemetry::RECORD_SIZE_MAX
+                && BLETelemetry::Decode(record, length, out)
+                && Same(t.values, out);
+            if (!ok) {
+                Check(false, "round trip mask " + std::to_string(mask));
+                return;
+            }
+            records++;
+        }
+    }
+    printf("round trip: %d records\n", records);
+}
+
+// Packet id: incremented once per Encode after a change, not for equal values
+static void PacketId() {
+    BLETelemetry t;
+    uint8_t record[BLETelemetry::RECORD_SIZE_MAX];
+    t.SetGas(false);
+    t.Encode(record);
+    Check(t.values.packetId == 1, "first change");
+    t.Encode(record);
+    Check(t.values.packetId == 1, "no change");
+    t.SetGas(false);
+    t.Encode(record);
+    Check(t.values.packetId == 1, "same value");
+    t.SetGas(true);
+    t.SetMotion(true);
+    t.Encode(record);
+    Check(t.values.packetId == 2, "two changes, one packet");
+    for (int i = 0; i < 300; i++) {
+        t.SetTemperature((int16_t)i);
+        t.Encode(record);
+    }
+    TelemetryValues out;
+    Check(BLETelemetry::Decode(record, record[0] + 1, out) && out.packetId == (uint8_t)302, "packet id wraps");
+}
+
+// Known record: 21.50 C, 45.00 %, moisture 12.34 %, gas clear, motion detected
+static void Layout() {
+    BLETelemetry t;
+    t.SetTemperature(2150);
+    t.SetHumidity(4500);
+    t.SetMoisture(1234);
+    t.SetGas(false);
+    t.SetMotion(true);
+    uint8_t record[BLETelemetry::RECORD_SIZE_MAX];
+    uint8_t length = t.Encode(record);
+    const uint8_t expect[] = {
+        0x13, 0x16, 0xD2, 0xFC, 0x40, 0x00, 0x01,
+        0x02, 0x66, 0x08,
+        0x03, 0x94, 0x11,
+        0x14, 0xD2, 0x04,
+        0x1C, 0x00,
+        0x21, 0x01 };
+    Check(length == sizeof(expect) && memcmp(record, expect, length) == 0, "layout");
+    Check(length == BLETelemetry::RECORD_SIZE_MAX && 3 + length <= 31, "fits the advertisement with flags");
+}
+
+static void Rejected() {
+    BLETelemetry t;
+    t.SetTemperature(-512);
+    t.SetMotion(false);
+    uint8_t record[BLETelemetry::RECORD_SIZE_MAX];
+    uint8_t length = t.Encode(record);
+    TelemetryValues out;
+    Check(BLETelemetry::Decode(record, length, out) && out.temperature == -512, "negative temperature");
+
+    uint8_t bad[BLETelemetry::RECORD_SIZE_MAX];
+    memcpy(bad, record, length);
+    bad[1] = 0xFF;
+    Check(!BLETelemetry::Decode(bad, length, out), "AD type");
+    memcpy(bad, record, length);
+    bad[2] = 0x1A;
+    Check(!BLETelemetry::Decode(bad, length, out), "UUID");
+    memcpy(bad, record, length);
+    bad[4] = 0x60;
+    Check(!BLETelemetry::Decode(bad, length, out), "version 3");
+    Check(!BLETelemetry::Decode(record, length - 1, out), "shorter than the length byte");
+    memcpy(bad, record, length);
+    bad[0] = length - 2;
+    Check(!BLETelemetry::Decode(bad, length, out), "object cut off");
+    memcpy(bad, record, length);
+    bad[7] = 0x05;
+    Check(!BLETelemetry::Decode(bad, length, out), "unknown object");
+    Check(!BLETelemetry::Decode(record, 6, out), "too short");
+}
+
+int main() {
+    RoundTrip();
+    PacketId();
+    Layout();
+    Rejected();
+    printf("telemetry: %s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
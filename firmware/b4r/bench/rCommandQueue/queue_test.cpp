@@ -0,0 +1,141 @@
+/**
+ * @file queue_test.cpp
+ * @brief Linux test: rCommandQueue payload limit, shared payload pool and dispatch order.
+ *
+ * Build and run from bench/rCommandQueue:
+ *   g++ -O2 -std=c++17 -Wall -Wextra -I../common queue_test.cpp ../../libs/rCommandQueue/rCommandQueue.cpp -o /tmp/queue_test
+ *   /tmp/queue_test
+ *
+ * A reassembled BLE message of RBLESERVER_REASSEMBLY_SIZE (1024) bytes is queued
+ * and dispatched intact, one byte more is rejected. A full pool is handled like
+ * a full queue by both policies, and payloads wrapping the pool end stay intact.
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../../libs/rCommandQueue/rCommandQueue.h"
+
+using namespace B4R;
+
+static uint32_t nowUs = 0;
+uint32_t millis() { return nowUs / 1000; }
+uint32_t micros() { return nowUs; }
+
+static int failures = 0;
+
+static void Check(bool ok, const std::string& what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+static B4RCommandQueue* queue;
+static std::vector<std::vector<uint8_t>> dispatched;
+static std::vector<uint8_t> ids;
+static std::vector<uint8_t> errors;
+
+static void OnCommand(Byte source, Byte id) {
+    (void)source;
+    ArrayByte* p = queue->getPayload();
+    const uint8_t* data = (const uint8_t*)p->data;
+    dispatched.emplace_back(data, data + p->length);
+    ids.push_back(id);
+}
+
+static void OnError(Byte code) {
+    errors.push_back(code);
+}
+
+static std::vector<uint8_t> Message(uint16_t length, uint8_t seed) {
+    std::vector<uint8_t> m(length);
+    for (uint16_t i = 0; i < length; i++) m[i] = (uint8_t)(i * 31 + seed);
+    return m;
+}
+
+static bool Push(uint8_t id, std::vector<uint8_t>& m) {
+    ArrayByte a;
+    a.data = m.data();
+    a.length = (uint16_t)m.size();
+    nowUs += 10;
+    return queue->Push(0, id, 0, &a);
+}
+
+static void Reset(B4RCommandQueue& q, Byte depth, Byte policy) {
+    queue = &q;
+    q.Initialize(depth, OnCommand, OnError);
+    q.setPolicy(policy);
+    dispatched.clear();
+    ids.clear();
+    errors.clear();
+}
+
+// The largest reassembled BLE message fits, one byte more is rejected
+static void PayloadLimit() {
+    static B4RCommandQueue q;
+    Reset(q, 8, B4RCommandQueue::POLICY_REJECT_NEWEST);
+    Check(B4RCommandQueue::PAYLOAD_SIZE == 1024, "payload size is the BLE reassembly size");
+
+    std::vector<uint8_t> largest = Message(B4RCommandQueue::PAYLOAD_SIZE, 1);
+    std::vector<uint8_t> tooLarge = Message(B4RCommandQueue::PAYLOAD_SIZE + 1, 2);
+    Check(Push(1, largest), "1024 bytes accepted");
+    Check(!Push(2, tooLarge), "1025 bytes rejected");
+    Check(errors.size() == 1 && errors[0] == B4RCommandQueue::ERROR_PAYLOAD_TOO_LARGE, "too large error");
+    Check(q.getLastDroppedId() == 2 && q.getDroppedCount() == 1 && q.getCount() == 1, "too large counters");
+
+    pollers.run();
+    Check(dispatched.size() == 1 && dispatched[0] == largest, "1024 bytes dispatched intact");
+}
+
+// Two 1024-byte payloads fill the pool: the third is rejected or replaces the oldest
+static void PoolFull() {
+    static B4RCommandQueue q;
+    Reset(q, 8, B4RCommandQueue::POLICY_REJECT_NEWEST);
+    std::vector<uint8_t> a = Message(1024, 3), b = Message(1024, 4), c = Message(1, 5);
+    Check(Push(1, a) && Push(2, b), "pool filled");
+    Check(!Push(3, c) && errors.size() == 1 && errors[0] == B4RCommandQueue::ERROR_QUEUE_FULL, "pool full rejects");
+    pollers.run();
+    Check(dispatched.size() == 2 && dispatched[0] == a && dispatched[1] == b, "pool full dispatch");
+
+    Reset(q, 8, B4RCommandQueue::POLICY_DROP_OLDEST);
+    std::vector<uint8_t> small = Message(100, 6);
+    Check(Push(1, small) && Push(2, a) && Push(3, b), "drop oldest");
+    Check(q.getCount() == 2 && q.getLastDroppedId() == 1 && errors.empty(), "drop oldest frees the pool");
+    std::vector<uint8_t> d = Message(1000, 7);
+    Check(Push(4, d) && q.getCount() == 2 && q.getLastDroppedId() == 2, "drop oldest again");
+    pollers.run();
+    Check(ids.size() == 2 && ids[0] == 3 && ids[1] == 4 && dispatched[0] == b && dispatched[1] == d, "drop oldest dispatch");
+}
+
+// Depth limit with small payloads, and FIFO order across many pool wraps
+static void DepthAndWrap() {
+    static B4RCommandQueue q;
+    Reset(q, 4, B4RCommandQueue::POLICY_REJECT_NEWEST);
+    std::vector<uint8_t> m = Message(8, 8);
+    for (uint8_t i = 0; i < 4; i++) Check(Push(i, m), "depth push");
+    Check(!Push(4, m) && q.getCount() == 4 && errors.size() == 1, "depth limit");
+    pollers.run();
+
+    Reset(q, 16, B4RCommandQueue::POLICY_REJECT_NEWEST);
+    std::vector<std::vector<uint8_t>> sent;
+    bool ok = true;
+    for (int round = 0; round < 200 && ok; round++) {
+        for (int i = 0; i < 3; i++) {
+            sent.push_back(Message((uint16_t)(1 + (round * 37 + i * 301) % 700), (uint8_t)round));
+            ok = ok && Push((uint8_t)sent.size(), sent.back());
+        }
+        pollers.run();
+    }
+    Check(ok && errors.empty(), "wrap pushes");
+    Check(dispatched == sent, "wrap payloads in order");
+    Check(q.getDispatchedCount() == sent.size() && q.getCount() == 0, "wrap counters");
+}
+
+int main() {
+    PayloadLimit();
+    PoolFull();
+    DepthAndWrap();
+    printf("command queue: %s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
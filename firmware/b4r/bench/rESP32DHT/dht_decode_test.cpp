@@ -0,0 +1,146 @@
+/**
+ * @file dht_decode_test.cpp
+ * @brief Linux test: DHTCapture::decode replays DHT11/DHT22 edge timings.
+ *
+ * Build and run from bench/rESP32DHT:
+ *   g++ -O2 -std=c++17 -I../../libs/rESP32DHT dht_decode_test.cpp ../../libs/rESP32DHT/DHTCapture.cpp \
+ *       -o /tmp/dht_decode_test
+ *   /tmp/dht_decode_test dht_traces.txt
+ *
+ * The test builds the host branch of DHTCapture.cpp. Syntax check of the ESP32 branch
+ * (timer callback, edge ISR) against the declarations in ../common/esp32:
+ *   g++ -std=c++17 -Wall -Wextra -fsyntax-only -DESP32 -DARDUINO -I../common/esp32 -I../../libs/rESP32DHT \
+ *       ../../libs/rESP32DHT/DHTCapture.cpp
+ *
+ * Each trace line holds the edge times as captured by the ISR (see dht_traces.txt).
+ * A round-trip check then encodes random readings with the slowest and fastest
+ * pulse widths of the datasheet plus ISR latency, and decodes them again.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <fstream>
+#include "DHTCapture.h"
+
+static int failures = 0;
+
+static void Check(bool ok, const char* what, const std::string& name) {
+    if (!ok) {
+        printf("FAIL: %s (%s)\n", what, name.c_str());
+        failures++;
+    }
+}
+
+static uint8_t ErrorOf(const std::string& s) {
+    if (s == "timeout") return DHTCapture::ERROR_TIMEOUT;
+    if (s == "checksum") return DHTCapture::ERROR_CHECKSUM;
+    if (s == "timing") return DHTCapture::ERROR_TIMING;
+    return DHTCapture::ERROR_NONE;
+}
+
+static int Replay(const char* path) {
+    std::ifstream in(path);
+    if (!in) {
+        printf("FAIL: cannot open %s\n", path);
+        failures++;
+        return 0;
+    }
+    std::string line;
+    int traces = 0;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream ls(line);
+        std::string name, model, expect;
+        ls >> name >> model >> expect;
+        float t = NAN, h = NAN;
+        if (expect == "ok") ls >> t >> h;
+        std::string colon;
+        ls >> colon;
+
+        uint32_t edges[DHTCapture::EDGES_MAX];
+        uint8_t count = 0;
+        uint32_t time = 1000000, delta;
+        while (ls >> delta && count < DHTCapture::EDGES_MAX) {
+            time += delta;
+            edges[count++] = time;
+        }
+
+        float temperature, humidity;
+        uint8_t error = DHTCapture::decode(edges, count, model == "dht22", temperature, humidity);
+        Check(error == ErrorOf(expect), "result", name);
+        if (expect == "ok") {
+            Check(fabsf(temperature - t) < 0.05f && fabsf(humidity - h) < 0.05f, "values", name);
+        } else {
+            Check(std::isnan(temperature) && std::isnan(humidity), "nan on error", name);
+        }
+        printf("%-20s %-6s edges %2u  error %u  t %5.1f  h %5.1f\n", name.c_str(), model.c_str(), count, error, temperature, humidity);
+        traces++;
+    }
+    return traces;
+}
+
+// Edges of one reading: release, response, 40 bits, end of transmission
+static uint8_t Encode(const uint8_t data[5], uint32_t* edges, uint32_t low, uint32_t zero, uint32_t one, std::mt19937& rng, int latency) {
+    std::uniform_int_distribution<int> jitter(0, latency);
+    uint32_t t = 1000;
+    uint8_t n = 0;
+    // ISR latency delays each timestamp, never advances it
+    auto edge = [&](uint32_t at) { edges[n++] = at + jitter(rng); };
+    edge(t);
+    t += 30; edge(t);
+    t += 80; edge(t);
+    t += 80; edge(t);
+    for (int i = 0; i < 40; i++) {
+        bool bit = (data[i >> 3] >> (7 - (i & 7))) & 1;
+        t += low; edge(t);
+        t += bit ? one : zero; edge(t);
+    }
+    t += 50; edge(t);
+    return n;
+}
+
+static void RoundTrip() {
+    std::mt19937 rng(7);
+    // Datasheet extremes: bit low 48-55 us, 0 high 22-30 us, 1 high 68-75 us
+    const uint32_t timings[][3] = { { 48, 22, 68 }, { 55, 30, 75 }, { 50, 26, 70 } };
+    for (int r = 0; r < 3000; r++) {
+        bool dht22 = r & 1;
+        uint8_t data[5];
+        float t, h;
+        if (dht22) {
+            int ht = rng() % 1001, tt = (int)(rng() % 1650) - 400;
+            uint16_t traw = (uint16_t)(tt < 0 ? (0x8000 | -tt) : tt);
+            data[0] = ht >> 8; data[1] = ht & 0xFF; data[2] = traw >> 8; data[3] = traw & 0xFF;
+            h = ht * 0.1f;
+            t = tt * 0.1f;
+        } else {
+            data[0] = 20 + rng() % 71; data[1] = 0; data[2] = rng() % 51; data[3] = rng() % 10;
+            h = data[0];
+            t = data[2];
+        }
+        data[4] = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
+
+        uint32_t edges[DHTCapture::EDGES_MAX];
+        const uint32_t* tm = timings[r % 3];
+        uint8_t n = Encode(data, edges, tm[0], tm[1], tm[2], rng, 10);
+        float temperature, humidity;
+        uint8_t error = DHTCapture::decode(edges, n, dht22, temperature, humidity);
+        Check(error == DHTCapture::ERROR_NONE && fabsf(temperature - t) < 0.05f && fabsf(humidity - h) < 0.05f,
+            "round trip", std::to_string(r));
+        // Without the release edge
+        error = DHTCapture::decode(edges + 1, n - 1, dht22, temperature, humidity);
+        Check(error == DHTCapture::ERROR_NONE && fabsf(temperature - t) < 0.05f, "round trip without release", std::to_string(r));
+    }
+}
+
+int main(int argc, char** argv) {
+    int traces = Replay(argc > 1 ? argv[1] : "dht_traces.txt");
+    RoundTrip();
+    printf("dht decode: %d traces, 3000 round trips: %s\n", traces, failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
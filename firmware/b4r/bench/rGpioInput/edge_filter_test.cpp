@@ -0,0 +1,230 @@
+/**
+ * @file edge_filter_test.cpp
+ * @brief Linux test: rGpioInput edge ring and debouncer with synthetic edge streams.
+ *
+ * Build and run from bench/rGpioInput:
+ *   g++ -O2 -std=c++17 -pthread -I../../libs/rGpioInput edge_filter_test.cpp ../../libs/rGpioInput/EdgeFilter.cpp \
+ *       -o /tmp/edge_filter_test
+ *   /tmp/edge_filter_test
+ *
+ * Streams: bouncing button presses, spikes, a PIR pulse while the main loop is
+ * blocked by a long handler, the 32-bit us wrap and a random bounce model.
+ * A producer thread stands in for the ISR to check the ring without locks.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "EdgeFilter.h"
+
+static int failures = 0;
+
+static void Check(bool ok, const std::string& what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+struct Event {
+    uint8_t state;
+    uint32_t at;
+    uint32_t duration;
+};
+
+// Main loop: drain the ring and settle at time now
+static void Drain(EdgeRing& ring, EdgeDebouncer& d, uint32_t now, std::vector<Event>& events) {
+    EdgeRing::Edge e;
+    while (ring.pop(e)) {
+        if (d.edge(e.level, e.time)) events.push_back({ d.state, d.changedAt, d.duration });
+    }
+    if (d.settle(now)) events.push_back({ d.state, d.changedAt, d.duration });
+}
+
+// Button (pull-up, pressed = 0) with contact bounce
+static void Button() {
+    EdgeRing ring;
+    EdgeDebouncer d;
+    d.debounce = 20000;
+    d.begin(1, 0);
+    std::vector<Event> events;
+    // Press at 1 s: 4 bounces within 1.5 ms
+    const uint32_t press[] = { 1000000, 1000300, 1000700, 1001100, 1001500 };
+    for (int i = 0; i < 5; i++) ring.push(press[i], i & 1 ? 1 : 0);
+    Drain(ring, d, 1010000, events);
+    Check(events.empty(), "no event during the debounce time");
+    Drain(ring, d, 1021500, events);
+    Check(events.size() == 1 && events[0].state == 0 && events[0].at == 1000000, "press at the first edge");
+    // Release at 1.25 s: 2 bounces
+    ring.push(1250000, 1);
+    ring.push(1250200, 0);
+    ring.push(1250500, 1);
+    Drain(ring, d, 1300000, events);
+    Check(events.size() == 2 && events[1].state == 1 && events[1].at == 1250000 && events[1].duration == 250000, "release");
+    Check(d.edgeCount == 8 && d.bounceCount == 6 && d.glitchCount == 0 && d.eventCount == 2, "button counters");
+}
+
+// Spikes on a long cable: no event
+static void Spike() {
+    EdgeRing ring;
+    EdgeDebouncer d;
+    d.begin(1, 0);
+    std::vector<Event> events;
+    ring.push(500000, 0);
+    ring.push(500004, 1);
+    // Missed rising edge: the ISR reads low twice
+    ring.push(800000, 0);
+    ring.push(800002, 0);
+    ring.push(800003, 1);
+    Drain(ring, d, 900000, events);
+    Check(events.empty() && d.glitchCount == 2 && d.state == 1, "spikes");
+}
+
+// PIR pulse of 2.3 s while the main loop is blocked 9 s by a handler (PlayAlarm)
+static void BlockedLoop() {
+    EdgeRing ring;
+    EdgeDebouncer d;
+    d.debounce = 50000;
+    d.begin(1, 0);
+    std::vector<Event> events;
+    // ISR during the handler
+    ring.push(1000000, 0);      // Detected (output low)
+    ring.push(3300000, 1);      // Clear
+    ring.push(6000000, 0);
+    ring.push(6000010, 1);      // Spike
+    // Handler returns at 10 s
+    Drain(ring, d, 10000000, events);
+    Check(events.size() == 2, "blocked loop: both edges of the pulse");
+    if (events.size() == 2) {
+        Check(events[0].state == 0 && events[0].at == 1000000, "detected time");
+        Check(events[1].state == 1 && events[1].at == 3300000 && events[1].duration == 2300000, "clear time and duration");
+    }
+    Check(d.glitchCount == 1, "blocked loop spike");
+
+    // Pin.AddListener: the level is compared on each main loop pass, none between 0.5 s and 10 s
+    int seen = 0;
+    uint8_t prev = 1;
+    for (uint32_t t = 0; t < 12000000; t += t >= 500000 && t < 10000000 ? 9500000 : 1000) {
+        uint8_t level = (t >= 1000000 && t < 3300000) ? 0 : 1;
+        if (level != prev) seen++;
+        prev = level;
+    }
+    printf("blocked loop 9 s: polled listener %d changes, edge queue %zu events\n", seen, events.size());
+    Check(seen == 0, "polling misses the pulse");
+}
+
+// 32-bit us time wraps after 71.6 min
+static void Wrap() {
+    EdgeRing ring;
+    EdgeDebouncer d;
+    d.begin(1, 0xFFFF0000);
+    std::vector<Event> events;
+    ring.push(0xFFFFF000, 0);
+    ring.push(0xFFFFF100, 1);
+    ring.push(0xFFFFF200, 0);
+    Drain(ring, d, 0x00005000, events);
+    Check(events.size() == 1 && events[0].at == 0xFFFFF000 && events[0].duration == 0xF000, "wrap");
+}
+
+// Random presses with random bounce, spikes in between
+static void Random() {
+    std::mt19937 rng(21);
+    EdgeRing ring;
+    EdgeDebouncer d;
+    d.debounce = 20000;
+    uint32_t t = 0xFF000000;    // Wraps during the test
+    d.begin(1, t);
+    std::vector<Event> events;
+    std::vector<Event> expect;
+    uint8_t level = 1;
+    for (int i = 0; i < 20000; i++) {
+        t += 30000 + rng() % 500000;
+        if (rng() % 4 == 0) {
+            // Spike: away and back within the debounce time
+            ring.push(t, level ^ 1);
+            t += 1 + rng() % 15000;
+            ring.push(t, level);
+            Drain(ring, d, t + rng() % 40000, events);
+            continue;
+        }
+        uint32_t start = t;
+        level ^= 1;
+        // Odd number of edges ending at the new level, gaps below the debounce time
+        int count = 1 + 2 * (rng() % 8);
+        for (int k = 0; k < count; k++) {
+            if (k > 0) t += 1 + rng() % 5000;
+            ring.push(t, k & 1 ? level ^ 1 : level);
+        }
+        expect.push_back({ level, start, 0 });
+        // The main loop comes by at a random time, often during the burst
+        Drain(ring, d, t + rng() % 40000, events);
+    }
+    Drain(ring, d, t + 100000, events);
+    bool same = events.size() == expect.size();
+    for (size_t i = 0; same && i < events.size(); i++) {
+        same = events[i].state == expect[i].state && events[i].at == expect[i].at;
+    }
+    printf("random: %zu changes, %u edges, %u bounces, %u glitches, %zu events\n",
+        expect.size(), d.edgeCount, d.bounceCount, d.glitchCount, events.size());
+    Check(same, "random events");
+    Check(ring.dropped == 0, "random no drop");
+}
+
+// Full ring: dropped and counted, the consumer continues
+static void Full() {
+    EdgeRing ring;
+    for (int i = 0; i < EdgeRing::SIZE + 5; i++) ring.push(i, i & 1);
+    Check(ring.pending() == EdgeRing::SIZE && ring.dropped == 5, "full");
+    EdgeRing::Edge e;
+    uint32_t n = 0;
+    while (ring.pop(e)) Check(e.time == n++, "full order");
+    Check(n == EdgeRing::SIZE && ring.empty(), "full drain");
+}
+
+// ISR thread against main loop thread
+static void Threads() {
+    EdgeRing ring;
+    const uint32_t edges = 200000;
+    std::atomic<bool> done(false);
+    uint32_t pushed = 0;
+    std::thread isr([&] {
+        for (uint32_t i = 0; i < edges; i++) {
+            if (ring.push(i, i & 1)) pushed++;
+            // Edges come at a rate, in bursts the ring fills (also on one core)
+            if (i % 4096 < 2048) std::this_thread::yield();
+        }
+        done = true;
+    });
+    uint32_t popped = 0, last = 0;
+    bool ordered = true, levels = true;
+    EdgeRing::Edge e;
+    while (!done || !ring.empty()) {
+        while (ring.pop(e)) {
+            if (popped > 0 && e.time <= last) ordered = false;
+            if (e.level != (e.time & 1)) levels = false;
+            last = e.time;
+            popped++;
+        }
+        std::this_thread::yield();
+    }
+    isr.join();
+    printf("threads: %u edges, %u queued, %u dropped, %u read\n", edges, pushed, ring.dropped, popped);
+    Check(popped == pushed && pushed + ring.dropped == edges, "threads count");
+    Check(ordered && levels, "threads order");
+    Check(pushed > edges / 4 && ring.dropped > 0, "threads queued and dropped");
+}
+
+int main() {
+    Button();
+    Spike();
+    BlockedLoop();
+    Wrap();
+    Random();
+    Full();
+    Threads();
+    printf("edge filter: %s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
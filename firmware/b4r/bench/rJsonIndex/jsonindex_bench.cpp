@@ -0,0 +1,164 @@
+/**
+ * @file jsonindex_bench.cpp
+ * @brief Linux microbenchmark: rJsonIndex single parse vs. the per-key MQTTClient JSON getters.
+ *
+ * Build and run from bench/rJsonIndex:
+ *   g++ -O2 -std=c++17 -I../common jsonindex_bench.cpp ../../libs/rJsonIndex/rJsonIndex.cpp -o /tmp/jsonindex_bench
+ *   /tmp/jsonindex_bench
+ *
+ * The per-key baseline mirrors GetNumberValueFromKey / GetTextValueFromKey: search the quoted
+ * key, then the colon and the next , } ] (number) or the next two quotes (text), copy and
+ * convert. The payloads are the ones the device modules read, every key is read once.
+ * A conformance check of the tokenizer runs first.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include "../../libs/rJsonIndex/rJsonIndex.h"
+
+using namespace B4R;
+
+// Per-key scan as in MQTTClient.bas (IndexOf2 = memmem from a start index)
+static int IndexOf(const char* json, int length, const char* what, int start) {
+    int n = (int)strlen(what);
+    for (int i = start; i + n <= length; i++) {
+        if (memcmp(json + i, what, n) == 0) return i;
+    }
+    return -1;
+}
+
+static double NumberFromKey(const char* json, int length, const char* key) {
+    char qkey[32];
+    int n = snprintf(qkey, sizeof(qkey), "\"%s\"", key);
+    int i = IndexOf(json, length, qkey, 0);
+    if (i == -1) return -1;
+    int colon = IndexOf(json, length, ":", i + n);
+    int end = -1;
+    for (const char* c : {",", "}", "]"}) {
+        end = IndexOf(json, length, c, colon + 1);
+        if (end != -1) break;
+    }
+    char text[32];
+    int len = end - colon - 1;
+    if (len < 0 || len >= (int)sizeof(text)) return -1;
+    memcpy(text, json + colon + 1, len);
+    text[len] = 0;
+    return atof(text);
+}
+
+static int TextFromKey(const char* json, int length, const char* key, char* out, int size) {
+    char qkey[32];
+    int n = snprintf(qkey, sizeof(qkey), "\"%s\"", key);
+    int i = IndexOf(json, length, qkey, 0);
+    if (i == -1) return 0;
+    int i1 = IndexOf(json, length, "\"", i + n + 1);
+    int i2 = IndexOf(json, length, "\"", i1 + 1);
+    int len = i2 - i1 - 1;
+    if (len > size) len = size;
+    memcpy(out, json + i1 + 1, len);
+    return len;
+}
+
+struct Payload {
+    const char* json;
+    const char* numberKeys[6];
+    const char* textKeys[2];
+};
+
+static const Payload PAYLOADS[] = {
+    { "{\"s\":\"on\"}", { nullptr }, { "s", nullptr } },
+    { "{\"i\":2,\"r\":255,\"g\":128,\"b\":0,\"x\":0}", { "i", "r", "g", "b", "x", nullptr }, { nullptr } },
+    { "{\"c\":0,\"r\":1,\"t\":\"Hello World\",\"x\":1}", { "c", "r", "x", nullptr }, { "t", nullptr } },
+    { "{\"t\":440,\"d\":250,\"a\":-1,\"r\":3}", { "t", "d", "a", "r", nullptr }, { nullptr } },
+    { "{ \"s\" : 512.5 }", { "s", nullptr }, { nullptr } },
+};
+static const int PAYLOAD_COUNT = sizeof(PAYLOADS) / sizeof(PAYLOADS[0]);
+
+static int failures = 0;
+
+static void Check(bool ok, const char* what) {
+    if (!ok) {
+        printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+static void Conformance() {
+    B4RJsonIndex j;
+    int32_t l;
+    double d;
+    char text[64];
+    uint16_t n;
+
+    const char* a = " {\"a\" : -12 , \"b\":3.5e2,\"c\":true,\"d\":null,\"e\":[1,{\"x\":\"]\"}],\"f\":{\"g\":{}} ,\"h\":\"A\\\"B\\\\C\\u00e9\\n\"}\n";
+    Check(j.ParseBytes(a, (uint16_t)strlen(a)), "parse grammar");
+    Check(j.getCount() == 7, "count");
+    Check(j.FindLong("a", l) && l == -12, "negative int");
+    Check(j.FindDouble("b", d) && d == 350.0, "exponent");
+    Check(j.FindLong("b", l) && l == 350, "exponent as long");
+    Check(j.FindLong("c", l) && l == 1, "true");
+    Check(!j.FindLong("d", l), "null is not a number");
+    n = j.FindText("e", text, sizeof(text));
+    Check(n == 13 && memcmp(text, "[1,{\"x\":\"]\"}]", 13) == 0, "nested array span");
+    n = j.FindText("h", text, sizeof(text));
+    Check(n == 8 && memcmp(text, "A\"B\\C\xC3\xA9\n", 8) == 0, "escapes");
+    Check(!j.FindLong("zz", l), "missing key");
+
+    const char* s = "{\"u\":\"\\ud83d\\ude00\"}";
+    Check(j.ParseBytes(s, (uint16_t)strlen(s)), "parse surrogate");
+    n = j.FindText("u", text, sizeof(text));
+    Check(n == 4 && memcmp(text, "\xF0\x9F\x98\x80", 4) == 0, "surrogate pair");
+
+    const char* bad[] = { "", "[1]", "{\"a\":}", "{\"a\":1,}", "{\"a\" 1}", "{\"a\":01x}", "{\"a\":\"x}", "{\"a\":1} x", "{\"a\":-}", "{\"a\":[1}" };
+    for (const char* b : bad) {
+        Check(!j.ParseBytes(b, (uint16_t)strlen(b)) && j.getCount() == 0, b);
+    }
+
+    // NUL padding as left by fixed-size buffers
+    const char padded[] = "{\"s\":1}\0\0\0";
+    Check(j.ParseBytes(padded, sizeof(padded)), "NUL padding");
+}
+
+static volatile double sink;
+
+int main() {
+    Conformance();
+    printf("conformance: %s\n", failures == 0 ? "ok" : "FAILED");
+
+    const int iterations = 2000000;
+    B4RJsonIndex j;
+    char text[32];
+
+    for (int p = 0; p < PAYLOAD_COUNT; p++) {
+        const Payload& pl = PAYLOADS[p];
+        int length = (int)strlen(pl.json);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int it = 0; it < iterations; it++) {
+            double acc = 0;
+            for (int k = 0; pl.numberKeys[k]; k++) acc += NumberFromKey(pl.json, length, pl.numberKeys[k]);
+            for (int k = 0; pl.textKeys[k]; k++) acc += TextFromKey(pl.json, length, pl.textKeys[k], text, 20);
+            sink = acc;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int it = 0; it < iterations; it++) {
+            double acc = 0;
+            j.ParseBytes(pl.json, (uint16_t)length);
+            for (int k = 0; pl.numberKeys[k]; k++) {
+                double d;
+                acc += j.FindDouble(pl.numberKeys[k], d) ? d : -1;
+            }
+            for (int k = 0; pl.textKeys[k]; k++) acc += j.FindText(pl.textKeys[k], text, 20);
+            sink = acc;
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        double perKey = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+        double index = std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations;
+        printf("%-40s per-key %7.1f ns  index %7.1f ns  x%.1f\n", pl.json, perKey, index, perKey / index);
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,290 @@
+/**
+ * @file connector_harness.cpp
+ * @brief Linux test harness: rMqttConnector state machine, backoff, CONNACK, receive and keepalive.
+ *
+ * Build and run from bench/rMqttConnector:
+ *   g++ -O2 -std=c++17 -I../common connector_harness.cpp ../../libs/rMqttConnector/rMqttConnector.cpp \
+ *       -o /tmp/connector_harness
+ *   /tmp/connector_harness
+ *
+ * Syntax check of the ESP32 branch (WiFi, lwIP connect) against the declarations in ../common/esp32:
+ *   g++ -std=c++17 -Wall -Wextra -fsyntax-only -DESP32 -DARDUINO -I../common/esp32 -I../common \
+ *       ../../libs/rMqttConnector/rMqttConnector.cpp
+ *
+ * On the host the WiFi and TCP states pass at once (no lwIP), the clock is simulated.
+ * The socket stand-in plays the broker: it decodes CONNECT, SUBSCRIBE, PUBACK and PINGREQ
+ * and answers with CONNACK, SUBACK and PINGRESP, unless set silent, refusing or mute.
+ * The harness plays the application: it subscribes a topic table in batches in the SUBSCRIBE step.
+ */
+
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+#include "../../libs/rMqttConnector/rMqttConnector.h"
+
+using namespace B4R;
+
+static uint32_t nowMs = 0;
+uint32_t millis() { return nowMs; }
+uint32_t micros() { return 12345; }
+
+/** Socket stand-in with the broker side of the protocol. */
+class Broker : public Stream {
+public:
+    bool online = true;         // false: writes fail
+    bool answerConnect = false; // false: silent broker, no CONNACK
+    uint8_t connackCode = 0;    // CONNACK return code
+    bool answerPings = true;    // false: no PINGRESP
+
+    std::deque<uint8_t> toClient;
+    uint32_t connects = 0, pings = 0, disconnects = 0;
+    uint16_t keepAliveSeconds = 0;
+    uint8_t connectFlags = 0;
+    std::string clientId;
+    std::vector<std::string> subscriptions;
+    std::vector<uint16_t> subscribeIds, pubacks;
+
+    int available() override { return (int)toClient.size(); }
+
+    int read() override {
+        if (toClient.empty()) return -1;
+        uint8_t b = toClient.front();
+        toClient.pop_front();
+        return b;
+    }
+
+    // The connector writes each packet in one call
+    size_t write(const uint8_t* data, size_t length) override {
+        if (!online) return 0;
+        size_t pos = 1;
+        while (data[pos] & 0x80) pos++;
+        pos++;
+        switch (data[0] & 0xF0) {
+            case 0x10:
+                connects++;
+                toClient.clear();
+                connectFlags = data[pos + 7];
+                keepAliveSeconds = (uint16_t)(data[pos + 8] << 8 | data[pos + 9]);
+                clientId.assign((const char*)data + pos + 12, data[pos + 10] << 8 | data[pos + 11]);
+                if (answerConnect) Send({0x20, 0x02, 0x00, connackCode});
+                break;
+            case 0x80: {
+                uint16_t id = (uint16_t)(data[pos] << 8 | data[pos + 1]);
+                uint16_t topicLength = (uint16_t)(data[pos + 2] << 8 | data[pos + 3]);
+                subscribeIds.push_back(id);
+                subscriptions.emplace_back((const char*)data + pos + 4, topicLength);
+                Send({0x90, 0x03, data[pos], data[pos + 1], data[pos + 4 + topicLength]});
+                break;
+            }
+            case 0x40:
+                pubacks.push_back((uint16_t)(data[2] << 8 | data[3]));
+                break;
+            case 0xC0:
+                pings++;
+                if (answerPings) Send({0xD0, 0x00});
+                break;
+            case 0xE0:
+                disconnects++;
+                break;
+        }
+        return length;
+    }
+
+    void Send(std::vector<uint8_t> packet) {
+        toClient.insert(toClient.end(), packet.begin(), packet.end());
+    }
+
+    /** PUBLISH packet from the broker, QoS 0 or 1. */
+    static std::vector<uint8_t> Publish(const std::string& topic, const std::string& payload, uint8_t qos, uint16_t id) {
+        std::vector<uint8_t> body;
+        body.push_back((uint8_t)(topic.size() >> 8));
+        body.push_back((uint8_t)topic.size());
+        body.insert(body.end(), topic.begin(), topic.end());
+        if (qos > 0) {
+            body.push_back((uint8_t)(id >> 8));
+            body.push_back((uint8_t)id);
+        }
+        body.insert(body.end(), payload.begin(), payload.end());
+        std::vector<uint8_t> packet = { (uint8_t)(0x30 | qos << 1) };
+        size_t length = body.size();
+        do {
+            uint8_t b = length & 0x7F;
+            length >>= 7;
+            packet.push_back(length > 0 ? (b | 0x80) : b);
+        } while (length > 0);
+        packet.insert(packet.end(), body.begin(), body.end());
+        return packet;
+    }
+};
+
+static B4RMqttConnector link;
+static Broker broker;
+static B4RStream socketB4R = { &broker };
+static std::vector<Byte> transitions;
+static std::vector<uint32_t> transitionTimes;
+static std::vector<std::pair<std::string, std::string>> messages;
+static const int TOPICS = 10, BATCH = 4;
+static int subscribed = 0;
+static uint32_t steps = 0;
+static int failures = 0;
+
+static void StateChanged(Byte state) {
+    transitions.push_back(state);
+    transitionTimes.push_back(nowMs);
+    if (state == B4RMqttConnector::STATE_SUBSCRIBE) subscribed = 0;
+}
+
+static void Step(Byte state) {
+    steps++;
+    if (state != B4RMqttConnector::STATE_SUBSCRIBE) return;
+    for (int n = 0; n < BATCH && subscribed < TOPICS; n++) {
+        std::string topic = "homekit32/home1/t" + std::to_string(subscribed) + "/set";
+        B4RString t = { topic.c_str() };
+        if (!link.Subscribe(&t, 1)) {
+            link.Fail();
+            return;
+        }
+        subscribed++;
+    }
+    if (subscribed == TOPICS) link.Advance();
+}
+
+static void MessageArrived(B4RString* topic, ArrayByte* payload) {
+    messages.emplace_back(topic->data, std::string((const char*)payload->data, payload->length));
+}
+
+static void Check(bool condition, const char* name) {
+    printf("%-58s %s\n", name, condition ? "ok" : "FAILED");
+    if (!condition) failures++;
+}
+
+/** Run the main loop for ms milliseconds in 10 ms passes. */
+static void Run(uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += 10) {
+        nowMs += 10;
+        pollers.run();
+    }
+}
+
+/** Run until the state is reached, at most ms milliseconds. */
+static bool RunUntil(Byte state, uint32_t ms) {
+    for (uint32_t t = 0; t < ms && link.getState() != state; t += 10) Run(10);
+    return link.getState() == state;
+}
+
+int main() {
+    uint8_t ip[4] = {192, 168, 1, 10};
+    ArrayByte brokerIp = { ip, 4 };
+    B4RString ssid = { "ssid" }, password = { "password" };
+    B4RString clientId = { "homekit32" }, username = { "user" }, empty = { "" };
+    link.Initialize(&socketB4R, &brokerIp, 1883, StateChanged, Step, MessageArrived);
+    link.SetClient(&clientId, &username, &empty);
+    link.setBackoffMin(1000);
+    link.setBackoffMax(16000);
+    Check(link.getState() == B4RMqttConnector::STATE_IDLE, "idle until Start");
+
+    // Silent broker: the CONNACK wait times out on the connector's deadline, in short passes
+    link.Start(&ssid, &password);
+    bool inRange = true;
+    uint32_t ceiling = 1000;
+    for (int attempt = 1; attempt <= 8; attempt++) {
+        while (link.getState() != B4RMqttConnector::STATE_BACKOFF) Run(10);
+        uint32_t delay = link.getLastDelay();
+        if (delay < ceiling / 2 || delay > ceiling) inRange = false;
+        printf("  attempt %d: ceiling=%5u delay=%5u\n", attempt, ceiling, delay);
+        Run(delay);
+        ceiling = ceiling * 2 > 16000 ? 16000 : ceiling * 2;
+    }
+    Check(inRange, "backoff delay within [ceiling/2, ceiling], capped");
+    Check(link.getAttempts() == 8 && link.getFailCount() == 8 && broker.connects == 8, "attempts and fail count");
+    size_t n = 1;
+    while (n < transitions.size() && transitions[n] != B4RMqttConnector::STATE_BACKOFF) n++;
+    Check(n < transitions.size() && transitions[n - 1] == B4RMqttConnector::STATE_CONNACK
+        && transitionTimes[n] - transitionTimes[n - 1] >= link.getConnackTimeout()
+        && transitionTimes[n] - transitionTimes[n - 1] <= link.getConnackTimeout() + 10, "no CONNACK: backoff after ConnackTimeout");
+    Check(steps == 0, "no step in CONNACK");
+
+    // Refused CONNECT (not authorized): backoff at once
+    broker.answerConnect = true;
+    broker.connackCode = 5;
+    Check(RunUntil(B4RMqttConnector::STATE_CONNACK, 20000) && RunUntil(B4RMqttConnector::STATE_BACKOFF, 100), "refused CONNACK backs off");
+    Check(link.getConnackCode() == 5, "CONNACK return code");
+
+    // Broker back: CONNACK, batched SUBSCRIBE, READY
+    broker.connackCode = 0;
+    transitions.clear();
+    steps = 0;
+    Run(20000);
+    Check(link.getReady() && subscribed == TOPICS, "ready after the broker is back");
+    Check(steps == (TOPICS + BATCH - 1) / BATCH, "one step per subscribe batch");
+    Check(link.getAttempts() == 0 && link.getReadyCount() == 1, "attempts reset in ready");
+    bool order = transitions.size() >= 4
+        && transitions[transitions.size() - 3] == B4RMqttConnector::STATE_CONNACK
+        && transitions[transitions.size() - 2] == B4RMqttConnector::STATE_SUBSCRIBE
+        && transitions[transitions.size() - 1] == B4RMqttConnector::STATE_READY;
+    Check(order, "state order CONNACK > SUBSCRIBE > READY");
+    Check(broker.clientId == "homekit32" && broker.connectFlags == (0x02 | 0x80) && broker.keepAliveSeconds == 20,
+        "CONNECT client id, flags, keepalive twice the ping interval");
+    bool ids = broker.subscriptions.size() == (size_t)TOPICS && broker.subscriptions[9] == "homekit32/home1/t9/set";
+    for (size_t i = 1; ids && i < broker.subscribeIds.size(); i++) ids = broker.subscribeIds[i] == broker.subscribeIds[i - 1] + 1;
+    Check(ids, "SUBSCRIBE topics and packet ids");
+
+    // Keepalive: a PINGREQ every KeepAlive ms in ready, answered in time
+    while (broker.pings == 0) Run(10);
+    broker.pings = 0;
+    uint32_t pingCount = link.getPingCount();
+    Run(60000);
+    Check(broker.pings == 6 && link.getPingCount() - pingCount == 6, "keepalive pings every 10 s");
+    Check(link.getReady() && link.getMissedPingCount() == 0, "answered pings keep the connection");
+
+    // Received messages: QoS 0 and QoS 1 (PUBACK), one split across passes, one too large
+    broker.Send(Broker::Publish("homekit32/home1/led/set", "{\"s\":1}", 0, 0));
+    broker.Send(Broker::Publish("homekit32/home1/fan/set", "{\"s\":0}", 1, 77));
+    Run(10);
+    std::vector<uint8_t> split = Broker::Publish("homekit32/home1/lcd/set", "{\"t\":\"hello\"}", 1, 78);
+    broker.toClient.insert(broker.toClient.end(), split.begin(), split.begin() + 5);
+    Run(10);
+    broker.toClient.insert(broker.toClient.end(), split.begin() + 5, split.end());
+    broker.Send(Broker::Publish("homekit32/home1/lcd/set", std::string(RMQTTCONNECTOR_RX_SIZE + 200, 'x'), 1, 79));
+    broker.Send(Broker::Publish("homekit32/home1/servo/set", "{\"p\":90}", 0, 0));
+    Run(50);
+    Check(messages.size() == 4 && messages[0].first == "homekit32/home1/led/set" && messages[0].second == "{\"s\":1}"
+        && messages[1].second == "{\"s\":0}" && messages[2].second == "{\"t\":\"hello\"}"
+        && messages[3].first == "homekit32/home1/servo/set", "messages arrive intact and in order");
+    Check(broker.pubacks == std::vector<uint16_t>({77, 78, 79}), "QoS 1 messages acknowledged");
+    Check(link.getReceivedCount() == 4 && link.getDroppedCount() == 1 && link.getReady(), "too large message dropped, stream in sync");
+
+    // Mute broker: the PINGRESP missing at the next ping fails the connection
+    broker.answerPings = false;
+    uint32_t start = nowMs;
+    Check(RunUntil(B4RMqttConnector::STATE_BACKOFF, 30000), "missed PINGRESP backs off");
+    Check(nowMs - start <= 2 * link.getKeepAlive() && link.getMissedPingCount() == 1, "dead link detected within two ping intervals");
+    broker.answerPings = true;
+    Run(2000);
+    Check(link.getReady() && link.getReadyCount() == 2, "reconnected within the first backoff");
+
+    // Connection lost: a failed ping write backs off, then reconnects
+    broker.online = false;
+    for (int i = 0; i < 1000 && link.getReady(); i++) Run(10);
+    Check(link.getState() == B4RMqttConnector::STATE_BACKOFF && link.getAttempts() == 1, "lost connection backs off");
+    broker.online = true;
+    Run(2000);
+    Check(link.getReady() && link.getReadyCount() == 3, "reconnected after the lost connection");
+
+    // Jitter spread over many first attempts
+    uint32_t low = 0xFFFFFFFF, high = 0;
+    for (int i = 0; i < 1000; i++) {
+        link.Fail();
+        uint32_t delay = link.getLastDelay();
+        if (delay < low) low = delay;
+        if (delay > high) high = delay;
+        Run(2000);
+    }
+    printf("  first attempt delays: %u..%u ms\n", low, high);
+    Check(low >= 500 && high <= 1000 && high - low > 400, "first attempt jitter spread");
+
+    link.Stop();
+    Check(link.getState() == B4RMqttConnector::STATE_IDLE && broker.disconnects == 1, "stop writes DISCONNECT");
+    return failures == 0 ? 0 : 1;
+}
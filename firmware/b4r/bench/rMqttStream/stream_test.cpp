@@ -0,0 +1,136 @@
+/**
+ * @file stream_test.cpp
+ * @brief Linux test: rMqttStream packet framing, failed and short publishes.
+ *
+ * Build and run from bench/rMqttStream:
+ *   g++ -O2 -std=c++17 -Wall -Wextra -I../common stream_test.cpp ../../libs/rMqttStream/rMqttStream.cpp -o /tmp/stream_test
+ *   /tmp/stream_test
+ *
+ * A publish that fails after its header must close the socket (CloseCount on the
+ * host, WiFiClient::stop on the ESP32), a second Begin or a Publish while a
+ * Begin packet is open must be rejected without writing.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../../libs/rMqttStream/rMqttStream.h"
+
+using namespace B4R;
+
+static uint32_t nowMs = 0;
+uint32_t millis() { return nowMs; }
+uint32_t micros() { return nowMs * 1000; }
+
+static int failures = 0;
+
+static void Check(bool ok, const std::string& what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+/** Socket stand-in: keeps the bytes, accepts at most `budget` more (then write returns 0). */
+class Socket : public Stream {
+public:
+    std::vector<uint8_t> bytes;
+    size_t budget = SIZE_MAX;
+
+    size_t write(const uint8_t* data, size_t length) override {
+        if (length > budget) length = budget;
+        budget -= length;
+        bytes.insert(bytes.end(), data, data + length);
+        return length;
+    }
+};
+
+static ArrayByte Bytes(const char* s) {
+    return ArrayByte{(void*)s, (uint16_t)strlen(s)};
+}
+
+// QoS 0 PUBLISH: 0x30, remaining length, topic length, topic, payload
+static void Framing() {
+    Socket socket;
+    B4RStream stream{&socket};
+    B4RMqttStream publisher;
+    publisher.Initialize(&stream);
+
+    B4RString topic{"h/t"};
+    ArrayByte payload = Bytes("{\"s\":1}");
+    Check(publisher.Publish(&topic, &payload, true), "publish");
+    const uint8_t expect[] = { 0x31, 12, 0, 3, 'h', '/', 't', '{', '"', 's', '"', ':', '1', '}' };
+    Check(socket.bytes == std::vector<uint8_t>(expect, expect + sizeof(expect)), "publish bytes");
+
+    socket.bytes.clear();
+    ArrayByte a = Bytes("{\"s\":"), b = Bytes("1}");
+    Check(publisher.Begin(&topic, 7, false) && publisher.Write(&a) && publisher.Write(&b) && publisher.EndPublish(), "parts");
+    Check(socket.bytes.size() == sizeof(expect) && socket.bytes[0] == 0x30
+        && memcmp(socket.bytes.data() + 1, expect + 1, sizeof(expect) - 1) == 0, "parts bytes");
+    Check(publisher.getPublishCount() == 2 && publisher.getCloseCount() == 0, "framing counters");
+}
+
+// Every failure after the header closes the socket, once per packet
+static void FailedPublish() {
+    Socket socket;
+    B4RStream stream{&socket};
+    B4RMqttStream publisher;
+    publisher.Initialize(&stream);
+    B4RString topic{"h/t"};
+
+    // Payload cut off by the socket
+    ArrayByte payload = Bytes("0123456789");
+    socket.budget = 9;
+    Check(!publisher.Publish(&topic, &payload, false) && publisher.getCloseCount() == 1, "publish cut off closes");
+
+    // Header refused
+    socket.budget = 0;
+    Check(!publisher.Begin(&topic, 10, false) && publisher.getCloseCount() == 2, "begin refused closes");
+    Check(!publisher.Write(&payload) && !publisher.EndPublish(), "nothing open after a failed begin");
+
+    // Write beyond Length
+    socket.budget = SIZE_MAX;
+    ArrayByte more = Bytes("01234567890");
+    Check(publisher.Begin(&topic, 10, false), "begin");
+    Check(!publisher.Write(&more) && publisher.getCloseCount() == 3, "write beyond length closes");
+    Check(!publisher.EndPublish() && publisher.getCloseCount() == 3, "end after failure closes once");
+
+    // Short of Length at EndPublish
+    ArrayByte part = Bytes("01234");
+    Check(publisher.Begin(&topic, 10, false) && publisher.Write(&part), "short begin");
+    Check(!publisher.EndPublish() && publisher.getCloseCount() == 4, "short end closes");
+
+    // Payload write refused mid-packet
+    Check(publisher.Begin(&topic, 10, false), "begin 2");
+    socket.budget = 3;
+    Check(!publisher.Write(&payload) && publisher.getCloseCount() == 5, "write refused closes");
+    Check(!publisher.EndPublish() && publisher.getCloseCount() == 5, "end after refused write");
+    Check(publisher.getErrorCount() == 5 && publisher.getPublishCount() == 0, "error count");
+}
+
+// A second Begin or a Publish inside an open packet writes nothing
+static void OpenPacket() {
+    Socket socket;
+    B4RStream stream{&socket};
+    B4RMqttStream publisher;
+    publisher.Initialize(&stream);
+    B4RString topic{"h/t"};
+    ArrayByte part = Bytes("01234");
+
+    Check(publisher.Begin(&topic, 10, false) && publisher.Write(&part), "open");
+    size_t before = socket.bytes.size();
+    Check(!publisher.Begin(&topic, 5, false), "second begin rejected");
+    Check(!publisher.Publish(&topic, &part, false), "publish rejected");
+    Check(socket.bytes.size() == before && publisher.getCloseCount() == 0, "nothing written");
+    Check(publisher.Write(&part) && publisher.EndPublish(), "first packet completes");
+    Check(publisher.Publish(&topic, &part, false) && publisher.getPublishCount() == 2, "publish after end");
+}
+
+int main() {
+    Framing();
+    FailedPublish();
+    OpenPacket();
+    printf("mqtt stream: %s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
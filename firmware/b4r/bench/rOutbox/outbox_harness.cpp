@@ -0,0 +1,339 @@
+/**
+ * @file outbox_harness.cpp
+ * @brief Linux test harness: rOutbox store-and-forward against a local stand-in broker.
+ *
+ * Build and run from bench/rOutbox:
+ *   g++ -O2 -std=c++17 -I../common -I../../libs/rMqttStream -DROUTBOX_FLASH -DROUTBOX_FLASH_PATH='"/tmp/outbox.bin"' \
+ *       outbox_harness.cpp ../../libs/rOutbox/rOutbox.cpp ../../libs/rMqttStream/rMqttStream.cpp -o /tmp/outbox_harness
+ *   /tmp/outbox_harness
+ *
+ * The stand-in broker is the socket stream: it decodes the MQTT PUBLISH packets written to it
+ * and refuses writes while "offline". Each scenario publishes while offline, reconnects,
+ * runs the main loop poller and checks the received sequence. Scenarios 1 to 4 set
+ * ConfirmTime 0, scenario 5 the resend of unconfirmed messages lost in a "dead"
+ * connection (writes accepted, never delivered). Scenario 6 the rejection of
+ * messages too large to be queued.
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../../libs/rOutbox/rOutbox.h"
+
+using namespace B4R;
+
+static uint32_t nowMs = 0;
+uint32_t millis() { return nowMs; }
+uint32_t micros() { return nowMs * 1000; }
+
+/** Stand-in broker: decodes QoS 0 PUBLISH packets from the byte stream. */
+class StandInBroker : public Stream {
+public:
+    bool online = true;
+    bool dead = false;                      // Writes accepted into the socket buffer, never delivered
+    std::vector<uint8_t> rx;
+    std::vector<std::string> received;      // "topic=payload"
+    std::vector<bool> retained;
+
+    size_t write(const uint8_t* data, size_t length) override {
+        if (!online) return 0;
+        if (dead) return length;
+        rx.insert(rx.end(), data, data + length);
+        Decode();
+        return length;
+    }
+
+    void Decode() {
+        for (;;) {
+            if (rx.size() < 2) return;
+            uint32_t remaining = 0, shift = 0;
+            size_t i = 1;
+            do {
+                if (i >= rx.size()) return;
+                remaining |= (rx[i] & 0x7F) << shift;
+                shift += 7;
+            } while (rx[i++] & 0x80);
+            if (rx.size() < i + remaining) return;
+            uint16_t topicLength = (rx[i] << 8) | rx[i + 1];
+            std::string topic(rx.begin() + i + 2, rx.begin() + i + 2 + topicLength);
+            std::string payload(rx.begin() + i + 2 + topicLength, rx.begin() + i + remaining);
+            received.push_back(topic + "=" + payload);
+            retained.push_back(rx[0] & 0x01);
+            rx.erase(rx.begin(), rx.begin() + i + remaining);
+        }
+    }
+};
+
+static int failures = 0;
+static ULong replayedEvent = 0;
+
+static void Check(bool ok, const char* what) {
+    printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) failures++;
+}
+
+static void Replayed(ULong count) {
+    replayedEvent = count;
+}
+
+static void Pub(B4ROutbox& box, const char* topic, const char* payload, bool retain = true) {
+    B4RString t{topic};
+    ArrayByte p{(void*)payload, (uint16_t)strlen(payload)};
+    box.Publish(&t, &p, retain);
+}
+
+static void Loop(int passes) {
+    for (int i = 0; i < passes; i++) {
+        nowMs += 10;
+        pollers.run();
+    }
+}
+
+static bool Sequence(const StandInBroker& broker, const std::vector<std::string>& expected) {
+    if (broker.received != expected) {
+        for (const std::string& r : broker.received) printf("     got %s\n", r.c_str());
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    remove("/tmp/outbox.bin");
+
+    // 1. Direct publish while connected, ordering of queued events after a reconnect
+    {
+        StandInBroker broker;
+        B4RStream stream{&broker};
+        static B4RMqttStream publisher;
+        static B4ROutbox box;
+        publisher.Initialize(&stream);
+        box.Initialize(&publisher, 8, Replayed);
+        box.setConfirmTime(0);
+        box.setConnected(true);
+
+        Pub(box, "h/rfid/status", "{\"u\":\"01\"}");
+        Check(broker.received.size() == 1 && box.getCount() == 0, "connected: sent immediately, nothing queued");
+
+        broker.online = false;
+        box.setConnected(false);
+        Pub(box, "h/rfid/status", "{\"u\":\"02\"}");
+        Pub(box, "h/gas/status", "{\"s\":\"detected\"}");
+        Pub(box, "h/pir/status", "{\"s\":\"detected\"}");
+        Pub(box, "h/rfid/status", "{\"u\":\"03\"}");
+        Check(box.getCount() == 4, "offline: 4 events queued");
+
+        Loop(3);
+        Check(broker.received.size() == 1, "offline: nothing replayed while disconnected");
+
+        broker.online = true;
+        box.setWindow(2);
+        box.setConnected(true);
+        Loop(1);
+        Check(broker.received.size() == 3, "window 2: two messages per loop pass");
+        Pub(box, "h/pir/status", "{\"s\":\"clear\"}");
+        Loop(2);
+        Check(Sequence(broker, {
+            "h/rfid/status={\"u\":\"01\"}", "h/rfid/status={\"u\":\"02\"}", "h/gas/status={\"s\":\"detected\"}",
+            "h/pir/status={\"s\":\"detected\"}", "h/rfid/status={\"u\":\"03\"}", "h/pir/status={\"s\":\"clear\"}" }),
+            "replay in publish order, publish during replay queued behind");
+        Check(replayedEvent == 5 && box.getReplayedCount() == 5, "Replayed event with 5 messages");
+        Check(box.getLastReplayTime() == 30, "replay time measured");
+    }
+
+    // 2. Latest-only compaction of state topics, events kept
+    {
+        StandInBroker broker;
+        B4RStream stream{&broker};
+        static B4RMqttStream publisher;
+        static B4ROutbox box;
+        publisher.Initialize(&stream);
+        box.Initialize(&publisher, 8, Replayed);
+        box.setConfirmTime(0);
+        B4RString dht{"h/dht11/status"}, moisture{"h/moisture/status"};
+        box.AddLatestOnly(&dht);
+        box.AddLatestOnly(&moisture);
+
+        broker.online = false;
+        Pub(box, "h/dht11/status", "{\"t\":20.0,\"h\":40.0}");
+        Pub(box, "h/rfid/status", "{\"u\":\"AA\"}");
+        Pub(box, "h/dht11/status", "{\"t\":21.0,\"h\":41.0}");
+        Pub(box, "h/moisture/status", "{\"s\":10}");
+        Pub(box, "h/rfid/status", "{\"u\":\"BB\"}");
+        Pub(box, "h/dht11/status", "{\"t\":22.0,\"h\":42.0}");
+        Pub(box, "h/moisture/status", "{\"s\":12}");
+        Check(box.getCount() == 4 && box.getCompactedCount() == 3, "3 state messages compacted, 4 queued");
+
+        broker.online = true;
+        box.setConnected(true);
+        Loop(4);
+        Check(Sequence(broker, {
+            "h/dht11/status={\"t\":22.0,\"h\":42.0}", "h/rfid/status={\"u\":\"AA\"}",
+            "h/moisture/status={\"s\":12}", "h/rfid/status={\"u\":\"BB\"}" }),
+            "latest state per topic, both RFID events in order");
+    }
+
+    // 3. Full RAM ring: drop oldest, reject newest
+    {
+        StandInBroker broker;
+        B4RStream stream{&broker};
+        static B4RMqttStream publisher;
+        static B4ROutbox box;
+        publisher.Initialize(&stream);
+        box.Initialize(&publisher, 3, Replayed);
+        box.setConfirmTime(0);
+        broker.online = false;
+        for (const char* p : {"1", "2", "3", "4", "5"}) Pub(box, "h/e", p);
+        Check(box.getCount() == 3 && box.getDroppedCount() == 2, "drop oldest: 2 dropped");
+        broker.online = true;
+        box.setConnected(true);
+        Loop(3);
+        Check(Sequence(broker, { "h/e=3", "h/e=4", "h/e=5" }), "drop oldest keeps the newest 3");
+
+        broker.received.clear();
+        box.setConnected(false);
+        broker.online = false;
+        box.setPolicy(B4ROutbox::POLICY_REJECT_NEWEST);
+        for (const char* p : {"6", "7", "8", "9"}) Pub(box, "h/e", p);
+        broker.online = true;
+        box.setConnected(true);
+        Loop(3);
+        Check(Sequence(broker, { "h/e=6", "h/e=7", "h/e=8" }), "reject newest keeps the oldest 3");
+    }
+
+    // 4. Flash spill: RAM ring full, later messages in flash, replay order across both
+    {
+        StandInBroker broker;
+        B4RStream stream{&broker};
+        static B4RMqttStream publisher;
+        static B4ROutbox box;
+        publisher.Initialize(&stream);
+        box.Initialize(&publisher, 3, Replayed);
+        box.setConfirmTime(0);
+        Check(box.EnableFlash(), "flash enabled");
+        broker.online = false;
+        std::vector<std::string> expected;
+        for (int i = 0; i < 10; i++) {
+            std::string p = std::to_string(i);
+            Pub(box, "h/e", p.c_str());
+            expected.push_back("h/e=" + p);
+        }
+        Check(box.getCount() == 3 && box.getFlashCount() == 7 && box.getDroppedCount() == 0, "3 in RAM, 7 spilled");
+
+        broker.online = true;
+        box.setConnected(true);
+        Pub(box, "h/e", "10");
+        expected.push_back("h/e=10");
+        Loop(5);
+        Check(Sequence(broker, expected), "replay RAM then flash then new, in order");
+        Check(box.getFlashCount() == 0 && replayedEvent == 11, "flash empty after replay, 11 replayed");
+
+        // Records left in flash are replayed after a restart
+        broker.received.clear();
+        broker.online = false;
+        box.setConnected(false);
+        for (const char* p : {"a", "b", "c", "d", "e"}) Pub(box, "h/r", p);
+        static B4ROutbox rebooted;
+        rebooted.Initialize(&publisher, 3, Replayed);
+        rebooted.setConfirmTime(0);
+        rebooted.EnableFlash();
+        broker.online = true;
+        rebooted.setConnected(true);
+        Loop(3);
+        Check(Sequence(broker, { "h/r=d", "h/r=e" }), "flash records replayed after restart (RAM lost)");
+    }
+
+    // 5. Messages written into a dead connection are sent again after the reconnect
+    {
+        StandInBroker broker;
+        B4RStream stream{&broker};
+        static B4RMqttStream publisher;
+        static B4ROutbox box;
+        publisher.Initialize(&stream);
+        box.Initialize(&publisher, 8, Replayed);
+        box.setConfirmTime(20000);
+        B4RString dht{"h/dht11/status"};
+        box.AddLatestOnly(&dht);
+        box.setConnected(true);
+
+        Pub(box, "h/e", "1");
+        Loop(1);
+        nowMs += 20000;
+        Loop(1);
+        Check(box.getUnconfirmedCount() == 0, "confirmed after ConfirmTime");
+
+        broker.dead = true;
+        Pub(box, "h/e", "2");
+        Pub(box, "h/dht11/status", "{\"t\":20.0}");
+        Pub(box, "h/e", "3");
+        Loop(2);
+        Check(box.getUnconfirmedCount() == 3 && broker.received.size() == 1, "3 sent into the dead connection, kept");
+
+        // Connection lost, a newer state and an event published while offline
+        broker.dead = false;
+        broker.online = false;
+        box.setConnected(false);
+        Pub(box, "h/dht11/status", "{\"t\":21.0}");
+        Pub(box, "h/e", "4");
+        Check(box.getCount() == 4 && box.getResentCount() == 3 && box.getCompactedCount() == 1, "3 requeued, the state compacted");
+
+        broker.online = true;
+        box.setConnected(true);
+        Loop(2);
+        Check(Sequence(broker, { "h/e=1", "h/e=2", "h/dht11/status={\"t\":21.0}", "h/e=3", "h/e=4" }),
+            "lost messages sent again in order before the offline ones, 1 not repeated");
+
+        // Only the last Window sent messages are kept
+        broker.received.clear();
+        box.setWindow(2);
+        for (const char* p : {"5", "6", "7"}) Pub(box, "h/e", p);
+        Check(box.getUnconfirmedCount() == 2, "window 2 kept");
+        box.setConnected(false);
+        box.setConnected(true);
+        Loop(1);
+        Check(Sequence(broker, { "h/e=5", "h/e=6", "h/e=7", "h/e=6", "h/e=7" }), "last window sent again");
+    }
+
+    // 6. Messages larger than PAYLOAD_SIZE: sent directly, else rejected apart from the full queue drops
+    {
+        StandInBroker broker;
+        B4RStream stream{&broker};
+        static B4RMqttStream publisher;
+        static B4ROutbox box;
+        publisher.Initialize(&stream);
+        box.Initialize(&publisher, 8, Replayed);
+        box.setConfirmTime(0);
+        box.setConnected(true);
+        std::string large(B4ROutbox::PAYLOAD_SIZE + 1, 'x');
+
+        Pub(box, "h/big", large.c_str());
+        Check(broker.received.size() == 1 && box.getLastError() == B4ROutbox::ERROR_NONE, "connected, nothing queued: sent directly");
+
+        // Offline: rejected, not queued
+        broker.online = false;
+        box.setConnected(false);
+        Pub(box, "h/e", "1");
+        Pub(box, "h/big", large.c_str());
+        Check(box.getLastError() == B4ROutbox::ERROR_PAYLOAD_TOO_LARGE && box.getOversizeCount() == 1
+            && box.getDroppedCount() == 0 && box.getCount() == 1, "offline: rejected as too large");
+
+        // Replaying: rejected rather than sent ahead of the queue
+        broker.online = true;
+        box.setWindow(1);
+        box.setConnected(true);
+        Pub(box, "h/e", "2");
+        Pub(box, "h/big", large.c_str());
+        Pub(box, "h/e", "3");
+        Loop(3);
+        Check(box.getOversizeCount() == 2 && box.getLastError() == B4ROutbox::ERROR_NONE, "replaying: rejected as too large");
+        Check(Sequence(broker, { "h/big=" + large, "h/e=1", "h/e=2", "h/e=3" }), "queued messages in order");
+
+        // Socket write failed: rejected, the message cannot be queued
+        broker.online = false;
+        Pub(box, "h/big", large.c_str());
+        Check(box.getOversizeCount() == 3 && box.getLastError() == B4ROutbox::ERROR_PAYLOAD_TOO_LARGE, "failed write: rejected as too large");
+    }
+
+    remove("/tmp/outbox.bin");
+    printf("%s\n", failures == 0 ? "all passed" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+/**
+ * @file codec_bench.cpp
+ * @brief Linux benchmark: payload size and render/parse time of JSON, CBOR and MessagePack.
+ *
+ * Build and run from bench/rPayloadCodec:
+ *   g++ -O2 -std=c++17 -I../common -I../../libs/rJsonIndex -I../../libs/rPayloadCodec codec_bench.cpp \
+ *       ../../libs/rPayloadCodec/rPayloadCodec.cpp ../../libs/rPayloadTemplate/rPayloadTemplate.cpp \
+ *       ../../libs/rJsonIndex/rJsonIndex.cpp -o /tmp/codec_bench
+ *   /tmp/codec_bench          sizes and ns per render / parse
+ *   /tmp/codec_bench --hex    payloads as hex lines "<name> <format> <hex>" for the Python decoder
+ *
+ * The templates and values are the ones the device modules publish (MQTTTopics.PAYLOAD_...).
+ * A conformance check runs first: every binary payload is parsed with ParseAuto and each
+ * member is compared with the JSON rendering of the same template.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "../../libs/rPayloadTemplate/rPayloadTemplate.h"
+
+using namespace B4R;
+
+struct Case {
+    const char* name;
+    const char* text;
+    void (*set)(B4RPayloadTemplate& t);
+};
+
+static B4RString S(const char* s) { return B4RString{ s }; }
+
+static void SetField(B4RPayloadTemplate& t, const char* name, int32_t value) {
+    B4RString n = S(name);
+    t.SetLong(&n, value);
+}
+
+static void SetFloat(B4RPayloadTemplate& t, const char* name, double value, uint8_t decimals) {
+    B4RString n = S(name);
+    t.SetFloat(&n, value, decimals);
+}
+
+static uint8_t UID[] = { 0x3A, 0x9F, 0x04, 0xC2 };
+
+static const Case CASES[] = {
+    { "state", "{\"s\":#S}", [](B4RPayloadTemplate& t) { SetField(t, "S", 1); } },
+    { "dht11", "{\"t\":#T,\"h\":#H}", [](B4RPayloadTemplate& t) { SetFloat(t, "T", 21.5, 1); SetFloat(t, "H", 45.2, 1); } },
+    { "moisture", "{\"s\":#S}", [](B4RPayloadTemplate& t) { SetField(t, "S", 1874); } },
+    { "rgbled", "{\"i\":#I,\"r\":#R,\"g\":#G,\"b\":#B,\"c\":#C}",
+        [](B4RPayloadTemplate& t) { SetField(t, "I", 2); SetField(t, "R", 255); SetField(t, "G", 128); SetField(t, "B", 0); SetField(t, "C", 0); } },
+    { "rfid", "{\"u\":\"#U\",\"g\":#G,\"c\":#C}",
+        [](B4RPayloadTemplate& t) {
+            B4RString n = S("U");
+            ArrayByte a = { UID, sizeof(UID) };
+            t.SetHex(&n, &a);
+            SetField(t, "G", 1);
+            SetField(t, "C", 12);
+        } },
+    { "systemerror", "{\"m\":\"#M\",\"c\":#C,\"i\":#I}",
+        [](B4RPayloadTemplate& t) {
+            B4RString n = S("M"), m = S("DHT11 read failed");
+            t.SetText(&n, &m);
+            SetField(t, "C", 3);
+            SetField(t, "I", -1);
+        } },
+    { "systeminfo", "{\"u\":#U,\"q\":#Q,\"f\":#F,\"w\":#W,\"x\":#X,\"k\":#K,\"n\":#N,\"r\":#R}",
+        [](B4RPayloadTemplate& t) {
+            SetField(t, "U", 86400); SetField(t, "Q", 3); SetField(t, "F", 0); SetField(t, "W", 17);
+            SetField(t, "X", 0); SetField(t, "K", 2); SetField(t, "N", 20); SetField(t, "R", 145);
+        } },
+};
+static const int CASE_COUNT = sizeof(CASES) / sizeof(CASES[0]);
+
+// Fixed payloads published as they are, transcoded by PayloadCodec
+static const char* STATIC_PAYLOADS[] = { "{\"s\":\"on\"}", "{\"p\":1}", "{\"s\":\"closed\"}", "{\"a\":-3.25,\"b\":null,\"c\":false}" };
+
+static const char* FORMAT_NAMES[] = { "json", "cbor", "msgpack" };
+
+static int failures = 0;
+
+static void Check(bool ok, const char* what, const char* name) {
+    if (!ok) {
+        printf("FAIL: %s (%s)\n", what, name);
+        failures++;
+    }
+}
+
+// Compare all members of a binary payload with the JSON payload
+static void Compare(const char* json, uint16_t jsonLength, const uint8_t* bin, uint16_t binLength, uint8_t format, const char* name) {
+    B4RJsonIndex a, b;
+    Check(a.ParseAutoBytes(json, jsonLength) && a.getFormat() == B4RJsonIndex::FORMAT_JSON, "parse json", name);
+    Check(b.ParseAutoBytes((const char*)bin, binLength), "parse binary", name);
+    Check(b.getFormat() == format, "detected format", name);
+    Check(a.getCount() == b.getCount(), "member count", name);
+
+    for (uint8_t i = 0; i < a.getCount(); i++) {
+        B4RJsonIndex::Member ma, mb;
+        a.MemberAt(i, ma);
+        b.MemberAt(i, mb);
+        Check(ma.keyLength == mb.keyLength && memcmp(ma.key, mb.key, ma.keyLength) == 0, "key", name);
+        Check(ma.type == mb.type, "type", name);
+        if (ma.type == B4RJsonIndex::TYPE_NUMBER) {
+            // float32 carries 7 significant digits
+            double tolerance = fabs(ma.doubleValue) * 1e-7;
+            Check(fabs(ma.doubleValue - mb.doubleValue) <= tolerance, "number", name);
+            Check(ma.integer == mb.integer, "integer", name);
+        } else if (ma.type == B4RJsonIndex::TYPE_STRING) {
+            char ta[64], tb[64];
+            uint16_t na = a.TextAt(i, ta, sizeof(ta));
+            uint16_t nb = b.TextAt(i, tb, sizeof(tb));
+            Check(na == nb && memcmp(ta, tb, na) == 0, "text", name);
+        } else if (ma.type == B4RJsonIndex::TYPE_BOOL) {
+            Check(ma.longValue == mb.longValue, "bool", name);
+        }
+    }
+}
+
+static void PrintHex(const char* name, uint8_t format, const uint8_t* data, uint16_t length) {
+    printf("%s %s ", name, FORMAT_NAMES[format]);
+    for (uint16_t i = 0; i < length; i++) printf("%02x", data[i]);
+    printf("\n");
+}
+
+static void Conformance(bool hex) {
+    B4RPayloadTemplate t;
+    B4RPayloadCodec codec;
+    uint8_t json[128], bin[128];
+
+    for (int c = 0; c < CASE_COUNT; c++) {
+        B4RString text = S(CASES[c].text);
+        Check(t.Initialize(&text) && t.getBinary(), "template", CASES[c].name);
+        CASES[c].set(t);
+        uint16_t jn = t.RenderInto(json, sizeof(json));
+        if (hex) PrintHex(CASES[c].name, 0, json, jn);
+        for (uint8_t f = 1; f <= 2; f++) {
+            uint16_t bn = t.RenderFormatInto(bin, sizeof(bin), f);
+            Check(bn > 0 && bn < jn, "binary smaller", CASES[c].name);
+            Compare((const char*)json, jn, bin, bn, f, CASES[c].name);
+            if (hex) PrintHex(CASES[c].name, f, bin, bn);
+
+            // Transcoding the JSON gives the same bytes as rendering (float32 both ways)
+            uint8_t trans[128];
+            uint16_t tn = codec.TranscodeInto((const char*)json, jn, f, trans, sizeof(trans));
+            Check(tn == bn && memcmp(trans, bin, bn) == 0, "transcode = render", CASES[c].name);
+        }
+    }
+
+    for (const char* s : STATIC_PAYLOADS) {
+        uint16_t jn = (uint16_t)strlen(s);
+        for (uint8_t f = 1; f <= 2; f++) {
+            uint16_t bn = codec.TranscodeInto(s, jn, f, bin, sizeof(bin));
+            Check(bn > 0, "transcode", s);
+            Compare(s, jn, bin, bn, f, s);
+            if (hex) PrintHex("static", f, bin, bn);
+        }
+    }
+
+    // Not plannable: nested value and a field inside text are rendered as JSON
+    const char* nested[] = { "{\"a\":[#A]}", "{\"m\":\"x#M\"}", "[#A]" };
+    for (const char* s : nested) {
+        B4RString text = S(s);
+        Check(t.Initialize(&text) && !t.getBinary(), "not binary", s);
+        Check(t.RenderFormatInto(bin, sizeof(bin), 1) == t.RenderInto(json, sizeof(json)), "json fallback", s);
+    }
+    const char* nestedJson = "{\"a\":{\"b\":1}}";
+    Check(codec.TranscodeInto(nestedJson, (uint16_t)strlen(nestedJson), 1, bin, sizeof(bin)) == 0, "nested stays json", nestedJson);
+
+    // NaN is null in all formats
+    B4RString dht = S(CASES[1].text);
+    t.Initialize(&dht);
+    SetFloat(t, "T", NAN, 1);
+    SetFloat(t, "H", 40, 1);
+    uint16_t bn = t.RenderFormatInto(bin, sizeof(bin), 1);
+    B4RJsonIndex j;
+    B4RString key = S("t");
+    Check(j.ParseAutoBytes((const char*)bin, bn) && j.TypeOf(&key) == B4RJsonIndex::TYPE_NULL, "NaN is null", "dht11");
+
+    // Too small buffer
+    Check(t.RenderFormatInto(bin, 4, 2) == 0, "overflow", "dht11");
+}
+
+static volatile uint32_t sink;
+
+int main(int argc, char** argv) {
+    bool hex = argc > 1 && strcmp(argv[1], "--hex") == 0;
+    Conformance(hex);
+    if (hex) return failures == 0 ? 0 : 1;
+    printf("conformance: %s\n", failures == 0 ? "ok" : "FAILED");
+
+    const int iterations = 1000000;
+    B4RPayloadTemplate t;
+    B4RJsonIndex j;
+    uint8_t out[128];
+    uint32_t total[3] = { 0, 0, 0 };
+
+    printf("%-12s %5s %5s %5s   %9s %9s %9s   %9s %9s %9s\n", "payload", "json", "cbor", "mpack",
+        "render ns", "", "", "parse ns", "", "");
+    for (int c = 0; c < CASE_COUNT; c++) {
+        B4RString text = S(CASES[c].text);
+        t.Initialize(&text);
+        CASES[c].set(t);
+
+        uint16_t size[3];
+        double render[3], parse[3];
+        for (uint8_t f = 0; f <= 2; f++) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (int it = 0; it < iterations; it++) {
+                size[f] = t.RenderFormatInto(out, sizeof(out), f);
+                sink += out[size[f] - 1];
+            }
+            auto t1 = std::chrono::steady_clock::now();
+            for (int it = 0; it < iterations; it++) {
+                j.ParseAutoBytes((const char*)out, size[f]);
+                sink += j.getCount();
+            }
+            auto t2 = std::chrono::steady_clock::now();
+            render[f] = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+            parse[f] = std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations;
+            total[f] += size[f];
+        }
+        printf("%-12s %5u %5u %5u   %9.1f %9.1f %9.1f   %9.1f %9.1f %9.1f\n", CASES[c].name,
+            size[0], size[1], size[2], render[0], render[1], render[2], parse[0], parse[1], parse[2]);
+    }
+    printf("%-12s %5u %5u %5u   (cbor %.0f%%, msgpack %.0f%% of json)\n", "total", total[0], total[1], total[2],
+        100.0 * total[1] / total[0], 100.0 * total[2] / total[0]);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,338 @@
+/**
+ * @file scheduler_test.cpp
+ * @brief Linux test: rScheduler TimingWheel with a virtual clock.
+ *
+ * Build and run from bench/rScheduler:
+ *   g++ -O2 -std=c++17 -I../../libs/rScheduler scheduler_test.cpp ../../libs/rScheduler/TimingWheel.cpp \
+ *       -o /tmp/scheduler_test
+ *   /tmp/scheduler_test
+ *
+ * The clock only moves when the test moves it: jobs must run exactly at their
+ * deadline tick, periods must not drift over hours, a blocked loop must skip
+ * periods instead of running them in a burst. The last part compares the main
+ * loop of the HomeKit32 sensors with pollers (every pass) and with the wheel.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "TimingWheel.h"
+
+static int failures = 0;
+static uint32_t nowMs = 0;
+static uint32_t nowUs = 0;
+
+static void Check(bool ok, const std::string& what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what.c_str());
+        failures++;
+    }
+}
+
+static uint32_t VirtualMicros() {
+    return nowUs;
+}
+
+// Advance tick by tick, as a main loop running faster than 1 kHz
+static void RunTo(TimingWheel& w, uint32_t until) {
+    while ((int32_t)(until - nowMs) > 0) {
+        nowMs++;
+        nowUs += 1000;
+        w.advance(nowMs);
+    }
+}
+
+struct Recorder {
+    std::vector<uint32_t> times;
+    uint32_t cost = 0;      // Virtual run time in us
+};
+
+static void Record(void* arg) {
+    Recorder* r = (Recorder*)arg;
+    r->times.push_back(nowMs);
+    nowUs += r->cost;
+}
+
+// Periods on every level, over the 32-bit wrap of millis()
+static void Periodic(uint32_t start) {
+    TimingWheel w;
+    nowMs = start;
+    w.begin(nowMs, VirtualMicros);
+    const uint32_t periods[] = { 63, 64, 500, 1000, 4096, 70000, 300000, 20000000 };
+    Recorder rec[8];
+    uint8_t ids[8];
+    for (int i = 0; i < 8; i++) ids[i] = w.add(Record, &rec[i], periods[i], periods[i], 0);
+    RunTo(w, start + 50000000);
+    for (int i = 0; i < 8; i++) {
+        bool exact = true;
+        for (size_t k = 0; k < rec[i].times.size(); k++) {
+            if (rec[i].times[k] != start + (uint32_t)(k + 1) * periods[i]) exact = false;
+        }
+        Check(rec[i].times.size() == 50000000 / periods[i], "periodic count " + std::to_string(periods[i]) + " start " + std::to_string(start));
+        Check(exact, "periodic phase " + std::to_string(periods[i]) + " start " + std::to_string(start));
+        Check(w.job(ids[i])->maxLate == 0 && w.job(ids[i])->missed == 0, "periodic late " + std::to_string(periods[i]));
+    }
+    printf("periodic from %10u: 8 jobs, 50e6 ms, %u runs, %u ticks\n", start, w.runCount, w.tickCount);
+}
+
+// Sensors added together get different phases
+static void Stagger() {
+    TimingWheel w;
+    nowMs = 1000;
+    w.begin(nowMs, VirtualMicros);
+    Recorder dht, moisture, rfid;
+    w.add(Record, &dht, 1000, TimingWheel::PHASE_AUTO, 0);
+    w.add(Record, &moisture, 500, TimingWheel::PHASE_AUTO, 0);
+    w.add(Record, &rfid, 100, TimingWheel::PHASE_AUTO, 0);
+    RunTo(w, 1000 + 60000);
+    std::map<uint32_t, int> perTick;
+    for (auto* r : { &dht, &moisture, &rfid }) {
+        for (uint32_t t : r->times) perTick[t]++;
+    }
+    int shared = 0;
+    for (auto& e : perTick) shared += e.second > 1;
+    printf("stagger: first runs at +%u +%u +%u ms, ticks with two jobs: %d\n",
+        dht.times[0] - 1000, moisture.times[0] - 1000, rfid.times[0] - 1000, shared);
+    Check(shared == 0, "stagger");
+    Check(dht.times.size() == 60 && moisture.times.size() == 120 && rfid.times.size() == 600, "stagger counts");
+}
+
+// One-shot retried by itself, as the DHT decode job
+struct Decoder {
+    TimingWheel* w;
+    uint8_t id;
+    int polls = 0;
+    std::vector<uint32_t> times;
+};
+
+static void Decode(void* arg) {
+    Decoder* d = (Decoder*)arg;
+    d->times.push_back(nowMs);
+    if (++d->polls < 4) d->w->schedule(d->id, 1);
+}
+
+static void OneShot() {
+    TimingWheel w;
+    nowMs = 0;
+    w.begin(nowMs, VirtualMicros);
+    Decoder d;
+    d.w = &w;
+    d.id = w.add(Decode, &d, 0, 27, 0);
+    RunTo(w, 200);
+    Check(d.times == std::vector<uint32_t>({ 27, 28, 29, 30 }), "one-shot retries");
+    // Started again from outside
+    w.schedule(d.id, 10);
+    RunTo(w, 300);
+    Check(d.times.size() == 5 && d.times[4] == 210, "one-shot again");
+    Check(w.nextDelay(nowMs) == UINT32_MAX, "no deadline");
+}
+
+// A job postponed by itself keeps the new phase (RFID hold-off)
+struct Holdoff {
+    TimingWheel* w;
+    uint8_t id;
+    std::vector<uint32_t> times;
+};
+
+static void Card(void* arg) {
+    Holdoff* h = (Holdoff*)arg;
+    h->times.push_back(nowMs);
+    if (nowMs == 300) h->w->schedule(h->id, 500);
+}
+
+static void Postpone() {
+    TimingWheel w;
+    nowMs = 0;
+    w.begin(nowMs, VirtualMicros);
+    Holdoff h;
+    h.w = &w;
+    h.id = w.add(Card, &h, 100, 100, 0);
+    RunTo(w, 1000);
+    Check(h.times == std::vector<uint32_t>({ 100, 200, 300, 800, 900, 1000 }), "hold-off");
+}
+
+// Blocked main loop: missed periods, no burst
+static void Missed() {
+    TimingWheel w;
+    nowMs = 0;
+    w.begin(nowMs, VirtualMicros);
+    Recorder rec;
+    uint8_t id = w.add(Record, &rec, 500, 500, 0);
+    RunTo(w, 1000);
+    // Blocked 2300 ms (e.g. a TLS handshake): 1500 runs late, 2000, 2500 and 3000 are skipped
+    nowMs = 3300;
+    w.advance(nowMs);
+    RunTo(w, 4000);
+    Check(rec.times == std::vector<uint32_t>({ 500, 1000, 3300, 3500, 4000 }), "missed runs");
+    Check(w.job(id)->missed == 3 && w.missedCount == 3 && w.job(id)->maxLate == 1800, "missed count");
+}
+
+// Budget: runs longer than the budget are counted
+static void Budget() {
+    TimingWheel w;
+    nowMs = 0;
+    w.begin(nowMs, VirtualMicros);
+    Recorder fast, slow;
+    fast.cost = 200;
+    slow.cost = 800;
+    uint8_t a = w.add(Record, &fast, 10, 10, 500);
+    uint8_t b = w.add(Record, &slow, 10, 15, 500);
+    RunTo(w, 1000);
+    Check(w.job(a)->overruns == 0 && w.job(a)->maxMicros == 200, "budget fast");
+    Check(w.job(b)->overruns == 99 && w.job(b)->maxMicros == 800 && w.overrunCount == 99, "budget slow");
+}
+
+// Cancel and remove, also from inside a job
+struct SelfStop {
+    TimingWheel* w;
+    uint8_t id;
+    int runs = 0;
+    bool remove;
+};
+
+static void Stop(void* arg) {
+    SelfStop* s = (SelfStop*)arg;
+    if (++s->runs == 3) {
+        if (s->remove) s->w->remove(s->id);
+        else s->w->cancel(s->id);
+    }
+}
+
+static void Cancel() {
+    TimingWheel w;
+    nowMs = 0;
+    w.begin(nowMs, VirtualMicros);
+    SelfStop c, r;
+    c.w = r.w = &w;
+    c.remove = false;
+    r.remove = true;
+    c.id = w.add(Stop, &c, 50, 50, 0);
+    r.id = w.add(Stop, &r, 70, 70, 0);
+    Recorder other;
+    uint8_t o = w.add(Record, &other, 5000, 5000, 0);
+    w.cancel(o);
+    RunTo(w, 10000);
+    Check(c.runs == 3 && r.runs == 3 && other.times.empty(), "cancel");
+    Check(w.jobCount == 2 && w.job(r.id) == nullptr && w.job(c.id) != nullptr, "remove");
+    // The removed id is reused
+    Check(w.add(Record, &other, 10, 10, 0) == r.id, "reuse");
+    // Full
+    for (int i = w.jobCount; i < TimingWheel::JOBS_MAX; i++) w.add(Record, &other, 10, 10, 0);
+    Check(w.add(Record, &other, 10, 10, 0) == TimingWheel::NONE, "full");
+}
+
+// Random add / cancel / schedule against a reference of deadlines
+struct Fuzz {
+    uint8_t id;
+    uint32_t period;
+    uint32_t expect;
+    bool active;
+    int runs;
+};
+static std::vector<Fuzz> fuzz(TimingWheel::JOBS_MAX);
+
+static void FuzzRun(void* arg) {
+    Fuzz* f = (Fuzz*)arg;
+    Check(f->active && nowMs == f->expect, "fuzz deadline");
+    f->runs++;
+    if (f->period == 0) f->active = false;
+    else f->expect += f->period;
+}
+
+static void Random() {
+    TimingWheel w;
+    std::mt19937 rng(11);
+    nowMs = 0xFFF00000;     // Wraps during the test
+    w.begin(nowMs, VirtualMicros);
+    int runs = 0;
+    for (int step = 0; step < 200000; step++) {
+        Fuzz& f = fuzz[rng() % fuzz.size()];
+        uint32_t r = rng() % 100;
+        uint32_t span = rng() % 8 == 0 ? 5000000 : rng() % 4 == 0 ? 20000 : 300;
+        if (!f.active && r < 30) {
+            f.period = rng() % 3 == 0 ? 0 : 1 + rng() % span;
+            uint32_t delay = 1 + rng() % span;
+            f.id = w.add(FuzzRun, &f, f.period, delay, 0);
+            f.expect = nowMs + delay;
+            f.active = f.id != TimingWheel::NONE;
+        } else if (f.active && r < 10) {
+            w.cancel(f.id);
+            f.active = false;
+            runs += f.runs;
+            f.runs = 0;
+            w.remove(f.id);
+        } else if (f.active && r < 20) {
+            uint32_t delay = 1 + rng() % span;
+            w.schedule(f.id, delay);
+            f.expect = nowMs + delay;
+        }
+        RunTo(w, nowMs + rng() % 50);
+        // The next deadline is the first expected run
+        uint32_t first = UINT32_MAX;
+        for (auto& g : fuzz) {
+            if (g.active && g.expect - nowMs < first) first = g.expect - nowMs;
+        }
+        if (w.nextDelay(nowMs) != first) {
+            Check(false, "fuzz next deadline");
+            break;
+        }
+    }
+    for (auto& f : fuzz) runs += f.runs;
+    printf("random: 200000 operations, %d runs, %u ticks, clock wrapped\n", runs, w.tickCount);
+}
+
+// Main loop of the sensors: a poller per library on every pass, or the wheel
+static void MainLoop() {
+    // DHT11 1000 ms, moisture 500 ms, RFID 100 ms; one pass of the other pollers 20 us
+    const uint32_t seconds = 600;
+    const double passUs = 20;
+    uint64_t pollerChecks = (uint64_t)(seconds * 1e6 / passUs) * 3;
+
+    TimingWheel w;
+    nowMs = 0;
+    nowUs = 0;
+    w.begin(nowMs, VirtualMicros);
+    Recorder dht, moisture, rfid;
+    w.add(Record, &dht, 1000, TimingWheel::PHASE_AUTO, 0);
+    w.add(Record, &moisture, 500, TimingWheel::PHASE_AUTO, 0);
+    w.add(Record, &rfid, 100, TimingWheel::PHASE_AUTO, 0);
+    // Idle sleep up to 2 ms: the loop passes until the next deadline are skipped
+    uint64_t passes = 0, slept = 0;
+    double t = 0;
+    while (t < seconds * 1e6) {
+        t += passUs;
+        passes++;
+        uint32_t ms = (uint32_t)(t / 1000);
+        if (ms != nowMs) {
+            nowMs = ms;
+            if (w.advance(nowMs) > 0) continue;
+        }
+        uint32_t wait = w.nextDelay(nowMs);
+        if (wait > 2) wait = 2;
+        if (wait > 1) {
+            t += wait * 1000.0;
+            slept += wait;
+        }
+    }
+    printf("main loop %u s: pollers %llu time checks, wheel %u runs (%u ticks), %llu passes, %.1f %% asleep\n",
+        seconds, (unsigned long long)pollerChecks, w.runCount, w.tickCount, (unsigned long long)passes, slept / (seconds * 10.0));
+    Check(dht.times.size() == seconds && moisture.times.size() == seconds * 2 && rfid.times.size() == seconds * 10, "main loop runs");
+}
+
+int main() {
+    Periodic(0);
+    Periodic(0xFFFFF000);
+    Stagger();
+    OneShot();
+    Postpone();
+    Missed();
+    Budget();
+    Cancel();
+    Random();
+    MainLoop();
+    printf("scheduler: %s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+/**
+ * @file filter_harness.cpp
+ * @brief Linux test harness: rSensorFilter behaviour and event rate on simulated sensor noise.
+ *
+ * Build and run from bench/rSensorFilter:
+ *   g++ -O2 -std=c++17 -I../common filter_harness.cpp ../../libs/rSensorFilter/rSensorFilter.cpp -o /tmp/filter_harness
+ *   /tmp/filter_harness
+ *
+ * The rate check feeds one hour of samples at the poll rate of the libraries
+ * (moisture ADC every 500 ms, DHT11 every 1 s) and counts the events without a
+ * filter (every change, as before) against the settings of DevMoisture and DevDHT11.
+ */
+
+#include <cstdio>
+#include <random>
+#include "../../libs/rSensorFilter/rSensorFilter.h"
+
+using namespace B4R;
+
+uint32_t millis() { return 0; }
+
+static int failures = 0;
+
+static void Check(bool ok, const char* what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static void Behaviour() {
+    B4RSensorFilter f;
+
+    // Default: every change, no repeat
+    f.Initialize();
+    Check(f.UpdateAt(20, 0), "first sample reported");
+    Check(!f.UpdateAt(20, 1), "same value not reported");
+    Check(f.UpdateAt(20.1f, 2), "any change reported");
+
+    // Absolute deadband
+    f.Initialize();
+    f.SetDeadband(1, 0, 0);
+    f.UpdateAt(20, 0);
+    Check(!f.UpdateAt(20.9f, 1), "inside band");
+    Check(f.UpdateAt(21, 2) && f.getReported() == 21, "band reached");
+
+    // Relative deadband: 2 % of 2000 = 40
+    f.Initialize();
+    f.SetDeadband(0, 0.02, 0);
+    f.UpdateAt(2000, 0);
+    Check(!f.UpdateAt(2039, 1) && f.UpdateAt(1960, 2), "relative band");
+
+    // Hysteresis: back against the last direction needs more
+    f.Initialize();
+    f.SetDeadband(1, 0, 1);
+    f.UpdateAt(21, 0);
+    Check(f.UpdateAt(22, 1), "up reported");
+    Check(!f.UpdateAt(21, 2), "toggle back suppressed");
+    Check(f.UpdateAt(20, 3), "back beyond hysteresis");
+    Check(f.UpdateAt(19, 4), "same direction without hysteresis");
+
+    // Median drops a spike, EMA smooths
+    f.Initialize();
+    f.SetMedian(3);
+    f.SetDeadband(5, 0, 0);
+    f.UpdateAt(100, 0);
+    f.UpdateAt(100, 1);
+    Check(!f.UpdateAt(900, 2), "spike dropped");
+    Check(!f.UpdateAt(101, 3), "after spike");
+    f.Initialize();
+    f.setAlpha(0.5);
+    f.UpdateAt(0, 0);
+    f.UpdateAt(10, 1);
+    Check(fabs(f.getValue() - 5) < 1e-6, "ema");
+
+    // Min interval holds a change until it has passed, max interval gives a heartbeat
+    f.Initialize();
+    f.setMinInterval(1000);
+    f.setMaxInterval(60000);
+    f.UpdateAt(1, 0);
+    Check(!f.UpdateAt(2, 500), "rate limited");
+    Check(f.UpdateAt(2, 1000) && !f.getHeartbeat(), "held change reported");
+    Check(!f.UpdateAt(2, 30000), "no heartbeat yet");
+    Check(f.UpdateAt(2, 61000) && f.getHeartbeat() && f.getHeartbeatCount() == 1, "heartbeat");
+
+    // NaN once, then the next valid value
+    f.Initialize();
+    f.SetDeadband(1, 0, 0);
+    f.UpdateAt(20, 0);
+    Check(f.UpdateAt(NAN, 1) && isnan(f.getValue()), "nan reported");
+    Check(!f.UpdateAt(NAN, 2), "nan once");
+    Check(f.UpdateAt(20, 3), "valid after nan");
+    Check(f.getUpdateCount() == 4 && f.getEmittedCount() == 3 && f.getSuppressedCount() == 1, "counters");
+}
+
+// Moisture: slow drift plus ADC noise (sigma 15 counts) and rare spikes
+static void MoistureRate(int& raw, int& filtered) {
+    std::mt19937 rng(3);
+    std::normal_distribution<float> noise(0, 15);
+    B4RSensorFilter none, f;
+    none.Initialize();
+    f.Initialize();
+    // DevMoisture settings
+    f.SetMedian(5);
+    f.setAlpha(0.3);
+    f.SetDeadband(40, 0.02, 20);
+    f.setMinInterval(2000);
+    f.setMaxInterval(300000);
+    raw = filtered = 0;
+    for (uint32_t t = 0; t < 3600000; t += 500) {
+        float level = 1800 + 400 * (t > 1800000) + 0.02f * (t / 1000);
+        float sample = roundf(level + noise(rng) + ((rng() % 500) == 0 ? 600 : 0));
+        if (none.UpdateAt(sample, t)) raw++;
+        if (f.UpdateAt(sample, t)) filtered++;
+    }
+    Check(fabs(f.getReported() - 2272) < 60, "moisture follows the level");
+}
+
+// DHT11: integer steps, the reading toggles on the edge between two degrees
+static void DHTRate(int& raw, int& filtered) {
+    std::mt19937 rng(5);
+    std::normal_distribution<float> noise(0, 0.4f);
+    B4RSensorFilter none, f;
+    none.Initialize();
+    f.Initialize();
+    // DevDHT11 temperature settings
+    f.SetMedian(3);
+    f.SetDeadband(1, 0, 1);
+    f.setMinInterval(5000);
+    f.setMaxInterval(300000);
+    raw = filtered = 0;
+    for (uint32_t t = 0; t < 3600000; t += 1000) {
+        float temp = 21.5f + 2.0f * t / 3600000;
+        float sample = roundf(temp + noise(rng));
+        if (none.UpdateAt(sample, t)) raw++;
+        if (f.UpdateAt(sample, t)) filtered++;
+    }
+    Check(fabs(f.getReported() - 23.5) <= 1.5, "temperature follows");
+}
+
+int main() {
+    Behaviour();
+    int mr, mf, dr, df;
+    MoistureRate(mr, mf);
+    DHTRate(dr, df);
+    printf("rate, 1 h: moisture events %d unfiltered, %d filtered; DHT11 temperature events %d unfiltered, %d filtered\n", mr, mf, dr, df);
+    Check(mf * 10 <= mr && df * 5 <= dr, "filtered rate");
+    printf("filter harness: %s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
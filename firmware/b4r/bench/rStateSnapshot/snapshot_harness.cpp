@@ -0,0 +1,229 @@
+/**
+ * @file snapshot_harness.cpp
+ * @brief Linux test harness: rStateSnapshot rendering, change bitmap, Due timing and message rate.
+ *
+ * Build and run from bench/rStateSnapshot:
+ *   g++ -O2 -std=c++17 -I../common -I../../libs/rJsonIndex -I../../libs/rPayloadCodec snapshot_harness.cpp \
+ *       ../../libs/rStateSnapshot/rStateSnapshot.cpp ../../libs/rPayloadCodec/rPayloadCodec.cpp \
+ *       ../../libs/rJsonIndex/rJsonIndex.cpp -o /tmp/snapshot_harness
+ *   /tmp/snapshot_harness
+ *
+ * The clock is simulated. The fields are the ones MQTTClient adds (MQTTTopics.SNAPSHOT_...).
+ * The rate check replays one hour of device activity and counts the messages of the
+ * per-device status topics against the snapshots with and without a sensor holdoff.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "../../libs/rStateSnapshot/rStateSnapshot.h"
+
+using namespace B4R;
+
+static uint32_t nowMs = 0;
+uint32_t millis() { return nowMs; }
+
+static int failures = 0;
+
+static void Check(bool ok, const char* what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// The application: renders and counts the snapshot in Due
+static B4RStateSnapshot snap;
+static bool renderInDue = true;
+static int dueCount = 0;
+static uint32_t dueChanged = 0;
+static char last[160];
+
+static void Due(ULong changed) {
+    dueCount++;
+    dueChanged = changed;
+    if (!renderInDue) return;
+    uint8_t out[160];
+    uint16_t n = snap.RenderInto(out, sizeof(out), B4RPayloadCodec::FORMAT_JSON);
+    memcpy(last, out, n);
+    last[n] = 0;
+}
+
+static void Run(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+        nowMs++;
+        pollers.run();
+    }
+}
+
+static const char* KEYS[] = { "led", "rgb", "dr", "wn", "fan", "t", "h", "m", "gas", "pir" };
+static const uint8_t DECIMALS[] = { 0, 0, 0, 0, 0, 1, 1, 0, 0, 0 };
+enum { LED, RGB, DOOR, WINDOW, FAN, TEMP, HUM, MOIST, GAS, PIR, FIELDS };
+
+static void Setup() {
+    snap.Initialize(Due);
+    for (int i = 0; i < FIELDS; i++) {
+        B4RString k = { KEYS[i] };
+        Check(snap.Add(&k, DECIMALS[i]) == i, "add");
+    }
+}
+
+static void Rendering() {
+    Setup();
+    uint8_t out[160];
+    uint16_t n = snap.RenderInto(out, sizeof(out), B4RPayloadCodec::FORMAT_JSON);
+    const char* empty = "{\"seq\":1,\"chg\":0,\"led\":null,\"rgb\":null,\"dr\":null,\"wn\":null,\"fan\":null,"
+        "\"t\":null,\"h\":null,\"m\":null,\"gas\":null,\"pir\":null}";
+    Check(n == strlen(empty) && memcmp(out, empty, n) == 0, "unset fields are null");
+
+    snap.SetLong(LED, 1);
+    snap.SetLong(DOOR, 2);
+    snap.SetFloat(TEMP, 21.46);
+    snap.SetFloat(HUM, 0.5);
+    snap.SetLong(MOIST, 1874);
+    snap.SetLong(FAN, -3);
+    Check(snap.getChanged() == ((1u << LED) | (1u << DOOR) | (1u << TEMP) | (1u << HUM) | (1u << MOIST) | (1u << FAN)), "changed bitmap");
+    n = snap.RenderInto(out, sizeof(out), B4RPayloadCodec::FORMAT_JSON);
+    const char* full = "{\"seq\":2,\"chg\":245,\"led\":1,\"rgb\":null,\"dr\":2,\"wn\":null,\"fan\":-3,"
+        "\"t\":21.5,\"h\":0.5,\"m\":1874,\"gas\":null,\"pir\":null}";
+    Check(n == strlen(full) && memcmp(out, full, n) == 0, "values and decimals");
+    Check(snap.getChanged() == 0 && snap.getLastChanged() == 245 && snap.getSequence() == 2, "render clears changed");
+
+    // Not a change: same state, sensor noise below the decimals
+    snap.SetLong(LED, 1);
+    snap.SetFloat(TEMP, 21.49);
+    Check(snap.getChanged() == 0, "noise is not a change");
+    snap.SetFloat(TEMP, -0.04);
+    snap.SetFloat(HUM, NAN);
+    n = snap.RenderInto(out, sizeof(out), B4RPayloadCodec::FORMAT_JSON);
+    Check(strstr((const char*)out, "\"t\":0.0,\"h\":null") != nullptr, "rounding to zero and NaN");
+
+    // Binary formats decode to the same members
+    snap.SetFloat(HUM, 45.2);
+    for (uint8_t f = 1; f <= 2; f++) {
+        n = snap.RenderInto(out, sizeof(out), f);
+        B4RJsonIndex j;
+        Check(j.ParseAutoBytes((const char*)out, n) && j.getFormat() == f && j.getCount() == FIELDS + 2, "binary parse");
+        double d;
+        int32_t l;
+        Check(j.FindDouble("h", d) && fabs(d - 45.2) < 1e-5, "binary float");
+        Check(j.FindLong("m", l) && l == 1874, "binary integer");
+        Check(j.FindLong("seq", l) && (uint32_t)l == snap.getSequence(), "binary seq");
+        B4RString rgb = { "rgb" };
+        Check(j.TypeOf(&rgb) == B4RJsonIndex::TYPE_NULL, "binary null");
+    }
+
+    // Too small buffer
+    Check(snap.RenderInto(out, 20, 0) == 0 && snap.getOverflowCount() == 1, "overflow");
+}
+
+static void Timing() {
+    nowMs = 0;
+    Setup();
+    dueCount = 0;
+    renderInDue = true;
+
+    // First change after a quiet period: published at once
+    Run(5000);
+    snap.SetLong(LED, 1);
+    Run(1);
+    Check(dueCount == 1 && dueChanged == (1u << LED), "change published at once");
+
+    // Burst: 10 changes in 300 ms give one snapshot after Holdoff
+    for (int i = 0; i < 10; i++) {
+        snap.SetLong(DOOR, i);
+        Run(30);
+    }
+    Check(dueCount == 1, "burst held off");
+    Run(1000);
+    Check(dueCount == 2 && dueChanged == (1u << DOOR), "burst coalesced");
+
+    // Periodic snapshot without changes
+    Run(60000);
+    Check(dueCount == 3 && dueChanged == 0 && strstr(last, "\"chg\":0") != nullptr, "periodic snapshot");
+
+    // Request: at the next pass
+    snap.Request();
+    Run(1);
+    Check(dueCount == 4, "request");
+
+    // Not rendered: raised again once per Holdoff, changes are kept
+    renderInDue = false;
+    snap.SetLong(PIR, 1);
+    Run(1000);
+    Check(dueCount == 5, "skipped render raised once");
+    Run(1000);
+    Check(dueCount == 6 && snap.getChanged() == (1u << PIR), "retry after holdoff");
+    renderInDue = true;
+    Run(1000);
+    Check(snap.getChanged() == 0, "rendered");
+}
+
+// One hour: DHT11 every 2 s (t and h), moisture every 5 s, a door/window/LED action
+// every 60 s, PIR motion on/off every 30 s, a fan change every 10 min.
+static int Simulate(uint32_t sensorHoldoff, uint32_t& deviceMessages) {
+    nowMs = 0;
+    Setup();
+    snap.SetFieldHoldoff(TEMP, sensorHoldoff);
+    snap.SetFieldHoldoff(HUM, sensorHoldoff);
+    snap.SetFieldHoldoff(MOIST, sensorHoldoff);
+    dueCount = 0;
+    deviceMessages = 0;
+    for (uint32_t s = 1; s <= 3600; s++) {
+        if (s % 2 == 0) {
+            snap.SetFloat(TEMP, 21 + (s % 20) * 0.1);
+            snap.SetFloat(HUM, 45 + (s % 14) * 0.1);
+            deviceMessages++;
+        }
+        if (s % 5 == 0) {
+            snap.SetLong(MOIST, 1800 + s % 50);
+            deviceMessages++;
+        }
+        if (s % 60 == 0) {
+            snap.SetLong(DOOR, (s / 60) % 2);
+            snap.SetLong(WINDOW, (s / 60) % 2);
+            snap.SetLong(LED, (s / 60) % 2);
+            deviceMessages += 3;
+        }
+        if (s % 30 == 0) {
+            snap.SetLong(PIR, (s / 30) % 2);
+            deviceMessages++;
+        }
+        if (s % 600 == 0) {
+            snap.SetLong(FAN, (s / 600) % 2);
+            deviceMessages++;
+        }
+        Run(1000);
+    }
+    return dueCount;
+}
+
+static void Rate() {
+    uint32_t deviceMessages;
+    int all = Simulate(0, deviceMessages);
+    int sensors = Simulate(30000, deviceMessages);
+    printf("rate, 1 h: device status messages %u, snapshots %d (holdoff 1 s), %d (sensor holdoff 30 s)\n",
+        deviceMessages, all, sensors);
+    Check(sensors * 8 <= (int)deviceMessages, "sensor holdoff cuts the rate");
+
+    // A sensor change alone waits for its holdoff (from the last snapshot), an event goes out at once
+    nowMs = 0;
+    Setup();
+    snap.SetFieldHoldoff(TEMP, 30000);
+    dueCount = 0;
+    Run(5000);
+    snap.SetFloat(TEMP, 20);
+    Run(20000);
+    Check(dueCount == 0, "sensor held off");
+    snap.SetLong(DOOR, 1);
+    Run(1);
+    Check(dueCount == 1 && dueChanged == ((1u << TEMP) | (1u << DOOR)), "event takes the sensor along");
+}
+
+int main() {
+    Rendering();
+    Timing();
+    Rate();
+    printf("snapshot harness: %s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
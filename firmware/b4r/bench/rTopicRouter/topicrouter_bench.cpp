@@ -0,0 +1,95 @@
+/**
+ * @file topicrouter_bench.cpp
+ * @brief Linux microbenchmark: rTopicRouter trie vs. the linear MQTTTopics.GetTopicIndex scan.
+ *
+ * Build and run from bench/rTopicRouter:
+ *   g++ -O2 -std=c++17 -I../common -DRTOPICROUTER_MAX_NODES=254 -DRTOPICROUTER_TEXT_SIZE=4096 \
+ *       topicrouter_bench.cpp ../../libs/rTopicRouter/rTopicRouter.cpp -o /tmp/topicrouter_bench
+ *   /tmp/topicrouter_bench
+ *
+ * The linear lookup mirrors GetTopicIndex: strcmp of the topic against each TopicTable entry
+ * (B4R compares strings with strcmp, all entries share the "homekit32/homeN/" prefix).
+ * Measured for the 13 HomeKit32 topics and for a table grown to N homes x 13 topics.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../../libs/rTopicRouter/rTopicRouter.h"
+
+using namespace B4R;
+
+static const char* DEVICE_TOPICS[] = {
+    "command", "yellow_led/set", "rgb_led/set", "button_left/action", "button_right/action",
+    "servo_door/set", "servo_window/set", "buzzer/set", "fan/set", "dht11/get",
+    "gas/get", "moisture/get", "lcd/set"
+};
+static const int DEVICE_TOPIC_COUNT = sizeof(DEVICE_TOPICS) / sizeof(DEVICE_TOPICS[0]);
+
+static uint8_t LinearIndex(const std::vector<const char*>& table, const char* topic) {
+    for (size_t i = 0; i < table.size(); i++) {
+        if (strcmp(topic, table[i]) == 0) return (uint8_t)i;
+    }
+    return 255;
+}
+
+static volatile uint32_t sink;
+
+static void Run(int homes, int iterations) {
+    std::vector<std::string> table;
+    for (int h = 1; h <= homes; h++) {
+        for (int d = 0; d < DEVICE_TOPIC_COUNT; d++) {
+            table.push_back("homekit32/home" + std::to_string(h) + "/" + DEVICE_TOPICS[d]);
+        }
+    }
+
+    static B4RTopicRouter router;
+    router.Initialize(nullptr);
+    for (size_t i = 0; i < table.size(); i++) {
+        router.AddFilter(table[i].c_str(), (uint16_t)table[i].size(), (uint8_t)(i % 255));
+    }
+
+    std::vector<const char*> linear;
+    for (const std::string& t : table) linear.push_back(t.c_str());
+
+    // Every topic once per round, plus one unknown topic
+    std::vector<std::string> topics = table;
+    topics.push_back("homekit32/home1/unknown/set");
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int n = 0; n < iterations; n++) {
+        for (const std::string& t : topics) sink += LinearIndex(linear, t.c_str());
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int n = 0; n < iterations; n++) {
+        for (const std::string& t : topics) sink += router.MatchTopic(t.c_str(), (uint16_t)t.size());
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double lookups = (double)iterations * topics.size();
+    double linearNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / lookups;
+    double trieNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / lookups;
+    printf("topics=%4zu  linear=%7.1f ns/lookup  trie=%6.1f ns/lookup  speedup=%5.1fx  nodes=%u text=%u\n",
+        table.size(), linearNs, trieNs, linearNs / trieNs, router.getNodeCount(), router.getTextUsed());
+}
+
+int main() {
+    // Correctness checks of the wildcard precedence
+    static B4RTopicRouter r;
+    r.Initialize(nullptr);
+    r.AddFilter("homekit32/home1/fan/set", 23, 8);
+    r.AddFilter("homekit32/+/fan/set", 19, 20);
+    r.AddFilter("homekit32/home1/#", 17, 30);
+    bool ok = r.MatchTopic("homekit32/home1/fan/set", 23) == 8
+        && r.MatchTopic("homekit32/home2/fan/set", 23) == 20 && r.getWildcardCount() == 1
+        && r.MatchTopic("homekit32/home1/lcd/get", 23) == 30
+        && r.MatchTopic("homekit32/home2/lcd/get", 23) == B4RTopicRouter::NOT_FOUND;
+    printf("wildcard checks: %s\n", ok ? "ok" : "FAILED");
+
+    Run(1, 200000);
+    Run(4, 50000);
+    Run(8, 25000);
+    return ok ? 0 : 1;
+}
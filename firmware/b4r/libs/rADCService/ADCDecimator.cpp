@@ -0,0 +1,70 @@
+/**
+ * @file ADCDecimator.cpp
+ * @brief ADC sample math of rADCService.
+ */
+
+#include "ADCDecimator.h"
+
+void ADCDecimator::setup(uint16_t factor) {
+    if (factor < 1) factor = 1;
+    if (factor > FACTOR_MAX) factor = FACTOR_MAX;
+    shift = 0;
+    while ((2u << shift) <= factor) shift++;
+    this->factor = 1u << shift;
+    sum = 0;
+    n = 0;
+}
+
+void ADCCalibration::build(uint32_t (*toMillivolts)(uint32_t raw, void* arg), void* arg) {
+    for (uint8_t i = 0; i < POINTS - 1; i++) {
+        lut[i] = (uint16_t)toMillivolts((uint32_t)i << STEP_SHIFT, arg);
+    }
+    // Code 4096 does not exist: extend the segment 4032-4095 to 64 codes
+    uint32_t last = toMillivolts(4095, arg);
+    uint32_t before = lut[POINTS - 2];
+    lut[POINTS - 1] = (uint16_t)(before + ((last > before ? last - before : 0) * 64 + 31) / 63);
+}
+
+void ADCCalibration::linear(uint32_t fullScale) {
+    for (uint8_t i = 0; i < POINTS; i++) {
+        lut[i] = (uint16_t)(((uint32_t)i * 64 * fullScale + 2047) / 4095);
+    }
+}
+
+uint16_t ADCCalibration::millivolts(uint16_t raw) const {
+    if (raw > 4095) raw = 4095;
+    uint8_t i = raw >> STEP_SHIFT;
+    int32_t f = raw & ((1 << STEP_SHIFT) - 1);
+    int32_t d = (int32_t)lut[i + 1] - lut[i];
+    return (uint16_t)(lut[i] + ((d * f + (1 << (STEP_SHIFT - 1))) >> STEP_SHIFT));
+}
+
+uint32_t ADCCalibration::microvolts(uint16_t q4) const {
+    // 10 fraction bits: 6 of the code, 4 of the oversampling
+    uint8_t i = q4 >> (STEP_SHIFT + 4);
+    if (i >= POINTS - 1) return (uint32_t)lut[POINTS - 1] * 1000;
+    int32_t f = q4 & ((1 << (STEP_SHIFT + 4)) - 1);
+    int32_t d = ((int32_t)lut[i + 1] - lut[i]) * 1000;
+    return (uint32_t)((int32_t)lut[i] * 1000 + ((d * f + (1 << (STEP_SHIFT + 3))) >> (STEP_SHIFT + 4)));
+}
+
+uint8_t ADC1ChannelOfPin(uint8_t pin) {
+    // ESP32: GPIO 36, 37, 38, 39, 32, 33, 34, 35 are ADC1 channel 0-7
+    static const uint8_t PINS[] = { 36, 37, 38, 39, 32, 33, 34, 35 };
+    for (uint8_t c = 0; c < sizeof(PINS); c++) {
+        if (PINS[c] == pin) return c;
+    }
+    return 255;
+}
+
+uint32_t ADCFeedType1(const uint8_t* frame, uint32_t length, ADCDecimator* const* byChannel) {
+    uint32_t fed = 0;
+    for (uint32_t i = 0; i + 1 < length; i += 2) {
+        uint16_t word = frame[i] | (frame[i + 1] << 8);
+        ADCDecimator* d = byChannel[word >> 12];
+        if (d == nullptr) continue;
+        d->add(word & 0x0FFF);
+        fed++;
+    }
+    return fed;
+}
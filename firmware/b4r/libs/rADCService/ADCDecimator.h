@@ -0,0 +1,95 @@
+/**
+ * @file ADCDecimator.h
+ * @brief ADC sample math of rADCService: decimation with oversampling, DMA frame parsing and the
+ * fixed-point calibration table. Plain C++, no ESP-IDF, tested on Linux (bench/rADCService).
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include <stdint.h>
+
+/**
+ * Averages blocks of Factor samples (power of two, 1 to 1024) into one value.
+ * Noise on the input dithers the samples, so the mean carries extra bits:
+ * 4 samples give 1 bit, 256 samples 4 bits. The value is kept in Q12.4
+ * (12-bit ADC code times 16), the rounded 12-bit code is in raw.
+ */
+class ADCDecimator {
+public:
+    static const uint16_t FACTOR_MAX = 1024;
+
+    /** Set the decimation factor, rounded down to a power of two. Clears the block. */
+    void setup(uint16_t factor);
+
+    /**
+     * Add a 12-bit sample.
+     * @return True when a block is complete and raw / oversampled are updated.
+     */
+    bool add(uint16_t sample) {
+        sum += sample;
+        if (++n < factor) return false;
+        raw = (uint16_t)((sum + (factor >> 1)) >> shift);
+        oversampled = (uint16_t)(((sum << 4) + (factor >> 1)) >> shift);
+        sum = 0;
+        n = 0;
+        count++;
+        return true;
+    }
+
+    uint16_t getFactor() const { return factor; }
+
+    /** Mean of the last block, 12-bit code rounded. */
+    uint16_t raw = 0;
+    /** Mean of the last block in Q12.4 (code * 16), 0-65520. */
+    uint16_t oversampled = 0;
+    /** Number of blocks. */
+    uint32_t count = 0;
+
+private:
+    uint32_t sum = 0;
+    uint16_t n = 0;
+    uint16_t factor = 1;
+    uint8_t shift = 0;
+};
+
+/**
+ * Raw code to voltage through a table of 65 points (every 64 codes) with
+ * linear interpolation in fixed point. Filled once from the chip calibration
+ * (eFuse), so a conversion is a table lookup, a multiply and a shift.
+ */
+class ADCCalibration {
+public:
+    static const uint8_t POINTS = 65;
+    static const uint8_t STEP_SHIFT = 6;
+
+    /**
+     * Fill the table from a raw (0-4095) to millivolts function, e.g. the chip calibration.
+     * The last point (code 4096) is extrapolated from the last segment.
+     */
+    void build(uint32_t (*toMillivolts)(uint32_t raw, void* arg), void* arg);
+
+    /** Fill the table with a straight line: code 0 = 0 mV, code 4095 = fullScale mV. */
+    void linear(uint32_t fullScale);
+
+    /** Millivolts of a 12-bit code. */
+    uint16_t millivolts(uint16_t raw) const;
+
+    /** Microvolts of a Q12.4 value (ADCDecimator::oversampled). */
+    uint32_t microvolts(uint16_t q4) const;
+
+    uint16_t lut[POINTS];
+};
+
+/** ADC1 channel of an ESP32 GPIO, 255 if the pin has no ADC1 channel. */
+uint8_t ADC1ChannelOfPin(uint8_t pin);
+
+/**
+ * Feed the samples of a DMA conversion frame of the ESP32 (output format TYPE1:
+ * 16-bit little endian, bits 0-11 data, bits 12-15 channel) to the decimators.
+ * @param byChannel Decimator per channel 0-15, nullptr for channels not sampled
+ * @return Number of samples fed
+ */
+uint32_t ADCFeedType1(const uint8_t* frame, uint32_t length, ADCDecimator* const* byChannel);
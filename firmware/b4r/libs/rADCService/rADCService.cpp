@@ -0,0 +1,225 @@
+/**
+ * @file rADCService.cpp
+ * @brief Continuous ADC sampling service for B4R (ESP32).
+ */
+
+#include "B4RDefines.h"
+#include "rADCService.h"
+
+#ifdef RADCSERVICE_CONTINUOUS
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+#define RADCSERVICE_ATTEN ADC_ATTEN_DB_12
+#else
+#define RADCSERVICE_ATTEN ADC_ATTEN_DB_11
+#endif
+#endif
+
+namespace B4R {
+
+    B4RADCService* B4RADCService::shared = nullptr;
+
+    // Nominal full scale without calibration, as the former analogRead conversion
+    static const uint32_t NOMINAL_FULL_SCALE_MV = 3300;
+
+    void B4RADCService::Initialize(ULong SampleRate, UInt Oversample) {
+        shared = this;
+        sampleRate = SampleRate;
+        oversample = Oversample;
+        channelCount = 0;
+        for (uint8_t c = 0; c < 16; c++) byChannel[c] = nullptr;
+        calibration.linear(NOMINAL_FULL_SCALE_MV);
+        calibrated = false;
+        running = false;
+        ResetCounters();
+
+        FunctionUnion fu;
+        fu.PollerFunction = looper;
+        pollers.add(fu, this);
+    }
+
+    Byte B4RADCService::AddChannel(Byte Pin) {
+        Byte index = ChannelOf(Pin);
+        if (index != INVALID_CHANNEL) return index;
+        // The pattern is fixed while running
+        if (running || channelCount >= RADCSERVICE_CHANNELS_MAX) return INVALID_CHANNEL;
+        uint8_t channel = ADC1ChannelOfPin(Pin);
+        if (channel == 255) return INVALID_CHANNEL;
+        pins[channelCount] = Pin;
+        adcChannels[channelCount] = channel;
+        decimators[channelCount] = ADCDecimator();
+        decimators[channelCount].setup(oversample);
+        byChannel[channel] = &decimators[channelCount];
+        return channelCount++;
+    }
+
+#ifdef RADCSERVICE_CONTINUOUS
+
+    bool IRAM_ATTR B4RADCService::OnOverrun(adc_continuous_handle_t handle, const adc_continuous_evt_data_t* data, void* arg) {
+        ((B4RADCService*)arg)->overrunCount++;
+        return false;
+    }
+
+    static uint32_t CalibratedMillivolts(uint32_t raw, void* arg) {
+        int mv = 0;
+        adc_cali_raw_to_voltage((adc_cali_handle_t)arg, (int)raw, &mv);
+        return mv < 0 ? 0 : (uint32_t)mv;
+    }
+
+    void B4RADCService::Calibrate() {
+        adc_cali_handle_t cali = nullptr;
+#if ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+        adc_cali_line_fitting_config_t config = {};
+        config.unit_id = ADC_UNIT_1;
+        config.atten = RADCSERVICE_ATTEN;
+        config.bitwidth = ADC_BITWIDTH_12;
+        if (adc_cali_create_scheme_line_fitting(&config, &cali) != ESP_OK) cali = nullptr;
+#endif
+        if (cali == nullptr) return;
+        // The conversion of the driver once per table point, not per sample
+        calibration.build(CalibratedMillivolts, cali);
+        calibrated = true;
+#if ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+        adc_cali_delete_scheme_line_fitting(cali);
+#endif
+    }
+
+    bool B4RADCService::Start() {
+        if (running) return true;
+        if (channelCount == 0) return false;
+        if (handle == nullptr) {
+            adc_continuous_handle_cfg_t handleConfig = {};
+            handleConfig.max_store_buf_size = RADCSERVICE_POOL_SIZE;
+            handleConfig.conv_frame_size = RADCSERVICE_FRAME_SIZE;
+            if (adc_continuous_new_handle(&handleConfig, &handle) != ESP_OK) {
+                handle = nullptr;
+                return false;
+            }
+
+            adc_digi_pattern_config_t pattern[RADCSERVICE_CHANNELS_MAX] = {};
+            for (uint8_t i = 0; i < channelCount; i++) {
+                pattern[i].atten = RADCSERVICE_ATTEN;
+                pattern[i].channel = adcChannels[i];
+                pattern[i].unit = ADC_UNIT_1;
+                pattern[i].bit_width = ADC_BITWIDTH_12;
+            }
+            adc_continuous_config_t config = {};
+            config.pattern_num = channelCount;
+            config.adc_pattern = pattern;
+            config.sample_freq_hz = sampleRate;
+            config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+            config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+            adc_continuous_evt_cbs_t callbacks = {};
+            callbacks.on_pool_ovf = OnOverrun;
+            if (adc_continuous_config(handle, &config) != ESP_OK
+                || adc_continuous_register_event_callbacks(handle, &callbacks, this) != ESP_OK) {
+                adc_continuous_deinit(handle);
+                handle = nullptr;
+                return false;
+            }
+            Calibrate();
+        }
+        running = adc_continuous_start(handle) == ESP_OK;
+        return running;
+    }
+
+    void B4RADCService::Stop() {
+        if (!running) return;
+        adc_continuous_stop(handle);
+        running = false;
+    }
+
+    void B4RADCService::looper(void* b) {
+        B4RADCService* me = (B4RADCService*)b;
+        if (!me->running) return;
+        // Completed frames only, never waits
+        uint32_t length = 0;
+        for (uint8_t i = 0; i < RADCSERVICE_DRAIN_MAX; i++) {
+            if (adc_continuous_read(me->handle, me->frame, RADCSERVICE_FRAME_SIZE, &length, 0) != ESP_OK) break;
+            me->frameCount++;
+            me->sampleCount += ADCFeedType1(me->frame, length, me->byChannel);
+        }
+    }
+
+#else
+
+    // No continuous driver: the sensor libraries use analogRead
+    void B4RADCService::Calibrate() {
+    }
+
+    bool B4RADCService::Start() {
+        return false;
+    }
+
+    void B4RADCService::Stop() {
+    }
+
+    void B4RADCService::looper(void* b) {
+    }
+
+#endif
+
+    bool B4RADCService::getRunning() {
+        return running;
+    }
+
+    bool B4RADCService::getCalibrated() {
+        return calibrated;
+    }
+
+    Byte B4RADCService::getChannelCount() {
+        return channelCount;
+    }
+
+    Byte B4RADCService::ChannelOf(Byte Pin) {
+        for (uint8_t i = 0; i < channelCount; i++) {
+            if (pins[i] == Pin) return i;
+        }
+        return INVALID_CHANNEL;
+    }
+
+    bool B4RADCService::Ready(Byte Index) {
+        return Index < channelCount && decimators[Index].count > 0;
+    }
+
+    UInt B4RADCService::Raw(Byte Index) {
+        if (Index >= channelCount) return 0;
+        return decimators[Index].raw;
+    }
+
+    UInt B4RADCService::Oversampled(Byte Index) {
+        if (Index >= channelCount) return 0;
+        return decimators[Index].oversampled;
+    }
+
+    UInt B4RADCService::Millivolts(Byte Index) {
+        if (Index >= channelCount) return 0;
+        return (UInt)((calibration.microvolts(decimators[Index].oversampled) + 500) / 1000);
+    }
+
+    Double B4RADCService::Voltage(Byte Index) {
+        if (Index >= channelCount) return 0;
+        return calibration.microvolts(decimators[Index].oversampled) / 1000000.0;
+    }
+
+    ULong B4RADCService::getFrameCount() {
+        return frameCount;
+    }
+
+    ULong B4RADCService::getSampleCount() {
+        return sampleCount;
+    }
+
+    ULong B4RADCService::getOverrunCount() {
+        return overrunCount;
+    }
+
+    void B4RADCService::ResetCounters() {
+        frameCount = 0;
+        sampleCount = 0;
+        overrunCount = 0;
+    }
+
+} // namespace B4R
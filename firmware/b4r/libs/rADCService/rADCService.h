@@ -0,0 +1,175 @@
+/**
+ * @file rADCService.h
+ * @brief Continuous ADC sampling service for B4R (ESP32).
+ *
+ * Runs the ADC1 in continuous mode (adc_continuous, DMA) at a fixed sample rate
+ * over up to CHANNELS_MAX pins. The driver fills its DMA pool (the ring) without
+ * the CPU; a poller drains the completed frames, averages blocks of Oversample
+ * samples per channel and keeps the latest value. Reading a value is O(1) and
+ * never touches the ADC, so sensor loops, MQTT and BLE do not wait for
+ * conversions and all channels are sampled on the same clock.
+ *
+ * Values:
+ * - Raw: mean of the last block, 12-bit code.
+ * - Oversampled: mean in Q12.4 (code * 16), noise dithers the samples so
+ *   4 samples add 1 bit, 256 samples 4 bits.
+ * - Millivolts / Voltage: calibrated with the eFuse calibration of the chip,
+ *   converted through a 65-point fixed-point table built at Start.
+ *
+ * Sensor libraries (rMoistureSensor) read their pin from the service when it
+ * samples the pin, else they use analogRead.
+ *
+ * Limits: ESP32 ADC1 pins (GPIO 32-39) only, ADC2 is used by WiFi.
+ * Sample rate 20000-2000000 Hz over all channels. Other chips: Start returns False.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+#include "ADCDecimator.h"
+
+/** Maximum number of channels. */
+#ifndef RADCSERVICE_CHANNELS_MAX
+#define RADCSERVICE_CHANNELS_MAX 8
+#endif
+
+/** Conversion frame size in bytes, 2 bytes per sample. */
+#ifndef RADCSERVICE_FRAME_SIZE
+#define RADCSERVICE_FRAME_SIZE 256
+#endif
+
+/** DMA pool (ring) size in bytes. */
+#ifndef RADCSERVICE_POOL_SIZE
+#define RADCSERVICE_POOL_SIZE 2048
+#endif
+
+/** Frames drained per poller call. */
+#ifndef RADCSERVICE_DRAIN_MAX
+#define RADCSERVICE_DRAIN_MAX 4
+#endif
+
+#if defined(ESP32) && __has_include("esp_adc/adc_continuous.h")
+#include "esp_adc/adc_continuous.h"
+#if CONFIG_IDF_TARGET_ESP32
+#define RADCSERVICE_CONTINUOUS 1
+#endif
+#endif
+
+//~Library: rADCService
+//~Author: Robert W.B. Linn
+//~Brief: Continuous ADC sampling with oversampling and calibrated voltages (ESP32 ADC1).
+//~Version: 1.00
+
+namespace B4R {
+
+    //~shortname: ADCService
+    class B4RADCService {
+    private:
+        static B4RADCService* shared;
+
+        uint32_t sampleRate = 20000;
+        uint16_t oversample = 64;
+        uint8_t channelCount = 0;
+        uint8_t pins[RADCSERVICE_CHANNELS_MAX];
+        uint8_t adcChannels[RADCSERVICE_CHANNELS_MAX];
+        ADCDecimator decimators[RADCSERVICE_CHANNELS_MAX];
+        // Decimator per ADC1 channel, for the frame parser
+        ADCDecimator* byChannel[16];
+        ADCCalibration calibration;
+        bool calibrated = false;
+        bool running = false;
+
+        // Counters
+        uint32_t frameCount = 0;
+        uint32_t sampleCount = 0;
+        volatile uint32_t overrunCount = 0;
+
+#ifdef RADCSERVICE_CONTINUOUS
+        adc_continuous_handle_t handle = nullptr;
+        uint8_t frame[RADCSERVICE_FRAME_SIZE];
+        static bool OnOverrun(adc_continuous_handle_t handle, const adc_continuous_evt_data_t* data, void* arg);
+#endif
+
+        void Calibrate();
+        static void looper(void* b);
+
+    public:
+        /**
+         * Initialize the service. Add the channels, then Start.
+         * @param SampleRate Samples per second over all channels, 20000 to 2000000
+         * @param Oversample Samples averaged per value, power of two 1 to 1024
+         */
+        void Initialize(ULong SampleRate, UInt Oversample);
+
+        /**
+         * Add a pin.
+         * @param Pin ADC1 pin (GPIO 32-39)
+         * @return Channel index, INVALID_CHANNEL if the pin has no ADC1 channel or the service is full
+         */
+        Byte AddChannel(Byte Pin);
+
+        /**
+         * Start sampling.
+         * @return True if running
+         */
+        bool Start();
+
+        /** Stop sampling, the last values are kept. */
+        void Stop();
+
+        /** True if sampling. */
+        bool getRunning();
+
+        /** True if the voltages use the eFuse calibration of the chip, False if nominal (0-3.3 V). */
+        bool getCalibrated();
+
+        /** Number of channels. */
+        Byte getChannelCount();
+
+        /**
+         * Channel index of a pin.
+         * @return Index, INVALID_CHANNEL if the pin is not sampled
+         */
+        Byte ChannelOf(Byte Pin);
+
+        /** True once the channel has a value. */
+        bool Ready(Byte Index);
+
+        /** Mean of the last block, 0-4095. */
+        UInt Raw(Byte Index);
+
+        /** Mean of the last block in 1/16 code (code * 16), 0-65520. */
+        UInt Oversampled(Byte Index);
+
+        /** Calibrated millivolts of the last block. */
+        UInt Millivolts(Byte Index);
+
+        /** Calibrated voltage of the last block. */
+        Double Voltage(Byte Index);
+
+        /** Number of DMA frames read. */
+        ULong getFrameCount();
+
+        /** Number of samples read. */
+        ULong getSampleCount();
+
+        /** Number of DMA pool overruns: frames lost because the poller was late. */
+        ULong getOverrunCount();
+
+        /** Reset the counters */
+        void ResetCounters();
+
+        /** Channel index for an unknown pin. */
+        static const Byte INVALID_CHANNEL = 255;
+        /** Limits */
+        static const Byte CHANNELS_MAX = RADCSERVICE_CHANNELS_MAX;
+
+        //~hide
+        // Last initialized service, used by the sensor libraries
+        static B4RADCService* Shared() { return shared; }
+    };
+
+} // namespace B4R
@@ -0,0 +1,262 @@
+/**
+ * @file BLESegmenter.h
+ * @brief Segmentation and reassembly of BLE payloads larger than the MTU.
+ *
+ * A message that does not fit into one notification or write is split into
+ * segment frames using the reserved DeviceID 0x00 as transport marker:
+ *
+ *   [0x00][0x02][Flags][MsgId][Seq][Chunk...]
+ *
+ * - Flags: SEG_FLAG_START on the first, SEG_FLAG_END on the last segment
+ *          (both for a message that fits into a single segment).
+ * - MsgId: Rolling message id, identical for all segments of a message.
+ * - Seq:   Segment index 0..254 within the message.
+ *
+ * The receiver discards a partial message if a segment is missing, belongs to
+ * another message or the reassembly timeout expires.
+ *
+ * This header has no Arduino or ESP-IDF dependencies so the segmenter,
+ * reassembler and the loopback transport can also be built on a host.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+/** Reassembly buffer size in bytes (largest inbound message). */
+#ifndef RBLESERVER_REASSEMBLY_SIZE
+#define RBLESERVER_REASSEMBLY_SIZE 1024
+#endif
+
+namespace B4R {
+
+    /** Segment frame layout */
+    static const uint8_t SEG_TRANSPORT_MARKER = 0x00;
+    static const uint8_t SEG_TRANSPORT_TYPE = 0x02;
+    static const uint8_t SEG_FLAG_START = 0x80;
+    static const uint8_t SEG_FLAG_END = 0x40;
+    static const uint8_t SEG_HEADER_SIZE = 5;
+    static const uint8_t SEG_MAX_SEGMENTS = 255;
+
+    /**
+     * @brief Splits messages into segment frames.
+     */
+    class BLESegmenter {
+    public:
+        /** Called once per segment frame; return false to abort. */
+        typedef bool (*SendFunction)(void* context, const uint8_t* data, uint16_t length);
+
+        /**
+         * @brief Check whether a frame is a segment frame.
+         */
+        static bool IsSegment(const uint8_t* data, uint16_t length) {
+            return length >= SEG_HEADER_SIZE
+                && data[0] == SEG_TRANSPORT_MARKER
+                && data[1] == SEG_TRANSPORT_TYPE;
+        }
+
+        /**
+         * @brief Number of segments needed for a message.
+         * @param length Message length.
+         * @param capacity Max frame size (notification or write payload).
+         * @return Segment count, 0 if the capacity is too small or the message too large.
+         */
+        static uint16_t SegmentCount(uint16_t length, uint16_t capacity) {
+            if (capacity <= SEG_HEADER_SIZE) return 0;
+            uint16_t chunk = capacity - SEG_HEADER_SIZE;
+            uint32_t count = length == 0 ? 1 : ((uint32_t)length + chunk - 1) / chunk;
+            return count > SEG_MAX_SEGMENTS ? 0 : (uint16_t)count;
+        }
+
+        /**
+         * @brief Split a message into segment frames of at most capacity bytes.
+         * @param data Message.
+         * @param length Message length.
+         * @param capacity Max frame size.
+         * @param send Callback receiving each segment frame.
+         * @param context Passed to the callback.
+         * @return Number of segments sent, 0 on error.
+         */
+        uint16_t Segment(const uint8_t* data, uint16_t length, uint16_t capacity, SendFunction send, void* context) {
+            uint16_t count = SegmentCount(length, capacity);
+            if (count == 0) return 0;
+
+            uint16_t chunk = capacity - SEG_HEADER_SIZE;
+            uint8_t msgId = nextMsgId++;
+            uint16_t offset = 0;
+
+            for (uint16_t seq = 0; seq < count; seq++) {
+                uint16_t size = length - offset;
+                if (size > chunk) size = chunk;
+
+                uint8_t flags = 0;
+                if (seq == 0) flags |= SEG_FLAG_START;
+                if (seq == count - 1) flags |= SEG_FLAG_END;
+
+                frame[0] = SEG_TRANSPORT_MARKER;
+                frame[1] = SEG_TRANSPORT_TYPE;
+                frame[2] = flags;
+                frame[3] = msgId;
+                frame[4] = (uint8_t)seq;
+                memcpy(&frame[SEG_HEADER_SIZE], data + offset, size);
+
+                if (!send(context, frame, SEG_HEADER_SIZE + size)) return 0;
+                offset += size;
+            }
+            return count;
+        }
+
+    private:
+        uint8_t nextMsgId = 0;
+        uint8_t frame[512];
+    };
+
+    /**
+     * @brief Reassembles segment frames into messages.
+     */
+    class BLEReassembler {
+    public:
+        /** Result of feeding a segment frame */
+        static const uint8_t RESULT_PENDING = 0;
+        static const uint8_t RESULT_COMPLETE = 1;
+        static const uint8_t RESULT_ERROR = 2;
+
+        /** Reassembly timeout in ms between first and last segment */
+        uint32_t timeoutMs = 500;
+
+        /** Statistics */
+        uint32_t completedCount = 0;
+        uint32_t timeoutCount = 0;
+        uint32_t errorCount = 0;
+
+        /**
+         * @brief Feed one segment frame.
+         * @param data Segment frame [0x00][0x02][Flags][MsgId][Seq][Chunk...].
+         * @param length Frame length.
+         * @param nowMs Current time in ms.
+         * @return RESULT_COMPLETE when Message()/MessageLength() hold a complete message.
+         */
+        uint8_t Feed(const uint8_t* data, uint16_t length, uint32_t nowMs) {
+            if (!BLESegmenter::IsSegment(data, length)) return Fail();
+
+            uint8_t flags = data[2];
+            uint8_t msgId = data[3];
+            uint8_t seq = data[4];
+            const uint8_t* chunk = data + SEG_HEADER_SIZE;
+            uint16_t size = length - SEG_HEADER_SIZE;
+
+            if (flags & SEG_FLAG_START) {
+                // A new start always replaces a partial message
+                if (active) errorCount++;
+                if (seq != 0) return Fail();
+                active = true;
+                currentMsgId = msgId;
+                nextSeq = 0;
+                received = 0;
+                startedMs = nowMs;
+            } else if (!active || msgId != currentMsgId || seq != nextSeq) {
+                return Fail();
+            }
+
+            if (received + size > sizeof(buffer)) return Fail();
+            memcpy(&buffer[received], chunk, size);
+            received += size;
+            nextSeq++;
+
+            if (flags & SEG_FLAG_END) {
+                active = false;
+                messageLength = received;
+                completedCount++;
+                return RESULT_COMPLETE;
+            }
+            return RESULT_PENDING;
+        }
+
+        /**
+         * @brief Discard a partial message if the timeout expired.
+         * @return True if a partial message was discarded.
+         */
+        bool CheckTimeout(uint32_t nowMs) {
+            if (active && nowMs - startedMs >= timeoutMs) {
+                active = false;
+                timeoutCount++;
+                return true;
+            }
+            return false;
+        }
+
+        /** True while a message is partially received */
+        bool IsActive() const { return active; }
+
+        /** Drop a partial message without counting it (new connection). */
+        void Reset() { active = false; }
+
+        /** Last completed message */
+        uint8_t* Message() { return buffer; }
+        uint16_t MessageLength() const { return messageLength; }
+
+    private:
+        uint8_t buffer[RBLESERVER_REASSEMBLY_SIZE];
+        uint16_t received = 0;
+        uint16_t messageLength = 0;
+        uint8_t currentMsgId = 0;
+        uint8_t nextSeq = 0;
+        bool active = false;
+        uint32_t startedMs = 0;
+
+        uint8_t Fail() {
+            active = false;
+            errorCount++;
+            return RESULT_ERROR;
+        }
+    };
+
+    /**
+     * @brief Host-side loopback transport.
+     *
+     * Segments a message with a given MTU and feeds every segment frame straight
+     * into a reassembler, counting frames and bytes on the "air". Used to check
+     * and benchmark segmentation without a radio.
+     */
+    class BLELoopbackTransport {
+    public:
+        BLESegmenter segmenter;
+        BLEReassembler reassembler;
+
+        /** ATT MTU of the simulated link (payload capacity is MTU - 3) */
+        uint16_t mtu = 23;
+
+        /** Traffic counters */
+        uint32_t framesSent = 0;
+        uint32_t bytesSent = 0;
+
+        /** Current time passed to the reassembler */
+        uint32_t nowMs = 0;
+
+        /**
+         * @brief Send a message through the loopback link.
+         * @return True if the reassembler produced the complete message.
+         */
+        bool Send(const uint8_t* data, uint16_t length) {
+            completed = false;
+            return segmenter.Segment(data, length, mtu - 3, Deliver, this) > 0 && completed;
+        }
+
+    private:
+        bool completed = false;
+
+        static bool Deliver(void* context, const uint8_t* data, uint16_t length) {
+            BLELoopbackTransport* me = (BLELoopbackTransport*)context;
+            me->framesSent++;
+            me->bytesSent += length;
+            uint8_t result = me->reassembler.Feed(data, length, me->nowMs);
+            if (result == BLEReassembler::RESULT_COMPLETE) me->completed = true;
+            return result != BLEReassembler::RESULT_ERROR;
+        }
+    };
+
+} // namespace B4R
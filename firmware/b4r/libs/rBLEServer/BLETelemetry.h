@@ -0,0 +1,180 @@
+/**
+ * @file BLETelemetry.h
+ * @brief Connectionless sensor telemetry record for BLE advertisements.
+ *
+ * The latest sensor states are packed into a BTHome v2 service data record
+ * (16-bit UUID 0xFCD2), so passive listeners can collect them without
+ * connecting:
+ *
+ *   [Len][0x16][0xD2][0xFC][0x40][0x00][PacketId][Objects...]
+ *
+ * - 0x40:     BTHome device info, version 2, not encrypted, regular interval.
+ * - 0x00:     Packet id object, rolling counter incremented per new record.
+ * - Objects:  [ObjectId][Value LE], ordered by object id, only values set:
+ *             0x02 Temperature  sint16  0.01 C
+ *             0x03 Humidity     uint16  0.01 %
+ *             0x14 Moisture     uint16  0.01 %
+ *             0x1C Gas          uint8   0 = clear, 1 = detected
+ *             0x21 Motion       uint8   0 = clear, 1 = detected
+ *
+ * This header has no Arduino or ESP-IDF dependencies so the encoder and
+ * decoder can also be built on a host.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+namespace B4R {
+
+    /** BTHome v2 record layout */
+    static const uint8_t BTHOME_AD_TYPE_SERVICE_DATA = 0x16;
+    static const uint16_t BTHOME_UUID = 0xFCD2;
+    static const uint8_t BTHOME_DEVICE_INFO = 0x40;
+    static const uint8_t BTHOME_VERSION_MASK = 0xE0;
+
+    /** BTHome object ids */
+    static const uint8_t BTHOME_PACKET_ID = 0x00;
+    static const uint8_t BTHOME_TEMPERATURE = 0x02;
+    static const uint8_t BTHOME_HUMIDITY = 0x03;
+    static const uint8_t BTHOME_MOISTURE = 0x14;
+    static const uint8_t BTHOME_GAS = 0x1C;
+    static const uint8_t BTHOME_MOTION = 0x21;
+
+    /**
+     * @brief Sensor values of one telemetry record.
+     */
+    struct TelemetryValues {
+        /** Bit per value set, see BLETelemetry::VALUE_* */
+        uint8_t present = 0;
+        uint8_t packetId = 0;
+        int16_t temperature = 0;    // 0.01 C
+        uint16_t humidity = 0;      // 0.01 %
+        uint16_t moisture = 0;      // 0.01 %
+        bool gas = false;
+        bool motion = false;
+    };
+
+    /**
+     * @brief Encodes and decodes the telemetry record.
+     */
+    class BLETelemetry {
+    public:
+        /** Bits of TelemetryValues::present */
+        static const uint8_t VALUE_TEMPERATURE = 0x01;
+        static const uint8_t VALUE_HUMIDITY = 0x02;
+        static const uint8_t VALUE_MOISTURE = 0x04;
+        static const uint8_t VALUE_GAS = 0x08;
+        static const uint8_t VALUE_MOTION = 0x10;
+
+        /** Largest record: header 7 + 3 x 3 + 2 x 2 bytes */
+        static const uint8_t RECORD_SIZE_MAX = 20;
+
+        /** Latest values */
+        TelemetryValues values;
+
+        /** True if a value changed since the last Encode */
+        bool changed = false;
+
+        void SetTemperature(int16_t centiDegrees) { Set(VALUE_TEMPERATURE, values.temperature, centiDegrees); }
+        void SetHumidity(uint16_t centiPercent) { Set(VALUE_HUMIDITY, values.humidity, centiPercent); }
+        void SetMoisture(uint16_t centiPercent) { Set(VALUE_MOISTURE, values.moisture, centiPercent); }
+        void SetGas(bool detected) { Set(VALUE_GAS, values.gas, detected); }
+        void SetMotion(bool detected) { Set(VALUE_MOTION, values.motion, detected); }
+
+        /**
+         * @brief Encode the record as advertising data structure.
+         * The packet id is incremented if a value changed since the last call.
+         * @param out Buffer of at least RECORD_SIZE_MAX bytes.
+         * @return Record length including the length byte.
+         */
+        uint8_t Encode(uint8_t* out) {
+            if (changed) {
+                values.packetId++;
+                changed = false;
+            }
+
+            uint8_t n = 1;
+            out[n++] = BTHOME_AD_TYPE_SERVICE_DATA;
+            out[n++] = (uint8_t)(BTHOME_UUID & 0xFF);
+            out[n++] = (uint8_t)(BTHOME_UUID >> 8);
+            out[n++] = BTHOME_DEVICE_INFO;
+            out[n++] = BTHOME_PACKET_ID;
+            out[n++] = values.packetId;
+
+            if (values.present & VALUE_TEMPERATURE) n = Put16(out, n, BTHOME_TEMPERATURE, (uint16_t)values.temperature);
+            if (values.present & VALUE_HUMIDITY) n = Put16(out, n, BTHOME_HUMIDITY, values.humidity);
+            if (values.present & VALUE_MOISTURE) n = Put16(out, n, BTHOME_MOISTURE, values.moisture);
+            if (values.present & VALUE_GAS) n = Put8(out, n, BTHOME_GAS, values.gas ? 1 : 0);
+            if (values.present & VALUE_MOTION) n = Put8(out, n, BTHOME_MOTION, values.motion ? 1 : 0);
+
+            out[0] = n - 1;
+            return n;
+        }
+
+        /**
+         * @brief Decode a record produced by Encode.
+         * @param data Advertising data structure [Len][0x16][0xD2][0xFC]...
+         * @param length Available bytes.
+         * @param out Decoded values.
+         * @return False if the record is not a BTHome v2 record or holds unknown objects.
+         */
+        static bool Decode(const uint8_t* data, uint8_t length, TelemetryValues& out) {
+            if (length < 7 || data[0] + 1 > length) return false;
+            if (data[1] != BTHOME_AD_TYPE_SERVICE_DATA
+                || (data[2] | (data[3] << 8)) != BTHOME_UUID
+                || (data[4] & BTHOME_VERSION_MASK) != (BTHOME_DEVICE_INFO & BTHOME_VERSION_MASK)) {
+                return false;
+            }
+
+            out = TelemetryValues();
+            uint8_t end = data[0] + 1;
+            uint8_t i = 5;
+            while (i < end) {
+                uint8_t id = data[i++];
+                uint8_t size = id == BTHOME_PACKET_ID || id == BTHOME_GAS || id == BTHOME_MOTION ? 1 : 2;
+                if (i + size > end) return false;
+                uint16_t value = size == 1 ? data[i] : (uint16_t)(data[i] | (data[i + 1] << 8));
+                i += size;
+
+                switch (id) {
+                    case BTHOME_PACKET_ID: out.packetId = (uint8_t)value; break;
+                    case BTHOME_TEMPERATURE: out.temperature = (int16_t)value; out.present |= VALUE_TEMPERATURE; break;
+                    case BTHOME_HUMIDITY: out.humidity = value; out.present |= VALUE_HUMIDITY; break;
+                    case BTHOME_MOISTURE: out.moisture = value; out.present |= VALUE_MOISTURE; break;
+                    case BTHOME_GAS: out.gas = value != 0; out.present |= VALUE_GAS; break;
+                    case BTHOME_MOTION: out.motion = value != 0; out.present |= VALUE_MOTION; break;
+                    default: return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        template <typename T>
+        void Set(uint8_t bit, T& field, T value) {
+            if ((values.present & bit) && field == value) return;
+            field = value;
+            values.present |= bit;
+            changed = true;
+        }
+
+        static uint8_t Put8(uint8_t* out, uint8_t n, uint8_t id, uint8_t value) {
+            out[n++] = id;
+            out[n++] = value;
+            return n;
+        }
+
+        static uint8_t Put16(uint8_t* out, uint8_t n, uint8_t id, uint16_t value) {
+            out[n++] = id;
+            out[n++] = (uint8_t)(value & 0xFF);
+            out[n++] = (uint8_t)(value >> 8);
+            return n;
+        }
+    };
+
+} // namespace B4R
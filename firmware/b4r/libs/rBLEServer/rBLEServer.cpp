@@ -1,199 +1,733 @@
 /**
  * @file rBLEServer.cpp
  * @brief ESP32 BLE UART-like server for B4R.
+ *
+ * Stack independent part: connection table, RX ring, TX coalescing,
+ * segmentation and counters.
+ * The Bluedroid and NimBLE specific parts are in rBLEServerBluedroid.cpp
+ * and rBLEServerNimBLE.cpp.
  */
 
 #include "B4RDefines.h"
 #include "rBLEServer.h"
 
-// UART-like BLE service UUIDs
-#define SERVICE_UUID            "6E400001-B5A3-F393-E0A9-E50E24DCCA9E"
-#define CHARACTERISTIC_UUID_TX  "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"  ///< Client -> Server (Write)
-#define CHARACTERISTIC_UUID_RX  "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"  ///< Server -> Client (Notify)
-
 namespace B4R {
 
     /// Static instance pointer initialization
     B4RBLEServer* B4RBLEServer::instance = nullptr;
 
     /**
-     * @brief BLE Server callback for connection events.
+     * @brief Initialize the BLE server.
+     * @param Name Device name to advertise.
+     * @param NewDataSub Callback for receiving byte arrays from client.
+     * @param ErrorSub Callback for error handling.
+     * @param mtuSize Preferred MTU size (23..517).
      */
-    class MyServerCallbacks : public BLEServerCallbacks {
-    public:
-        /**
-         * @brief Called when a BLE client connects.
-         * @param pServer Pointer to BLEServer instance.
-         */
-        void onConnect(BLEServer* pServer) override {
-            if (B4RBLEServer::GetInstance()) {
-                B4RBLEServer::GetInstance()->SetDeviceConnected(true);
-                ::Serial.println("[B4RBLEServer::onConnect] Client connected");
-            }
+    void B4RBLEServer::Initialize(B4RString* Name, SubVoidArray NewDataSub, SubVoidByte ErrorSub, uint16_t mtuSize) {
+        uint32_t started = millis();
+
+        instance = this;
+        this->NewDataSub = NewDataSub;
+        this->ErrorSub = ErrorSub;
+
+        // Reset the connection table and the RX frame ring
+        for (uint8_t i = 0; i < RBLESERVER_MAX_CONNECTIONS; i++) {
+            connections[i].used = false;
         }
+        connectedCount = 0;
+        rxHead.store(0, std::memory_order_relaxed);
+        rxTail.store(0, std::memory_order_relaxed);
+        ResetRxCounters();
 
-        /**
-         * @brief Called when a BLE client disconnects.
-         * @param pServer Pointer to BLEServer instance.
-         */
-        void onDisconnect(BLEServer* pServer) override {
-            if (B4RBLEServer::GetInstance()) {
-                B4RBLEServer::GetInstance()->SetDeviceConnected(false);
-                B4RBLEServer::GetInstance()->SetStartAdvertising();
-                ::Serial.println("[B4RBLEServer::onDisconnect] Client disconnected, restarting advertising");
-            }
+        internalDeviceName = String(Name->data, Name->getLength());
+
+        // Validate MTU
+        if (mtuSize < MTU_SIZE_MIN || mtuSize > MTU_SIZE_MAX) {
+            HandleError(ERROR_INVALID_CHARACTERISTIC);
+            mtuSize = MTU_SIZE_MIN;
         }
-    };
+
+        // Stack specific setup of device, service and characteristics
+        BeginStack(mtuSize);
+        if (deviceCount > 0) BeginDeviceService();
+
+        SetStartAdvertising();
+
+        // Drain the RX ring from the B4R main loop
+        FunctionUnion fu;
+        fu.PollerFunction = looper;
+        pollers.add(fu, this);
+
+        // Footprint figures to compare the backends
+        initDuration = millis() - started;
+        freeHeapAfterInit = ESP.getFreeHeap();
+        RLOG_I("[B4RBLEServer::Initialize] Backend: %s, init ms: %u, free heap: %u",
+            RLOG_STR(BACKEND == BACKEND_NIMBLE ? "NimBLE" : "Bluedroid"), initDuration, freeHeapAfterInit);
+    }
+
+    /**
+     * @brief Returns whether at least one BLE client is connected.
+     */
+    bool B4RBLEServer::IsConnected() {
+        return connectedCount > 0;
+    }
+
+    Byte B4RBLEServer::getConnectionCount() {
+        return connectedCount;
+    }
 
     /**
-     * @brief BLE Characteristic callback for client writes.
-     *
-     * This class handles incoming byte arrays written by the BLE client
-     * to the TX characteristic.
+     * @brief Connection id of a slot, CONN_ID_ALL if the slot is free.
      */
-    class MyCallbacks : public BLECharacteristicCallbacks {
-    public:
-        /**
-         * @brief Invoked when a client writes data to the TX characteristic.
-         * @param pCharacteristic Pointer to BLECharacteristic.
-         */
-        void onWrite(BLECharacteristic* pCharacteristic) override {
-            int len = pCharacteristic->getLength();
-            if (len == 0) return;
+    UInt B4RBLEServer::ConnIdAt(Byte Index) {
+        if (Index >= RBLESERVER_MAX_CONNECTIONS || !connections[Index].used) return CONN_ID_ALL;
+        return connections[Index].connId;
+    }
+
+    UInt B4RBLEServer::getLastConnId() {
+        return rxConnId;
+    }
 
-            static uint8_t buffer[512];
-            if (len > sizeof(buffer)) len = sizeof(buffer);
+    bool B4RBLEServer::IsSubscribed(UInt ConnId) {
+        Connection* c = FindConnection(ConnId);
+        return c != nullptr && c->subscribed;
+    }
 
-            const uint8_t* rawData = pCharacteristic->getData();
-            memcpy(buffer, rawData, len);
+    ULong B4RBLEServer::NotifySentCount(UInt ConnId) {
+        Connection* c = FindConnection(ConnId);
+        return c != nullptr ? c->notifySent : 0;
+    }
 
-            ArrayByte b4rData;
-            b4rData.data = buffer;
-            b4rData.length = len;
+    ULong B4RBLEServer::NotifyDroppedCount(UInt ConnId) {
+        Connection* c = FindConnection(ConnId);
+        return c != nullptr ? c->notifyDropped : 0;
+    }
+
+    /**
+     * @brief Find the slot of a connected client.
+     * @return Slot or nullptr if the client is not connected.
+     */
+    B4RBLEServer::Connection* B4RBLEServer::FindConnection(uint16_t connId) {
+        for (uint8_t i = 0; i < RBLESERVER_MAX_CONNECTIONS; i++) {
+            if (connections[i].used && connections[i].connId == connId) return &connections[i];
+        }
+        return nullptr;
+    }
 
-            if (B4RBLEServer::GetInstance()) {
-                B4RBLEServer::GetInstance()->HandleDataReceived(b4rData);
+    /**
+     * @brief Claim a slot for a new client (BLE task).
+     * Advertising continues while slots are free.
+     * @param connId Connection id (Bluedroid conn_id, NimBLE connection handle).
+     * @param address Peer address (6 bytes) or nullptr.
+     * @return False if all slots are in use, the backend then disconnects the client.
+     */
+    bool B4RBLEServer::AddConnection(uint16_t connId, const uint8_t* address) {
+        Connection* c = nullptr;
+        for (uint8_t i = 0; i < RBLESERVER_MAX_CONNECTIONS; i++) {
+            if (!connections[i].used) {
+                c = &connections[i];
+                break;
             }
+        }
+        if (c == nullptr) return false;
+
+        c->connId = connId;
+        c->subscribed = false;
+        c->deviceSubscribed = 0;
+        c->mtu = MTU_SIZE_MIN;
+        if (address != nullptr) memcpy(c->address, address, sizeof(c->address));
+        c->notifySent = 0;
+        c->notifyDropped = 0;
+        c->generation++;
+        c->used = true;
+        connectedCount++;
+
+        if (connectedCount < RBLESERVER_MAX_CONNECTIONS) SetStartAdvertising();
+        return true;
+    }
+
+    /**
+     * @brief Release the slot of a disconnected client (BLE task) and keep advertising.
+     */
+    void B4RBLEServer::RemoveConnection(uint16_t connId) {
+        Connection* c = FindConnection(connId);
+        if (c != nullptr) {
+            c->used = false;
+            c->subscribed = false;
+            c->deviceSubscribed = 0;
+            connectedCount--;
+        }
 
-            ::Serial.print("[B4RBLEServer::onWrite] Received bytes: ");
-            ::Serial.println(len);
+        if (connectedCount == 0) {
+            // The next client starts with the default link values
+            linkInterval = 0;
+            linkLatency = 0;
+            linkTimeout = 0;
+            linkDataLength = 27;
+            linkPhy = 1;
         }
-    };
+
+        SetStartAdvertising();
+    }
 
     /**
-     * @brief Initialize the BLE server.
-     * @param Name Device name to advertise.
-     * @param NewDataSub Callback for receiving byte arrays from client.
-     * @param ErrorSub Callback for error handling.
-     * @param mtuSize Preferred MTU size (23..517).
+     * @brief Store the CCCD notify state of a client (BLE task).
      */
-    void B4RBLEServer::Initialize(B4RString* Name, SubVoidArray NewDataSub, SubVoidByte ErrorSub, uint16_t mtuSize) {
-        instance = this;
-        this->NewDataSub = NewDataSub;
-        this->ErrorSub = ErrorSub;
+    void B4RBLEServer::SetSubscribed(uint16_t connId, bool subscribed) {
+        Connection* c = FindConnection(connId);
+        if (c != nullptr) c->subscribed = subscribed;
+    }
 
-        internalDeviceName = String(Name->data, Name->getLength());
+    /**
+     * @brief Store the CCCD notify state of a device characteristic of a client (BLE task).
+     * @param slot Device slot, see FindDevice.
+     */
+    void B4RBLEServer::SetDeviceSubscribed(uint16_t connId, uint8_t slot, bool subscribed) {
+        Connection* c = FindConnection(connId);
+        if (c == nullptr || slot >= deviceCount) return;
+        if (subscribed) {
+            c->deviceSubscribed |= (uint16_t)(1 << slot);
+        } else {
+            c->deviceSubscribed &= (uint16_t)~(1 << slot);
+        }
+    }
+
+    /**
+     * @brief Add a device characteristic, before Initialize.
+     */
+    void B4RBLEServer::AddDeviceCharacteristic(Byte DeviceId) {
+        if (pServer != nullptr || DeviceId == TRANSPORT_MARKER
+            || deviceCount >= RBLESERVER_MAX_DEVICE_CHARACTERISTICS || FindDevice(DeviceId) >= 0) {
+            HandleError(ERROR_INVALID_DEVICE_CHARACTERISTIC);
+            return;
+        }
+        devices[deviceCount].deviceId = DeviceId;
+        devices[deviceCount].pCharacteristic = nullptr;
+        deviceCount++;
+    }
+
+    Byte B4RBLEServer::getDeviceCharacteristicCount() {
+        return deviceCount;
+    }
+
+    bool B4RBLEServer::IsDeviceSubscribed(UInt ConnId, Byte DeviceId) {
+        Connection* c = FindConnection(ConnId);
+        int8_t slot = FindDevice(DeviceId);
+        return c != nullptr && slot >= 0 && (c->deviceSubscribed & (1 << slot)) != 0;
+    }
+
+    ULong B4RBLEServer::getDeviceNotifyCount() {
+        return deviceNotifyCount;
+    }
+
+    /**
+     * @brief Slot of the characteristic of a DeviceID.
+     * @return Slot or -1 if the device has no characteristic.
+     */
+    int8_t B4RBLEServer::FindDevice(uint8_t deviceId) {
+        for (uint8_t i = 0; i < deviceCount; i++) {
+            if (devices[i].deviceId == deviceId) return i;
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Characteristic UUID of a device, e.g. 0x09 -> 6E400109-B5A3-F393-E0A9-E50E24DCCA9E.
+     * @param uuid Buffer of at least 37 bytes.
+     */
+    void B4RBLEServer::DeviceUUID(uint8_t deviceId, char* uuid) {
+        snprintf(uuid, 37, RBLESERVER_DEVICE_UUID_FORMAT, deviceId);
+    }
 
-        // Reset BLE to ensure clean init
-        BLEDevice::deinit();
-        delay(100);
+    /**
+     * @brief Characteristic addressed by txDevice.
+     */
+    RBLECharacteristicImpl* B4RBLEServer::TxCharacteristic() {
+        return txDevice == DEVICE_NONE ? pCharacteristicRX : devices[txDevice].pCharacteristic;
+    }
+
+    /**
+     * @brief Notify a frame on the characteristic of its DeviceID to the
+     * txTarget clients that enabled it. Nothing is sent if none did.
+     */
+    void B4RBLEServer::SendDevice(const uint8_t* data, uint16_t length) {
+        int8_t slot = FindDevice(data[0]);
+        if (slot < 0 || devices[slot].pCharacteristic == nullptr) return;
+
+        // Keep the last frame as read value
+        devices[slot].pCharacteristic->setValue((uint8_t*)data, length);
+
+        uint16_t mask = (uint16_t)(1 << slot);
+        bool subscribed = false;
+        for (uint8_t i = 0; i < RBLESERVER_MAX_CONNECTIONS; i++) {
+            Connection* c = &connections[i];
+            if (!c->used || (txTarget != CONN_ID_ALL && c->connId != txTarget)) continue;
+            if (c->deviceSubscribed & mask) subscribed = true;
+        }
+        if (!subscribed) return;
 
-        BLEDevice::init(internalDeviceName.c_str());
+        txDevice = (uint8_t)slot;
+        Send(data, length);
+        txDevice = DEVICE_NONE;
+        deviceNotifyCount++;
+    }
 
-        String macStr = BLEDevice::getAddress().toString().c_str();
-        ::Serial.print("[B4RBLEServer::Initialize] MAC Address: ");
-        ::Serial.println(macStr.c_str());
+    /**
+     * @brief Connection parameters of a link profile.
+     * Intervals in 1.25 ms units, timeout in 10 ms units.
+     * @return False for LINK_PROFILE_NONE or an unknown profile.
+     */
+    bool B4RBLEServer::GetLinkParams(uint8_t profile, LinkParams& params) {
+        switch (profile) {
+            case LINK_PROFILE_LOW_LATENCY:
+                params = { 6, 12, 0, 200 };
+                return true;
+            case LINK_PROFILE_BALANCED:
+                params = { 24, 40, 0, 400 };
+                return true;
+            case LINK_PROFILE_LOW_POWER:
+                params = { 80, 160, 4, 600 };
+                return true;
+            default:
+                return false;
+        }
+    }
 
-        pServer = BLEDevice::createServer();
-        pServer->setCallbacks(new MyServerCallbacks());
+    void B4RBLEServer::setLinkProfile(Byte profile) {
+        if (profile > LINK_PROFILE_LOW_POWER) {
+            HandleError(ERROR_INVALID_LINK_PROFILE);
+            return;
+        }
+        linkProfile = profile;
+        for (uint8_t i = 0; i < RBLESERVER_MAX_CONNECTIONS; i++) {
+            if (connections[i].used) RequestLinkProfile(connections[i].connId);
+        }
+    }
 
-        // Create the UART-like BLE service
-        pService = pServer->createService(SERVICE_UUID);
+    Byte B4RBLEServer::getLinkProfile() {
+        return linkProfile;
+    }
 
-        // Characteristic for client writes (TX)
-        pCharacteristicTX = pService->createCharacteristic(
-            CHARACTERISTIC_UUID_TX,
-            BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_READ
-        );
-        pCharacteristicTX->setCallbacks(new MyCallbacks());
+    /**
+     * @brief Store negotiated connection parameters (BLE task).
+     * With several clients the values of the last updated link are kept.
+     */
+    void B4RBLEServer::SetLinkParams(uint16_t interval, uint16_t latency, uint16_t timeout) {
+        linkInterval = interval;
+        linkLatency = latency;
+        linkTimeout = timeout;
+        linkChanged = true;
+    }
 
-        // Characteristic for server notifications (RX)
-        pCharacteristicRX = pService->createCharacteristic(
-            CHARACTERISTIC_UUID_RX,
-            BLECharacteristic::PROPERTY_NOTIFY
-        );
-        pCharacteristicRX->addDescriptor(new BLE2902());
+    /**
+     * @brief Store the negotiated LL data length (BLE task).
+     */
+    void B4RBLEServer::SetLinkDataLength(uint16_t length) {
+        linkDataLength = length;
+        linkChanged = true;
+    }
 
-        pService->start();
+    /**
+     * @brief Store the negotiated PHY (BLE task).
+     */
+    void B4RBLEServer::SetLinkPhy(uint8_t phy) {
+        linkPhy = phy;
+        linkChanged = true;
+    }
 
-        // Validate and set MTU
-        if (mtuSize < MTU_SIZE_MIN || mtuSize > MTU_SIZE_MAX) {
-            HandleError(ERROR_INVALID_CHARACTERISTIC);
-            mtuSize = MTU_SIZE_MIN;
+    UInt B4RBLEServer::getLinkInterval() {
+        return linkInterval;
+    }
+
+    UInt B4RBLEServer::getLinkLatency() {
+        return linkLatency;
+    }
+
+    UInt B4RBLEServer::getLinkTimeout() {
+        return linkTimeout * 10;
+    }
+
+    UInt B4RBLEServer::getLinkDataLength() {
+        return linkDataLength;
+    }
+
+    Byte B4RBLEServer::getLinkPhy() {
+        return linkPhy;
+    }
+
+    /**
+     * @brief Copy bytes into the RX ring, wrapping at the end.
+     * @param pos Free-running ring position.
+     */
+    void B4RBLEServer::RingWrite(uint32_t pos, const uint8_t* src, uint32_t len) {
+        uint32_t offset = pos & (RBLESERVER_RX_RING_SIZE - 1);
+        uint32_t first = RBLESERVER_RX_RING_SIZE - offset;
+        if (first > len) first = len;
+        memcpy(&rxRing[offset], src, first);
+        memcpy(&rxRing[0], src + first, len - first);
+    }
+
+    /**
+     * @brief Copy bytes out of the RX ring, wrapping at the end.
+     * @param pos Free-running ring position.
+     */
+    void B4RBLEServer::RingRead(uint32_t pos, uint8_t* dst, uint32_t len) {
+        uint32_t offset = pos & (RBLESERVER_RX_RING_SIZE - 1);
+        uint32_t first = RBLESERVER_RX_RING_SIZE - offset;
+        if (first > len) first = len;
+        memcpy(dst, &rxRing[offset], first);
+        memcpy(dst + first, &rxRing[0], len - first);
+    }
+
+    /**
+     * @brief Enqueue a received frame (producer side, BLE host task).
+     * Frames longer than the drain buffer are truncated.
+     * @param connId Connection id of the sending client.
+     * @param data Received bytes.
+     * @param length Number of bytes.
+     * @return False if the ring was full and the frame was dropped.
+     */
+    bool B4RBLEServer::HandleDataReceived(uint16_t connId, const uint8_t* data, uint16_t length) {
+        if (length > sizeof(rxFrame)) length = sizeof(rxFrame);
+
+        uint32_t head = rxHead.load(std::memory_order_relaxed);
+        uint32_t tail = rxTail.load(std::memory_order_acquire);
+        uint32_t used = head - tail;
+        uint32_t needed = (uint32_t)length + 4;
+
+        if (RBLESERVER_RX_RING_SIZE - used < needed) {
+            rxOverflowCount++;
+            return false;
         }
-        BLEDevice::setMTU(mtuSize);
 
-        // Set TX power to maximum
-        esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_DEFAULT, ESP_PWR_LVL_P9);
+        uint8_t prefix[4] = {
+            (uint8_t)(length & 0xFF), (uint8_t)(length >> 8),
+            (uint8_t)(connId & 0xFF), (uint8_t)(connId >> 8)
+        };
+        RingWrite(head, prefix, 4);
+        RingWrite(head + 4, data, length);
+        rxHead.store(head + needed, std::memory_order_release);
 
-        SetStartAdvertising();
+        if (used + needed > rxHighWater) rxHighWater = used + needed;
+        return true;
     }
 
     /**
-     * @brief Start BLE advertising with device name and service UUID.
+     * @brief Main loop poller: flush due TX frames, drain all queued RX frames,
+     * reassemble segmented messages and raise NewData per message.
+     * Overflows detected since the last poll are reported once via the Error event.
      */
-    void B4RBLEServer::SetStartAdvertising() {
-        deviceConnected = false;
+    void B4RBLEServer::looper(void* b) {
+        B4RBLEServer* me = (B4RBLEServer*)b;
+        if (me->rxOverflowCount != me->rxOverflowReported) {
+            me->rxOverflowReported = me->rxOverflowCount;
+            me->HandleError(ERROR_RX_OVERFLOW);
+        }
+
+        // Report link parameter updates from the BLE task
+        if (me->linkChanged) {
+            me->linkChanged = false;
+            RLOG_I("[B4RBLEServer::Link] interval x1.25ms: %u, latency: %u, timeout ms: %u",
+                me->linkInterval, me->linkLatency, me->linkTimeout * 10);
+            RLOG_I("[B4RBLEServer::Link] data length: %u, phy: %u", me->linkDataLength, me->linkPhy);
+        }
+
+        // Advertise the latest telemetry record, at most once per interval
+        if (me->telemetryInterval > 0 && me->telemetry.changed
+            && millis() - me->telemetryLast >= me->telemetryInterval) {
+            me->telemetryLast = millis();
+            me->UpdateTelemetryAdvertisement();
+        }
+
+        // Send coalesced frames once the flush deadline has passed
+        if (me->txFrames > 0 && millis() - me->txFirstQueued >= me->txFlushDeadline) {
+            me->Flush();
+        }
+
+        uint32_t tail = me->rxTail.load(std::memory_order_relaxed);
+        uint32_t head = me->rxHead.load(std::memory_order_acquire);
 
-        BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
-        pAdvertising->stop();
+        while (tail != head) {
+            uint8_t prefix[4];
+            me->RingRead(tail, prefix, 4);
+            uint16_t length = prefix[0] | (prefix[1] << 8);
+            uint16_t connId = prefix[2] | (prefix[3] << 8);
+            me->RingRead(tail + 4, me->rxFrame, length);
 
-        BLEAdvertisementData advData;
-        advData.setName(internalDeviceName.c_str());
-        advData.setCompleteServices(BLEUUID(SERVICE_UUID));
-        pAdvertising->setAdvertisementData(advData);
+            // Release the slot before the callback so the BLE task can refill it
+            tail += (uint32_t)length + 4;
+            me->rxTail.store(tail, std::memory_order_release);
 
-        BLEAdvertisementData scanRespData;
-        scanRespData.setName(internalDeviceName.c_str());
-        pAdvertising->setScanResponseData(scanRespData);
+            // The client may have disconnected meanwhile, the frame is still delivered
+            me->rxConnId = connId;
+            me->ProcessFrame(me->FindConnection(connId), me->rxFrame, length);
+        }
 
-        pAdvertising->setScanResponse(true);
-        pAdvertising->setMinPreferred(0x06);
-        pAdvertising->setMaxPreferred(0x12);
+        me->CheckReassemblyTimeouts();
 
-        pAdvertising->start();
+        // Acknowledge the sequenced frames received during the ACK interval
+        for (uint8_t i = 0; i < RBLESERVER_MAX_CONNECTIONS; i++) {
+            Connection* c = &me->connections[i];
+            if (c->used && c->seqGeneration == c->generation
+                && c->ackReceived > 0 && millis() - c->ackFirst >= me->ackInterval) {
+                me->SendAck(c);
+            }
+        }
+    }
 
-        ::Serial.print("[B4RBLEServer::SetStartAdvertising] Started advertising: ");
-        ::Serial.println(internalDeviceName.c_str());
+    /**
+     * @brief Handle one received frame.
+     * Segments are reassembled, sequenced frames are unwrapped,
+     * device frames are delivered to NewData.
+     */
+    void B4RBLEServer::ProcessFrame(Connection* c, uint8_t* data, uint16_t length) {
+        if (BLESegmenter::IsSegment(data, length)) {
+            BLEReassembler* r = Reassembler(c);
+            uint8_t result = r->Feed(data, length, millis());
+            if (result == BLEReassembler::RESULT_COMPLETE) {
+                Deliver(r->Message(), r->MessageLength());
+            } else if (result == BLEReassembler::RESULT_ERROR) {
+                HandleError(ERROR_REASSEMBLY);
+            }
+        } else if (length >= 3 && data[0] == TRANSPORT_MARKER && data[1] == TRANSPORT_SEQUENCED) {
+            if (c != nullptr) CheckSequence(c, data[2]);
+            if (length > 3) ProcessFrame(c, data + 3, length - 3);
+        } else {
+            Deliver(data, length);
+        }
     }
 
     /**
-     * @brief Returns whether a BLE client is connected.
+     * @brief Reassembler of a client. A new connection in the slot drops the
+     * partial message of the previous client.
      */
-    bool B4RBLEServer::IsConnected() {
-        return deviceConnected;
+    BLEReassembler* B4RBLEServer::Reassembler(Connection* c) {
+        BLEReassembler* r = &rxReassembler;
+        if (c != nullptr) {
+            r = &c->reassembler;
+            uint32_t generation = c->generation;
+            if (generation != c->rxGeneration) {
+                c->rxGeneration = generation;
+                r->Reset();
+            }
+        }
+        r->timeoutMs = rxReassemblyTimeout;
+        return r;
+    }
+
+    /**
+     * @brief Discard the partial messages, per client, whose remaining segments
+     * did not arrive within the reassembly timeout.
+     */
+    void B4RBLEServer::CheckReassemblyTimeouts() {
+        uint32_t now = millis();
+        for (uint8_t i = 0; i < RBLESERVER_MAX_CONNECTIONS; i++) {
+            BLEReassembler* r = &connections[i].reassembler;
+            r->timeoutMs = rxReassemblyTimeout;
+            if (r->CheckTimeout(now)) HandleError(ERROR_REASSEMBLY);
+        }
+        rxReassembler.timeoutMs = rxReassemblyTimeout;
+        if (rxReassembler.CheckTimeout(now)) HandleError(ERROR_REASSEMBLY);
+    }
+
+    /**
+     * @brief Track the sequence number of a sequenced frame, per client.
+     * A forward gap counts as dropped frames; any other jump (client restart,
+     * reordering) resynchronizes without counting.
+     */
+    void B4RBLEServer::CheckSequence(Connection* c, uint8_t seq) {
+        // A new connection in this slot starts a new sequence
+        uint32_t generation = c->generation;
+        if (generation != c->seqGeneration) {
+            c->seqGeneration = generation;
+            c->seqValid = false;
+            c->ackReceived = 0;
+            c->ackDropped = 0;
+        }
+
+        if (c->seqValid) {
+            uint8_t gap = (uint8_t)(seq - c->seqExpected);
+            if (gap > 0 && gap < 0x80) {
+                rxSeqDropCount += gap;
+                c->ackDropped = (c->ackDropped + gap > 0xFF) ? 0xFF : c->ackDropped + gap;
+            }
+        }
+        c->seqExpected = seq + 1;
+        c->seqValid = true;
+        rxSeqFrameCount++;
+
+        if (ackInterval == 0) return;
+        if (c->ackReceived == 0) c->ackFirst = millis();
+        c->ackSeq = seq;
+        c->ackReceived++;
+        if (c->ackReceived == 0xFF) SendAck(c);
     }
 
     /**
-     * @brief Sets the internal device connection status.
-     * @param status True if client connected.
+     * @brief Send the batched ACK [0x00][0x04][LastSeq][Received][Dropped] to the client.
      */
-    void B4RBLEServer::SetDeviceConnected(bool status) {
-        deviceConnected = status;
+    void B4RBLEServer::SendAck(Connection* c) {
+        uint8_t ack[5] = { TRANSPORT_MARKER, TRANSPORT_ACK, c->ackSeq, c->ackReceived, c->ackDropped };
+        c->ackReceived = 0;
+        c->ackDropped = 0;
+        SendTo(c->connId, ack, sizeof(ack));
+    }
+
+    ULong B4RBLEServer::getRxSeqFrameCount() {
+        return rxSeqFrameCount;
+    }
+
+    ULong B4RBLEServer::getRxSeqDropCount() {
+        return rxSeqDropCount;
+    }
+
+    void B4RBLEServer::setAckInterval(UInt ms) {
+        ackInterval = ms;
+        if (ms == 0) {
+            for (uint8_t i = 0; i < RBLESERVER_MAX_CONNECTIONS; i++) {
+                connections[i].ackReceived = 0;
+                connections[i].ackDropped = 0;
+            }
+        }
+    }
+
+    UInt B4RBLEServer::getAckInterval() {
+        return ackInterval;
     }
 
     /**
-     * @brief Internal callback to process received data.
-     * @param value Array of bytes received from client.
+     * @brief Raise NewData for a received message.
      */
-    void B4RBLEServer::HandleDataReceived(ArrayByte& value) {
+    void B4RBLEServer::Deliver(uint8_t* data, uint16_t length) {
         if (NewDataSub) {
-            NewDataSub(&value);
+            const UInt cp = B4R::StackMemory::cp;
+            ArrayByte* arr = CreateStackMemoryObject(ArrayByte);
+            arr->data = data;
+            arr->length = length;
+            NewDataSub(arr);
+            B4R::StackMemory::cp = cp;
+        }
+    }
+
+    /**
+     * @brief Number of frames dropped because the RX ring was full.
+     */
+    ULong B4RBLEServer::getRxOverflowCount() {
+        return rxOverflowCount;
+    }
+
+    /**
+     * @brief Highest RX ring fill level in bytes.
+     */
+    UInt B4RBLEServer::getRxHighWater() {
+        return rxHighWater;
+    }
+
+    /**
+     * @brief Current RX ring fill level in bytes.
+     */
+    UInt B4RBLEServer::getRxPending() {
+        return rxHead.load(std::memory_order_acquire) - rxTail.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Reset the RX overflow and high-water counters.
+     */
+    void B4RBLEServer::ResetRxCounters() {
+        rxOverflowCount = 0;
+        rxOverflowReported = 0;
+        rxHighWater = 0;
+    }
+
+    /**
+     * @brief Set the negotiated MTU of a client (BLE task).
+     * @param connId Connection id.
+     * @param mtu ATT MTU.
+     */
+    void B4RBLEServer::SetPeerMTU(uint16_t connId, uint16_t mtu) {
+        if (mtu < MTU_SIZE_MIN) mtu = MTU_SIZE_MIN;
+        if (mtu > MTU_SIZE_MAX) mtu = MTU_SIZE_MAX;
+        Connection* c = FindConnection(connId);
+        if (c != nullptr) c->mtu = mtu;
+    }
+
+    /**
+     * @brief Usable notification payload: smallest ATT MTU of the clients
+     * addressed by txTarget minus 3 bytes ATT header.
+     */
+    uint16_t B4RBLEServer::PayloadCapacity() {
+        uint16_t mtu = 0;
+        for (uint8_t i = 0; i < RBLESERVER_MAX_CONNECTIONS; i++) {
+            Connection* c = &connections[i];
+            if (!c->used || (txTarget != CONN_ID_ALL && c->connId != txTarget)) continue;
+            if (mtu == 0 || c->mtu < mtu) mtu = c->mtu;
+        }
+        if (mtu == 0) mtu = MTU_SIZE_MIN;
+
+        uint16_t capacity = mtu - 3;
+        if (capacity > sizeof(txBuffer)) capacity = sizeof(txBuffer);
+        return capacity;
+    }
+
+    /**
+     * @brief Notify the subscribed clients addressed by txTarget,
+     * on the UART RX or the txDevice characteristic.
+     * A client addressed directly but not subscribed counts as dropped.
+     */
+    void B4RBLEServer::Notify(const uint8_t* data, uint16_t length) {
+        uint16_t mask = txDevice == DEVICE_NONE ? 0 : (uint16_t)(1 << txDevice);
+        for (uint8_t i = 0; i < RBLESERVER_MAX_CONNECTIONS; i++) {
+            Connection* c = &connections[i];
+            if (!c->used || (txTarget != CONN_ID_ALL && c->connId != txTarget)) continue;
+
+            bool subscribed = mask == 0 ? c->subscribed : (c->deviceSubscribed & mask) != 0;
+            if (subscribed && NotifyConnection(c->connId, data, length)) {
+                c->notifySent++;
+            } else if (subscribed || txTarget != CONN_ID_ALL) {
+                c->notifyDropped++;
+            }
+        }
+
+        RLOG_D("[B4RBLEServer::Write] Notified bytes: %u", length);
+    }
+
+    /**
+     * @brief Send a message to one client only.
+     */
+    void B4RBLEServer::SendTo(uint16_t connId, const uint8_t* data, uint16_t length) {
+        uint16_t target = txTarget;
+        txTarget = connId;
+        Send(data, length);
+        txTarget = target;
+    }
+
+    /**
+     * @brief Send a message; messages larger than the notification payload are segmented.
+     */
+    void B4RBLEServer::Send(const uint8_t* data, uint16_t length) {
+        uint16_t capacity = PayloadCapacity();
+        if (length <= capacity) {
+            Notify(data, length);
+            return;
+        }
+        if (txSegmenter.Segment(data, length, capacity, SendSegment, this) > 0) {
+            txSegmentedCount++;
+        } else {
+            HandleError(ERROR_MESSAGE_TOO_LARGE);
         }
     }
 
     /**
-     * @brief Send data to the connected client via notification.
+     * @brief Segmenter callback: notify one segment frame.
+     */
+    bool B4RBLEServer::SendSegment(void* context, const uint8_t* data, uint16_t length) {
+        ((B4RBLEServer*)context)->Notify(data, length);
+        return true;
+    }
+
+    /**
+     * @brief Send data to all subscribed clients via notification.
+     * With a TX flush deadline set, the frame is queued for a batch notification.
      * @param data Pointer to byte array.
      */
     void B4RBLEServer::Write(ArrayByte* data) {
@@ -205,33 +739,210 @@ namespace B4R {
             HandleError(ERROR_EMPTY_DATA);
             return;
         }
-        pCharacteristicRX->setValue((uint8_t*)data->data, data->length);
-        pCharacteristicRX->notify();
+        Queue((uint8_t*)data->data, data->length);
+        SendDevice((uint8_t*)data->data, data->length);
+    }
+
+    /**
+     * @brief Queue a frame for the next batch notification.
+     * Sent directly if coalescing is off or the frame can never share a notification.
+     */
+    void B4RBLEServer::Queue(const uint8_t* data, uint16_t length) {
+        if (txFlushDeadline == 0) {
+            Send(data, length);
+            return;
+        }
+
+        uint16_t capacity = PayloadCapacity();
+
+        // Frames that can never share a notification are sent on their own
+        if (length > 0xFF || 2 + 1 + length > capacity) {
+            Flush();
+            Send(data, length);
+            return;
+        }
+
+        if (txLength + 1 + length > capacity) {
+            Flush();
+        }
+
+        if (txFrames == 0) {
+            txBuffer[0] = TRANSPORT_MARKER;
+            txBuffer[1] = TRANSPORT_BATCH;
+            txLength = 2;
+            txFirstQueued = millis();
+        }
+        txBuffer[txLength++] = (uint8_t)length;
+        memcpy(&txBuffer[txLength], data, length);
+        txLength += length;
+        txFrames++;
+    }
+
+    /**
+     * @brief Send data to one client via notification, bypassing the TX queue.
+     * @param ConnId Connection id of the client.
+     * @param data Pointer to byte array.
+     */
+    void B4RBLEServer::WriteTo(UInt ConnId, ArrayByte* data) {
+        if (pCharacteristicRX == nullptr) {
+            HandleError(ERROR_INVALID_CHARACTERISTIC);
+            return;
+        }
+        if (data->length == 0) {
+            HandleError(ERROR_EMPTY_DATA);
+            return;
+        }
+        Flush();
+        SendTo(ConnId, (uint8_t*)data->data, data->length);
+
+        uint16_t target = txTarget;
+        txTarget = ConnId;
+        SendDevice((uint8_t*)data->data, data->length);
+        txTarget = target;
+    }
 
-        ::Serial.print("[B4RBLEServer::Write] Notified bytes: ");
-        ::Serial.println(data->length);
+    /**
+     * @brief Send data to all subscribed clients via notification, bypassing the TX queue.
+     * @param data Pointer to byte array.
+     */
+    void B4RBLEServer::WriteImmediate(ArrayByte* data) {
+        if (pCharacteristicRX == nullptr) {
+            HandleError(ERROR_INVALID_CHARACTERISTIC);
+            return;
+        }
+        if (data->length == 0) {
+            HandleError(ERROR_EMPTY_DATA);
+            return;
+        }
+        Flush();
+        Send((uint8_t*)data->data, data->length);
+        SendDevice((uint8_t*)data->data, data->length);
     }
 
     /**
-     * @brief Update BLE advertisement manufacturer data.
-     * @param data Pointer to byte array containing manufacturer data.
+     * @brief Send all queued frames.
+     * A single queued frame is sent as is, without the batch header.
      */
-    void B4RBLEServer::WriteAdvertisement(ArrayByte* data) {
-        BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
-        pAdvertising->stop();
+    void B4RBLEServer::Flush() {
+        if (txFrames == 0 || pCharacteristicRX == nullptr) return;
+
+        if (txFrames == 1) {
+            Notify(&txBuffer[3], txLength - 3);
+        } else {
+            Notify(txBuffer, txLength);
+        }
+
+        txFlushCount++;
+        txFrameCount += txFrames;
+        txLastFlushFrames = txFrames;
+        txLastFlushBytes = txFrames == 1 ? txLength - 3 : txLength;
+
+        txFrames = 0;
+        txLength = 0;
+    }
+
+    void B4RBLEServer::setTxFlushDeadline(UInt ms) {
+        if (ms == 0) Flush();
+        txFlushDeadline = ms;
+    }
+
+    UInt B4RBLEServer::getTxFlushDeadline() {
+        return txFlushDeadline;
+    }
+
+    UInt B4RBLEServer::getNegotiatedMTU() {
+        return PayloadCapacity() + 3;
+    }
+
+    ULong B4RBLEServer::getTxFlushCount() {
+        return txFlushCount;
+    }
+
+    ULong B4RBLEServer::getTxFrameCount() {
+        return txFrameCount;
+    }
+
+    Byte B4RBLEServer::getTxLastFlushFrames() {
+        return txLastFlushFrames;
+    }
+
+    UInt B4RBLEServer::getTxLastFlushBytes() {
+        return txLastFlushBytes;
+    }
+
+    ULong B4RBLEServer::getTxSegmentedCount() {
+        return txSegmentedCount;
+    }
+
+    void B4RBLEServer::setReassemblyTimeout(UInt ms) {
+        rxReassemblyTimeout = ms;
+    }
 
-        BLEAdvertisementData advertisementData;
+    UInt B4RBLEServer::getReassemblyTimeout() {
+        return rxReassemblyTimeout;
+    }
 
-        uint8_t* bytes = (uint8_t*)data->data;
-        String manufData = "";
-        for (int i = 0; i < data->length; i++) {
-            if (bytes[i] < 16) manufData += "0";
-            manufData += String(bytes[i], HEX);
+    ULong B4RBLEServer::getRxReassembledCount() {
+        uint32_t count = rxReassembler.completedCount;
+        for (uint8_t i = 0; i < RBLESERVER_MAX_CONNECTIONS; i++) {
+            count += connections[i].reassembler.completedCount;
         }
+        return count;
+    }
+
+    ULong B4RBLEServer::getRxReassemblyErrors() {
+        uint32_t count = rxReassembler.errorCount + rxReassembler.timeoutCount;
+        for (uint8_t i = 0; i < RBLESERVER_MAX_CONNECTIONS; i++) {
+            count += connections[i].reassembler.errorCount + connections[i].reassembler.timeoutCount;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Set the telemetry interval; switching telemetry on or off
+     * changes the advertisement layout and restarts advertising once.
+     */
+    void B4RBLEServer::setTelemetryInterval(UInt ms) {
+        bool modeChanged = (ms > 0) != (telemetryInterval > 0);
+        telemetryInterval = ms;
+        if (modeChanged && pServer != nullptr) SetStartAdvertising();
+    }
+
+    UInt B4RBLEServer::getTelemetryInterval() {
+        return telemetryInterval;
+    }
+
+    void B4RBLEServer::SetTelemetryClimate(float Temperature, float Humidity) {
+        telemetry.SetTemperature((int16_t)lroundf(Temperature * 100));
+        telemetry.SetHumidity((uint16_t)lroundf(Humidity * 100));
+    }
+
+    void B4RBLEServer::SetTelemetryMoisture(float Percent) {
+        telemetry.SetMoisture((uint16_t)lroundf(Percent * 100));
+    }
+
+    void B4RBLEServer::SetTelemetryGas(bool Detected) {
+        telemetry.SetGas(Detected);
+    }
+
+    void B4RBLEServer::SetTelemetryMotion(bool Detected) {
+        telemetry.SetMotion(Detected);
+    }
+
+    Byte B4RBLEServer::getTelemetryPacketId() {
+        return telemetry.values.packetId;
+    }
+
+    ULong B4RBLEServer::getInitDuration() {
+        return initDuration;
+    }
+
+    ULong B4RBLEServer::getFreeHeapAfterInit() {
+        return freeHeapAfterInit;
+    }
 
-        advertisementData.setManufacturerData(manufData);
-        pAdvertising->setAdvertisementData(advertisementData);
-        pAdvertising->start();
+    Byte B4RBLEServer::getBackend() {
+        return BACKEND;
     }
 
     /**
@@ -7,10 +7,31 @@
  * - One RX characteristic (Server -> Client, Notify)
  *
  * It supports:
- * - Connection/disconnection callbacks
- * - Receiving byte arrays from clients
- * - Sending notifications to connected clients
- * - Updating BLE advertisement data dynamically
+ * - Several concurrent clients (centrals), each with its own MTU, notify
+ *   subscription (CCCD) and notification counters; Write broadcasts to all
+ *   subscribed clients, WriteTo targets one client
+ * - Receiving byte arrays from clients via a lock-free RX frame ring
+ *   (BLE task enqueues, the B4R main loop drains and raises NewData)
+ * - Write without response with sequence numbers for drop detection and
+ *   an optional batched ACK notification (see AckInterval)
+ * - Sending notifications to connected clients, optionally coalescing
+ *   several [DeviceID][Command][Payload] frames into one notification
+ *   up to the negotiated MTU (see TxFlushDeadline)
+ * - Segmentation and reassembly of messages larger than the MTU in both
+ *   directions (see BLESegmenter.h)
+ * - Link profiles (connection interval, slave latency, supervision timeout,
+ *   Data Length Extension, 2M PHY) requested after connect (see LinkProfile)
+ * - Updating BLE advertisement data dynamically, in place
+ * - Connectionless telemetry: latest sensor values broadcast as BTHome v2
+ *   service data record in the advertisement (see BLETelemetry.h)
+ * - Optional device service with one characteristic per DeviceID; frames are
+ *   also notified on the characteristic of their DeviceID to the clients that
+ *   enabled its CCCD (see AddDeviceCharacteristic)
+ *
+ * Two BLE stacks are supported, selected at compile time with the same B4R API:
+ * - Bluedroid (ESP32 core BLE library, default)
+ * - NimBLE (NimBLE-Arduino 2.x, define RBLESERVER_NIMBLE, e.g. via
+ *   #DefineExtra: #define RBLESERVER_NIMBLE in the B4R project)
  *
  * @author Robert W.B. Linn
  * @date 2025
@@ -21,19 +42,76 @@
 #pragma once
 #include "B4RDefines.h"
 
-// ESP32 BLE library
+#if defined(RBLESERVER_NIMBLE)
+// NimBLE-Arduino library
+#include <NimBLEDevice.h>
+typedef NimBLEServer RBLEServerImpl;
+typedef NimBLEService RBLEServiceImpl;
+typedef NimBLECharacteristic RBLECharacteristicImpl;
+#else
+// ESP32 BLE library (Bluedroid)
 #include <BLEDevice.h>
 #include <BLEServer.h>
 #include <BLECharacteristic.h>
 #include <BLEUtils.h>
 #include <BLE2902.h>
+typedef BLEServer RBLEServerImpl;
+typedef BLEService RBLEServiceImpl;
+typedef BLECharacteristic RBLECharacteristicImpl;
+#endif
+
+#include <atomic>
+
+#include "BLESegmenter.h"
+#include "BLETelemetry.h"
+#include "rLog.h"
+
+/**
+ * RX frame ring capacity in bytes. Must be a power of two.
+ * Each frame occupies its length plus a 2-byte length prefix.
+ */
+#ifndef RBLESERVER_RX_RING_SIZE
+#define RBLESERVER_RX_RING_SIZE 2048
+#endif
+
+// 2M PHY needs a BLE 5.0 controller (ESP32-C3/S3/C6/H2), the ESP32 classic is BLE 4.2
+#include "soc/soc_caps.h"
+#if defined(SOC_BLE_50_SUPPORTED) && SOC_BLE_50_SUPPORTED
+#define RBLESERVER_PHY_2M 1
+#endif
+
+/**
+ * Maximum number of concurrent client connections.
+ * The BLE stack must allow at least as many (Bluedroid: BTDM_CTRL_BLE_MAX_CONN,
+ * NimBLE: CONFIG_BT_NIMBLE_MAX_CONNECTIONS, both default 3).
+ */
+#ifndef RBLESERVER_MAX_CONNECTIONS
+#define RBLESERVER_MAX_CONNECTIONS 3
+#endif
+
+// UART-like BLE service UUIDs
+#define RBLESERVER_SERVICE_UUID            "6E400001-B5A3-F393-E0A9-E50E24DCCA9E"
+#define RBLESERVER_CHARACTERISTIC_UUID_TX  "6E400002-B5A3-F393-E0A9-E50E24DCCA9E"  ///< Client -> Server (Write)
+#define RBLESERVER_CHARACTERISTIC_UUID_RX  "6E400003-B5A3-F393-E0A9-E50E24DCCA9E"  ///< Server -> Client (Notify)
+
+// Device service UUIDs, the characteristic UUID carries the DeviceID: 6E4001<ID>-...
+#define RBLESERVER_DEVICE_SERVICE_UUID     "6E400100-B5A3-F393-E0A9-E50E24DCCA9E"
+#define RBLESERVER_DEVICE_UUID_FORMAT      "6E4001%02X-B5A3-F393-E0A9-E50E24DCCA9E"
+
+/**
+ * Maximum number of device characteristics.
+ * Subscriptions are tracked as bitmask per connection (max 16).
+ */
+#ifndef RBLESERVER_MAX_DEVICE_CHARACTERISTICS
+#define RBLESERVER_MAX_DEVICE_CHARACTERISTICS 16
+#endif
 
 //~Library: rBLEServer
 //~Author: Robert W.B. Linn
 //~Brief: B4R library Bluetooth Low Energy (BLE) server for ESP32 (UART-style TX/RX).
-//~Dependencies: Built-in ESP32 BLE library 3.1.1
-//~Version: 0.92
-//~Built: 20250730
+//~Dependencies: Built-in ESP32 BLE library 3.1.1 or NimBLE-Arduino 2.x (RBLESERVER_NIMBLE), rLog
+//~Version: 1.02
+//~Built: 20261017
 
 namespace B4R {
 
@@ -48,33 +126,259 @@ namespace B4R {
         static B4RBLEServer* instance;
 
         // B4R callbacks
-        SubVoidArray NewDataSub;
-        SubVoidByte ErrorSub;
+        SubVoidArray NewDataSub = nullptr;
+        SubVoidByte ErrorSub = nullptr;
 
         // BLE components
-        BLEServer* pServer;
-        BLEService* pService;
-        BLECharacteristic* pCharacteristicTX;  // Client -> Server (Write)
-        BLECharacteristic* pCharacteristicRX;  // Server -> Client (Notify)
+        RBLEServerImpl* pServer = nullptr;
+        RBLEServiceImpl* pService = nullptr;
+        RBLECharacteristicImpl* pCharacteristicTX = nullptr;  // Client -> Server (Write)
+        RBLECharacteristicImpl* pCharacteristicRX = nullptr;  // Server -> Client (Notify)
 
         // Internal device name storage
         String internalDeviceName;
 
-        // Internal Connection flag
-        bool deviceConnected = false;
+        // Connection table. Slots are claimed and released by the BLE task,
+        // the sequence, ACK and reassembly fields are used by the main loop only.
+        struct Connection {
+            volatile bool used;
+            volatile bool subscribed;           // CCCD notifications enabled
+            volatile uint16_t deviceSubscribed; // CCCD of the device characteristics, bit per slot
+            uint16_t connId;
+            volatile uint16_t mtu;
+            uint8_t address[6];                 // Peer address (Bluedroid link requests)
+            volatile uint32_t generation;       // Incremented on each connect
+            uint32_t notifySent;
+            uint32_t notifyDropped;
+            uint32_t seqGeneration;
+            bool seqValid;
+            uint8_t seqExpected;
+            uint8_t ackSeq;
+            uint8_t ackReceived;
+            uint8_t ackDropped;
+            uint32_t ackFirst;
+            uint32_t rxGeneration;              // Generation the reassembler belongs to
+            BLEReassembler reassembler;         // Segments of this client only
+        };
+        Connection connections[RBLESERVER_MAX_CONNECTIONS] = {};
+        volatile uint8_t connectedCount = 0;
+
+        // Target of the notifications being sent: CONN_ID_ALL or one connection
+        uint16_t txTarget = 0xFFFF;
+
+        // Connection of the frame being delivered to NewData
+        uint16_t rxConnId = 0xFFFF;
+
+        // Device characteristics, registered before Initialize
+        struct DeviceCharacteristic {
+            uint8_t deviceId;
+            RBLECharacteristicImpl* pCharacteristic;
+        };
+        DeviceCharacteristic devices[RBLESERVER_MAX_DEVICE_CHARACTERISTICS] = {};
+        uint8_t deviceCount = 0;
+        RBLEServiceImpl* pDeviceService = nullptr;
+        uint32_t deviceNotifyCount = 0;
+
+        // Characteristic of the notifications being sent: DEVICE_NONE (UART RX) or a device slot
+        static const uint8_t DEVICE_NONE = 0xFF;
+        uint8_t txDevice = DEVICE_NONE;
+
+        // Slot of a device characteristic, -1 if none
+        int8_t FindDevice(uint8_t deviceId);
+
+        // Characteristic UUID of a device ("6E4001<ID>-...", 37 bytes)
+        static void DeviceUUID(uint8_t deviceId, char* uuid);
+
+        // Create the device service and characteristics (backend file)
+        void BeginDeviceService();
+
+        // Characteristic addressed by txDevice
+        RBLECharacteristicImpl* TxCharacteristic();
+
+        // Notify a frame on the characteristic of its DeviceID
+        void SendDevice(const uint8_t* data, uint16_t length);
+
+        Connection* FindConnection(uint16_t connId);
+
+        // RX frame ring: single producer (BLE task), single consumer (B4R main loop).
+        // Frames are stored as [LenLo][LenHi][ConnLo][ConnHi][Data...]; head/tail are free-running.
+        uint8_t rxRing[RBLESERVER_RX_RING_SIZE];
+        std::atomic<uint32_t> rxHead{0};
+        std::atomic<uint32_t> rxTail{0};
+        volatile uint32_t rxOverflowCount = 0;
+        uint32_t rxOverflowReported = 0;
+        volatile uint32_t rxHighWater = 0;
+
+        // Linear copy of the frame currently delivered to NewData
+        uint8_t rxFrame[512];
+
+        // TX coalescing queue: [0x00][0x01] followed by [Len][Frame...] records
+        uint8_t txBuffer[512];
+        uint16_t txLength = 0;
+        uint8_t txFrames = 0;
+        uint32_t txFirstQueued = 0;
+        uint16_t txFlushDeadline = 0;
+
+        // TX statistics
+        uint32_t txFlushCount = 0;
+        uint32_t txFrameCount = 0;
+        uint8_t txLastFlushFrames = 0;
+        uint16_t txLastFlushBytes = 0;
+
+        // Segmentation (TX) and reassembly (RX) of messages larger than the MTU.
+        // Each connection has its own reassembler, rxReassembler takes the segments
+        // of a client that disconnected before its frames were processed.
+        BLESegmenter txSegmenter;
+        BLEReassembler rxReassembler;
+        uint16_t rxReassemblyTimeout = 500;
+        uint32_t txSegmentedCount = 0;
+
+        // Reassembler of a connection, rxReassembler if none
+        BLEReassembler* Reassembler(Connection* c);
+
+        // Discard the partial messages whose remaining segments did not arrive in time
+        void CheckReassemblyTimeouts();
+
+        // Sequenced frames (write without response): drop detection and batched ACK
+        uint32_t rxSeqFrameCount = 0;
+        uint32_t rxSeqDropCount = 0;
+        uint16_t ackInterval = 0;
+
+        // Requested link profile and the link values negotiated with the client
+        uint8_t linkProfile = 0;
+        volatile uint16_t linkInterval = 0;     // 1.25 ms units
+        volatile uint16_t linkLatency = 0;      // connection events
+        volatile uint16_t linkTimeout = 0;      // 10 ms units
+        volatile uint16_t linkDataLength = 27;  // LL payload octets
+        volatile uint8_t linkPhy = 1;           // 1 = 1M, 2 = 2M
+        volatile bool linkChanged = false;
+
+        // Connection parameters of a link profile
+        struct LinkParams {
+            uint16_t minInterval;
+            uint16_t maxInterval;
+            uint16_t latency;
+            uint16_t timeout;
+        };
+        static bool GetLinkParams(uint8_t profile, LinkParams& params);
+
+        // Connectionless telemetry record, updated in the advertisement every telemetryInterval ms
+        BLETelemetry telemetry;
+        uint16_t telemetryInterval = 0;
+        uint32_t telemetryLast = 0;
+
+        // Set the advertisement data to flags + telemetry record (backend file)
+        void UpdateTelemetryAdvertisement();
+
+        // Footprint measured by Initialize
+        uint32_t initDuration = 0;
+        uint32_t freeHeapAfterInit = 0;
 
         // Centralized error handler
         void HandleError(uint8_t errorcode);
 
+        // Stack specific device, service and characteristic setup (backend file)
+        void BeginStack(uint16_t mtuSize);
+
+        // Send one notification to the subscribed clients of txTarget, on the txDevice characteristic
+        void Notify(const uint8_t* data, uint16_t length);
+
+        // Send one notification of TxCharacteristic to one client (backend file)
+        bool NotifyConnection(uint16_t connId, const uint8_t* data, uint16_t length);
+
+        // Send a message to one client only
+        void SendTo(uint16_t connId, const uint8_t* data, uint16_t length);
+
+        // Send a message, segmented if it exceeds the notification payload
+        void Send(const uint8_t* data, uint16_t length);
+        static bool SendSegment(void* context, const uint8_t* data, uint16_t length);
+
+        // Handle one received frame (transport frames or device frame)
+        void ProcessFrame(Connection* c, uint8_t* data, uint16_t length);
+
+        // Track the sequence number of a sequenced frame
+        void CheckSequence(Connection* c, uint8_t seq);
+
+        // Send the batched ACK notification to one client
+        void SendAck(Connection* c);
+
+        // Queue a frame for the next batch notification (or send it directly)
+        void Queue(const uint8_t* data, uint16_t length);
+
+        // Raise NewData for a received message
+        void Deliver(uint8_t* data, uint16_t length);
+
+        // Usable notification payload for the smallest MTU of the txTarget clients
+        uint16_t PayloadCapacity();
+
+        // Ring helpers
+        void RingWrite(uint32_t pos, const uint8_t* src, uint32_t len);
+        void RingRead(uint32_t pos, uint8_t* dst, uint32_t len);
+
+        // Main loop poller draining the RX ring
+        static void looper(void* b);
+
     public:
         /** MTU limits */
         static const UInt MTU_SIZE_MIN = 23;
         static const UInt MTU_SIZE_MAX = 512;
+        /** Largest MTU whose notification fits one 251-byte LL packet (DLE) */
+        static const UInt MTU_SIZE_DLE = 247;
 
         /** Warning and error codes */
         static const Byte WARNING_INVALID_MTU = 1;
         static const Byte ERROR_INVALID_CHARACTERISTIC = 2;
         static const Byte ERROR_EMPTY_DATA = 3;
+        static const Byte ERROR_RX_OVERFLOW = 4;
+        static const Byte ERROR_REASSEMBLY = 5;
+        static const Byte ERROR_MESSAGE_TOO_LARGE = 6;
+        static const Byte ERROR_INVALID_LINK_PROFILE = 7;
+        static const Byte ERROR_INVALID_DEVICE_CHARACTERISTIC = 8;
+
+        /**
+         * Link profiles requested after connect.
+         * LOW_LATENCY: interval 7.5-15 ms, latency 0, timeout 2 s
+         * BALANCED: interval 30-50 ms, latency 0, timeout 4 s
+         * LOW_POWER: interval 100-200 ms, latency 4, timeout 6 s
+         * All profiles request 251-byte LL packets and, if supported, the 2M PHY.
+         */
+        static const Byte LINK_PROFILE_NONE = 0;
+        static const Byte LINK_PROFILE_LOW_LATENCY = 1;
+        static const Byte LINK_PROFILE_BALANCED = 2;
+        static const Byte LINK_PROFILE_LOW_POWER = 3;
+
+        /** Largest LL data length (Data Length Extension) */
+        static const UInt LINK_DATA_LENGTH_MAX = 251;
+
+        /**
+         * Transport frames use the reserved DeviceID 0x00 as marker,
+         * followed by the transport type.
+         * Batch: [0x00][0x01][Len][Frame...][Len][Frame...]...
+         * Segment: [0x00][0x02][Flags][MsgId][Seq][Chunk...]
+         * Sequenced (client write without response): [0x00][0x03][Seq][Frame...]
+         * Ack (server notification): [0x00][0x04][LastSeq][Received][Dropped]
+         */
+        static const Byte TRANSPORT_MARKER = 0x00;
+        static const Byte TRANSPORT_BATCH = 0x01;
+        static const Byte TRANSPORT_SEGMENT = 0x02;
+        static const Byte TRANSPORT_SEQUENCED = 0x03;
+        static const Byte TRANSPORT_ACK = 0x04;
+
+        /** Connections */
+        static const Byte MAX_CONNECTIONS = RBLESERVER_MAX_CONNECTIONS;
+        static const UInt CONN_ID_ALL = 0xFFFF;
+
+        /** Device characteristics */
+        static const Byte MAX_DEVICE_CHARACTERISTICS = RBLESERVER_MAX_DEVICE_CHARACTERISTICS;
+
+        /** BLE stack the library was compiled with */
+        static const Byte BACKEND_BLUEDROID = 1;
+        static const Byte BACKEND_NIMBLE = 2;
+#if defined(RBLESERVER_NIMBLE)
+        static const Byte BACKEND = BACKEND_NIMBLE;
+#else
+        static const Byte BACKEND = BACKEND_BLUEDROID;
+#endif
 
         /**
          * Initialize the BLE server.
@@ -85,28 +389,240 @@ namespace B4R {
          */
         void Initialize(B4RString* Name, SubVoidArray NewDataSub, SubVoidByte ErrorSub, UInt mtuSize);
 
-        /** Check if a client is connected */
+        /** Check if at least one client is connected */
         bool IsConnected();
 
-        /** Send data to client via Notify */
+        /** Number of connected clients */
+        Byte getConnectionCount();
+
+        /**
+         * Connection id of a connection slot.
+         * @param Index Slot 0 to MAX_CONNECTIONS - 1
+         * @return Connection id or CONN_ID_ALL if the slot is free
+         */
+        UInt ConnIdAt(Byte Index);
+
+        /** Connection id of the client that sent the data raised in NewData */
+        UInt getLastConnId();
+
+        /** Check if a client enabled notifications (CCCD) */
+        bool IsSubscribed(UInt ConnId);
+
+        /**
+         * Add a characteristic (Notify, Read, Write) for a DeviceID to the device service.
+         * Must be called before Initialize. Frames written with Write/WriteTo/WriteImmediate
+         * are also notified on the characteristic of their first byte (DeviceID),
+         * only to clients that enabled its CCCD; the last frame is its read value.
+         * Writes to the characteristic are received like writes to the UART TX characteristic.
+         * The UART service is unchanged.
+         * @param DeviceId 0x01-0xFF (0x00 is the transport marker)
+         */
+        void AddDeviceCharacteristic(Byte DeviceId);
+
+        /** Number of device characteristics */
+        Byte getDeviceCharacteristicCount();
+
+        /** Check if a client enabled notifications of a device characteristic */
+        bool IsDeviceSubscribed(UInt ConnId, Byte DeviceId);
+
+        /** Number of frames notified on device characteristics */
+        ULong getDeviceNotifyCount();
+
+        /** Number of notifications sent to a client */
+        ULong NotifySentCount(UInt ConnId);
+
+        /** Number of notifications to a client that failed or were not subscribed */
+        ULong NotifyDroppedCount(UInt ConnId);
+
+        /**
+         * Send data to all subscribed clients via Notify.
+         * If TxFlushDeadline is greater than 0 the frame is queued and sent
+         * together with other frames in one batch notification.
+         */
         void Write(ArrayByte* data);
 
-        /** Update BLE advertisement manufacturer data */
+        /**
+         * Send data to one client via Notify without coalescing,
+         * e.g. the response to a request (see LastConnId).
+         * Frames still queued are flushed first to keep the order.
+         */
+        void WriteTo(UInt ConnId, ArrayByte* data);
+
+        /**
+         * Send data to client via Notify without coalescing.
+         * Frames still queued are flushed first to keep the order.
+         */
+        void WriteImmediate(ArrayByte* data);
+
+        /** Send all queued frames now */
+        void Flush();
+
+        /**
+         * Set/Get the TX flush deadline in ms (0 = no coalescing, default).
+         * Queued frames are sent at the latest after this time or earlier
+         * when the next frame does not fit into the negotiated MTU.
+         */
+        void setTxFlushDeadline(UInt ms);
+        UInt getTxFlushDeadline();
+
+        /** Smallest negotiated ATT MTU of the connected clients (23 if not negotiated) */
+        UInt getNegotiatedMTU();
+
+        /** Number of coalesced notifications sent */
+        ULong getTxFlushCount();
+
+        /** Number of frames sent via coalesced notifications */
+        ULong getTxFrameCount();
+
+        /** Number of frames in the last coalesced notification */
+        Byte getTxLastFlushFrames();
+
+        /** Size in bytes of the last coalesced notification */
+        UInt getTxLastFlushBytes();
+
+        /** Number of outbound messages sent as segments */
+        ULong getTxSegmentedCount();
+
+        /**
+         * Set/Get the reassembly timeout in ms (default 500).
+         * A partially received segmented message is discarded after this time.
+         * Segments are reassembled per client, writes of several clients do not mix.
+         */
+        void setReassemblyTimeout(UInt ms);
+        UInt getReassemblyTimeout();
+
+        /** Number of inbound segmented messages reassembled */
+        ULong getRxReassembledCount();
+
+        /** Number of inbound segmented messages discarded (sequence errors, overflow, timeout) */
+        ULong getRxReassemblyErrors();
+
+        /**
+         * Set/Get the link profile (default LINK_PROFILE_NONE = stack defaults).
+         * The profile is requested after each connect, and immediately
+         * if a client is connected. Best set before Initialize.
+         */
+        void setLinkProfile(Byte profile);
+        Byte getLinkProfile();
+
+        /** Negotiated connection interval in 1.25 ms units (0 if not connected) */
+        UInt getLinkInterval();
+
+        /** Negotiated slave latency in connection events */
+        UInt getLinkLatency();
+
+        /** Negotiated supervision timeout in ms */
+        UInt getLinkTimeout();
+
+        /** LL data length in octets (27 without Data Length Extension) */
+        UInt getLinkDataLength();
+
+        /** PHY in use: 1 = 1M, 2 = 2M */
+        Byte getLinkPhy();
+
+        /** Number of sequenced frames received (write without response) */
+        ULong getRxSeqFrameCount();
+
+        /** Number of sequenced frames missing (sequence gaps) */
+        ULong getRxSeqDropCount();
+
+        /**
+         * Set/Get the batched ACK interval in ms (0 = no ACK, default).
+         * Received sequenced frames are acknowledged with one notification
+         * [0x00][0x04][LastSeq][Received][Dropped] per interval.
+         */
+        void setAckInterval(UInt ms);
+        UInt getAckInterval();
+
+        /**
+         * Update BLE advertisement manufacturer data in place, without
+         * restarting advertising. Replaces the name and service UUID of the
+         * advertisement (both stay in the scan response). Not used with telemetry.
+         */
         void WriteAdvertisement(ArrayByte* data);
 
+        /**
+         * Set/Get the telemetry update interval in ms (0 = off, default).
+         * If > 0 the advertisement carries the BTHome v2 telemetry record,
+         * updated in place at most once per interval when a value changed.
+         * The device name and UART service UUID are in the scan response.
+         */
+        void setTelemetryInterval(UInt ms);
+        UInt getTelemetryInterval();
+
+        /** Set the telemetry temperature (C) and humidity (%) */
+        void SetTelemetryClimate(float Temperature, float Humidity);
+
+        /** Set the telemetry moisture (%) */
+        void SetTelemetryMoisture(float Percent);
+
+        /** Set the telemetry gas state */
+        void SetTelemetryGas(bool Detected);
+
+        /** Set the telemetry motion state */
+        void SetTelemetryMotion(bool Detected);
+
+        /** Rolling packet id of the last telemetry record advertised */
+        Byte getTelemetryPacketId();
+
+        /** BLE stack in use: BACKEND_BLUEDROID or BACKEND_NIMBLE */
+        Byte getBackend();
+
+        /** Duration of Initialize in ms (stack init, GATT setup, advertising start) */
+        ULong getInitDuration();
+
+        /** Free heap in bytes measured at the end of Initialize */
+        ULong getFreeHeapAfterInit();
+
+        /** Number of received frames dropped because the RX ring was full */
+        ULong getRxOverflowCount();
+
+        /** Highest RX ring fill level seen (bytes, including length prefixes) */
+        UInt getRxHighWater();
+
+        /** Current RX ring fill level (bytes, including length prefixes) */
+        UInt getRxPending();
+
+        /** Reset the RX overflow and high-water counters */
+        void ResetRxCounters();
+
         // --- Hidden / internal methods for B4R runtime ---
 
         //~hide
         static B4RBLEServer* GetInstance() { return instance; }
 
         //~hide
-        void SetDeviceConnected(bool status);
+        bool AddConnection(uint16_t connId, const uint8_t* address);
+
+        //~hide
+        void RemoveConnection(uint16_t connId);
+
+        //~hide
+        void SetSubscribed(uint16_t connId, bool subscribed);
+
+        //~hide
+        void SetDeviceSubscribed(uint16_t connId, uint8_t slot, bool subscribed);
 
         //~hide
         void SetStartAdvertising();
 
         //~hide
-        void HandleDataReceived(ArrayByte &value);
+        void SetPeerMTU(uint16_t connId, uint16_t mtu);
+
+        //~hide
+        void RequestLinkProfile(uint16_t connId);
+
+        //~hide
+        void SetLinkParams(uint16_t interval, uint16_t latency, uint16_t timeout);
+
+        //~hide
+        void SetLinkDataLength(uint16_t length);
+
+        //~hide
+        void SetLinkPhy(uint8_t phy);
+
+        //~hide
+        bool HandleDataReceived(uint16_t connId, const uint8_t* data, uint16_t length);
     };
 
 } // namespace B4R
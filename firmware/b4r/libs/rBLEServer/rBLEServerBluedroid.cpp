@@ -0,0 +1,343 @@
+/**
+ * @file rBLEServerBluedroid.cpp
+ * @brief Bluedroid backend of the ESP32 BLE UART-like server for B4R.
+ *
+ * Used unless RBLESERVER_NIMBLE is defined.
+ */
+
+#include "B4RDefines.h"
+#include "rBLEServer.h"
+
+#if !defined(RBLESERVER_NIMBLE)
+
+namespace B4R {
+
+    /// GATT interface of the server, captured from the GATTS events
+    static esp_gatt_if_t gattsIf = ESP_GATT_IF_NONE;
+
+    /// CCCD of the RX characteristic, written per client to enable notifications
+    static BLE2902* pCCCD = nullptr;
+
+    /// CCCDs of the device characteristics, indexed by device slot
+    static BLE2902* pDeviceCCCD[RBLESERVER_MAX_DEVICE_CHARACTERISTICS] = {};
+
+    /**
+     * @brief GATTS event handler tracking the per-client CCCD state.
+     * The BLE2902 descriptor itself keeps one value for all clients.
+     */
+    static void GattsEventHandler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param) {
+        B4RBLEServer* server = B4RBLEServer::GetInstance();
+        if (!server) return;
+
+        if (event == ESP_GATTS_CONNECT_EVT) {
+            gattsIf = gatts_if;
+        } else if (event == ESP_GATTS_WRITE_EVT && param->write.len >= 2) {
+            bool enabled = (param->write.value[0] & 0x01) != 0;
+            if (pCCCD != nullptr && param->write.handle == pCCCD->getHandle()) {
+                server->SetSubscribed(param->write.conn_id, enabled);
+                return;
+            }
+            for (uint8_t i = 0; i < RBLESERVER_MAX_DEVICE_CHARACTERISTICS && pDeviceCCCD[i] != nullptr; i++) {
+                if (param->write.handle == pDeviceCCCD[i]->getHandle()) {
+                    server->SetDeviceSubscribed(param->write.conn_id, i, enabled);
+                    return;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief GAP event handler reporting the negotiated link parameters.
+     */
+    static void GapEventHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+        B4RBLEServer* server = B4RBLEServer::GetInstance();
+        if (!server) return;
+
+        switch (event) {
+            case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+                if (param->update_conn_params.status == ESP_BT_STATUS_SUCCESS) {
+                    server->SetLinkParams(
+                        param->update_conn_params.conn_int,
+                        param->update_conn_params.latency,
+                        param->update_conn_params.timeout);
+                }
+                break;
+            case ESP_GAP_BLE_SET_PKT_LENGTH_COMPLETE_EVT:
+                if (param->pkt_data_length_cmpl.status == ESP_BT_STATUS_SUCCESS) {
+                    server->SetLinkDataLength(param->pkt_data_length_cmpl.params.tx_len);
+                }
+                break;
+#if defined(RBLESERVER_PHY_2M) && defined(CONFIG_BT_BLE_50_FEATURES_SUPPORTED)
+            case ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT:
+                if (param->phy_update.status == ESP_BT_STATUS_SUCCESS) {
+                    server->SetLinkPhy(param->phy_update.tx_phy);
+                }
+                break;
+#endif
+            default:
+                break;
+        }
+    }
+
+    /**
+     * @brief BLE Server callback for connection events.
+     */
+    class MyServerCallbacks : public BLEServerCallbacks {
+    public:
+        /**
+         * @brief Called when a BLE client connects.
+         * @param pServer Pointer to BLEServer instance.
+         * @param param GATT server event parameters.
+         */
+        void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) override {
+            if (B4RBLEServer::GetInstance()) {
+                uint16_t connId = param->connect.conn_id;
+                if (!B4RBLEServer::GetInstance()->AddConnection(connId, param->connect.remote_bda)) {
+                    RLOG_W("[B4RBLEServer::onConnect] No free connection slot, disconnecting");
+                    pServer->disconnect(connId);
+                    return;
+                }
+                B4RBLEServer::GetInstance()->SetLinkParams(
+                    param->connect.conn_params.interval,
+                    param->connect.conn_params.latency,
+                    param->connect.conn_params.timeout);
+                B4RBLEServer::GetInstance()->RequestLinkProfile(connId);
+                RLOG_I("[B4RBLEServer::onConnect] Client connected, conn_id: %u", connId);
+            }
+        }
+
+        /**
+         * @brief Called when a BLE client disconnects.
+         * @param pServer Pointer to BLEServer instance.
+         * @param param GATT server event parameters.
+         */
+        void onDisconnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) override {
+            if (B4RBLEServer::GetInstance()) {
+                B4RBLEServer::GetInstance()->RemoveConnection(param->disconnect.conn_id);
+                RLOG_I("[B4RBLEServer::onDisconnect] Client disconnected, conn_id: %u", param->disconnect.conn_id);
+            }
+        }
+
+        /**
+         * @brief Called when the client negotiated a new ATT MTU.
+         * @param pServer Pointer to BLEServer instance.
+         * @param param GATT server event parameters.
+         */
+        void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) override {
+            if (B4RBLEServer::GetInstance()) {
+                B4RBLEServer::GetInstance()->SetPeerMTU(param->mtu.conn_id, param->mtu.mtu);
+            }
+        }
+    };
+
+    /**
+     * @brief BLE Characteristic callback for client writes.
+     *
+     * This class handles incoming byte arrays written by the BLE client
+     * to the TX characteristic.
+     */
+    class MyCallbacks : public BLECharacteristicCallbacks {
+    public:
+        /**
+         * @brief Invoked when a client writes data to the TX characteristic.
+         * @param pCharacteristic Pointer to BLECharacteristic.
+         * @param param GATT server event parameters.
+         */
+        void onWrite(BLECharacteristic* pCharacteristic, esp_ble_gatts_cb_param_t* param) override {
+            size_t len = pCharacteristic->getLength();
+            if (len == 0) return;
+
+            // Runs on the BLE host task: only enqueue, never call into B4R here
+            if (B4RBLEServer::GetInstance()) {
+                B4RBLEServer::GetInstance()->HandleDataReceived(param->write.conn_id, pCharacteristic->getData(), len);
+            }
+
+            RLOG_D("[B4RBLEServer::onWrite] Received bytes: %u", len);
+        }
+    };
+
+    /**
+     * @brief Create the Bluedroid device, UART service and characteristics.
+     * @param mtuSize Validated preferred MTU size.
+     */
+    void B4RBLEServer::BeginStack(uint16_t mtuSize) {
+        // Reset BLE to ensure clean init
+        BLEDevice::deinit();
+        delay(100);
+
+        BLEDevice::init(internalDeviceName.c_str());
+
+#if RLOG_LEVEL >= RLOG_LEVEL_INFO
+        // Formatted here: the address string does not outlive this call
+        String macStr = BLEDevice::getAddress().toString().c_str();
+        ::Serial.print("[B4RBLEServer::Initialize] MAC Address: ");
+        ::Serial.println(macStr.c_str());
+#endif
+
+        // Negotiated link parameters are reported via GAP events,
+        // the per-client CCCD state via GATTS events
+        BLEDevice::setCustomGapHandler(GapEventHandler);
+        BLEDevice::setCustomGattsHandler(GattsEventHandler);
+
+        pServer = BLEDevice::createServer();
+        pServer->setCallbacks(new MyServerCallbacks());
+
+        // Create the UART-like BLE service
+        pService = pServer->createService(RBLESERVER_SERVICE_UUID);
+
+        // Characteristic for client writes (TX), with and without response
+        pCharacteristicTX = pService->createCharacteristic(
+            RBLESERVER_CHARACTERISTIC_UUID_TX,
+            BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR | BLECharacteristic::PROPERTY_READ
+        );
+        pCharacteristicTX->setCallbacks(new MyCallbacks());
+
+        // Characteristic for server notifications (RX)
+        pCharacteristicRX = pService->createCharacteristic(
+            RBLESERVER_CHARACTERISTIC_UUID_RX,
+            BLECharacteristic::PROPERTY_NOTIFY
+        );
+        pCCCD = new BLE2902();
+        pCharacteristicRX->addDescriptor(pCCCD);
+
+        pService->start();
+
+        BLEDevice::setMTU(mtuSize);
+
+        // Set TX power to maximum
+        esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_DEFAULT, ESP_PWR_LVL_P9);
+    }
+
+    /**
+     * @brief Create the device service with one characteristic per registered DeviceID.
+     * Each characteristic uses 3 handles (declaration, value, CCCD).
+     */
+    void B4RBLEServer::BeginDeviceService() {
+        pDeviceService = pServer->createService(BLEUUID(RBLESERVER_DEVICE_SERVICE_UUID), 1 + 3 * deviceCount);
+
+        BLECharacteristicCallbacks* callbacks = new MyCallbacks();
+        char uuid[37];
+        for (uint8_t i = 0; i < deviceCount; i++) {
+            DeviceUUID(devices[i].deviceId, uuid);
+            devices[i].pCharacteristic = pDeviceService->createCharacteristic(
+                uuid,
+                BLECharacteristic::PROPERTY_NOTIFY | BLECharacteristic::PROPERTY_READ
+                | BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR
+            );
+            devices[i].pCharacteristic->setCallbacks(callbacks);
+            pDeviceCCCD[i] = new BLE2902();
+            devices[i].pCharacteristic->addDescriptor(pDeviceCCCD[i]);
+        }
+
+        pDeviceService->start();
+
+        RLOG_I("[B4RBLEServer::Initialize] Device characteristics: %u", deviceCount);
+    }
+
+    /**
+     * @brief Start BLE advertising with device name and service UUID.
+     */
+    void B4RBLEServer::SetStartAdvertising() {
+        BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
+        pAdvertising->stop();
+
+        BLEAdvertisementData scanRespData;
+        // Name and service UUID always in the scan response (2 + name + 18 bytes of 31),
+        // so they stay visible when the advertisement is replaced (telemetry, WriteAdvertisement)
+        scanRespData.setName(internalDeviceName.c_str());
+        scanRespData.setCompleteServices(BLEUUID(RBLESERVER_SERVICE_UUID));
+
+        if (telemetryInterval > 0) {
+            // Telemetry record in the advertisement
+            UpdateTelemetryAdvertisement();
+        } else {
+            BLEAdvertisementData advData;
+            advData.setName(internalDeviceName.c_str());
+            advData.setCompleteServices(BLEUUID(RBLESERVER_SERVICE_UUID));
+            pAdvertising->setAdvertisementData(advData);
+        }
+        pAdvertising->setScanResponseData(scanRespData);
+
+        pAdvertising->setScanResponse(true);
+
+        // Preferred connection interval of the link profile
+        LinkParams params;
+        if (GetLinkParams(linkProfile, params)) {
+            pAdvertising->setMinPreferred(params.minInterval);
+            pAdvertising->setMaxPreferred(params.maxInterval);
+        } else {
+            pAdvertising->setMinPreferred(0x06);
+            pAdvertising->setMaxPreferred(0x12);
+        }
+
+        pAdvertising->start();
+
+        RLOG_I("[B4RBLEServer::SetStartAdvertising] Started advertising: %s", RLOG_STR(internalDeviceName.c_str()));
+    }
+
+    /**
+     * @brief Request the connection parameters, data length and PHY of the link profile.
+     * Results arrive as GAP events and are stored via SetLinkParams/SetLinkDataLength/SetLinkPhy.
+     */
+    void B4RBLEServer::RequestLinkProfile(uint16_t connId) {
+        LinkParams params;
+        if (!GetLinkParams(linkProfile, params)) return;
+
+        Connection* c = FindConnection(connId);
+        if (c == nullptr) return;
+
+        esp_ble_conn_update_params_t connParams = {};
+        memcpy(connParams.bda, c->address, sizeof(esp_bd_addr_t));
+        connParams.min_int = params.minInterval;
+        connParams.max_int = params.maxInterval;
+        connParams.latency = params.latency;
+        connParams.timeout = params.timeout;
+        esp_ble_gap_update_conn_params(&connParams);
+
+        esp_ble_gap_set_pkt_data_len(c->address, LINK_DATA_LENGTH_MAX);
+
+#if defined(RBLESERVER_PHY_2M) && defined(CONFIG_BT_BLE_50_FEATURES_SUPPORTED)
+        esp_ble_gap_set_preferred_phy(c->address, 0,
+            ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_2M_PREF_MASK,
+            ESP_BLE_GAP_PHY_OPTIONS_NO_PREF);
+#endif
+    }
+
+    /**
+     * @brief Send one notification of the RX or device characteristic (TxCharacteristic) to one client.
+     * @return False if the notification could not be queued by the stack.
+     */
+    bool B4RBLEServer::NotifyConnection(uint16_t connId, const uint8_t* data, uint16_t length) {
+        if (gattsIf == ESP_GATT_IF_NONE) return false;
+        return esp_ble_gatts_send_indicate(gattsIf, connId, TxCharacteristic()->getHandle(),
+            length, (uint8_t*)data, false) == ESP_OK;
+    }
+
+    /**
+     * @brief Update BLE advertisement manufacturer data in place.
+     * The controller accepts new advertising data while advertising.
+     * @param data Pointer to byte array containing manufacturer data.
+     */
+    void B4RBLEServer::WriteAdvertisement(ArrayByte* data) {
+        BLEAdvertisementData advertisementData;
+        advertisementData.setFlags(ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT);
+        advertisementData.setManufacturerData(String((const char*)data->data, data->length));
+        BLEDevice::getAdvertising()->setAdvertisementData(advertisementData);
+    }
+
+    /**
+     * @brief Set the advertisement data to flags + telemetry record, in place.
+     */
+    void B4RBLEServer::UpdateTelemetryAdvertisement() {
+        uint8_t record[BLETelemetry::RECORD_SIZE_MAX];
+        uint8_t length = telemetry.Encode(record);
+
+        BLEAdvertisementData advertisementData;
+        advertisementData.setFlags(ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT);
+        advertisementData.addData(String((const char*)record, length));
+        BLEDevice::getAdvertising()->setAdvertisementData(advertisementData);
+    }
+
+} // namespace B4R
+
+#endif // !RBLESERVER_NIMBLE
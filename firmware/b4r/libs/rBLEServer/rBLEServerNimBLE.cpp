@@ -0,0 +1,338 @@
+/**
+ * @file rBLEServerNimBLE.cpp
+ * @brief NimBLE backend of the ESP32 BLE UART-like server for B4R.
+ *
+ * Used when RBLESERVER_NIMBLE is defined. Requires NimBLE-Arduino 2.x.
+ * Same service, characteristics and behaviour as the Bluedroid backend.
+ */
+
+#include "B4RDefines.h"
+#include "rBLEServer.h"
+
+#if defined(RBLESERVER_NIMBLE)
+
+namespace B4R {
+
+    /**
+     * @brief BLE Server callback for connection events.
+     */
+    class MyServerCallbacks : public NimBLEServerCallbacks {
+    public:
+        /**
+         * @brief Called when a BLE client connects.
+         * @param pServer Pointer to NimBLEServer instance.
+         * @param connInfo Connection information.
+         */
+        void onConnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo) override {
+            if (B4RBLEServer::GetInstance()) {
+                uint16_t connHandle = connInfo.getConnHandle();
+                if (!B4RBLEServer::GetInstance()->AddConnection(connHandle, connInfo.getAddress().getVal())) {
+                    RLOG_W("[B4RBLEServer::onConnect] No free connection slot, disconnecting");
+                    pServer->disconnect(connHandle);
+                    return;
+                }
+                B4RBLEServer::GetInstance()->SetLinkParams(
+                    connInfo.getConnInterval(),
+                    connInfo.getConnLatency(),
+                    connInfo.getConnTimeout());
+                B4RBLEServer::GetInstance()->RequestLinkProfile(connHandle);
+                RLOG_I("[B4RBLEServer::onConnect] Client connected, conn_id: %u", connHandle);
+            }
+        }
+
+        /**
+         * @brief Called when a BLE client disconnects.
+         * @param pServer Pointer to NimBLEServer instance.
+         * @param connInfo Connection information.
+         * @param reason Disconnect reason (HCI error code).
+         */
+        void onDisconnect(NimBLEServer* pServer, NimBLEConnInfo& connInfo, int reason) override {
+            if (B4RBLEServer::GetInstance()) {
+                B4RBLEServer::GetInstance()->RemoveConnection(connInfo.getConnHandle());
+                RLOG_I("[B4RBLEServer::onDisconnect] Client disconnected, conn_id: %u", connInfo.getConnHandle());
+            }
+        }
+
+        /**
+         * @brief Called when the client negotiated a new ATT MTU.
+         * @param MTU Negotiated MTU.
+         * @param connInfo Connection information.
+         */
+        void onMTUChange(uint16_t MTU, NimBLEConnInfo& connInfo) override {
+            if (B4RBLEServer::GetInstance()) {
+                B4RBLEServer::GetInstance()->SetPeerMTU(connInfo.getConnHandle(), MTU);
+            }
+        }
+
+        /**
+         * @brief Called when the connection parameters were updated.
+         * @param connInfo Connection information with the new parameters.
+         */
+        void onConnParamsUpdate(NimBLEConnInfo& connInfo) override {
+            if (B4RBLEServer::GetInstance()) {
+                B4RBLEServer::GetInstance()->SetLinkParams(
+                    connInfo.getConnInterval(),
+                    connInfo.getConnLatency(),
+                    connInfo.getConnTimeout());
+            }
+        }
+
+        /**
+         * @brief Called when the PHY was updated.
+         * @param connInfo Connection information.
+         * @param txPhy TX PHY (1 = 1M, 2 = 2M, 3 = Coded).
+         * @param rxPhy RX PHY.
+         */
+        void onPhyUpdate(NimBLEConnInfo& connInfo, uint8_t txPhy, uint8_t rxPhy) override {
+            if (B4RBLEServer::GetInstance()) {
+                B4RBLEServer::GetInstance()->SetLinkPhy(txPhy);
+            }
+        }
+    };
+
+    /**
+     * @brief BLE Characteristic callback for client writes.
+     *
+     * This class handles incoming byte arrays written by the BLE client
+     * to the TX characteristic.
+     */
+    class MyCallbacks : public NimBLECharacteristicCallbacks {
+    public:
+        /**
+         * @brief Invoked when a client writes data to the TX characteristic.
+         * @param pCharacteristic Pointer to NimBLECharacteristic.
+         * @param connInfo Connection information.
+         */
+        void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+            NimBLEAttValue value = pCharacteristic->getValue();
+            size_t len = value.length();
+            if (len == 0) return;
+
+            // Runs on the NimBLE host task: only enqueue, never call into B4R here
+            if (B4RBLEServer::GetInstance()) {
+                B4RBLEServer::GetInstance()->HandleDataReceived(connInfo.getConnHandle(), value.data(), len);
+            }
+
+            RLOG_D("[B4RBLEServer::onWrite] Received bytes: %u", len);
+        }
+    };
+
+    /**
+     * @brief BLE Characteristic callback for notify subscriptions.
+     *
+     * Tracks the CCCD state of the RX characteristic per client.
+     */
+    class MyRxCallbacks : public NimBLECharacteristicCallbacks {
+    public:
+        /**
+         * @brief Invoked when a client writes the CCCD of the RX characteristic.
+         * @param pCharacteristic Pointer to NimBLECharacteristic.
+         * @param connInfo Connection information.
+         * @param subValue 0 = off, 1 = notify, 2 = indicate, 3 = both.
+         */
+        void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue) override {
+            if (B4RBLEServer::GetInstance()) {
+                B4RBLEServer::GetInstance()->SetSubscribed(connInfo.getConnHandle(), (subValue & 0x0001) != 0);
+            }
+        }
+    };
+
+    /**
+     * @brief Device characteristic callback for client writes and notify subscriptions.
+     *
+     * Writes are received like writes to the TX characteristic,
+     * the CCCD state is tracked per client and device slot.
+     */
+    class MyDeviceCallbacks : public NimBLECharacteristicCallbacks {
+    public:
+        explicit MyDeviceCallbacks(uint8_t slot) : slot(slot) {}
+
+        /**
+         * @brief Invoked when a client writes a frame to the device characteristic.
+         */
+        void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo) override {
+            NimBLEAttValue value = pCharacteristic->getValue();
+            if (value.length() == 0) return;
+            if (B4RBLEServer::GetInstance()) {
+                B4RBLEServer::GetInstance()->HandleDataReceived(connInfo.getConnHandle(), value.data(), value.length());
+            }
+        }
+
+        /**
+         * @brief Invoked when a client writes the CCCD of the device characteristic.
+         */
+        void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue) override {
+            if (B4RBLEServer::GetInstance()) {
+                B4RBLEServer::GetInstance()->SetDeviceSubscribed(connInfo.getConnHandle(), slot, (subValue & 0x0001) != 0);
+            }
+        }
+
+    private:
+        uint8_t slot;
+    };
+
+    /**
+     * @brief Create the NimBLE device, UART service and characteristics.
+     * @param mtuSize Validated preferred MTU size.
+     */
+    void B4RBLEServer::BeginStack(uint16_t mtuSize) {
+        // Reset BLE to ensure clean init
+        if (NimBLEDevice::isInitialized()) {
+            NimBLEDevice::deinit(true);
+            delay(100);
+        }
+
+        NimBLEDevice::init(internalDeviceName.c_str());
+
+#if RLOG_LEVEL >= RLOG_LEVEL_INFO
+        // Formatted here: the address string does not outlive this call
+        String macStr = NimBLEDevice::getAddress().toString().c_str();
+        ::Serial.print("[B4RBLEServer::Initialize] MAC Address: ");
+        ::Serial.println(macStr.c_str());
+#endif
+
+        pServer = NimBLEDevice::createServer();
+        pServer->setCallbacks(new MyServerCallbacks());
+
+        // Create the UART-like BLE service
+        pService = pServer->createService(RBLESERVER_SERVICE_UUID);
+
+        // Characteristic for client writes (TX), with and without response
+        pCharacteristicTX = pService->createCharacteristic(
+            RBLESERVER_CHARACTERISTIC_UUID_TX,
+            NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR | NIMBLE_PROPERTY::READ
+        );
+        pCharacteristicTX->setCallbacks(new MyCallbacks());
+
+        // Characteristic for server notifications (RX), NimBLE adds the CCCD itself
+        pCharacteristicRX = pService->createCharacteristic(
+            RBLESERVER_CHARACTERISTIC_UUID_RX,
+            NIMBLE_PROPERTY::NOTIFY
+        );
+        pCharacteristicRX->setCallbacks(new MyRxCallbacks());
+
+        pService->start();
+
+        NimBLEDevice::setMTU(mtuSize);
+
+        // Set TX power to maximum (+9 dBm)
+        NimBLEDevice::setPower(9);
+    }
+
+    /**
+     * @brief Create the device service with one characteristic per registered DeviceID.
+     */
+    void B4RBLEServer::BeginDeviceService() {
+        pDeviceService = pServer->createService(RBLESERVER_DEVICE_SERVICE_UUID);
+
+        char uuid[37];
+        for (uint8_t i = 0; i < deviceCount; i++) {
+            DeviceUUID(devices[i].deviceId, uuid);
+            devices[i].pCharacteristic = pDeviceService->createCharacteristic(
+                uuid,
+                NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::READ
+                | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR
+            );
+            devices[i].pCharacteristic->setCallbacks(new MyDeviceCallbacks(i));
+        }
+
+        pDeviceService->start();
+
+        RLOG_I("[B4RBLEServer::Initialize] Device characteristics: %u", deviceCount);
+    }
+
+    /**
+     * @brief Start BLE advertising with device name and service UUID.
+     */
+    void B4RBLEServer::SetStartAdvertising() {
+        NimBLEAdvertising* pAdvertising = NimBLEDevice::getAdvertising();
+        pAdvertising->stop();
+
+        NimBLEAdvertisementData scanRespData;
+        // Name and service UUID always in the scan response (2 + name + 18 bytes of 31),
+        // so they stay visible when the advertisement is replaced (telemetry, WriteAdvertisement)
+        scanRespData.setName(internalDeviceName.c_str());
+        scanRespData.setCompleteServices(NimBLEUUID(RBLESERVER_SERVICE_UUID));
+
+        if (telemetryInterval > 0) {
+            // Telemetry record in the advertisement
+            UpdateTelemetryAdvertisement();
+        } else {
+            NimBLEAdvertisementData advData;
+            advData.setName(internalDeviceName.c_str());
+            advData.setCompleteServices(NimBLEUUID(RBLESERVER_SERVICE_UUID));
+            pAdvertising->setAdvertisementData(advData);
+        }
+        pAdvertising->setScanResponseData(scanRespData);
+
+        pAdvertising->enableScanResponse(true);
+
+        // Preferred connection interval of the link profile
+        LinkParams params;
+        if (GetLinkParams(linkProfile, params)) {
+            pAdvertising->setPreferredParams(params.minInterval, params.maxInterval);
+        } else {
+            pAdvertising->setPreferredParams(0x06, 0x12);
+        }
+
+        pAdvertising->start();
+
+        RLOG_I("[B4RBLEServer::SetStartAdvertising] Started advertising: %s", RLOG_STR(internalDeviceName.c_str()));
+    }
+
+    /**
+     * @brief Request the connection parameters, data length and PHY of the link profile.
+     * Connection parameter and PHY results arrive via onConnParamsUpdate/onPhyUpdate.
+     * NimBLE-Arduino has no data length callback, the requested length is reported.
+     */
+    void B4RBLEServer::RequestLinkProfile(uint16_t connHandle) {
+        LinkParams params;
+        if (!GetLinkParams(linkProfile, params)) return;
+
+        pServer->updateConnParams(connHandle,
+            params.minInterval, params.maxInterval, params.latency, params.timeout);
+
+        pServer->setDataLen(connHandle, LINK_DATA_LENGTH_MAX);
+        SetLinkDataLength(LINK_DATA_LENGTH_MAX);
+
+#if defined(RBLESERVER_PHY_2M)
+        pServer->updatePhy(connHandle, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK, 0);
+#endif
+    }
+
+    /**
+     * @brief Send one notification of the RX or device characteristic (TxCharacteristic) to one client.
+     * @return False if the notification could not be sent.
+     */
+    bool B4RBLEServer::NotifyConnection(uint16_t connId, const uint8_t* data, uint16_t length) {
+        return TxCharacteristic()->notify(data, length, connId);
+    }
+
+    /**
+     * @brief Update BLE advertisement manufacturer data in place.
+     * The controller accepts new advertising data while advertising.
+     * @param data Pointer to byte array containing manufacturer data.
+     */
+    void B4RBLEServer::WriteAdvertisement(ArrayByte* data) {
+        NimBLEAdvertisementData advertisementData;
+        advertisementData.setFlags(BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP);
+        advertisementData.setManufacturerData((const uint8_t*)data->data, data->length);
+        NimBLEDevice::getAdvertising()->setAdvertisementData(advertisementData);
+    }
+
+    /**
+     * @brief Set the advertisement data to flags + telemetry record, in place.
+     */
+    void B4RBLEServer::UpdateTelemetryAdvertisement() {
+        uint8_t record[BLETelemetry::RECORD_SIZE_MAX];
+        uint8_t length = telemetry.Encode(record);
+
+        NimBLEAdvertisementData advertisementData;
+        advertisementData.setFlags(BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP);
+        advertisementData.addData(record, length);
+        NimBLEDevice::getAdvertising()->setAdvertisementData(advertisementData);
+    }
+
+} // namespace B4R
+
+#endif // RBLESERVER_NIMBLE
@@ -0,0 +1,231 @@
+/**
+ * @file rCommandQueue.cpp
+ * @brief Bounded FIFO queue of received commands for B4R.
+ */
+
+#include "B4RDefines.h"
+#include "rCommandQueue.h"
+
+namespace B4R {
+
+    /**
+     * @brief Initialize the queue and register the dispatch poller.
+     */
+    void B4RCommandQueue::Initialize(Byte Depth, SubVoidByteByte CommandSub, SubVoidByte ErrorSub) {
+        this->CommandSub = CommandSub;
+        this->ErrorSub = ErrorSub;
+
+        if (Depth == 0 || Depth > RCOMMANDQUEUE_DEPTH_MAX) {
+            HandleError(ERROR_INVALID_DEPTH);
+            Depth = RCOMMANDQUEUE_DEPTH_MAX;
+        }
+        depth = Depth;
+        head = 0;
+        count = 0;
+        poolWrite = 0;
+        poolUsed = 0;
+        current.length = 0;
+        ResetCounters();
+
+        FunctionUnion fu;
+        fu.PollerFunction = looper;
+        pollers.add(fu, this);
+    }
+
+    void B4RCommandQueue::setPolicy(Byte policy) {
+        this->policy = policy;
+    }
+
+    Byte B4RCommandQueue::getPolicy() {
+        return policy;
+    }
+
+    /**
+     * @brief Copy a command into the queue, applying the full-queue policy.
+     */
+    bool B4RCommandQueue::Push(Byte Source, Byte Id, UInt Context, ArrayByte* Payload) {
+        if (Payload->length > RCOMMANDQUEUE_PAYLOAD_SIZE) {
+            Reject(Source, Id, ERROR_PAYLOAD_TOO_LARGE);
+            return false;
+        }
+
+        // Full: no free entry or not enough pool bytes
+        while (count == depth || poolUsed + Payload->length > RCOMMANDQUEUE_POOL_SIZE) {
+            if (policy != POLICY_DROP_OLDEST) {
+                Reject(Source, Id, ERROR_QUEUE_FULL);
+                return false;
+            }
+            Drop(entries[head]);
+            ReleaseHead();
+        }
+
+        Entry& e = entries[(head + count) % depth];
+        e.source = Source;
+        e.id = Id;
+        e.length = Payload->length;
+        e.context = Context;
+        e.arrivedMs = millis();
+        e.arrivedUs = micros();
+        e.offset = poolWrite;
+        PoolWrite(poolWrite, (const uint8_t*)Payload->data, Payload->length);
+        poolWrite += Payload->length;
+        poolUsed += Payload->length;
+        count++;
+
+        pushedCount++;
+        if (count > highWater) highWater = count;
+        return true;
+    }
+
+    /**
+     * @brief Count a dropped waiting command.
+     */
+    void B4RCommandQueue::Drop(const Entry& e) {
+        lastDroppedSource = e.source;
+        lastDroppedId = e.id;
+        droppedCount++;
+    }
+
+    /**
+     * @brief Count a rejected new command and raise the error.
+     */
+    void B4RCommandQueue::Reject(uint8_t source, uint8_t id, uint8_t code) {
+        lastDroppedSource = source;
+        lastDroppedId = id;
+        droppedCount++;
+        HandleError(code);
+    }
+
+    void B4RCommandQueue::ReleaseHead() {
+        // Payloads are released in the order they were written
+        poolUsed -= entries[head].length;
+        head = (head + 1) % depth;
+        count--;
+    }
+
+    void B4RCommandQueue::PoolWrite(uint32_t pos, const uint8_t* src, uint16_t len) {
+        uint32_t offset = pos % RCOMMANDQUEUE_POOL_SIZE;
+        uint32_t first = RCOMMANDQUEUE_POOL_SIZE - offset;
+        if (first > len) first = len;
+        memcpy(&pool[offset], src, first);
+        memcpy(pool, src + first, len - first);
+    }
+
+    void B4RCommandQueue::PoolRead(uint32_t pos, uint8_t* dst, uint16_t len) {
+        uint32_t offset = pos % RCOMMANDQUEUE_POOL_SIZE;
+        uint32_t first = RCOMMANDQUEUE_POOL_SIZE - offset;
+        if (first > len) first = len;
+        memcpy(dst, &pool[offset], first);
+        memcpy(dst + first, pool, len - first);
+    }
+
+    /**
+     * @brief Main loop poller: dispatch the commands waiting at poll start, oldest first.
+     * Commands queued by a Command event sub are dispatched on the next poll.
+     */
+    void B4RCommandQueue::looper(void* b) {
+        B4RCommandQueue* me = (B4RCommandQueue*)b;
+        uint8_t pending = me->count;
+
+        while (pending > 0 && me->count > 0) {
+            pending--;
+
+            // Copy out and release the slot, so new commands cannot overwrite the payload
+            me->current = me->entries[me->head];
+            me->PoolRead(me->current.offset, me->currentData, me->current.length);
+            me->ReleaseHead();
+
+            uint32_t latency = micros() - me->current.arrivedUs;
+            me->latencyLast = latency;
+            if (latency > me->latencyMax) me->latencyMax = latency;
+            me->latencySum += latency;
+            me->dispatchedCount++;
+
+            if (me->CommandSub) {
+                const UInt cp = B4R::StackMemory::cp;
+                me->CommandSub(me->current.source, me->current.id);
+                B4R::StackMemory::cp = cp;
+            }
+            me->current.length = 0;
+        }
+    }
+
+    ArrayByte* B4RCommandQueue::getPayload() {
+        ArrayByte* arr = CreateStackMemoryObject(ArrayByte);
+        arr->data = currentData;
+        arr->length = current.length;
+        return arr;
+    }
+
+    UInt B4RCommandQueue::getContext() {
+        return current.context;
+    }
+
+    ULong B4RCommandQueue::getArrivalTime() {
+        return current.arrivedMs;
+    }
+
+    Byte B4RCommandQueue::getDepth() {
+        return depth;
+    }
+
+    Byte B4RCommandQueue::getCount() {
+        return count;
+    }
+
+    Byte B4RCommandQueue::getHighWater() {
+        return highWater;
+    }
+
+    ULong B4RCommandQueue::getPushedCount() {
+        return pushedCount;
+    }
+
+    ULong B4RCommandQueue::getDispatchedCount() {
+        return dispatchedCount;
+    }
+
+    ULong B4RCommandQueue::getDroppedCount() {
+        return droppedCount;
+    }
+
+    ULong B4RCommandQueue::getLatencyLast() {
+        return latencyLast;
+    }
+
+    ULong B4RCommandQueue::getLatencyMax() {
+        return latencyMax;
+    }
+
+    ULong B4RCommandQueue::getLatencyAvg() {
+        return dispatchedCount > 0 ? (ULong)(latencySum / dispatchedCount) : 0;
+    }
+
+    Byte B4RCommandQueue::getLastDroppedSource() {
+        return lastDroppedSource;
+    }
+
+    Byte B4RCommandQueue::getLastDroppedId() {
+        return lastDroppedId;
+    }
+
+    void B4RCommandQueue::ResetCounters() {
+        pushedCount = 0;
+        dispatchedCount = 0;
+        droppedCount = 0;
+        highWater = count;
+        latencyLast = 0;
+        latencyMax = 0;
+        latencySum = 0;
+    }
+
+    /**
+     * @brief Invokes the error callback.
+     */
+    void B4RCommandQueue::HandleError(uint8_t code) {
+        if (ErrorSub) {
+            ErrorSub(code);
+        }
+    }
+
+} // namespace B4R
@@ -0,0 +1,214 @@
+/**
+ * @file rCommandQueue.h
+ * @brief Bounded FIFO queue of received commands for B4R.
+ *
+ * Received BLE frames and MQTT payloads are copied into the queue together
+ * with their source, device/topic id, a caller context (e.g. the BLE
+ * connection id to reply to) and arrival time. A poller dispatches
+ * them in arrival order from the main loop via the Command event, one at a
+ * time: the payload of the command being dispatched (Payload) stays valid
+ * until the event sub returns, even if new commands arrive meanwhile.
+ *
+ * Full-queue policy:
+ * - POLICY_REJECT_NEWEST: the new command is dropped and the Error event is
+ *   raised with ERROR_QUEUE_FULL (LastDroppedSource/LastDroppedId tell whom to notify).
+ * - POLICY_DROP_OLDEST: the oldest waiting command is dropped for the new one.
+ *
+ * Payloads are stored back to back in a shared byte pool (POOL_SIZE), so one
+ * large reassembled BLE message (up to PAYLOAD_SIZE, the BLE reassembly size)
+ * does not cost PAYLOAD_SIZE bytes per entry. The queue is full when either
+ * the entries or the pool are used up; the policy applies to both.
+ *
+ * Counters: pushed, dispatched, dropped, depth high-water and queueing latency
+ * (arrival to dispatch) last/max/average in microseconds.
+ *
+ * All methods run in the B4R main loop, the queue has no locking.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+
+/** Maximum queue depth (entries are allocated statically). */
+#ifndef RCOMMANDQUEUE_DEPTH_MAX
+#define RCOMMANDQUEUE_DEPTH_MAX 16
+#endif
+
+/**
+ * Maximum payload size per command in bytes.
+ * Same as the largest reassembled BLE message (RBLESERVER_REASSEMBLY_SIZE).
+ */
+#ifndef RCOMMANDQUEUE_PAYLOAD_SIZE
+#define RCOMMANDQUEUE_PAYLOAD_SIZE 1024
+#endif
+
+/** Payload pool shared by the waiting commands in bytes, at least PAYLOAD_SIZE. */
+#ifndef RCOMMANDQUEUE_POOL_SIZE
+#define RCOMMANDQUEUE_POOL_SIZE 2048
+#endif
+
+static_assert(RCOMMANDQUEUE_POOL_SIZE >= RCOMMANDQUEUE_PAYLOAD_SIZE, "RCOMMANDQUEUE_POOL_SIZE must hold one payload");
+
+//~Library: rCommandQueue
+//~Author: Robert W.B. Linn
+//~Brief: Bounded FIFO queue of received commands with drop policy and latency counters.
+//~Version: 1.00
+
+namespace B4R {
+
+    //~shortname: CommandQueue
+    //~Event: Command (Source As Byte, Id As Byte)
+    //~Event: Error (Code As Byte)
+    typedef void (*SubVoidByteByte)(Byte source, Byte id);
+    typedef void (*SubVoidByte)(Byte b);
+
+    class B4RCommandQueue {
+    private:
+        struct Entry {
+            uint8_t source;
+            uint8_t id;
+            uint16_t length;
+            uint16_t context;
+            uint32_t arrivedMs;
+            uint32_t arrivedUs;
+            uint32_t offset;        // Free-running position of the payload in the pool
+        };
+
+        // Ring of waiting commands
+        Entry entries[RCOMMANDQUEUE_DEPTH_MAX];
+        uint8_t depth = RCOMMANDQUEUE_DEPTH_MAX;
+        uint8_t head = 0;
+        uint8_t count = 0;
+        uint8_t policy = 0;
+
+        // Payload pool: payloads in arrival order, wrapping at the end
+        uint8_t pool[RCOMMANDQUEUE_POOL_SIZE];
+        uint32_t poolWrite = 0;
+        uint32_t poolUsed = 0;
+
+        // Copy of the command being dispatched
+        Entry current;
+        uint8_t currentData[RCOMMANDQUEUE_PAYLOAD_SIZE];
+
+        SubVoidByteByte CommandSub = nullptr;
+        SubVoidByte ErrorSub = nullptr;
+
+        // Counters
+        uint32_t pushedCount = 0;
+        uint32_t dispatchedCount = 0;
+        uint32_t droppedCount = 0;
+        uint8_t highWater = 0;
+        uint32_t latencyLast = 0;
+        uint32_t latencyMax = 0;
+        uint64_t latencySum = 0;
+        uint8_t lastDroppedSource = 0;
+        uint8_t lastDroppedId = 0;
+
+        void Drop(const Entry& e);
+        void Reject(uint8_t source, uint8_t id, uint8_t code);
+        void HandleError(uint8_t code);
+
+        // Release the oldest waiting command and its pool bytes
+        void ReleaseHead();
+
+        // Copy between a linear buffer and the pool at a free-running position
+        void PoolWrite(uint32_t pos, const uint8_t* src, uint16_t len);
+        void PoolRead(uint32_t pos, uint8_t* dst, uint16_t len);
+
+        // Main loop poller dispatching the waiting commands
+        static void looper(void* b);
+
+    public:
+        /** Command sources */
+        static const Byte SOURCE_NONE = 0;
+        static const Byte SOURCE_BLE = 1;
+        static const Byte SOURCE_MQTT = 2;
+
+        /** Full-queue policies */
+        static const Byte POLICY_REJECT_NEWEST = 0;
+        static const Byte POLICY_DROP_OLDEST = 1;
+
+        /** Error codes */
+        static const Byte ERROR_QUEUE_FULL = 1;
+        static const Byte ERROR_PAYLOAD_TOO_LARGE = 2;
+        static const Byte ERROR_INVALID_DEPTH = 3;
+
+        /** Limits */
+        static const Byte DEPTH_MAX = RCOMMANDQUEUE_DEPTH_MAX;
+        static const UInt PAYLOAD_SIZE = RCOMMANDQUEUE_PAYLOAD_SIZE;
+        static const UInt POOL_SIZE = RCOMMANDQUEUE_POOL_SIZE;
+
+        /**
+         * Initialize the queue.
+         * @param Depth Number of waiting commands, 1 to DEPTH_MAX
+         * @param CommandSub Raised per command from the main loop
+         * @param ErrorSub Raised on errors
+         */
+        void Initialize(Byte Depth, SubVoidByteByte CommandSub, SubVoidByte ErrorSub);
+
+        /**
+         * Set/Get the full-queue policy (default POLICY_REJECT_NEWEST).
+         */
+        void setPolicy(Byte policy);
+        Byte getPolicy();
+
+        /**
+         * Queue a command. The payload is copied.
+         * @param Source SOURCE_BLE or SOURCE_MQTT
+         * @param Id Device id (BLE) or topic index (MQTT)
+         * @param Context Caller value returned by Context during dispatch, e.g. the BLE connection id
+         * @param Payload Payload, at most PAYLOAD_SIZE bytes (larger: ERROR_PAYLOAD_TOO_LARGE)
+         * @return False if the command was rejected
+         */
+        bool Push(Byte Source, Byte Id, UInt Context, ArrayByte* Payload);
+
+        /** Payload of the command being dispatched (empty outside the Command event) */
+        ArrayByte* getPayload();
+
+        /** Context of the command being dispatched */
+        UInt getContext();
+
+        /** Arrival time in ms (millis) of the command being dispatched */
+        ULong getArrivalTime();
+
+        /** Queue depth */
+        Byte getDepth();
+
+        /** Number of waiting commands */
+        Byte getCount();
+
+        /** Highest number of waiting commands */
+        Byte getHighWater();
+
+        /** Number of commands queued */
+        ULong getPushedCount();
+
+        /** Number of commands dispatched */
+        ULong getDispatchedCount();
+
+        /** Number of commands dropped (rejected newest or dropped oldest) */
+        ULong getDroppedCount();
+
+        /** Queueing latency of the last dispatched command in us */
+        ULong getLatencyLast();
+
+        /** Highest queueing latency in us */
+        ULong getLatencyMax();
+
+        /** Average queueing latency in us */
+        ULong getLatencyAvg();
+
+        /** Source of the last dropped command */
+        Byte getLastDroppedSource();
+
+        /** Id of the last dropped command */
+        Byte getLastDroppedId();
+
+        /** Reset the counters */
+        void ResetCounters();
+    };
+
+} // namespace B4R
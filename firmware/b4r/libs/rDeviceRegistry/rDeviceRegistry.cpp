@@ -0,0 +1,143 @@
+/**
+ * @file rDeviceRegistry.cpp
+ * @brief Table-driven dispatch of received commands to the device handlers for B4R.
+ */
+
+#include "B4RDefines.h"
+#include "rDeviceRegistry.h"
+
+namespace B4R {
+
+    /**
+     * @brief Clear both lookup tables and the handlers.
+     */
+    void B4RDeviceRegistry::Initialize(SubVoidByte ErrorSub) {
+        this->ErrorSub = ErrorSub;
+        memset(bleTable, SLOT_NONE, sizeof(bleTable));
+        memset(mqttTable, SLOT_NONE, sizeof(mqttTable));
+        handlerCount = 0;
+        missCount = 0;
+    }
+
+    bool B4RDeviceRegistry::RegisterBLE(Byte DeviceId, SubVoidByte Handler) {
+        if (DeviceId == 0x00) {
+            HandleError(ERROR_INVALID_KEY);
+            return false;
+        }
+        return Register(bleTable, KIND_BLE, DeviceId, Handler);
+    }
+
+    bool B4RDeviceRegistry::RegisterMQTT(Byte TopicIndex, SubVoidByte Handler) {
+        if (TopicIndex == 0xFF) {
+            HandleError(ERROR_INVALID_KEY);
+            return false;
+        }
+        return Register(mqttTable, KIND_MQTT, TopicIndex, Handler);
+    }
+
+    /**
+     * @brief Add a handler slot and point the table entry of the key to it.
+     */
+    bool B4RDeviceRegistry::Register(uint8_t* table, Byte kind, Byte key, SubVoidByte sub) {
+        if (table[key] != SLOT_NONE) {
+            HandleError(ERROR_DUPLICATE);
+            return false;
+        }
+        if (handlerCount >= RDEVICEREGISTRY_MAX_HANDLERS) {
+            HandleError(ERROR_TABLE_FULL);
+            return false;
+        }
+        Handler& h = handlers[handlerCount];
+        h.sub = sub;
+        h.kind = kind;
+        h.key = key;
+        h.calls = 0;
+        h.maxUs = 0;
+        h.totalUs = 0;
+        table[key] = handlerCount++;
+        return true;
+    }
+
+    bool B4RDeviceRegistry::DispatchBLE(Byte DeviceId, Byte Arg) {
+        return Dispatch(bleTable, DeviceId, Arg);
+    }
+
+    bool B4RDeviceRegistry::DispatchMQTT(Byte TopicIndex, Byte Arg) {
+        return Dispatch(mqttTable, TopicIndex, Arg);
+    }
+
+    /**
+     * @brief Look up the handler slot of the key and call the handler, timed with micros.
+     */
+    bool B4RDeviceRegistry::Dispatch(const uint8_t* table, Byte key, Byte arg) {
+        uint8_t slot = table[key];
+        if (slot == SLOT_NONE) {
+            missCount++;
+            return false;
+        }
+        Handler& h = handlers[slot];
+
+        uint32_t start = micros();
+        const UInt cp = B4R::StackMemory::cp;
+        h.sub(arg);
+        B4R::StackMemory::cp = cp;
+        uint32_t elapsed = micros() - start;
+
+        h.calls++;
+        h.totalUs += elapsed;
+        if (elapsed > h.maxUs) h.maxUs = elapsed;
+        return true;
+    }
+
+    Byte B4RDeviceRegistry::getHandlerCount() {
+        return handlerCount;
+    }
+
+    Byte B4RDeviceRegistry::HandlerKind(Byte Index) {
+        return Index < handlerCount ? handlers[Index].kind : 0;
+    }
+
+    Byte B4RDeviceRegistry::HandlerKey(Byte Index) {
+        return Index < handlerCount ? handlers[Index].key : 0;
+    }
+
+    ULong B4RDeviceRegistry::HandlerCalls(Byte Index) {
+        return Index < handlerCount ? handlers[Index].calls : 0;
+    }
+
+    ULong B4RDeviceRegistry::HandlerTimeMs(Byte Index) {
+        return Index < handlerCount ? (ULong)(handlers[Index].totalUs / 1000) : 0;
+    }
+
+    ULong B4RDeviceRegistry::HandlerAvgUs(Byte Index) {
+        if (Index >= handlerCount || handlers[Index].calls == 0) return 0;
+        return (ULong)(handlers[Index].totalUs / handlers[Index].calls);
+    }
+
+    ULong B4RDeviceRegistry::HandlerMaxUs(Byte Index) {
+        return Index < handlerCount ? handlers[Index].maxUs : 0;
+    }
+
+    ULong B4RDeviceRegistry::getMissCount() {
+        return missCount;
+    }
+
+    void B4RDeviceRegistry::ResetStats() {
+        for (uint8_t i = 0; i < handlerCount; i++) {
+            handlers[i].calls = 0;
+            handlers[i].maxUs = 0;
+            handlers[i].totalUs = 0;
+        }
+        missCount = 0;
+    }
+
+    /**
+     * @brief Invokes the error callback.
+     */
+    void B4RDeviceRegistry::HandleError(uint8_t code) {
+        if (ErrorSub) {
+            ErrorSub(code);
+        }
+    }
+
+} // namespace B4R
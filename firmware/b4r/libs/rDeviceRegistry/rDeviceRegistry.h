@@ -0,0 +1,145 @@
+/**
+ * @file rDeviceRegistry.h
+ * @brief Table-driven dispatch of received commands to the device handlers for B4R.
+ *
+ * Each device module registers its ProcessBLE / ProcessMQTT sub against its
+ * BLE device id and MQTT topic index. Both transports dispatch through
+ * direct-indexed tables (id -> handler slot), so routing is O(1) and the
+ * BLE and MQTT routers no longer keep their own Select blocks.
+ *
+ * Per handler the number of calls, the cumulative and the highest execution
+ * time (micros) are collected on every dispatch.
+ *
+ * All methods run in the B4R main loop.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+
+/** Maximum number of registered handlers (BLE and MQTT together). */
+#ifndef RDEVICEREGISTRY_MAX_HANDLERS
+#define RDEVICEREGISTRY_MAX_HANDLERS 32
+#endif
+
+//~Library: rDeviceRegistry
+//~Author: Robert W.B. Linn
+//~Brief: O(1) dispatch of BLE device ids and MQTT topic indices to registered handlers with per-handler statistics.
+//~Version: 1.00
+
+namespace B4R {
+
+    //~shortname: DeviceRegistry
+    //~Event: Error (Code As Byte)
+    typedef void (*SubVoidByte)(Byte b);
+
+    class B4RDeviceRegistry {
+    private:
+        struct Handler {
+            SubVoidByte sub;
+            uint8_t kind;
+            uint8_t key;
+            uint32_t calls;
+            uint32_t maxUs;
+            uint64_t totalUs;
+        };
+
+        Handler handlers[RDEVICEREGISTRY_MAX_HANDLERS];
+        uint8_t handlerCount = 0;
+
+        // Key -> handler slot, SLOT_NONE if not registered
+        uint8_t bleTable[256];
+        uint8_t mqttTable[256];
+
+        uint32_t missCount = 0;
+        SubVoidByte ErrorSub = nullptr;
+
+        static const uint8_t SLOT_NONE = 0xFF;
+
+        bool Register(uint8_t* table, Byte kind, Byte key, SubVoidByte sub);
+        bool Dispatch(const uint8_t* table, Byte key, Byte arg);
+        void HandleError(uint8_t code);
+
+    public:
+        /** Handler kinds */
+        static const Byte KIND_BLE = 0;
+        static const Byte KIND_MQTT = 1;
+
+        /** Error codes */
+        static const Byte ERROR_TABLE_FULL = 1;
+        static const Byte ERROR_DUPLICATE = 2;
+        static const Byte ERROR_INVALID_KEY = 3;
+
+        /** Maximum number of handlers */
+        static const Byte MAX_HANDLERS = RDEVICEREGISTRY_MAX_HANDLERS;
+
+        /**
+         * Initialize (clear) the registry.
+         * @param ErrorSub Raised on registration errors
+         */
+        void Initialize(SubVoidByte ErrorSub);
+
+        /**
+         * Register the BLE handler of a device.
+         * @param DeviceId BLE device id 0x01-0xFF (0x00 is the transport frame id)
+         * @param Handler Sub with one Byte parameter (store index), e.g. "ProcessBLE"
+         * @return False on error (duplicate id or table full)
+         */
+        bool RegisterBLE(Byte DeviceId, SubVoidByte Handler);
+
+        /**
+         * Register the MQTT handler of a topic.
+         * @param TopicIndex Topic index 0-254 (255 is MQTTTopics.TOPIC_NOT_FOUND)
+         * @param Handler Sub with one Byte parameter (store index), e.g. "ProcessMQTT"
+         * @return False on error (invalid or duplicate index, table full)
+         */
+        bool RegisterMQTT(Byte TopicIndex, SubVoidByte Handler);
+
+        /**
+         * Call the handler registered for a BLE device id.
+         * @param DeviceId BLE device id
+         * @param Arg Passed to the handler (store index)
+         * @return False if no handler is registered (counted in MissCount)
+         */
+        bool DispatchBLE(Byte DeviceId, Byte Arg);
+
+        /**
+         * Call the handler registered for an MQTT topic index.
+         * @param TopicIndex Topic index
+         * @param Arg Passed to the handler (store index)
+         * @return False if no handler is registered (counted in MissCount)
+         */
+        bool DispatchMQTT(Byte TopicIndex, Byte Arg);
+
+        /** Number of registered handlers */
+        Byte getHandlerCount();
+
+        /** Kind (KIND_BLE or KIND_MQTT) of handler 0 to HandlerCount - 1 */
+        Byte HandlerKind(Byte Index);
+
+        /** Device id or topic index of a handler */
+        Byte HandlerKey(Byte Index);
+
+        /** Number of calls of a handler */
+        ULong HandlerCalls(Byte Index);
+
+        /** Cumulative execution time of a handler in ms */
+        ULong HandlerTimeMs(Byte Index);
+
+        /** Average execution time of a handler in us */
+        ULong HandlerAvgUs(Byte Index);
+
+        /** Highest execution time of a handler in us */
+        ULong HandlerMaxUs(Byte Index);
+
+        /** Number of dispatches without a registered handler */
+        ULong getMissCount();
+
+        /** Reset the handler statistics */
+        void ResetStats();
+    };
+
+} // namespace B4R
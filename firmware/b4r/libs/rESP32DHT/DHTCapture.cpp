@@ -0,0 +1,159 @@
+#include <math.h>
+#include "DHTCapture.h"
+
+#ifdef ESP32
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#define DHT_IRAM IRAM_ATTR
+#else
+#define DHT_IRAM
+#endif
+
+/** @brief Start pulse length in us. DHT11: at least 18 ms, DHT22: 1-10 ms. */
+static const uint32_t START_US_DHT11 = 20000;
+static const uint32_t START_US_DHT22 = 1100;
+
+/** @brief Pulse limits in us, generous against ISR latency. */
+static const uint32_t RESPONSE_MIN_US = 50;
+static const uint32_t RESPONSE_MAX_US = 120;
+static const uint32_t BIT_LOW_MIN_US = 25;
+static const uint32_t BIT_LOW_MAX_US = 100;
+static const uint32_t BIT_HIGH_MAX_US = 110;
+/** @brief High pulse threshold: 0 is 26-28 us, 1 is 70 us. */
+static const uint32_t BIT_ONE_US = 48;
+/** @brief The line is idle when no edge came for this time. */
+static const uint32_t IDLE_US = 200;
+
+static inline bool within(uint32_t value, uint32_t min, uint32_t max) {
+	return value >= min && value <= max;
+}
+
+uint8_t DHTCapture::decode(const volatile uint32_t* edges, uint8_t count, bool dht22, float& temperature, float& humidity) {
+	temperature = NAN;
+	humidity = NAN;
+	if (count < EDGES_DATA) return ERROR_TIMEOUT;
+
+	// Response: falling edge, 80 us low, 80 us high. Edge 0 may be the release of the start pulse (20-40 us before).
+	int8_t first = -1;
+	for (uint8_t s = 0; s <= 1 && s + EDGES_DATA <= count; s++) {
+		if (within(edges[s + 1] - edges[s], RESPONSE_MIN_US, RESPONSE_MAX_US)
+			&& within(edges[s + 2] - edges[s + 1], RESPONSE_MIN_US, RESPONSE_MAX_US)) {
+			first = s;
+			break;
+		}
+	}
+	if (first < 0) return ERROR_TIMING;
+
+	// 40 bits, each a low pulse (falling to rising) and a high pulse (rising to falling)
+	uint8_t data[5] = { 0, 0, 0, 0, 0 };
+	const volatile uint32_t* e = edges + first + 2;
+	for (uint8_t i = 0; i < 40; i++) {
+		uint32_t low = e[2 * i + 1] - e[2 * i];
+		uint32_t high = e[2 * i + 2] - e[2 * i + 1];
+		if (!within(low, BIT_LOW_MIN_US, BIT_LOW_MAX_US) || high > BIT_HIGH_MAX_US) return ERROR_TIMING;
+		data[i >> 3] = (data[i >> 3] << 1) | (high > BIT_ONE_US ? 1 : 0);
+	}
+
+	if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4]) return ERROR_CHECKSUM;
+
+	if (dht22) {
+		humidity = ((data[0] << 8) | data[1]) * 0.1f;
+		int16_t raw = ((data[2] & 0x7F) << 8) | data[3];
+		temperature = ((data[2] & 0x80) ? -raw : raw) * 0.1f;
+	} else {
+		// Integer part only, as DHTesp
+		humidity = data[0];
+		temperature = data[2];
+	}
+	return ERROR_NONE;
+}
+
+#ifdef ESP32
+
+void DHTCapture::setup(uint8_t pin, bool dht22) {
+	this->pin = pin;
+	this->dht22 = dht22;
+	state = STATE_IDLE;
+
+	// The ISR stays attached, it records only while capturing.
+	// The start pulse switches the direction only, so the pull-up and the interrupt type are kept.
+	pinMode(pin, INPUT_PULLUP);
+	attachInterruptArg(pin, edge, this, CHANGE);
+
+	if (timer == nullptr) {
+		esp_timer_create_args_t args = {};
+		args.callback = release;
+		args.arg = this;
+		args.name = "dht";
+		esp_timer_handle_t handle;
+		if (esp_timer_create(&args, &handle) == ESP_OK) timer = handle;
+	}
+}
+
+bool DHTCapture::start() {
+	if (state != STATE_IDLE || timer == nullptr) return false;
+	count = 0;
+	state = STATE_START;
+	gpio_set_level((gpio_num_t)pin, 0);
+	gpio_set_direction((gpio_num_t)pin, GPIO_MODE_INPUT_OUTPUT);
+	esp_timer_start_once((esp_timer_handle_t)timer, dht22 ? START_US_DHT22 : START_US_DHT11);
+	return true;
+}
+
+/**
+ * @brief Timer callback (esp_timer task): release the line, the sensor answers within 20-40 us.
+ */
+void DHTCapture::release(void* arg) {
+	DHTCapture* me = (DHTCapture*)arg;
+	me->released = (uint32_t)esp_timer_get_time();
+	me->state = STATE_CAPTURE;
+	gpio_set_direction((gpio_num_t)me->pin, GPIO_MODE_INPUT);
+}
+
+/**
+ * @brief Edge ISR: store the time only.
+ */
+void DHT_IRAM DHTCapture::edge(void* arg) {
+	DHTCapture* me = (DHTCapture*)arg;
+	if (me->state != STATE_CAPTURE || me->count >= EDGES_MAX) return;
+	me->edges[me->count] = (uint32_t)esp_timer_get_time();
+	me->count = me->count + 1;
+}
+
+bool DHTCapture::poll() {
+	if (state != STATE_CAPTURE) return false;
+	uint32_t now = (uint32_t)esp_timer_get_time();
+	uint8_t n = count;
+	bool idle = n >= EDGES_DATA && now - edges[n - 1] > IDLE_US;
+	if (!idle && now - released < CAPTURE_TIMEOUT_US) return false;
+
+	state = STATE_IDLE;
+	edgeCount = n;
+	error = decode(edges, n, dht22, temperature, humidity);
+	return true;
+}
+
+#else
+
+// Capture requires the ESP32 GPIO ISR and esp_timer, other targets report a timeout.
+void DHTCapture::setup(uint8_t pin, bool dht22) {
+	this->pin = pin;
+	this->dht22 = dht22;
+}
+
+bool DHTCapture::start() {
+	error = ERROR_TIMEOUT;
+	return false;
+}
+
+bool DHTCapture::poll() {
+	return false;
+}
+
+void DHTCapture::release(void*) {
+}
+
+void DHTCapture::edge(void*) {
+}
+
+#endif
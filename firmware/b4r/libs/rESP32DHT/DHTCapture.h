@@ -0,0 +1,96 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#ifdef ARDUINO
+#include "Arduino.h"
+#endif
+
+/**
+ * @file DHTCapture.h
+ * @brief Non-blocking DHT11 & DHT22 reader: timer-driven start pulse, edge timestamps captured by a GPIO ISR,
+ * bits decoded afterwards on the main loop.
+ * @note DHTesp::readSensor busy-waits about 5 ms with interrupts disabled. Here interrupts stay enabled,
+ * the ISR only stores the time of each edge (CHANGE) and the main loop decodes the pulse widths.
+ * @note Read sequence (ESP32):
+ * 1. Start: the line is driven low, an esp_timer one-shot releases it after 20 ms (DHT11) or 1.1 ms (DHT22).
+ * 2. Capture: the sensor answers with 80 us low, 80 us high, then 40 bits (50 us low, 26-28 us high = 0, 70 us high = 1).
+ * 3. Decode: once the line is idle or after CAPTURE_TIMEOUT_US the edges are decoded (Decode, host testable).
+ * @version 1.0
+ * @date 2026-10-17
+ * @author Robert W. B. Linn (c) 2026 — MIT License
+ */
+
+class DHTCapture {
+	public:
+		/** @brief Read result. */
+		static const uint8_t ERROR_NONE = 0;
+		/** @brief Too few edges, sensor not connected or not answering. */
+		static const uint8_t ERROR_TIMEOUT = 1;
+		/** @brief Checksum mismatch. */
+		static const uint8_t ERROR_CHECKSUM = 2;
+		/** @brief A pulse out of the DHT timing, e.g. a missed edge. */
+		static const uint8_t ERROR_TIMING = 3;
+
+		/** @brief Edges of a read: start pulse release, 3 response edges, 80 bit edges, end of transmission + spare. */
+		static const uint8_t EDGES_MAX = 88;
+		/** @brief Edges needed to decode: 3 response edges + 80 bit edges. */
+		static const uint8_t EDGES_DATA = 83;
+		/** @brief Maximum transmission time after the start pulse release. */
+		static const uint32_t CAPTURE_TIMEOUT_US = 6000;
+
+		/**
+		 * @brief Set up the pin and the release timer.
+		 * @param pin - Data pin.
+		 * @param dht22 - True for DHT22 (short start pulse and 0.1 resolution).
+		 */
+		void setup(uint8_t pin, bool dht22);
+
+		/**
+		 * @brief Start a read: drive the line low, the timer releases it and arms the capture.
+		 * @return False if a read is in progress.
+		 */
+		bool start();
+
+		/**
+		 * @brief Check a read in progress, call from the main loop.
+		 * @return True once when the read is complete, the result is in error, temperature and humidity.
+		 */
+		bool poll();
+
+		/** @brief True while a read is in progress. */
+		bool busy() { return state != STATE_IDLE; }
+
+		/**
+		 * @brief Decode captured edge timestamps.
+		 * @param edges - Time of each edge in us. The first edge may be the release of the start pulse.
+		 * @param count - Number of edges.
+		 * @param dht22 - True for DHT22 data format.
+		 * @param temperature - Temperature in Celsius, NAN on error.
+		 * @param humidity - Relative humidity in %, NAN on error.
+		 * @return ERROR_NONE, ERROR_TIMEOUT, ERROR_TIMING or ERROR_CHECKSUM.
+		 */
+		static uint8_t decode(const volatile uint32_t* edges, uint8_t count, bool dht22, float& temperature, float& humidity);
+
+		/** @brief Result of the last read. */
+		float temperature = NAN;
+		float humidity = NAN;
+		uint8_t error = ERROR_TIMEOUT;
+		/** @brief Edges captured by the last read. */
+		uint8_t edgeCount = 0;
+
+	private:
+		static const uint8_t STATE_IDLE = 0;
+		static const uint8_t STATE_START = 1;
+		static const uint8_t STATE_CAPTURE = 2;
+
+		uint8_t pin = 0;
+		bool dht22 = false;
+		volatile uint8_t state = STATE_IDLE;
+		volatile uint8_t count = 0;
+		volatile uint32_t released = 0;
+		volatile uint32_t edges[EDGES_MAX];
+		void* timer = nullptr;
+
+		static void release(void* arg);
+		static void edge(void* arg);
+};
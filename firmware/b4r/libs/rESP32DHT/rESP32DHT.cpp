@@ -12,26 +12,44 @@ namespace B4R {
 			// Optional: fallback safety
 			dht.setup(Pin, DHTesp::DHT11);
 		}
+		capture.setup(Pin, Mode == DHT22);
 
 		// Initialize internal state
 		tempprev = NAN;       // Ensures first reading always fires event
 		humprev  = NAN;
+		temperature = NAN;
+		humidity = NAN;
 		eventenabled = true;
-		lastEvent = 0;
+		backend = BACKEND_CAPTURE;
+		retried = false;
+		readCount = 0;
+		errorCount = 0;
+		filters[CHANNEL_TEMPERATURE].Initialize();
+		filters[CHANNEL_HUMIDITY].Initialize();
+		eventCount = 0;
+		suppressedCount = 0;
 
 		// Register event callback
 		this->StateChangedSub = StateChangedSub;
-		
-		FunctionUnion fu;
-		fu.PollerFunction = looper;
-		pollers.add(fu, this);
+
+		// Read every sampling period, first read staggered against the other sensors
+		readJob = B4RScheduler::Every(looper, this, ReadPeriod(), READ_BUDGET_US);
+		decodeJob = B4RScheduler::Once(decoder, this, 0, DECODE_BUDGET_US);
+	}
+
+	ULong B4RESP32DHT::ReadPeriod() {
+		// DHT11 1 Hz, DHT22 0.5 Hz; DHTesp as before every 500 ms
+		if (backend == BACKEND_DHTESP) return 500;
+		return dht.getMinimumSamplingPeriod();
 	}
 
 	float B4RESP32DHT::Humidity(){
+		if (backend == BACKEND_CAPTURE) return humidity;
 		return dht.getHumidity();
 	}
 
 	float B4RESP32DHT::Temperature(){
+		if (backend == BACKEND_CAPTURE) return temperature;
 		return dht.getTemperature();
 	}
 
@@ -42,31 +60,136 @@ namespace B4R {
 		return eventenabled;
 	}
 
-	// Event
+	void B4RESP32DHT::setBackend(Byte backend) {
+		// Switch between reads only
+		if (capture.busy()) return;
+		this->backend = backend == BACKEND_DHTESP ? BACKEND_DHTESP : BACKEND_CAPTURE;
+		B4RScheduler::SetPeriod(readJob, ReadPeriod());
+	}
+	Byte B4RESP32DHT::getBackend() {
+		return backend;
+	}
+
+	ULong B4RESP32DHT::getReadCount() {
+		return readCount;
+	}
+
+	ULong B4RESP32DHT::getErrorCount() {
+		return errorCount;
+	}
+
+	Byte B4RESP32DHT::getLastError() {
+		return capture.error;
+	}
+
+	void B4RESP32DHT::SetFilter(Byte Channel, Byte Median, Double Alpha) {
+		if (Channel > CHANNEL_HUMIDITY) return;
+		filters[Channel].SetMedian(Median);
+		filters[Channel].setAlpha(Alpha);
+	}
+
+	void B4RESP32DHT::SetDeadband(Byte Channel, Double Absolute, Double Relative, Double Hysteresis) {
+		if (Channel > CHANNEL_HUMIDITY) return;
+		filters[Channel].SetDeadband(Absolute, Relative, Hysteresis);
+	}
+
+	void B4RESP32DHT::setMinInterval(ULong ms) {
+		filters[CHANNEL_TEMPERATURE].setMinInterval(ms);
+		filters[CHANNEL_HUMIDITY].setMinInterval(ms);
+	}
+	ULong B4RESP32DHT::getMinInterval() {
+		return filters[CHANNEL_TEMPERATURE].getMinInterval();
+	}
+
+	void B4RESP32DHT::setMaxInterval(ULong ms) {
+		filters[CHANNEL_TEMPERATURE].setMaxInterval(ms);
+		filters[CHANNEL_HUMIDITY].setMaxInterval(ms);
+	}
+	ULong B4RESP32DHT::getMaxInterval() {
+		return filters[CHANNEL_TEMPERATURE].getMaxInterval();
+	}
+
+	ULong B4RESP32DHT::getEventCount() {
+		return eventCount;
+	}
+
+	ULong B4RESP32DHT::getSuppressedCount() {
+		return suppressedCount;
+	}
+
+	ULong B4RESP32DHT::getHeartbeatCount() {
+		// Both filters report together, the temperature filter counts the heartbeats
+		return filters[CHANNEL_TEMPERATURE].getHeartbeatCount();
+	}
+
+	// Read job
 	void B4RESP32DHT::looper(void* b) {
-		
+
+		B4RESP32DHT* me = (B4RESP32DHT*)b;
+
+		if (me->backend == BACKEND_CAPTURE) {
+			// Read also with the event disabled, Temperature and Humidity return the last values
+			if (me->capture.busy() || !me->capture.start()) return;
+			// Start pulse (DHT11 20 ms, DHT22 1.1 ms) and transmission (max 6 ms), then decode
+			B4RScheduler::Schedule(me->decodeJob, me->dht.getModel() == DHTesp::DHT22 ? 8 : 27);
+			return;
+		}
+
+		if (!me->getEventEnabled()) return;
+		// Read the sensor values
+		me->Report(me->Temperature(), me->Humidity());
+	}
+
+	// Decode job, BACKEND_CAPTURE
+	void B4RESP32DHT::decoder(void* b) {
+
 		B4RESP32DHT* me = (B4RESP32DHT*)b;
-		
-		if (me->lastEvent + 500 > millis())
+		if (!me->capture.busy()) return;
+		// Still receiving: the line is not idle yet
+		if (!me->capture.poll()) {
+			B4RScheduler::Schedule(me->decodeJob, 1);
 			return;
-		me->lastEvent = millis();
-
-		// Check if the event is enabled
-		if (me->getEventEnabled()) {
-			// Read the sensor values
-			float temp = me->Temperature();
-			float hum = me->Humidity();
-
-			// Call the event if temp or hum has changed
-			if (temp != me->tempprev || hum != me->humprev) {
-				const UInt cp = B4R::StackMemory::cp;
-				
-				me->StateChangedSub(temp, hum);
-				B4R::StackMemory::cp = cp;
-				
-				me->tempprev = temp;
-				me->humprev = hum;
+		}
+
+		me->readCount++;
+		if (me->capture.error != DHTCapture::ERROR_NONE) {
+			me->errorCount++;
+			// Keep the last values for one failed read, the next read is the retry
+			if (!me->retried) {
+				me->retried = true;
+				return;
 			}
+		} else {
+			me->retried = false;
+		}
+		// The getters return the read, the event the filtered value
+		me->temperature = me->capture.temperature;
+		me->humidity = me->capture.humidity;
+		me->Report(me->temperature, me->humidity);
+	}
+
+	// Event
+	void B4RESP32DHT::Report(float temp, float hum) {
+
+		// Call the event if the filtered temp or hum left its deadband, or for the heartbeat.
+		// Both values are reported together.
+		ULong now = millis();
+		bool tempDue = filters[CHANNEL_TEMPERATURE].Sample(temp, now);
+		bool humDue = filters[CHANNEL_HUMIDITY].Sample(hum, now);
+		if (!tempDue && !humDue) {
+			suppressedCount++;
+			return;
+		}
+		filters[CHANNEL_TEMPERATURE].Commit(now);
+		filters[CHANNEL_HUMIDITY].Commit(now);
+		tempprev = filters[CHANNEL_TEMPERATURE].getValue();
+		humprev = filters[CHANNEL_HUMIDITY].getValue();
+		if (getEventEnabled()) {
+			eventCount++;
+			const UInt cp = B4R::StackMemory::cp;
+
+			StateChangedSub(tempprev, humprev);
+			B4R::StackMemory::cp = cp;
 		}
 	}
-}
\ No newline at end of file
+}
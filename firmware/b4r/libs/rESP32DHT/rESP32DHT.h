@@ -1,19 +1,28 @@
 #pragma once
 #include "B4RDefines.h"
 #include "DHTesp.h"
+#include "DHTCapture.h"
+#include "rSensorFilter.h"
+#include "rScheduler.h"
 
 /**
  * @file rESP32DHT.h
  * @brief B4R C++ wrapper for the DHT11 & DHT22 sensors connected to ESP32.
  * @note This B4R Library is partly wrapped from project https://github.com/beegee-tokyo/arduino-DHTesp. Thanks to the author.
  * @note Tested with the Keyestudio DHT11.
- * @version 1.0
- * @date 2025-11-20
+ * @note Backend BACKEND_CAPTURE (default) reads without blocking: timer-driven start pulse, edges captured by a GPIO ISR,
+ * decoded on the main loop (DHTCapture). BACKEND_DHTESP reads with DHTesp, which busy-waits about 5 ms with interrupts disabled.
+ * @note StateChanged is raised when the filtered temperature or humidity leaves its deadband (rSensorFilter, SetFilter,
+ * SetDeadband, MinInterval, MaxInterval). Without settings every change is raised.
+ * @note Reads are jobs of rScheduler: a read every sampling period (DHT11 1 s, DHT22 2 s, BACKEND_DHTESP 500 ms),
+ * the capture is decoded by a one-shot job when the transmission is over. No poller runs on every main loop pass.
+ * @version 1.03
+ * @date 2026-10-17
  * @author Robert W. B. Linn (c) 2025 — MIT License
  */
 
 namespace B4R {
-	//~Version: 1.00
+	//~Version: 1.03
 	//~Shortname: ESP32DHT
 	//~Event: StateChanged (Temperature As Float, Humidity As Float)
 	class B4RESP32DHT {
@@ -23,20 +32,42 @@ namespace B4R {
 		private:
 			/** @brief Declare object from DHTesp.h. */
 			DHTesp dht;
+
+			/** @brief Non-blocking reader, see DHTCapture.h. */
+			DHTCapture capture;
+			Byte backend;
+			bool retried;
+
+			/** @brief Read counters (capture backend). */
+			ULong readCount;
+			ULong errorCount;
+
+			/** @brief Filter per value, the event reports both when one is due. */
+			B4RSensorFilter filters[2];
+			ULong eventCount;
+			ULong suppressedCount;
 			
 			/** @brief Store the prev value.*/
 			float tempprev;
 			float humprev;
 
+			/** @brief Last decoded values (capture backend), returned by Temperature and Humidity. */
+			float temperature;
+			float humidity;
+
 			/** @brief Event-enabled flag (instance specific). */
 			bool eventenabled;
 
-			/** @brief Per-instance event timer. */
-			UInt lastEvent = 0;
+			/** @brief Scheduler jobs: read every sampling period, decode after the transmission. */
+			Byte readJob;
+			Byte decodeJob;
 
 			/** @brief Callback event state changed. */
 			SubVoidFloatFloat StateChangedSub;
 			static void looper(void* b);
+			static void decoder(void* b);
+			void Report(float temp, float hum);
+			ULong ReadPeriod();
 
 		public:
 
@@ -51,15 +82,85 @@ namespace B4R {
 			/**
 			 * @brief Read temperature from DHT (Celsius).
 			 * @note Returns nan if there was a failure.
+			 * @note BACKEND_CAPTURE returns the value of the last read (no blocking read), unfiltered and
+			 * also when no event was raised. A single failed read keeps the previous value.
 			 */
 			float Temperature();	
 
 			/**
 			 * @brief Read Humidity as Percentage from DHT.
 			 * @note Returns nan if there was a failure.
+			 * @note BACKEND_CAPTURE returns the value of the last read (no blocking read), unfiltered and
+			 * also when no event was raised. A single failed read keeps the previous value.
 			 */
 			float Humidity();
 
+			/**
+			 * @brief Set/Get the acquisition backend BACKEND_CAPTURE (default) or BACKEND_DHTESP.
+			 */
+			void setBackend(Byte backend);
+			Byte getBackend(void);
+
+			/**
+			 * @brief Number of reads (BACKEND_CAPTURE).
+			 */
+			ULong getReadCount(void);
+
+			/**
+			 * @brief Number of failed reads. One failed read keeps the last values, the next read is the retry (BACKEND_CAPTURE).
+			 */
+			ULong getErrorCount(void);
+
+			/**
+			 * @brief Result of the last read: ERROR_NONE, ERROR_TIMEOUT, ERROR_CHECKSUM or ERROR_TIMING.
+			 */
+			Byte getLastError(void);
+
+			/**
+			 * @brief Set the noise filter of a value.
+			 * @param Channel - CHANNEL_TEMPERATURE or CHANNEL_HUMIDITY.
+			 * @param Median - Median of the last N reads, odd, 1 = off (max 7).
+			 * @param Alpha - EMA factor 0 < Alpha <= 1, 1 = off.
+			 */
+			void SetFilter(Byte Channel, Byte Median, Double Alpha);
+
+			/**
+			 * @brief Set the deadband of a value: StateChanged is raised when the value moved at least
+			 * max(Absolute, Relative * |last value|), against the last direction Hysteresis more.
+			 * @param Channel - CHANNEL_TEMPERATURE or CHANNEL_HUMIDITY.
+			 * @param Absolute - Minimum change (Celsius or %), 0 = any change.
+			 * @param Relative - Minimum change as fraction of the last value, e.g. 0.02 = 2 %.
+			 * @param Hysteresis - Extra change against the direction of the last event.
+			 */
+			void SetDeadband(Byte Channel, Double Absolute, Double Relative, Double Hysteresis);
+
+			/**
+			 * @brief Set/Get the minimum time between two events in ms (rate limit), 0 = off (default).
+			 */
+			void setMinInterval(ULong ms);
+			ULong getMinInterval(void);
+
+			/**
+			 * @brief Set/Get the maximum time between two events in ms (heartbeat), 0 = off (default).
+			 */
+			void setMaxInterval(ULong ms);
+			ULong getMaxInterval(void);
+
+			/**
+			 * @brief Number of StateChanged events.
+			 */
+			ULong getEventCount(void);
+
+			/**
+			 * @brief Number of reads without event (no change beyond the deadband or rate limited).
+			 */
+			ULong getSuppressedCount(void);
+
+			/**
+			 * @brief Number of heartbeat events (MaxInterval without change).
+			 */
+			ULong getHeartbeatCount(void);
+
 			/**
 			 * @brief Set/Get enabled state change event.
 			 */
@@ -73,6 +174,21 @@ namespace B4R {
 			const Byte DHT11 = 0;
 			 /** @brief DHT22 mode. */
 			const Byte DHT22 = 1;
+			 /** @brief Non-blocking backend: edge capture by ISR, decoded on the main loop. */
+			static const Byte BACKEND_CAPTURE = 0;
+			 /** @brief Blocking backend DHTesp (interrupts disabled during the read). */
+			static const Byte BACKEND_DHTESP = 1;
+			 /** @brief Filter channels. */
+			static const Byte CHANNEL_TEMPERATURE = 0;
+			static const Byte CHANNEL_HUMIDITY = 1;
+			 /** @brief Read results. */
+			static const Byte ERROR_NONE = DHTCapture::ERROR_NONE;
+			static const Byte ERROR_TIMEOUT = DHTCapture::ERROR_TIMEOUT;
+			static const Byte ERROR_CHECKSUM = DHTCapture::ERROR_CHECKSUM;
+			static const Byte ERROR_TIMING = DHTCapture::ERROR_TIMING;
+			 /** @brief CPU budget of the jobs in us (the decode job includes the StateChanged event). */
+			static const ULong READ_BUDGET_US = 500;
+			static const ULong DECODE_BUDGET_US = 5000;
 
 	};
 }
\ No newline at end of file
@@ -0,0 +1,49 @@
+/**
+ * @file EdgeFilter.cpp
+ * @brief Edge queue and debouncer of rGpioInput.
+ */
+
+#include "EdgeFilter.h"
+
+void EdgeDebouncer::begin(uint8_t level, uint32_t now) {
+    state = level;
+    this->level = level;
+    bursting = false;
+    lastEdge = now;
+    burstStart = now;
+    changedAt = now;
+    duration = 0;
+}
+
+bool EdgeDebouncer::edge(uint8_t level, uint32_t time) {
+    edgeCount++;
+    // The burst before this edge may be over
+    bool accepted = settle(time);
+
+    if (!bursting) {
+        bursting = true;
+        burstStart = time;
+    } else {
+        bounceCount++;
+    }
+    // Same level again: the opposite edge was too short for the ISR to read
+    if (level == this->level) bounceCount++;
+    this->level = level;
+    lastEdge = time;
+    return accepted;
+}
+
+bool EdgeDebouncer::settle(uint32_t now) {
+    if (!bursting || now - lastEdge < debounce) return false;
+    bursting = false;
+    if (level == state) {
+        // Back to the accepted level: a glitch or a pulse shorter than the debounce time
+        glitchCount++;
+        return false;
+    }
+    duration = burstStart - changedAt;
+    changedAt = burstStart;
+    state = level;
+    eventCount++;
+    return true;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file EdgeFilter.h
+ * @brief Edge queue and debouncer of rGpioInput. Plain C++, no Arduino, tested on Linux
+ * (bench/rGpioInput).
+ *
+ * EdgeRing: single producer (GPIO ISR), single consumer (main loop) ring of
+ * timestamped edges. The ISR writes the entry, then the head; the main loop
+ * reads the entry, then moves the tail. No lock, no critical section. A full
+ * ring drops the edge and counts it; the consumer then reads the pin again.
+ *
+ * EdgeDebouncer: edges less than Debounce us apart form a burst. When no edge
+ * came for Debounce us the burst is over and its last level is accepted. The
+ * event carries the time of the first edge of the burst, so the change time is
+ * accurate to the ISR latency, not to the debounce time or the main loop.
+ * Edges after the first of a burst are counted as bounces, a burst that ends at
+ * the accepted level (spike, pulse shorter than Debounce) as glitch, no event.
+ * Works on timestamps only: edges queued during a long handler are filtered
+ * the same way when the main loop gets to them.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include <stdint.h>
+
+/** Edges queued per pin, power of two. */
+#ifndef RGPIOINPUT_QUEUE_SIZE
+#define RGPIOINPUT_QUEUE_SIZE 32
+#endif
+
+class EdgeRing {
+public:
+    static const uint8_t SIZE = RGPIOINPUT_QUEUE_SIZE;
+
+    struct Edge {
+        uint32_t time;      // us
+        uint8_t level;
+    };
+
+    /** ISR: queue an edge. @return False if full (edge dropped). */
+    bool push(uint32_t time, uint8_t level) {
+        uint8_t h = head;
+        if ((uint8_t)(h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE)) >= SIZE) {
+            dropped = dropped + 1;
+            return false;
+        }
+        edges[h & (SIZE - 1)].time = time;
+        edges[h & (SIZE - 1)].level = level;
+        __atomic_store_n(&head, (uint8_t)(h + 1), __ATOMIC_RELEASE);
+        return true;
+    }
+
+    /** Main loop: take the oldest edge. @return False if empty. */
+    bool pop(Edge& edge) {
+        uint8_t t = tail;
+        if (__atomic_load_n(&head, __ATOMIC_ACQUIRE) == t) return false;
+        edge.time = edges[t & (SIZE - 1)].time;
+        edge.level = edges[t & (SIZE - 1)].level;
+        __atomic_store_n(&tail, (uint8_t)(t + 1), __ATOMIC_RELEASE);
+        return true;
+    }
+
+    bool empty() const { return __atomic_load_n(&head, __ATOMIC_ACQUIRE) == tail; }
+
+    uint8_t pending() const { return (uint8_t)(__atomic_load_n(&head, __ATOMIC_ACQUIRE) - tail); }
+
+    /** Edges dropped because the ring was full (written by the ISR). */
+    volatile uint32_t dropped = 0;
+
+private:
+    Edge edges[SIZE];
+    uint8_t head = 0;
+    uint8_t tail = 0;
+};
+
+class EdgeDebouncer {
+public:
+    /** Start with an accepted level at time now. */
+    void begin(uint8_t level, uint32_t now);
+
+    /**
+     * Process an edge to level at time (us), in time order.
+     * @return True if the burst before this edge ended with a change (event in state / changedAt / duration)
+     */
+    bool edge(uint8_t level, uint32_t time);
+
+    /**
+     * End the burst if no edge came for Debounce us at time now (us).
+     * @return True if the burst ended with a change (event)
+     */
+    bool settle(uint32_t now);
+
+    /** True during a burst: settle must be called again. */
+    bool busy() const { return bursting; }
+
+    /** Debounce time in us. */
+    uint32_t debounce = 20000;
+
+    /** Accepted level. */
+    uint8_t state = 0;
+    /** Time of the first edge of the accepted change (us). */
+    uint32_t changedAt = 0;
+    /** Time the previous accepted level lasted (us). */
+    uint32_t duration = 0;
+
+    // Counters
+    uint32_t edgeCount = 0;
+    uint32_t bounceCount = 0;
+    uint32_t glitchCount = 0;
+    uint32_t eventCount = 0;
+
+private:
+    uint8_t level = 0;          // Level after the last edge
+    bool bursting = false;
+    uint32_t lastEdge = 0;
+    uint32_t burstStart = 0;    // First edge of the burst
+};
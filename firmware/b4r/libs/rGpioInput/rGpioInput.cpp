@@ -0,0 +1,131 @@
+/**
+ * @file rGpioInput.cpp
+ * @brief Interrupt driven digital input with debouncing for B4R.
+ */
+
+#include "B4RDefines.h"
+#include "rGpioInput.h"
+
+#ifdef ESP32
+#include "esp_timer.h"
+#include "hal/gpio_ll.h"
+#define RGPIOINPUT_IRAM IRAM_ATTR
+#else
+#define RGPIOINPUT_IRAM
+#endif
+
+namespace B4R {
+
+    uint32_t RGPIOINPUT_IRAM B4RGpioInput::Micros() {
+#ifdef ESP32
+        return (uint32_t)esp_timer_get_time();
+#else
+        return micros();
+#endif
+    }
+
+    void B4RGpioInput::Initialize(Byte Pin, Byte Mode, SubVoidBool StateChangedSub) {
+        pin = Pin;
+        pinMode(pin, Mode == MODE_INPUT_PULLUP ? INPUT_PULLUP : Mode == MODE_INPUT_PULLDOWN ? INPUT_PULLDOWN : INPUT);
+        this->StateChangedSub = StateChangedSub;
+
+        // The level at start is the state, no event
+        debouncer.begin(digitalRead(pin), Micros());
+        droppedSeen = ring.dropped;
+        attachInterruptArg(pin, edge, this, CHANGE);
+
+        FunctionUnion fu;
+        fu.PollerFunction = looper;
+        pollers.add(fu, this);
+    }
+
+    /**
+     * Edge ISR: store the time and the level only.
+     */
+    void RGPIOINPUT_IRAM B4RGpioInput::edge(void* arg) {
+        B4RGpioInput* me = (B4RGpioInput*)arg;
+#ifdef ESP32
+        uint8_t level = gpio_ll_get_level(GPIO_LL_GET_HW(GPIO_PORT_0), (gpio_num_t)me->pin);
+#else
+        uint8_t level = digitalRead(me->pin);
+#endif
+        me->ring.push(Micros(), level);
+    }
+
+    void B4RGpioInput::looper(void* b) {
+        B4RGpioInput* me = (B4RGpioInput*)b;
+        // Nothing queued and no burst to end
+        if (me->ring.empty() && !me->debouncer.busy() && me->ring.dropped == me->droppedSeen) return;
+
+        // Edges in time order, also those queued while a handler ran
+        EdgeRing::Edge e;
+        while (me->ring.pop(e)) {
+            if (me->debouncer.edge(e.level, e.time)) me->Raise();
+        }
+        // Queue was full: continue from the level of the pin
+        if (me->ring.dropped != me->droppedSeen) {
+            me->droppedSeen = me->ring.dropped;
+            if (me->debouncer.edge(digitalRead(me->pin), Micros())) me->Raise();
+        }
+        if (me->debouncer.settle(Micros())) me->Raise();
+    }
+
+    void B4RGpioInput::Raise() {
+        const UInt cp = B4R::StackMemory::cp;
+        StateChangedSub(debouncer.state != 0);
+        B4R::StackMemory::cp = cp;
+    }
+
+    bool B4RGpioInput::getState() {
+        return debouncer.state != 0;
+    }
+
+    bool B4RGpioInput::Read() {
+        return digitalRead(pin) != 0;
+    }
+
+    void B4RGpioInput::setDebounceMicros(ULong us) {
+        debouncer.debounce = us;
+    }
+    ULong B4RGpioInput::getDebounceMicros() {
+        return debouncer.debounce;
+    }
+
+    ULong B4RGpioInput::getChangedMicros() {
+        return debouncer.changedAt;
+    }
+
+    ULong B4RGpioInput::getDuration() {
+        return debouncer.duration;
+    }
+
+    ULong B4RGpioInput::getEdgeCount() {
+        return debouncer.edgeCount;
+    }
+
+    ULong B4RGpioInput::getBounceCount() {
+        return debouncer.bounceCount;
+    }
+
+    ULong B4RGpioInput::getGlitchCount() {
+        return debouncer.glitchCount;
+    }
+
+    ULong B4RGpioInput::getEventCount() {
+        return debouncer.eventCount;
+    }
+
+    ULong B4RGpioInput::getDroppedCount() {
+        return ring.dropped;
+    }
+
+    void B4RGpioInput::ResetCounters() {
+        debouncer.edgeCount = 0;
+        debouncer.bounceCount = 0;
+        debouncer.glitchCount = 0;
+        debouncer.eventCount = 0;
+        ring.dropped = 0;
+        droppedSeen = 0;
+    }
+
+} // namespace B4R
@@ -0,0 +1,105 @@
+/**
+ * @file rGpioInput.h
+ * @brief Interrupt driven digital input with debouncing for B4R.
+ *
+ * Replaces Pin.AddListener plus a Millis debounce in B4R. An edge interrupt
+ * stores the time (esp_timer_get_time, us) and the level of each edge in a
+ * lock-free ring (EdgeFilter.h), a poller debounces the edges and raises
+ * StateChanged with the debounced state.
+ *
+ * - No edge is lost while a handler blocks the main loop (e.g. PlayAlarm):
+ *   up to QUEUE_SIZE edges are queued and filtered on their own timestamps,
+ *   a short pulse is still raised as two events.
+ * - ChangedMicros is the time of the first edge of the change, accurate to the
+ *   interrupt latency (a few us), Duration the time the previous state lasted.
+ * - Debounce: edges less than DebounceMicros apart are one change, the last
+ *   level counts. A burst ending at the old state is a glitch, no event.
+ * - Counters per pin: edges, bounces, glitches, events, dropped (queue full,
+ *   the pin is then read again).
+ * - No event for the level at Initialize.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+#include "EdgeFilter.h"
+
+//~Library: rGpioInput
+//~Author: Robert W.B. Linn
+//~Brief: Interrupt driven digital input with timestamped edges, debouncing and counters.
+//~Version: 1.00
+
+namespace B4R {
+
+    //~shortname: GpioInput
+    //~Event: StateChanged (State As Boolean)
+    class B4RGpioInput {
+    private:
+        typedef void (*SubVoidBool)(bool state);
+
+        Byte pin;
+        EdgeRing ring;
+        EdgeDebouncer debouncer;
+        uint32_t droppedSeen = 0;
+        SubVoidBool StateChangedSub;
+
+        static uint32_t Micros();
+        static void edge(void* arg);
+        static void looper(void* b);
+        void Raise();
+
+    public:
+        /**
+         * Initialize the pin and attach the edge interrupt.
+         * @param Pin GPIO
+         * @param Mode MODE_INPUT, MODE_INPUT_PULLUP or MODE_INPUT_PULLDOWN
+         * @param StateChangedSub Event with the debounced state
+         */
+        void Initialize(Byte Pin, Byte Mode, SubVoidBool StateChangedSub);
+
+        /** Debounced state. */
+        bool getState();
+
+        /** Level of the pin now, not debounced. */
+        bool Read();
+
+        /** Set/Get the debounce time in us (default 20000). */
+        void setDebounceMicros(ULong us);
+        ULong getDebounceMicros();
+
+        /** Time of the first edge of the last change (esp_timer us, 32-bit). */
+        ULong getChangedMicros();
+
+        /** Time in us the state before the last change lasted. */
+        ULong getDuration();
+
+        /** Number of edges. */
+        ULong getEdgeCount();
+
+        /** Number of edges absorbed by the debounce. */
+        ULong getBounceCount();
+
+        /** Number of bursts ending at the previous state (no event). */
+        ULong getGlitchCount();
+
+        /** Number of StateChanged events. */
+        ULong getEventCount();
+
+        /** Number of edges dropped because the queue was full. */
+        ULong getDroppedCount();
+
+        /** Reset the counters */
+        void ResetCounters();
+
+        /** Modes */
+        static const Byte MODE_INPUT = 0;
+        static const Byte MODE_INPUT_PULLUP = 1;
+        static const Byte MODE_INPUT_PULLDOWN = 2;
+        /** Limits */
+        static const Byte QUEUE_SIZE = RGPIOINPUT_QUEUE_SIZE;
+    };
+
+} // namespace B4R
@@ -0,0 +1,834 @@
+/**
+ * @file rJsonIndex.cpp
+ * @brief Single-pass, zero-allocation JSON tokenizer for MQTT payloads for B4R.
+ */
+
+#include "B4RDefines.h"
+#include "rJsonIndex.h"
+#include <math.h>
+
+namespace B4R {
+
+    bool B4RJsonIndex::Parse(ArrayByte* Json) {
+        return ParseBytes((const char*)Json->data, Json->length);
+    }
+
+    /**
+     * @brief Scan '{' member (',' member)* '}' and store the members.
+     * Trailing whitespace and NUL bytes are accepted.
+     */
+    bool B4RJsonIndex::ParseBytes(const char* data, uint16_t len) {
+        json = data;
+        length = len;
+        pos = 0;
+        count = 0;
+        format = FORMAT_JSON;
+        parseCount++;
+
+        SkipWhitespace();
+        if (pos >= length || json[pos] != '{') goto fail;
+        pos++;
+        SkipWhitespace();
+        if (pos < length && json[pos] == '}') {
+            pos++;
+        } else {
+            for (;;) {
+                Field f;
+                uint16_t keyStart, keyLength;
+                bool keyEscaped;
+
+                SkipWhitespace();
+                if (pos >= length || json[pos] != '"') goto fail;
+                if (!ScanString(keyStart, keyLength, keyEscaped) || keyLength > 255) goto fail;
+                f.keyOffset = keyStart;
+                f.keyLength = (uint8_t)keyLength;
+
+                SkipWhitespace();
+                if (pos >= length || json[pos] != ':') goto fail;
+                pos++;
+                SkipWhitespace();
+                if (!ScanValue(f)) goto fail;
+                if (count < RJSONINDEX_MAX_FIELDS) fields[count++] = f;
+
+                SkipWhitespace();
+                if (pos >= length) goto fail;
+                if (json[pos] == ',') {
+                    pos++;
+                    continue;
+                }
+                if (json[pos] == '}') {
+                    pos++;
+                    break;
+                }
+                goto fail;
+            }
+        }
+
+        while (pos < length && (json[pos] == 0 || json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\r' || json[pos] == '\n')) pos++;
+        if (pos == length) return true;
+
+    fail:
+        errorPosition = pos;
+        errorCount++;
+        count = 0;
+        return false;
+    }
+
+    void B4RJsonIndex::SkipWhitespace() {
+        while (pos < length) {
+            char c = json[pos];
+            if (c != ' ' && c != '\t' && c != '\r' && c != '\n') return;
+            pos++;
+        }
+    }
+
+    /**
+     * @brief Scan a string starting at the opening quote.
+     * @param start Offset of the first character after the quote
+     * @param len Length without the quotes (escapes not resolved)
+     */
+    bool B4RJsonIndex::ScanString(uint16_t& start, uint16_t& len, bool& escaped) {
+        pos++;
+        start = pos;
+        escaped = false;
+        while (pos < length) {
+            char c = json[pos];
+            if (c == '"') {
+                len = pos - start;
+                pos++;
+                return true;
+            }
+            if (c == '\\') {
+                escaped = true;
+                pos++;
+                if (pos >= length) return false;
+                if (json[pos] == 'u') {
+                    if (pos + 4 >= length) return false;
+                    pos += 4;
+                }
+            } else if ((uint8_t)c < 0x20) {
+                return false;
+            }
+            pos++;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Scan and decode a number: -?int(.frac)?([eE][+-]?exp)?
+     */
+    bool B4RJsonIndex::ScanNumber(Field& f) {
+        uint16_t start = pos;
+        bool negative = false;
+        uint64_t mantissa = 0;
+        int16_t exponent = 0;
+        uint8_t digits = 0;
+
+        if (json[pos] == '-') {
+            negative = true;
+            pos++;
+        }
+        if (pos >= length || json[pos] < '0' || json[pos] > '9') return false;
+        while (pos < length && json[pos] >= '0' && json[pos] <= '9') {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (json[pos] - '0');
+                if (mantissa) digits++;
+            } else {
+                exponent++;
+            }
+            pos++;
+        }
+        f.integer = true;
+        int64_t whole = exponent == 0 ? (int64_t)mantissa : INT32_MAX;
+
+        if (pos < length && json[pos] == '.') {
+            f.integer = false;
+            pos++;
+            if (pos >= length || json[pos] < '0' || json[pos] > '9') return false;
+            while (pos < length && json[pos] >= '0' && json[pos] <= '9') {
+                if (digits < 19) {
+                    mantissa = mantissa * 10 + (json[pos] - '0');
+                    if (mantissa) digits++;
+                    exponent--;
+                }
+                pos++;
+            }
+        }
+        if (pos < length && (json[pos] == 'e' || json[pos] == 'E')) {
+            f.integer = false;
+            pos++;
+            bool expNegative = false;
+            if (pos < length && (json[pos] == '+' || json[pos] == '-')) {
+                expNegative = json[pos] == '-';
+                pos++;
+            }
+            if (pos >= length || json[pos] < '0' || json[pos] > '9') return false;
+            int16_t e = 0;
+            while (pos < length && json[pos] >= '0' && json[pos] <= '9') {
+                if (e < 1000) e = e * 10 + (json[pos] - '0');
+                pos++;
+            }
+            exponent += expNegative ? -e : e;
+        }
+
+        double value = (double)mantissa;
+        double scale = 1.0;
+        int16_t e = exponent < 0 ? -exponent : exponent;
+        for (int16_t i = 0; i < e && i < 330; i++) scale *= 10.0;
+        value = exponent < 0 ? value / scale : value * scale;
+        f.doubleValue = negative ? -value : value;
+
+        if (!f.integer) {
+            // Truncate toward zero like a cast
+            double t = f.doubleValue;
+            whole = t >= 2147483647.0 ? INT32_MAX : (t <= -2147483648.0 ? INT32_MIN : (int64_t)t);
+            f.longValue = (int32_t)whole;
+        } else {
+            if (whole > INT32_MAX) whole = negative ? (int64_t)INT32_MIN : INT32_MAX;
+            else if (negative) whole = -whole;
+            f.longValue = (int32_t)whole;
+        }
+
+        f.valueOffset = start;
+        f.valueLength = pos - start;
+        return true;
+    }
+
+    bool B4RJsonIndex::ScanLiteral(const char* literal, uint8_t len) {
+        if (pos + len > length || memcmp(json + pos, literal, len) != 0) return false;
+        pos += len;
+        return true;
+    }
+
+    /**
+     * @brief Skip a nested object or array, strings inside are scanned so brackets in text are ignored.
+     */
+    bool B4RJsonIndex::SkipNested() {
+        uint8_t depth = 0;
+        while (pos < length) {
+            char c = json[pos];
+            if (c == '"') {
+                uint16_t s, l;
+                bool e;
+                if (!ScanString(s, l, e)) return false;
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (depth == 0) return false;
+                depth--;
+                if (depth == 0) {
+                    pos++;
+                    return true;
+                }
+            }
+            pos++;
+        }
+        return false;
+    }
+
+    bool B4RJsonIndex::ScanValue(Field& f) {
+        if (pos >= length) return false;
+        f.escaped = false;
+        f.integer = false;
+        f.longValue = 0;
+        f.doubleValue = 0;
+        uint16_t start = pos;
+        char c = json[pos];
+
+        switch (c) {
+            case '"': {
+                uint16_t s, l;
+                bool e;
+                if (!ScanString(s, l, e)) return false;
+                f.type = TYPE_STRING;
+                f.valueOffset = s;
+                f.valueLength = l;
+                f.escaped = e;
+                return true;
+            }
+            case '{':
+            case '[':
+                if (!SkipNested()) return false;
+                f.type = c == '{' ? TYPE_OBJECT : TYPE_ARRAY;
+                break;
+            case 't':
+                if (!ScanLiteral("true", 4)) return false;
+                f.type = TYPE_BOOL;
+                f.longValue = 1;
+                f.doubleValue = 1;
+                break;
+            case 'f':
+                if (!ScanLiteral("false", 5)) return false;
+                f.type = TYPE_BOOL;
+                break;
+            case 'n':
+                if (!ScanLiteral("null", 4)) return false;
+                f.type = TYPE_NULL;
+                break;
+            default:
+                f.type = TYPE_NUMBER;
+                return ScanNumber(f);
+        }
+        f.valueOffset = start;
+        f.valueLength = pos - start;
+        return true;
+    }
+
+    const B4RJsonIndex::Field* B4RJsonIndex::Find(const char* key, uint8_t keyLength) {
+        for (uint8_t i = 0; i < count; i++) {
+            const Field& f = fields[i];
+            if (f.keyLength == keyLength && memcmp(json + f.keyOffset, key, keyLength) == 0) return &f;
+        }
+        return nullptr;
+    }
+
+    const B4RJsonIndex::Field* B4RJsonIndex::Find(B4RString* key) {
+        uint16_t n = key->getLength();
+        return n > 255 ? nullptr : Find(key->data, (uint8_t)n);
+    }
+
+    /**
+     * @brief Resolve the escapes of a string value into out.
+     * \uXXXX is written as UTF-8, a surrogate pair as one 4-byte sequence.
+     * @return Length written (truncated to size)
+     */
+    uint16_t B4RJsonIndex::Unescape(const Field& f, char* out, uint16_t size) {
+        const char* s = json + f.valueOffset;
+        const char* end = s + f.valueLength;
+        uint16_t n = 0;
+        char utf8[4];
+
+        while (s < end && n < size) {
+            if (*s != '\\') {
+                out[n++] = *s++;
+                continue;
+            }
+            s++;
+            char c = *s++;
+            uint8_t u = 0;
+            switch (c) {
+                case 'b': utf8[0] = '\b'; u = 1; break;
+                case 'f': utf8[0] = '\f'; u = 1; break;
+                case 'n': utf8[0] = '\n'; u = 1; break;
+                case 'r': utf8[0] = '\r'; u = 1; break;
+                case 't': utf8[0] = '\t'; u = 1; break;
+                case 'u': {
+                    uint32_t cp = 0;
+                    for (uint8_t i = 0; i < 4 && s < end; i++, s++) {
+                        char h = *s;
+                        cp = (cp << 4) | (h <= '9' ? h - '0' : (h | 0x20) - 'a' + 10);
+                    }
+                    if (cp >= 0xD800 && cp <= 0xDBFF && s + 6 <= end && s[0] == '\\' && s[1] == 'u') {
+                        uint32_t lo = 0;
+                        for (uint8_t i = 2; i < 6; i++) {
+                            char h = s[i];
+                            lo = (lo << 4) | (h <= '9' ? h - '0' : (h | 0x20) - 'a' + 10);
+                        }
+                        if (lo >= 0xDC00 && lo <= 0xDFFF) {
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                            s += 6;
+                        }
+                    }
+                    if (cp < 0x80) {
+                        utf8[0] = (char)cp; u = 1;
+                    } else if (cp < 0x800) {
+                        utf8[0] = (char)(0xC0 | (cp >> 6));
+                        utf8[1] = (char)(0x80 | (cp & 0x3F)); u = 2;
+                    } else if (cp < 0x10000) {
+                        utf8[0] = (char)(0xE0 | (cp >> 12));
+                        utf8[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                        utf8[2] = (char)(0x80 | (cp & 0x3F)); u = 3;
+                    } else {
+                        utf8[0] = (char)(0xF0 | (cp >> 18));
+                        utf8[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+                        utf8[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                        utf8[3] = (char)(0x80 | (cp & 0x3F)); u = 4;
+                    }
+                    break;
+                }
+                default:
+                    // \" \\ \/
+                    utf8[0] = c; u = 1; break;
+            }
+            for (uint8_t i = 0; i < u && n < size; i++) out[n++] = utf8[i];
+        }
+        return n;
+    }
+
+    bool B4RJsonIndex::ParseAuto(ArrayByte* Payload) {
+        return ParseAutoBytes((const char*)Payload->data, Payload->length);
+    }
+
+    bool B4RJsonIndex::ParseAutoBytes(const char* data, uint16_t len) {
+        uint8_t fmt = DetectFormat((const uint8_t*)data, len);
+        if (fmt == FORMAT_JSON) return ParseBytes(data, len);
+        Begin(data, len, fmt);
+        return fmt == FORMAT_CBOR ? ParseCbor() : ParseMsgPack();
+    }
+
+    /**
+     * @brief Format from the first byte: CBOR map 0xA0-0xBB, MessagePack map 0x80-0x8F,
+     * 0xDE, 0xDF. Anything else is handed to the JSON parser.
+     */
+    uint8_t B4RJsonIndex::DetectFormat(const uint8_t* data, uint16_t len) {
+        if (len == 0) return FORMAT_JSON;
+        uint8_t b = data[0];
+        if (b >= 0xA0 && b <= 0xBB) return FORMAT_CBOR;
+        if ((b >= 0x80 && b <= 0x8F) || b == 0xDE || b == 0xDF) return FORMAT_MSGPACK;
+        return FORMAT_JSON;
+    }
+
+    Byte B4RJsonIndex::getFormat() {
+        return format;
+    }
+
+    bool B4RJsonIndex::Begin(const char* data, uint16_t len, uint8_t fmt) {
+        json = data;
+        length = len;
+        pos = 0;
+        count = 0;
+        format = fmt;
+        parseCount++;
+        return true;
+    }
+
+    bool B4RJsonIndex::Fail() {
+        errorPosition = pos;
+        errorCount++;
+        count = 0;
+        return false;
+    }
+
+    bool B4RJsonIndex::ReadBig(uint8_t bytes, uint64_t& value) {
+        if (bytes > length - pos) return false;
+        value = 0;
+        for (uint8_t i = 0; i < bytes; i++) value = (value << 8) | (uint8_t)json[pos++];
+        return true;
+    }
+
+    void B4RJsonIndex::SetInteger(Field& f, int64_t value) {
+        f.type = TYPE_NUMBER;
+        f.integer = true;
+        f.doubleValue = (double)value;
+        f.longValue = value > INT32_MAX ? INT32_MAX : (value < INT32_MIN ? INT32_MIN : (int32_t)value);
+    }
+
+    void B4RJsonIndex::SetReal(Field& f, double value) {
+        f.type = TYPE_NUMBER;
+        f.integer = false;
+        f.doubleValue = value;
+        // Truncate toward zero like a cast, NaN as 0
+        f.longValue = value != value ? 0 : (value >= 2147483647.0 ? INT32_MAX : (value <= -2147483648.0 ? INT32_MIN : (int32_t)value));
+    }
+
+    /**
+     * @brief Read a CBOR initial byte and its argument (definite lengths only).
+     * For major type 7 the argument holds the float bits.
+     */
+    bool B4RJsonIndex::CborHead(uint8_t& major, uint8_t& info, uint64_t& value) {
+        if (pos >= length) return false;
+        uint8_t b = (uint8_t)json[pos++];
+        major = b >> 5;
+        info = b & 0x1F;
+        if (info < 24) {
+            value = info;
+            return true;
+        }
+        if (info > 27) return false;
+        return ReadBig(1 << (info - 24), value);
+    }
+
+    /**
+     * @brief Skip one CBOR item including nested arrays and maps, without recursion.
+     */
+    bool B4RJsonIndex::CborSkip() {
+        uint32_t items = 1;
+        while (items > 0) {
+            uint8_t major, info;
+            uint64_t value;
+            if (!CborHead(major, info, value)) return false;
+            items--;
+            switch (major) {
+                case 2:
+                case 3:
+                    if (value > (uint64_t)(length - pos)) return false;
+                    pos += (uint16_t)value;
+                    break;
+                case 4:
+                case 5:
+                    // Each item takes at least one byte
+                    if (value > length) return false;
+                    items += (uint32_t)value * (major == 5 ? 2 : 1);
+                    break;
+                case 6:
+                    items++;
+                    break;
+                default:
+                    break;
+            }
+        }
+        return true;
+    }
+
+    bool B4RJsonIndex::CborValue(Field& f) {
+        f.escaped = false;
+        f.integer = false;
+        f.longValue = 0;
+        f.doubleValue = 0;
+        uint8_t major, info;
+        uint64_t value;
+
+        // Tags (major type 6) are skipped, the tagged item is stored
+        uint16_t start;
+        do {
+            start = pos;
+            if (!CborHead(major, info, value)) return false;
+        } while (major == 6);
+
+        switch (major) {
+            case 0:
+                SetInteger(f, value > INT64_MAX ? INT64_MAX : (int64_t)value);
+                break;
+            case 1:
+                SetInteger(f, value > INT64_MAX ? INT64_MIN : -1 - (int64_t)value);
+                break;
+            case 2:
+            case 3:
+                if (value > (uint64_t)(length - pos)) return false;
+                f.type = TYPE_STRING;
+                f.valueOffset = pos;
+                f.valueLength = (uint16_t)value;
+                pos += (uint16_t)value;
+                return true;
+            case 4:
+            case 5:
+                pos = start;
+                if (!CborSkip()) return false;
+                f.type = major == 5 ? TYPE_OBJECT : TYPE_ARRAY;
+                break;
+            default:
+                if (info == 20 || info == 21) {
+                    f.type = TYPE_BOOL;
+                    f.longValue = info == 21;
+                    f.doubleValue = f.longValue;
+                } else if (info == 22 || info == 23) {
+                    f.type = TYPE_NULL;
+                } else if (info == 25) {
+                    // Half precision
+                    uint16_t h = (uint16_t)value;
+                    int exponent = (h >> 10) & 0x1F;
+                    int mantissa = h & 0x3FF;
+                    double d = exponent == 0 ? ldexp(mantissa, -24)
+                        : (exponent != 31 ? ldexp(mantissa + 1024, exponent - 25) : (mantissa == 0 ? INFINITY : NAN));
+                    SetReal(f, (h & 0x8000) ? -d : d);
+                } else if (info == 26) {
+                    uint32_t bits = (uint32_t)value;
+                    float x;
+                    memcpy(&x, &bits, 4);
+                    SetReal(f, x);
+                } else if (info == 27) {
+                    double x;
+                    memcpy(&x, &value, 8);
+                    SetReal(f, x);
+                } else {
+                    return false;
+                }
+                break;
+        }
+        f.valueOffset = start;
+        f.valueLength = pos - start;
+        return true;
+    }
+
+    /**
+     * @brief Index a CBOR map with text keys.
+     */
+    bool B4RJsonIndex::ParseCbor() {
+        uint8_t major, info;
+        uint64_t members;
+        if (!CborHead(major, info, members) || major != 5 || members > length) return Fail();
+        for (uint32_t i = 0; i < (uint32_t)members; i++) {
+            Field f;
+            uint64_t keyLength;
+            if (!CborHead(major, info, keyLength) || major != 3 || keyLength > 255 || keyLength > (uint64_t)(length - pos)) return Fail();
+            f.keyOffset = pos;
+            f.keyLength = (uint8_t)keyLength;
+            pos += (uint16_t)keyLength;
+            if (!CborValue(f)) return Fail();
+            if (count < RJSONINDEX_MAX_FIELDS) fields[count++] = f;
+        }
+        return pos == length ? true : Fail();
+    }
+
+    // MessagePack item kinds
+    static const uint8_t MP_INTEGER = 0;
+    static const uint8_t MP_REAL = 1;
+    static const uint8_t MP_STRING = 2;
+    static const uint8_t MP_ARRAY = 3;
+    static const uint8_t MP_MAP = 4;
+    static const uint8_t MP_NIL = 5;
+    static const uint8_t MP_BOOL = 6;
+
+    /**
+     * @brief Read a MessagePack type byte and its length, count or value.
+     * Strings and binaries return their length, the content is not skipped.
+     * Extension types are not supported.
+     */
+    bool B4RJsonIndex::MsgPackHead(uint8_t& kind, uint64_t& value, int64_t& signedValue, double& real) {
+        if (pos >= length) return false;
+        uint8_t b = (uint8_t)json[pos++];
+        value = 0;
+        if (b <= 0x7F) { kind = MP_INTEGER; signedValue = b; return true; }
+        if (b >= 0xE0) { kind = MP_INTEGER; signedValue = (int8_t)b; return true; }
+        if (b <= 0x8F) { kind = MP_MAP; value = b & 0x0F; return true; }
+        if (b <= 0x9F) { kind = MP_ARRAY; value = b & 0x0F; return true; }
+        if (b <= 0xBF) { kind = MP_STRING; value = b & 0x1F; return true; }
+
+        switch (b) {
+            case 0xC0: kind = MP_NIL; return true;
+            case 0xC2: kind = MP_BOOL; value = 0; return true;
+            case 0xC3: kind = MP_BOOL; value = 1; return true;
+            case 0xC4: case 0xD9: kind = MP_STRING; return ReadBig(1, value);
+            case 0xC5: case 0xDA: kind = MP_STRING; return ReadBig(2, value);
+            case 0xC6: case 0xDB: kind = MP_STRING; return ReadBig(4, value);
+            case 0xCA: {
+                kind = MP_REAL;
+                if (!ReadBig(4, value)) return false;
+                uint32_t bits = (uint32_t)value;
+                float x;
+                memcpy(&x, &bits, 4);
+                real = x;
+                return true;
+            }
+            case 0xCB:
+                kind = MP_REAL;
+                if (!ReadBig(8, value)) return false;
+                memcpy(&real, &value, 8);
+                return true;
+            case 0xCC: case 0xCD: case 0xCE: case 0xCF:
+                kind = MP_INTEGER;
+                if (!ReadBig(1 << (b - 0xCC), value)) return false;
+                signedValue = value > INT64_MAX ? INT64_MAX : (int64_t)value;
+                return true;
+            case 0xD0: case 0xD1: case 0xD2: case 0xD3: {
+                kind = MP_INTEGER;
+                uint8_t bytes = 1 << (b - 0xD0);
+                if (!ReadBig(bytes, value)) return false;
+                // Sign-extend from the encoded width
+                uint8_t shift = 64 - 8 * bytes;
+                signedValue = (int64_t)(value << shift) >> shift;
+                return true;
+            }
+            case 0xDC: kind = MP_ARRAY; return ReadBig(2, value);
+            case 0xDD: kind = MP_ARRAY; return ReadBig(4, value);
+            case 0xDE: kind = MP_MAP; return ReadBig(2, value);
+            case 0xDF: kind = MP_MAP; return ReadBig(4, value);
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * @brief Skip one MessagePack item including nested arrays and maps, without recursion.
+     */
+    bool B4RJsonIndex::MsgPackSkip() {
+        uint32_t items = 1;
+        while (items > 0) {
+            uint8_t kind;
+            uint64_t value;
+            int64_t signedValue;
+            double real;
+            if (!MsgPackHead(kind, value, signedValue, real)) return false;
+            items--;
+            if (kind == MP_STRING) {
+                if (value > (uint64_t)(length - pos)) return false;
+                pos += (uint16_t)value;
+            } else if (kind == MP_ARRAY || kind == MP_MAP) {
+                if (value > length) return false;
+                items += (uint32_t)value * (kind == MP_MAP ? 2 : 1);
+            }
+        }
+        return true;
+    }
+
+    bool B4RJsonIndex::MsgPackValue(Field& f) {
+        f.escaped = false;
+        f.integer = false;
+        f.longValue = 0;
+        f.doubleValue = 0;
+        uint16_t start = pos;
+        uint8_t kind;
+        uint64_t value;
+        int64_t signedValue;
+        double real;
+        if (!MsgPackHead(kind, value, signedValue, real)) return false;
+
+        switch (kind) {
+            case MP_INTEGER:
+                SetInteger(f, signedValue);
+                break;
+            case MP_REAL:
+                SetReal(f, real);
+                break;
+            case MP_STRING:
+                if (value > (uint64_t)(length - pos)) return false;
+                f.type = TYPE_STRING;
+                f.valueOffset = pos;
+                f.valueLength = (uint16_t)value;
+                pos += (uint16_t)value;
+                return true;
+            case MP_ARRAY:
+            case MP_MAP:
+                pos = start;
+                if (!MsgPackSkip()) return false;
+                f.type = kind == MP_MAP ? TYPE_OBJECT : TYPE_ARRAY;
+                break;
+            case MP_BOOL:
+                f.type = TYPE_BOOL;
+                f.longValue = (int32_t)value;
+                f.doubleValue = (double)value;
+                break;
+            default:
+                f.type = TYPE_NULL;
+                break;
+        }
+        f.valueOffset = start;
+        f.valueLength = pos - start;
+        return true;
+    }
+
+    /**
+     * @brief Index a MessagePack map with string keys.
+     */
+    bool B4RJsonIndex::ParseMsgPack() {
+        uint8_t kind;
+        uint64_t members;
+        int64_t signedValue;
+        double real;
+        if (!MsgPackHead(kind, members, signedValue, real) || kind != MP_MAP || members > length) return Fail();
+        for (uint32_t i = 0; i < (uint32_t)members; i++) {
+            Field f;
+            uint64_t keyLength;
+            if (!MsgPackHead(kind, keyLength, signedValue, real) || kind != MP_STRING
+                || keyLength > 255 || keyLength > (uint64_t)(length - pos)) return Fail();
+            f.keyOffset = pos;
+            f.keyLength = (uint8_t)keyLength;
+            pos += (uint16_t)keyLength;
+            if (!MsgPackValue(f)) return Fail();
+            if (count < RJSONINDEX_MAX_FIELDS) fields[count++] = f;
+        }
+        return pos == length ? true : Fail();
+    }
+
+    bool B4RJsonIndex::MemberAt(uint8_t i, Member& m) {
+        if (i >= count) return false;
+        const Field& f = fields[i];
+        m.key = json + f.keyOffset;
+        m.keyLength = f.keyLength;
+        m.type = f.type;
+        m.integer = f.integer;
+        m.longValue = f.longValue;
+        m.doubleValue = f.doubleValue;
+        return true;
+    }
+
+    uint16_t B4RJsonIndex::TextAt(uint8_t i, char* out, uint16_t size) {
+        if (i >= count) return 0;
+        const Field& f = fields[i];
+        if (!f.escaped) {
+            uint16_t n = f.valueLength < size ? f.valueLength : size;
+            memcpy(out, json + f.valueOffset, n);
+            return n;
+        }
+        return Unescape(f, out, size);
+    }
+
+    Byte B4RJsonIndex::getCount() {
+        return count;
+    }
+
+    UInt B4RJsonIndex::getErrorPosition() {
+        return errorPosition;
+    }
+
+    ULong B4RJsonIndex::getParseCount() {
+        return parseCount;
+    }
+
+    ULong B4RJsonIndex::getErrorCount() {
+        return errorCount;
+    }
+
+    bool B4RJsonIndex::Has(B4RString* Key) {
+        return Find(Key) != nullptr;
+    }
+
+    Byte B4RJsonIndex::TypeOf(B4RString* Key) {
+        const Field* f = Find(Key);
+        return f ? f->type : TYPE_NONE;
+    }
+
+    Long B4RJsonIndex::GetLong(B4RString* Key, Long Default) {
+        const Field* f = Find(Key);
+        if (!f || (f->type != TYPE_NUMBER && f->type != TYPE_BOOL)) return Default;
+        return f->longValue;
+    }
+
+    Double B4RJsonIndex::GetDouble(B4RString* Key, Double Default) {
+        const Field* f = Find(Key);
+        if (!f || (f->type != TYPE_NUMBER && f->type != TYPE_BOOL)) return Default;
+        return f->doubleValue;
+    }
+
+    bool B4RJsonIndex::GetBool(B4RString* Key, bool Default) {
+        const Field* f = Find(Key);
+        if (!f || (f->type != TYPE_NUMBER && f->type != TYPE_BOOL)) return Default;
+        return f->doubleValue != 0;
+    }
+
+    ArrayByte* B4RJsonIndex::GetText(B4RString* Key) {
+        ArrayByte* arr = CreateStackMemoryObject(ArrayByte);
+        arr->data = (void*)json;
+        arr->length = 0;
+        const Field* f = Find(Key);
+        if (!f) return arr;
+
+        if (!f->escaped) {
+            arr->data = (void*)(json + f->valueOffset);
+            arr->length = f->valueLength;
+            return arr;
+        }
+        // Escaped text is resolved into a buffer and copied to the B4R stack
+        char text[RJSONINDEX_TEXT_SIZE];
+        arr->length = Unescape(*f, text, sizeof(text));
+        return StackMemory::ReturnArrayOnStack(arr, text);
+    }
+
+    bool B4RJsonIndex::FindLong(const char* key, int32_t& value) {
+        const Field* f = Find(key, (uint8_t)strlen(key));
+        if (!f || (f->type != TYPE_NUMBER && f->type != TYPE_BOOL)) return false;
+        value = f->longValue;
+        return true;
+    }
+
+    bool B4RJsonIndex::FindDouble(const char* key, double& value) {
+        const Field* f = Find(key, (uint8_t)strlen(key));
+        if (!f || (f->type != TYPE_NUMBER && f->type != TYPE_BOOL)) return false;
+        value = f->doubleValue;
+        return true;
+    }
+
+    uint16_t B4RJsonIndex::FindText(const char* key, char* out, uint16_t size) {
+        const Field* f = Find(key, (uint8_t)strlen(key));
+        if (!f) return 0;
+        if (!f->escaped) {
+            uint16_t n = f->valueLength < size ? f->valueLength : size;
+            memcpy(out, json + f->valueOffset, n);
+            return n;
+        }
+        return Unescape(*f, out, size);
+    }
+
+} // namespace B4R
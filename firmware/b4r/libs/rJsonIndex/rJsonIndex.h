@@ -0,0 +1,197 @@
+/**
+ * @file rJsonIndex.h
+ * @brief Single-pass, zero-allocation JSON tokenizer for MQTT payloads for B4R.
+ *
+ * Parse scans a JSON object once and stores its top-level members as
+ * key/value spans into the payload in a fixed array (no heap, no copy).
+ * Numbers are decoded during the scan, so GetLong / GetDouble are lookups.
+ * Nested objects and arrays are kept as one raw span.
+ *
+ * Grammar: one JSON object with whitespace anywhere between tokens, string
+ * escapes (\" \\ \/ \b \f \n \r \t \uXXXX), numbers with fraction and exponent,
+ * true, false, null, nested objects and arrays.
+ *
+ * ParseAuto also indexes CBOR (RFC 8949) and MessagePack maps, detected from
+ * the first byte, into the same member table: strings point into the payload,
+ * numbers are decoded, nested maps and arrays are kept as one raw span. The
+ * typed getters are the same for all three formats (see rPayloadCodec).
+ *
+ * The payload must stay valid while the fields are read, e.g. during the
+ * ProcessMQTT handler. Keys are compared as sent (not unescaped).
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+
+/** Maximum number of top-level members stored, further members are parsed but not stored. */
+#ifndef RJSONINDEX_MAX_FIELDS
+#define RJSONINDEX_MAX_FIELDS 16
+#endif
+
+/** Maximum unescaped length of a string value with escapes (GetText). */
+#ifndef RJSONINDEX_TEXT_SIZE
+#define RJSONINDEX_TEXT_SIZE 128
+#endif
+
+//~Library: rJsonIndex
+//~Author: Robert W.B. Linn
+//~Brief: Single-pass zero-allocation JSON tokenizer with typed field access.
+//~Version: 1.01
+
+namespace B4R {
+
+    //~shortname: JsonIndex
+    class B4RJsonIndex {
+    private:
+        struct Field {
+            uint16_t keyOffset;
+            uint16_t valueOffset;       // For strings without the quotes
+            uint16_t valueLength;
+            uint8_t keyLength;
+            uint8_t type;
+            bool escaped;               // String value contains escapes
+            bool integer;               // Number without fraction/exponent
+            int32_t longValue;
+            double doubleValue;
+        };
+
+        Field fields[RJSONINDEX_MAX_FIELDS];
+        uint8_t count = 0;
+        const char* json = nullptr;
+        uint16_t length = 0;
+        uint16_t pos = 0;
+        uint16_t errorPosition = 0;
+        uint32_t parseCount = 0;
+        uint32_t errorCount = 0;
+        uint8_t format = 0;
+
+        void SkipWhitespace();
+        bool ScanString(uint16_t& start, uint16_t& len, bool& escaped);
+        bool ScanNumber(Field& f);
+        bool ScanLiteral(const char* literal, uint8_t len);
+        bool SkipNested();
+        bool ScanValue(Field& f);
+        const Field* Find(const char* key, uint8_t keyLength);
+        const Field* Find(B4RString* key);
+        uint16_t Unescape(const Field& f, char* out, uint16_t size);
+        bool Begin(const char* data, uint16_t len, uint8_t fmt);
+        bool Fail();
+        bool CborHead(uint8_t& major, uint8_t& info, uint64_t& value);
+        bool CborValue(Field& f);
+        bool CborSkip();
+        bool MsgPackHead(uint8_t& kind, uint64_t& value, int64_t& signedValue, double& real);
+        bool MsgPackValue(Field& f);
+        bool MsgPackSkip();
+        bool ParseCbor();
+        bool ParseMsgPack();
+        bool ReadBig(uint8_t bytes, uint64_t& value);
+        static void SetInteger(Field& f, int64_t value);
+        static void SetReal(Field& f, double value);
+
+    public:
+        /** Value types */
+        static const Byte TYPE_NONE = 0;
+        static const Byte TYPE_STRING = 1;
+        static const Byte TYPE_NUMBER = 2;
+        static const Byte TYPE_BOOL = 3;
+        static const Byte TYPE_NULL = 4;
+        static const Byte TYPE_OBJECT = 5;
+        static const Byte TYPE_ARRAY = 6;
+
+        /** Payload formats (ParseAuto, Format) */
+        static const Byte FORMAT_JSON = 0;
+        static const Byte FORMAT_CBOR = 1;
+        static const Byte FORMAT_MSGPACK = 2;
+
+        /** Maximum number of members stored */
+        static const Byte MAX_FIELDS = RJSONINDEX_MAX_FIELDS;
+
+        /**
+         * Parse a JSON object in one pass.
+         * @param Json Payload, must stay valid while the fields are read
+         * @return False if the payload is not a valid JSON object (Count is 0)
+         */
+        bool Parse(ArrayByte* Json);
+
+        /**
+         * Parse a JSON object, CBOR map or MessagePack map, detected from the first byte.
+         * @param Payload Payload, must stay valid while the fields are read
+         * @return False if the payload is not a valid object/map (Count is 0)
+         */
+        bool ParseAuto(ArrayByte* Payload);
+
+        /** Format of the last parsed payload (FORMAT_...) */
+        Byte getFormat();
+
+        /** Number of members stored by the last Parse */
+        Byte getCount();
+
+        /** Byte offset of the syntax error of the last failed Parse */
+        UInt getErrorPosition();
+
+        /** Number of Parse calls */
+        ULong getParseCount();
+
+        /** Number of failed Parse calls */
+        ULong getErrorCount();
+
+        /** True if the key is present */
+        bool Has(B4RString* Key);
+
+        /** Value type of a key, TYPE_NONE if not present */
+        Byte TypeOf(B4RString* Key);
+
+        /**
+         * Integer value of a number (fraction truncated) or bool (1/0).
+         * @param Key Key
+         * @param Default Returned if the key is missing or not a number/bool
+         */
+        Long GetLong(B4RString* Key, Long Default);
+
+        /**
+         * Value of a number or bool (1/0).
+         * @param Key Key
+         * @param Default Returned if the key is missing or not a number/bool
+         */
+        Double GetDouble(B4RString* Key, Double Default);
+
+        /**
+         * Value of a bool, or a number (not 0).
+         * @param Key Key
+         * @param Default Returned if the key is missing or not a bool/number
+         */
+        bool GetBool(B4RString* Key, bool Default);
+
+        /**
+         * Text of a string value (unescaped), or the raw text of other values.
+         * Points into the payload unless the string has escapes. Empty if the key is missing.
+         * @param Key Key
+         */
+        ArrayByte* GetText(B4RString* Key);
+
+        //~hide
+        // Same as Parse / lookups for C++ callers and host tools
+        bool ParseBytes(const char* data, uint16_t len);
+        bool FindLong(const char* key, int32_t& value);
+        bool FindDouble(const char* key, double& value);
+        uint16_t FindText(const char* key, char* out, uint16_t size);
+        bool ParseAutoBytes(const char* data, uint16_t len);
+        static uint8_t DetectFormat(const uint8_t* data, uint16_t len);
+        // Member i of the last parse, used to re-encode it (rPayloadCodec)
+        struct Member {
+            const char* key;
+            uint8_t keyLength;
+            uint8_t type;
+            bool integer;
+            int32_t longValue;
+            double doubleValue;
+        };
+        bool MemberAt(uint8_t i, Member& m);
+        uint16_t TextAt(uint8_t i, char* out, uint16_t size);
+    };
+
+} // namespace B4R
@@ -0,0 +1,188 @@
+/**
+ * @file rLog.cpp
+ * @brief Levelled logging into a binary RAM ring, drained by a low-priority task.
+ */
+
+#include "B4RDefines.h"
+#include "rLog.h"
+
+namespace B4R {
+
+    B4RLog::Record B4RLog::ring[RLOG_RING_RECORDS];
+    volatile uint32_t B4RLog::head = 0;
+    volatile uint32_t B4RLog::tail = 0;
+    volatile uint32_t B4RLog::writtenCount = 0;
+    volatile uint32_t B4RLog::droppedCount = 0;
+    volatile uint32_t B4RLog::highWater = 0;
+    TaskHandle_t B4RLog::drainTask = nullptr;
+
+    /// Guards head/tail and the record copies
+    static portMUX_TYPE ringMux = portMUX_INITIALIZER_UNLOCKED;
+
+    static const char LEVEL_CHARS[] = { '-', 'E', 'W', 'I', 'D' };
+
+    /**
+     * @brief Start the drain task on RLOG_DRAIN_CORE with RLOG_DRAIN_PRIORITY.
+     */
+    void B4RLog::Initialize() {
+        if (drainTask != nullptr) return;
+        xTaskCreatePinnedToCore(DrainTask, "rlog", RLOG_DRAIN_STACK, nullptr,
+            RLOG_DRAIN_PRIORITY, &drainTask, RLOG_DRAIN_CORE);
+    }
+
+    Byte B4RLog::getLevel() {
+        return RLOG_LEVEL;
+    }
+
+    /**
+     * @brief Store a format record. The format must be a string literal,
+     * it is only read when the drain task prints the record.
+     */
+    void B4RLog::Write(uint8_t level, const char* fmt, uint32_t a0, uint32_t a1, uint32_t a2) {
+        Record r;
+        r.level = level;
+        r.kind = KIND_FORMAT;
+        r.length = 0;
+        r.format.fmt = fmt;
+        r.format.args[0] = a0;
+        r.format.args[1] = a1;
+        r.format.args[2] = a2;
+        Push(r);
+    }
+
+    void B4RLog::Frame(Byte Level, B4RString* Tag, ArrayByte* Data) {
+        if (Level == LEVEL_NONE || Level > RLOG_LEVEL) return;
+        Record r;
+        r.level = Level;
+        r.kind = KIND_FRAME;
+        r.length = Data->length;
+        CopyTag(r.frame.tag, Tag);
+        memcpy(r.frame.data, Data->data, Data->length < FRAME_BYTES ? Data->length : FRAME_BYTES);
+        Push(r);
+    }
+
+    void B4RLog::Value(Byte Level, B4RString* Tag, Long Value) {
+        if (Level == LEVEL_NONE || Level > RLOG_LEVEL) return;
+        Record r;
+        r.level = Level;
+        r.kind = KIND_VALUE;
+        r.length = 0;
+        CopyTag(r.value.tag, Tag);
+        r.value.value = Value;
+        Push(r);
+    }
+
+    /**
+     * @brief Copy the tag, truncated to TAG_SIZE - 1 characters.
+     */
+    void B4RLog::CopyTag(char* dst, B4RString* tag) {
+        uint16_t length = tag->getLength();
+        if (length > TAG_SIZE - 1) length = TAG_SIZE - 1;
+        memcpy(dst, tag->data, length);
+        dst[length] = 0;
+    }
+
+    /**
+     * @brief Timestamp a record and copy it into the ring, or count it as dropped.
+     * Safe from any task and from ISRs.
+     */
+    void B4RLog::Push(Record& r) {
+        r.timeMs = millis();
+        portENTER_CRITICAL_SAFE(&ringMux);
+        uint32_t used = head - tail;
+        if (used >= RLOG_RING_RECORDS) {
+            droppedCount++;
+        } else {
+            ring[head & (RLOG_RING_RECORDS - 1)] = r;
+            head++;
+            writtenCount++;
+            if (used + 1 > highWater) highWater = used + 1;
+        }
+        portEXIT_CRITICAL_SAFE(&ringMux);
+
+        if (drainTask == nullptr) return;
+        if (xPortInIsrContext()) {
+            vTaskNotifyGiveFromISR(drainTask, nullptr);
+        } else {
+            xTaskNotifyGive(drainTask);
+        }
+    }
+
+    /**
+     * @brief Copy the oldest record out of the ring.
+     * @return False if the ring is empty.
+     */
+    bool B4RLog::Pop(Record& r) {
+        bool found = false;
+        portENTER_CRITICAL(&ringMux);
+        if (tail != head) {
+            r = ring[tail & (RLOG_RING_RECORDS - 1)];
+            tail++;
+            found = true;
+        }
+        portEXIT_CRITICAL(&ringMux);
+        return found;
+    }
+
+    /**
+     * @brief Format one record as "[ms][L] text" and print it.
+     */
+    void B4RLog::Print(const Record& r) {
+        char line[128];
+        int n = snprintf(line, sizeof(line), "[%lu][%c] ",
+            (unsigned long)r.timeMs, LEVEL_CHARS[r.level <= RLOG_LEVEL_DEBUG ? r.level : 0]);
+
+        switch (r.kind) {
+            case KIND_FORMAT:
+                snprintf(line + n, sizeof(line) - n, r.format.fmt,
+                    r.format.args[0], r.format.args[1], r.format.args[2]);
+                break;
+            case KIND_FRAME: {
+                n += snprintf(line + n, sizeof(line) - n, "[%s] len=%u hex=", r.frame.tag, r.length);
+                uint16_t count = r.length < FRAME_BYTES ? r.length : FRAME_BYTES;
+                for (uint16_t i = 0; i < count && n < (int)sizeof(line) - 3; i++) {
+                    n += snprintf(line + n, sizeof(line) - n, "%02X", r.frame.data[i]);
+                }
+                if (r.length > FRAME_BYTES) snprintf(line + n, sizeof(line) - n, "..");
+                break;
+            }
+            case KIND_VALUE:
+                snprintf(line + n, sizeof(line) - n, "[%s] %ld", r.value.tag, (long)r.value.value);
+                break;
+        }
+        ::Serial.println(line);
+    }
+
+    /**
+     * @brief Drain task: print records as they arrive, sleep while the ring is empty.
+     */
+    void B4RLog::DrainTask(void* arg) {
+        Record r;
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            while (Pop(r)) Print(r);
+        }
+    }
+
+    void B4RLog::Flush() {
+        Record r;
+        while (Pop(r)) Print(r);
+    }
+
+    ULong B4RLog::getWrittenCount() {
+        return writtenCount;
+    }
+
+    ULong B4RLog::getDroppedCount() {
+        return droppedCount;
+    }
+
+    UInt B4RLog::getPending() {
+        return head - tail;
+    }
+
+    UInt B4RLog::getHighWater() {
+        return highWater;
+    }
+
+} // namespace B4R
@@ -0,0 +1,194 @@
+/**
+ * @file rLog.h
+ * @brief Levelled logging with compile-time filtering for B4R and C++ libraries.
+ *
+ * Log records are not formatted by the caller. They are stored in binary
+ * form in a RAM ring and formatted and printed by a low-priority drain task:
+ * - C++ libraries use the RLOG_E/W/I/D macros with a format string literal
+ *   and up to 3 integer arguments. Levels above RLOG_LEVEL compile to nothing.
+ * - B4R modules use Frame and Value. Calls in hot paths are wrapped in
+ *   #If LOG_DEBUG ... #End If so production builds contain no code at all.
+ *
+ * Record layout (52 bytes): time, level, kind and either
+ * format pointer + 3 arguments (C++) or tag + first frame bytes (B4R).
+ * A full ring drops new records and counts them (DroppedCount).
+ *
+ * Set the level in the B4R project attributes, e.g. for debug builds:
+ *   #DefineExtra: #define RLOG_LEVEL 4
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+
+/** Log levels */
+#define RLOG_LEVEL_NONE     0
+#define RLOG_LEVEL_ERROR    1
+#define RLOG_LEVEL_WARN     2
+#define RLOG_LEVEL_INFO     3
+#define RLOG_LEVEL_DEBUG    4
+
+/** Compile-time level, records above are removed (default WARN for production builds). */
+#ifndef RLOG_LEVEL
+#define RLOG_LEVEL RLOG_LEVEL_WARN
+#endif
+
+/** Number of records in the RAM ring. Must be a power of two. */
+#ifndef RLOG_RING_RECORDS
+#define RLOG_RING_RECORDS 32
+#endif
+
+/** Drain task priority, stack size and core (core 0: the B4R loop runs on core 1) */
+#ifndef RLOG_DRAIN_PRIORITY
+#define RLOG_DRAIN_PRIORITY 1
+#endif
+#ifndef RLOG_DRAIN_STACK
+#define RLOG_DRAIN_STACK 3072
+#endif
+#ifndef RLOG_DRAIN_CORE
+#define RLOG_DRAIN_CORE 0
+#endif
+
+/** Cast a string argument for %s (32-bit targets); the string must outlive the record, e.g. a literal */
+#define RLOG_STR(s) ((uint32_t)(uintptr_t)(s))
+
+#if RLOG_LEVEL >= RLOG_LEVEL_ERROR
+#define RLOG_E(...) B4R::B4RLog::Write(RLOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define RLOG_E(...) do {} while (0)
+#endif
+
+#if RLOG_LEVEL >= RLOG_LEVEL_WARN
+#define RLOG_W(...) B4R::B4RLog::Write(RLOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define RLOG_W(...) do {} while (0)
+#endif
+
+#if RLOG_LEVEL >= RLOG_LEVEL_INFO
+#define RLOG_I(...) B4R::B4RLog::Write(RLOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define RLOG_I(...) do {} while (0)
+#endif
+
+#if RLOG_LEVEL >= RLOG_LEVEL_DEBUG
+#define RLOG_D(...) B4R::B4RLog::Write(RLOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define RLOG_D(...) do {} while (0)
+#endif
+
+//~Library: rLog
+//~Author: Robert W.B. Linn
+//~Brief: Levelled logging into a binary RAM ring, formatted and printed by a low-priority task.
+//~Version: 1.00
+
+namespace B4R {
+
+    //~shortname: RLog
+    class B4RLog {
+    private:
+        static const uint8_t KIND_FORMAT = 0;
+        static const uint8_t KIND_FRAME = 1;
+        static const uint8_t KIND_VALUE = 2;
+        static const uint8_t TAG_SIZE = 28;
+        static const uint8_t FRAME_BYTES = 16;
+
+        struct Record {
+            uint32_t timeMs;
+            uint8_t level;
+            uint8_t kind;
+            uint16_t length;                    // Frame length (may exceed FRAME_BYTES)
+            union {
+                struct {
+                    const char* fmt;
+                    uint32_t args[3];
+                } format;
+                struct {
+                    char tag[TAG_SIZE];
+                    uint8_t data[FRAME_BYTES];
+                } frame;
+                struct {
+                    char tag[TAG_SIZE];
+                    int32_t value;
+                } value;
+            };
+        };
+
+        // Ring of records, producers (any task) and the drain task copy records under a spinlock
+        static Record ring[RLOG_RING_RECORDS];
+        static volatile uint32_t head;
+        static volatile uint32_t tail;
+        static volatile uint32_t writtenCount;
+        static volatile uint32_t droppedCount;
+        static volatile uint32_t highWater;
+        static TaskHandle_t drainTask;
+
+        // Copy a record into / out of the ring under the spinlock
+        static void Push(Record& r);
+        static bool Pop(Record& r);
+        static void CopyTag(char* dst, B4RString* tag);
+
+        // Format and print one record
+        static void Print(const Record& r);
+
+        static void DrainTask(void* arg);
+
+    public:
+        /** Levels */
+        static const Byte LEVEL_NONE = RLOG_LEVEL_NONE;
+        static const Byte LEVEL_ERROR = RLOG_LEVEL_ERROR;
+        static const Byte LEVEL_WARN = RLOG_LEVEL_WARN;
+        static const Byte LEVEL_INFO = RLOG_LEVEL_INFO;
+        static const Byte LEVEL_DEBUG = RLOG_LEVEL_DEBUG;
+
+        /** Ring capacity in records */
+        static const UInt RING_RECORDS = RLOG_RING_RECORDS;
+
+        /**
+         * Start the drain task. Records written before are kept and printed then.
+         * Calling it again has no effect.
+         */
+        void Initialize();
+
+        /** Compile-time level (RLOG_LEVEL), records above are not stored */
+        Byte getLevel();
+
+        /**
+         * Log a byte array (e.g. a BLE frame) with a tag.
+         * The first 16 bytes are stored and printed as hex by the drain task.
+         * @param Level LEVEL_ERROR to LEVEL_DEBUG
+         * @param Tag Source, e.g. "CommBLE.NewData" (first 27 characters kept)
+         * @param Data Bytes
+         */
+        void Frame(Byte Level, B4RString* Tag, ArrayByte* Data);
+
+        /**
+         * Log a numeric value with a tag.
+         * @param Level LEVEL_ERROR to LEVEL_DEBUG
+         * @param Tag Source (first 27 characters kept)
+         * @param Value Value
+         */
+        void Value(Byte Level, B4RString* Tag, Long Value);
+
+        /** Number of records written */
+        ULong getWrittenCount();
+
+        /** Number of records dropped because the ring was full */
+        ULong getDroppedCount();
+
+        /** Number of records waiting for the drain task */
+        UInt getPending();
+
+        /** Highest number of records waiting */
+        UInt getHighWater();
+
+        /** Print all waiting records now, from the calling task */
+        void Flush();
+
+        //~hide
+        static void Write(uint8_t level, const char* fmt, uint32_t a0 = 0, uint32_t a1 = 0, uint32_t a2 = 0);
+    };
+
+} // namespace B4R
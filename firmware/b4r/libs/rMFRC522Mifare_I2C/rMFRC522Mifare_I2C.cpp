@@ -19,11 +19,9 @@ namespace B4R {
 		rfid->PCD_Init();
 		// ::Serial.println("[B4RMFRC522::Initialize] PCD_Init");
 		
-		// Registare callback event for handling card reading
+		// Register callback event for handling card reading, checked every CARD_POLL_PERIOD ms
 		this->CardPresentSub = CardPresentSub;
-		FunctionUnion fu;
-		fu.PollerFunction = looper;
-		pollers.add(fu, this);
+		pollJob = B4RScheduler::Every(looper, this, CARD_POLL_PERIOD, CARD_BUDGET_US);
 		
 		// ::Serial.println("[B4RMFRC522::Initialize] OK");
 	}
@@ -41,16 +39,14 @@ namespace B4R {
 		rfid->PCD_ReadRegister(reg);
 	}
 
-	static UInt lastEvent = 0;
 	void B4RMFRC522::looper(void* b) {
 		B4RMFRC522* me = (B4RMFRC522*)b;
 		if ( ! me->rfid->PICC_IsNewCardPresent())
 			return;
 		if ( ! me->rfid->PICC_ReadCardSerial())
 			return;
-		if (lastEvent + 500 > millis())
-			return;
-		lastEvent = millis();
+		// Next check after the hold-off, then again every CARD_POLL_PERIOD
+		B4RScheduler::Schedule(me->pollJob, CARD_HOLDOFF);
 		const UInt cp = B4R::StackMemory::cp;
 		ArrayByte* arr = CreateStackMemoryObject(ArrayByte);
 		arr->data = me->rfid->uid.uidByte;
@@ -1,6 +1,7 @@
 #pragma once
 #include "B4RDefines.h"
 #include "MFRC522_I2C.h"
+#include "rScheduler.h"
 
 /**
  * @file rMFRC522Mifare.h
@@ -53,8 +54,10 @@
  * ```
  *
  * @note This library is tailored for MIFARE Classic tags and does not cover MIFARE DESFire, Ultralight, or NTAG.
+ * @note The reader is checked for a new card every CARD_POLL_PERIOD ms by a job of rScheduler (I2C traffic),
+ *       after CardPresent the next check is CARD_HOLDOFF ms later.
  *
- * @version 1.0
+ * @version 1.01
  * @date 2025
  * @author
  *   Robert W. B. Linn (c) 2025 — MIT License
@@ -65,13 +68,14 @@
 namespace B4R {
 	typedef void (*SubVoidArrayByte)(Array* barray, Byte type);
 
-    //~version: 1.0
+    //~version: 1.01
 	//~shortname: MFRC522Mifare_I2C
 	class B4RMFRC522 {
 		private:
 			byte beMFRC522[sizeof(MFRC522)];
 			MFRC522* rfid;
 			SubVoidArrayByte CardPresentSub;
+			Byte pollJob;
 			static void looper(void* b);
 
 		public:
@@ -161,6 +165,11 @@ namespace B4R {
 			/** @brief Default I2C address for MFRC522 on SDA. */
 			static const int I2C_DEFAULT_ADDRESS = 0x28;
 
+			/** @brief Card check period in ms, hold-off after CardPresent in ms, CPU budget of the check in us (includes the event). */
+			static const ULong CARD_POLL_PERIOD = 100;
+			static const ULong CARD_HOLDOFF = 500;
+			static const ULong CARD_BUDGET_US = 5000;
+
 			// PICC Type identifiers
 			
 			// PICC Unknown type (0)
@@ -17,31 +17,45 @@ namespace B4R {
 		sensorPin = pin;		
 		pinMode(sensorPin, INPUT);
 
-		// Initialize internal state
-		moistureprev = NAN;			// Ensures first reading always fires event
+		// Initialize internal state, the first reading always fires the event
+		filter.Initialize();
+		eventCount = 0;
+		suppressedCount = 0;
 		eventenabled = true;
-		lastEvent = 0;
+		adc = nullptr;
 				
-		// Register callback event for handling analog reading
+		// Register callback event for handling analog reading, read every READ_PERIOD ms
 		this->MoistureDetectedSub = MoistureDetectedSub;
-		FunctionUnion fu;
-		fu.PollerFunction = looper;
-		pollers.add(fu, this);
+		readJob = B4RScheduler::Every(looper, this, READ_PERIOD, READ_BUDGET_US);
 		
 		// ::Serial.println("[B4RMOISTURESENSOR::Initialize] OK");
 	}
 
+	bool B4RMOISTURESENSOR::FromService() {
+		// The service may be started after this sensor
+		if (adc == nullptr) {
+			B4RADCService* service = B4RADCService::Shared();
+			if (service == nullptr || !service->getRunning()) return false;
+			adcChannel = service->ChannelOf(sensorPin);
+			if (adcChannel == B4RADCService::INVALID_CHANNEL) return false;
+			adc = service;
+		}
+		// Until the first decimation block is complete Raw is 0, read the pin directly
+		return adc->getRunning() && adc->Ready(adcChannel);
+	}
+
 	int B4RMOISTURESENSOR::Read() {
+		// Latest oversampled value of the service, no conversion
+		if (FromService()) return adc->Raw(adcChannel);
 		return analogRead(sensorPin);
 	}
 
 	int B4RMOISTURESENSOR::ADC() {
-		int adcVal = analogRead(sensorPin);
-		return adcVal;
+		return Read();
 	}
 
 	int B4RMOISTURESENSOR::DAC() {
-		int adcVal = analogRead(sensorPin);
+		int adcVal = Read();
 		// Handle noise
 		if (adcVal < MIN_VALUE) {
 			adcVal = MIN_VALUE;
@@ -54,10 +68,11 @@ namespace B4R {
 	}
 
 	double B4RMOISTURESENSOR::Voltage() {
+		if (FromService()) return adc->Voltage(adcChannel);
 		int adcVal = analogRead(sensorPin);
 		double voltage = 0;
 		if (adcVal > 0) {
-			voltage = adcVal / MAX_VALUE * 3.3;
+			voltage = adcVal * 3.3 / MAX_VALUE;
 		}
 		return voltage;
 	}
@@ -69,28 +84,59 @@ namespace B4R {
 		return eventenabled;
 	}
 
+	void B4RMOISTURESENSOR::SetFilter(Byte Median, Double Alpha) {
+		filter.SetMedian(Median);
+		filter.setAlpha(Alpha);
+	}
+
+	void B4RMOISTURESENSOR::SetDeadband(Double Absolute, Double Relative, Double Hysteresis) {
+		filter.SetDeadband(Absolute, Relative, Hysteresis);
+	}
+
+	void B4RMOISTURESENSOR::setMinInterval(ULong ms) {
+		filter.setMinInterval(ms);
+	}
+	ULong B4RMOISTURESENSOR::getMinInterval() {
+		return filter.getMinInterval();
+	}
+
+	void B4RMOISTURESENSOR::setMaxInterval(ULong ms) {
+		filter.setMaxInterval(ms);
+	}
+	ULong B4RMOISTURESENSOR::getMaxInterval() {
+		return filter.getMaxInterval();
+	}
+
+	ULong B4RMOISTURESENSOR::getEventCount() {
+		return eventCount;
+	}
+
+	ULong B4RMOISTURESENSOR::getSuppressedCount() {
+		return suppressedCount;
+	}
+
+	ULong B4RMOISTURESENSOR::getHeartbeatCount() {
+		return filter.getHeartbeatCount();
+	}
+
 	// Event
 	void B4RMOISTURESENSOR::looper(void* b) {
 
 		B4RMOISTURESENSOR* me = (B4RMOISTURESENSOR*)b;
-		
-		// Handle debounce
-		if (me->lastEvent + 500 > millis())
-			return;
-		me->lastEvent = millis();
 
 		// Read the sensor valuevalue
 		int moisture = me->Read();
 	
 		// Check if the event is enabled
 		if (me->getEventEnabled()) {
-			// Call the event if the value has changed			
-			if (moisture != me->moistureprev) {
+			// Call the event if the filtered value left the deadband, or for the heartbeat
+			if (me->filter.UpdateAt(moisture, millis())) {
+				me->eventCount++;
 				const UInt cp = B4R::StackMemory::cp;
-				me->MoistureDetectedSub(moisture);
+				me->MoistureDetectedSub((Int)lroundf(me->filter.getValue()));
 				B4R::StackMemory::cp = cp;
-				
-				me->moistureprev = moisture;
+			} else {
+				me->suppressedCount++;
 			}
 		}
 	}
@@ -1,5 +1,8 @@
 #pragma once
 #include "B4RDefines.h"
+#include "rSensorFilter.h"
+#include "rADCService.h"
+#include "rScheduler.h"
 
 /**
  * @file rMoistureSensor.h
@@ -7,13 +10,18 @@
  * @note Tested with the Keyestudio Steam Sensor, Working Temperature: －10-70C, Interface Type: Analog Signal Output.
  * @note This is an analog (digital) input module, also called rain, rain sensor. 
  *       The output is converted into a digital signal (DO) and an analog signal (AO) output.
- * @version 1.0
- * @date 2025-11-29
+ * @note MoistureDetected is raised when the filtered value leaves its deadband (rSensorFilter, SetFilter, SetDeadband,
+ *       MinInterval, MaxInterval). Without settings every change of the ADC value is raised.
+ * @note If an ADCService samples the pin, the values are read from the service (oversampled, calibrated)
+ *       once its channel is ready, else with analogRead.
+ * @note The sensor is read every 500 ms by a job of rScheduler, not by a poller on every main loop pass.
+ * @version 1.03
+ * @date 2026-10-17
  * @author Robert W. B. Linn (c) 2025 — MIT License
  */
 
 namespace B4R {
-    //~version: 1.0
+    //~version: 1.03
 	//~shortname: MoistureSensor
 	//~Event: MoistureDetected (Value As Int)
 	class B4RMOISTURESENSOR {
@@ -27,14 +35,22 @@ namespace B4R {
 			/** @brief Sensor analog pin number. */
 			Byte sensorPin;
 
-			/** @brief Store previous value. */
-			int moistureprev;
+			/** @brief Noise filter, decides when a value is raised. */
+			B4RSensorFilter filter;
+			ULong eventCount;
+			ULong suppressedCount;
 
 			/** @brief Event-enabled flag (instance specific). */
 			bool eventenabled;
 
-			/** @brief Per-instance event timer. */
-			UInt lastEvent = 0;
+			/** @brief Scheduler job reading the sensor. */
+			Byte readJob;
+
+			/** @brief ADCService channel of the pin, nullptr if read with analogRead. */
+			B4RADCService* adc = nullptr;
+			Byte adcChannel;
+			/** @brief True if the values are read from the ADCService: running and the channel has a value. */
+			bool FromService();
 
 			/** @brief Event using call in B4R program */
 			SubVoidInt MoistureDetectedSub;
@@ -67,7 +83,7 @@ namespace B4R {
 			int DAC();
 
 			/**
-			 * @brief Get the voltage 0-3.3V.
+			 * @brief Get the voltage 0-3.3V, calibrated if read from an ADCService.
 			 * @return double Voltage value.
 			 */
 			double Voltage();
@@ -78,6 +94,49 @@ namespace B4R {
 			void setEventEnabled(bool state);
 			bool getEventEnabled(void);
 
+			/**
+			 * @brief Set the noise filter.
+			 * @param Median - Median of the last N reads, odd, 1 = off (max 7).
+			 * @param Alpha - EMA factor 0 < Alpha <= 1, 1 = off.
+			 */
+			void SetFilter(Byte Median, Double Alpha);
+
+			/**
+			 * @brief Set the deadband: MoistureDetected is raised when the value moved at least
+			 * max(Absolute, Relative * |last value|), against the last direction Hysteresis more.
+			 * @param Absolute - Minimum change in ADC counts, 0 = any change.
+			 * @param Relative - Minimum change as fraction of the last value, e.g. 0.02 = 2 %.
+			 * @param Hysteresis - Extra change against the direction of the last event.
+			 */
+			void SetDeadband(Double Absolute, Double Relative, Double Hysteresis);
+
+			/**
+			 * @brief Set/Get the minimum time between two events in ms (rate limit), 0 = off (default).
+			 */
+			void setMinInterval(ULong ms);
+			ULong getMinInterval(void);
+
+			/**
+			 * @brief Set/Get the maximum time between two events in ms (heartbeat), 0 = off (default).
+			 */
+			void setMaxInterval(ULong ms);
+			ULong getMaxInterval(void);
+
+			/**
+			 * @brief Number of MoistureDetected events.
+			 */
+			ULong getEventCount(void);
+
+			/**
+			 * @brief Number of reads without event (no change beyond the deadband or rate limited).
+			 */
+			ULong getSuppressedCount(void);
+
+			/**
+			 * @brief Number of heartbeat events (MaxInterval without change).
+			 */
+			ULong getHeartbeatCount(void);
+
 			//==================================================
 			// CONSTANTS
 			//==================================================
@@ -89,5 +148,9 @@ namespace B4R {
 
 			/** @brief Moisture detected (ADC max analog value 4095). */
 			static const int MAX_VALUE = 4095;
+
+			/** @brief Read period in ms and CPU budget of the read job in us (includes the MoistureDetected event). */
+			static const ULong READ_PERIOD = 500;
+			static const ULong READ_BUDGET_US = 5000;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,645 @@
+/**
+ * @file rMqttConnector.cpp
+ * @brief Non-blocking MQTT connection state machine for B4R.
+ */
+
+#include "B4RDefines.h"
+#include "rMqttConnector.h"
+
+#ifdef ESP32
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <esp_random.h>
+#endif
+
+namespace B4R {
+
+    // MQTT 3.1.1 packet types (upper nibble of the fixed header)
+    static const uint8_t MQTT_CONNECT = 0x10;
+    static const uint8_t MQTT_CONNACK = 0x20;
+    static const uint8_t MQTT_PUBLISH = 0x30;
+    static const uint8_t MQTT_PUBACK = 0x40;
+    static const uint8_t MQTT_SUBSCRIBE = 0x82;
+    static const uint8_t MQTT_SUBACK = 0x90;
+    static const uint8_t MQTT_PINGREQ = 0xC0;
+    static const uint8_t MQTT_PINGRESP = 0xD0;
+    static const uint8_t MQTT_DISCONNECT = 0xE0;
+
+    // Receive phases
+    static const uint8_t RX_HEADER = 0;
+    static const uint8_t RX_LENGTH = 1;
+    static const uint8_t RX_BODY = 2;
+
+    /** Append a length-prefixed string, returns the new position. */
+    static size_t PutString(uint8_t* buffer, size_t pos, const char* text) {
+        size_t length = strlen(text);
+        buffer[pos++] = (uint8_t)(length >> 8);
+        buffer[pos++] = (uint8_t)length;
+        memcpy(buffer + pos, text, length);
+        return pos + length;
+    }
+
+    /** Encode the remaining length (1..4 bytes), returns the number of bytes. */
+    static size_t PutLength(uint8_t* buffer, size_t length) {
+        size_t n = 0;
+        do {
+            uint8_t b = length & 0x7F;
+            length >>= 7;
+            buffer[n++] = length > 0 ? (b | 0x80) : b;
+        } while (length > 0 && n < 4);
+        return n;
+    }
+
+    /**
+     * @brief Initialize the connector and register the poller.
+     */
+    void B4RMqttConnector::Initialize(B4RStream* Socket, ArrayByte* BrokerIP, UInt BrokerPort,
+        SubVoidByte StateChangedSub, SubVoidByte StepSub, SubVoidStringArray MessageArrivedSub) {
+        this->socket = Socket;
+        this->StateChangedSub = StateChangedSub;
+        this->StepSub = StepSub;
+        this->MessageArrivedSub = MessageArrivedSub;
+        if (BrokerIP->length == 4) memcpy(brokerIp, BrokerIP->data, 4);
+        brokerPort = BrokerPort;
+        state = STATE_IDLE;
+        attempts = 0;
+        ResetCounters();
+
+#ifdef ESP32
+        seed = esp_random();
+#else
+        seed = micros();
+#endif
+        if (seed == 0) seed = 1;
+
+        FunctionUnion fu;
+        fu.PollerFunction = looper;
+        pollers.add(fu, this);
+    }
+
+    void B4RMqttConnector::SetClient(B4RString* ClientId, B4RString* Username, B4RString* Password) {
+        strncpy(clientId, ClientId->data, sizeof(clientId) - 1);
+        strncpy(username, Username->data, sizeof(username) - 1);
+        strncpy(mqttPassword, Password->data, sizeof(mqttPassword) - 1);
+    }
+
+    void B4RMqttConnector::Start(B4RString* SSID, B4RString* Password) {
+        strncpy(ssid, SSID->data, sizeof(ssid) - 1);
+        strncpy(password, Password->data, sizeof(password) - 1);
+        attempts = 0;
+        connectStart = millis();
+#ifdef ESP32
+        WiFi.mode(WIFI_STA);
+#endif
+        Enter(STATE_WIFI);
+    }
+
+    void B4RMqttConnector::Stop() {
+        if (state >= STATE_CONNACK && state <= STATE_READY) {
+            static const uint8_t DISCONNECT[2] = {MQTT_DISCONNECT, 0x00};
+            socket->wrappedStream->write(DISCONNECT, 2);
+        }
+        SocketClose();
+        Enter(STATE_IDLE);
+    }
+
+    void B4RMqttConnector::Advance() {
+        if (state == STATE_SUBSCRIBE) {
+            attempts = 0;
+            readyCount++;
+            lastConnectTime = millis() - connectStart;
+            lastPing = millis();
+            pingOutstanding = false;
+            Enter(STATE_READY);
+        }
+    }
+
+    /**
+     * @brief Write a SUBSCRIBE packet with one topic filter.
+     */
+    bool B4RMqttConnector::Subscribe(B4RString* Topic, Byte QoS) {
+        if (state != STATE_SUBSCRIBE && state != STATE_READY) return false;
+        size_t length = strlen(Topic->data);
+        if (length == 0 || length >= RMQTTCONNECTOR_TOPIC_SIZE) return false;
+
+        uint8_t packet[RMQTTCONNECTOR_TOPIC_SIZE + 8];
+        if (++packetId == 0) packetId = 1;
+        size_t pos = 0;
+        packet[pos++] = MQTT_SUBSCRIBE;
+        pos += PutLength(packet + pos, 2 + 2 + length + 1);
+        packet[pos++] = (uint8_t)(packetId >> 8);
+        packet[pos++] = (uint8_t)packetId;
+        pos = PutString(packet, pos, Topic->data);
+        packet[pos++] = QoS > 1 ? 1 : QoS;
+        return Send(packet, pos);
+    }
+
+    /**
+     * @brief Close the socket and wait a jittered exponential backoff delay.
+     * The ceiling doubles per attempt (BackoffMin .. BackoffMax), the delay is
+     * drawn between half the ceiling and the ceiling.
+     */
+    void B4RMqttConnector::Fail() {
+        if (state == STATE_IDLE || state == STATE_BACKOFF) return;
+        if (state == STATE_READY) connectStart = millis();
+        SocketClose();
+        failCount++;
+        if (attempts < 255) attempts++;
+
+        uint32_t ceiling = backoffMin;
+        for (uint8_t i = 1; i < attempts && ceiling < backoffMax; i++) ceiling <<= 1;
+        if (ceiling > backoffMax) ceiling = backoffMax;
+        uint32_t half = ceiling / 2;
+        lastDelay = half + NextRandom() % (ceiling - half + 1);
+        backoffUntil = millis() + lastDelay;
+        Enter(STATE_BACKOFF);
+    }
+
+    /**
+     * @brief Set the state and raise StateChanged.
+     */
+    void B4RMqttConnector::Enter(uint8_t newState) {
+        state = newState;
+        stateStart = millis();
+        stepStarted = false;
+        if (state == STATE_CONNACK) {
+            rxPhase = RX_HEADER;
+            pingOutstanding = false;
+        }
+        if (state == STATE_WIFI && !WiFiUp()) WiFiBegin();
+        if (StateChangedSub != nullptr) {
+            const UInt cp = B4R::StackMemory::cp;
+            StateChangedSub(state);
+            B4R::StackMemory::cp = cp;
+        }
+    }
+
+    /**
+     * @brief xorshift32, seeded from the hardware RNG.
+     */
+    uint32_t B4RMqttConnector::NextRandom() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    /**
+     * @brief One short step per main loop pass, nothing here waits.
+     */
+    void B4RMqttConnector::looper(void* b) {
+        B4RMqttConnector* me = (B4RMqttConnector*)b;
+        uint32_t now = millis();
+        switch (me->state) {
+            case STATE_WIFI:
+                if (me->WiFiUp()) {
+                    me->Enter(STATE_TCP);
+                } else if (now - me->stateStart >= me->wifiTimeout) {
+                    me->Fail();
+                }
+                break;
+
+            case STATE_TCP: {
+                if (!me->WiFiUp()) {
+                    me->Fail();
+                    break;
+                }
+                if (!me->stepStarted) {
+                    me->stepStarted = true;
+                    if (!me->TcpStart()) {
+                        me->Fail();
+                        break;
+                    }
+                }
+                int8_t result = me->TcpPoll();
+                if (result > 0) {
+                    me->Enter(STATE_CONNACK);
+                } else if (result < 0 || now - me->stateStart >= me->connectTimeout) {
+                    me->Fail();
+                }
+                break;
+            }
+
+            case STATE_CONNACK:
+                if (!me->WiFiUp() || !me->SocketUp()) {
+                    me->Fail();
+                    break;
+                }
+                if (!me->stepStarted) {
+                    me->stepStarted = true;
+                    if (!me->SendConnect()) break;
+                }
+                me->Receive();
+                if (me->state == STATE_CONNACK && now - me->stateStart >= me->connackTimeout) me->Fail();
+                break;
+
+            case STATE_SUBSCRIBE:
+                if (!me->WiFiUp() || !me->SocketUp()) {
+                    me->Fail();
+                    break;
+                }
+                me->Receive();
+                if (me->state == STATE_SUBSCRIBE && me->StepSub != nullptr) {
+                    const UInt cp = B4R::StackMemory::cp;
+                    me->StepSub(me->state);
+                    B4R::StackMemory::cp = cp;
+                }
+                break;
+
+            case STATE_READY:
+                if (!me->WiFiUp() || !me->SocketUp()) {
+                    me->Fail();
+                    break;
+                }
+                me->Receive();
+                if (me->state != STATE_READY || me->keepAlive == 0 || now - me->lastPing < me->keepAlive) break;
+                if (me->pingOutstanding) {
+                    // No PINGRESP within one interval: the connection is dead
+                    me->missedPingCount++;
+                    me->Fail();
+                } else {
+                    me->Ping();
+                }
+                break;
+
+            case STATE_BACKOFF:
+                if ((int32_t)(now - me->backoffUntil) >= 0) me->Enter(STATE_WIFI);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    /**
+     * @brief Write a PINGREQ packet, the PINGRESP is expected before the next one.
+     */
+    void B4RMqttConnector::Ping() {
+        static const uint8_t PINGREQ[2] = {MQTT_PINGREQ, 0x00};
+        lastPing = millis();
+        if (!Send(PINGREQ, 2)) return;
+        pingOutstanding = true;
+        pingCount++;
+    }
+
+    /**
+     * @brief Write a packet in one call, a short write fails the connection.
+     */
+    bool B4RMqttConnector::Send(const uint8_t* data, size_t length) {
+        if (socket->wrappedStream->write(data, length) == length) return true;
+        Fail();
+        return false;
+    }
+
+    /**
+     * @brief Write CONNECT (MQTT 3.1.1, clean session), the CONNACK is polled by Receive.
+     */
+    bool B4RMqttConnector::SendConnect() {
+        // Body after 5 bytes of room for the fixed header, moved up once its length is known
+        uint8_t packet[5 + 10 + 2 + RMQTTCONNECTOR_CLIENTID_SIZE + 2 + RMQTTCONNECTOR_USERNAME_SIZE
+            + 2 + RMQTTCONNECTOR_PASSWORD_SIZE];
+        uint8_t* body = packet + 5;
+        size_t n = 0;
+        uint8_t flags = 0x02;
+        if (username[0] != 0) flags |= 0x80;
+        if (mqttPassword[0] != 0) flags |= 0x40;
+        uint32_t seconds = (keepAlive * 2 + 999) / 1000;
+        if (seconds > 0xFFFF) seconds = 0xFFFF;
+
+        n = PutString(body, n, "MQTT");
+        body[n++] = 4;
+        body[n++] = flags;
+        body[n++] = (uint8_t)(seconds >> 8);
+        body[n++] = (uint8_t)seconds;
+        n = PutString(body, n, clientId);
+        if (flags & 0x80) n = PutString(body, n, username);
+        if (flags & 0x40) n = PutString(body, n, mqttPassword);
+
+        size_t pos = 0;
+        packet[pos++] = MQTT_CONNECT;
+        pos += PutLength(packet + pos, n);
+        memmove(packet + pos, body, n);
+        return Send(packet, pos + n);
+    }
+
+    /**
+     * @brief Read the available bytes (at most READ_BUDGET per pass) and dispatch complete packets.
+     * Stops when a packet changed the state, e.g. a refused CONNACK.
+     */
+    void B4RMqttConnector::Receive() {
+        Stream* in = socket->wrappedStream;
+        uint8_t current = state;
+        for (uint16_t budget = RMQTTCONNECTOR_READ_BUDGET; budget > 0 && state == current; budget--) {
+            if (in->available() <= 0) return;
+            int c = in->read();
+            if (c < 0) return;
+            uint8_t b = (uint8_t)c;
+            switch (rxPhase) {
+                case RX_HEADER:
+                    rxHeader = b;
+                    rxTotal = 0;
+                    rxShift = 0;
+                    rxPhase = RX_LENGTH;
+                    break;
+
+                case RX_LENGTH:
+                    rxTotal |= (uint32_t)(b & 0x7F) << rxShift;
+                    rxShift += 7;
+                    if (b & 0x80) {
+                        if (rxShift >= 28) {
+                            // Malformed remaining length, the stream cannot be resynchronized
+                            droppedCount++;
+                            Fail();
+                        }
+                        break;
+                    }
+                    rxRemaining = rxTotal;
+                    rxLength = 0;
+                    if (rxRemaining == 0) {
+                        rxPhase = RX_HEADER;
+                        Dispatch();
+                    } else {
+                        rxPhase = RX_BODY;
+                    }
+                    break;
+
+                default:
+                    if (rxLength < sizeof(rx)) rx[rxLength++] = b;
+                    if (--rxRemaining == 0) {
+                        rxPhase = RX_HEADER;
+                        Dispatch();
+                    }
+                    break;
+            }
+        }
+    }
+
+    /**
+     * @brief Handle a received packet: CONNACK, PUBLISH (PUBACK for QoS 1), SUBACK, PINGRESP.
+     * A PUBLISH larger than the receive buffer is acknowledged but dropped.
+     */
+    void B4RMqttConnector::Dispatch() {
+        bool complete = rxTotal == rxLength;
+        switch (rxHeader & 0xF0) {
+            case MQTT_CONNACK:
+                if (state != STATE_CONNACK || rxLength < 2) break;
+                connackCode = rx[1];
+                if (connackCode == 0) Enter(STATE_SUBSCRIBE);
+                else Fail();
+                break;
+
+            case MQTT_PUBLISH: {
+                uint8_t qos = (rxHeader >> 1) & 0x03;
+                if (rxLength < 2) {
+                    droppedCount++;
+                    break;
+                }
+                uint16_t topicLength = (uint16_t)(rx[0] << 8 | rx[1]);
+                uint32_t pos = 2 + topicLength;
+                uint16_t id = 0;
+                if (qos > 0 && pos + 2 <= rxLength) id = (uint16_t)(rx[pos] << 8 | rx[pos + 1]);
+                if (qos > 0) pos += 2;
+
+                if (!complete || pos > rxLength || topicLength >= sizeof(topic)) {
+                    droppedCount++;
+                } else if (MessageArrivedSub != nullptr) {
+                    memcpy(topic, rx + 2, topicLength);
+                    topic[topicLength] = 0;
+                    receivedCount++;
+                    const UInt cp = B4R::StackMemory::cp;
+                    B4RString* t = CreateStackMemoryObject(B4RString);
+                    t->wrap(topic);
+                    ArrayByte* arr = CreateStackMemoryObject(ArrayByte);
+                    arr->data = rx + pos;
+                    arr->length = rxLength - pos;
+                    MessageArrivedSub(t, arr);
+                    B4R::StackMemory::cp = cp;
+                }
+                if (qos == 1 && id != 0 && (state == STATE_SUBSCRIBE || state == STATE_READY)) {
+                    uint8_t puback[4] = {MQTT_PUBACK, 0x02, (uint8_t)(id >> 8), (uint8_t)id};
+                    Send(puback, 4);
+                }
+                break;
+            }
+
+            case MQTT_SUBACK:
+                for (uint16_t i = 2; i < rxLength; i++) {
+                    if (rx[i] == 0x80) rejectedCount++;
+                }
+                break;
+
+            case MQTT_PINGRESP:
+                pingOutstanding = false;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+#ifdef ESP32
+    bool B4RMqttConnector::WiFiUp() {
+        return WiFi.status() == WL_CONNECTED;
+    }
+
+    void B4RMqttConnector::WiFiBegin() {
+        if (ssid[0] == 0) return;
+        WiFi.disconnect();
+        WiFi.begin(ssid, password);
+    }
+
+    /**
+     * @brief Open a non-blocking lwIP socket and start the connect (EINPROGRESS).
+     */
+    bool B4RMqttConnector::TcpStart() {
+        SocketClose();
+        int fd = lwip_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (fd < 0) return false;
+        lwip_fcntl(fd, F_SETFL, lwip_fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(brokerPort);
+        memcpy(&addr.sin_addr.s_addr, brokerIp, 4);
+        if (lwip_connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+            lwip_close(fd);
+            return false;
+        }
+        socketFd = fd;
+        return true;
+    }
+
+    /**
+     * @brief Poll the pending connect: 1 connected, 0 pending, -1 failed.
+     * Once connected the socket is handed to the WiFiClient behind the stream,
+     * which rMqttStream writes to and Receive reads from.
+     */
+    int8_t B4RMqttConnector::TcpPoll() {
+        if (socketFd < 0) return -1;
+        fd_set writable;
+        FD_ZERO(&writable);
+        FD_SET(socketFd, &writable);
+        struct timeval tv = {0, 0};
+        int result = lwip_select(socketFd + 1, nullptr, &writable, nullptr, &tv);
+        if (result == 0) return 0;
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (result < 0 || lwip_getsockopt(socketFd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+            SocketClose();
+            return -1;
+        }
+
+        // Blocking mode and no Nagle delay, as WiFiClient::connect leaves the socket
+        lwip_fcntl(socketFd, F_SETFL, lwip_fcntl(socketFd, F_GETFL, 0) & ~O_NONBLOCK);
+        int one = 1;
+        lwip_setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        WiFiClient* client = static_cast<WiFiClient*>(socket->wrappedStream);
+        *client = WiFiClient(socketFd);
+        socketFd = -1;
+        return 1;
+    }
+
+    bool B4RMqttConnector::SocketUp() {
+        return static_cast<WiFiClient*>(socket->wrappedStream)->connected();
+    }
+
+    void B4RMqttConnector::SocketClose() {
+        if (socketFd >= 0) {
+            lwip_close(socketFd);
+            socketFd = -1;
+        }
+        static_cast<WiFiClient*>(socket->wrappedStream)->stop();
+    }
+#else
+    // Other targets: the WiFi is managed elsewhere and the socket is connected by the caller
+    bool B4RMqttConnector::WiFiUp() { return true; }
+    void B4RMqttConnector::WiFiBegin() {}
+    bool B4RMqttConnector::TcpStart() { return true; }
+    int8_t B4RMqttConnector::TcpPoll() { return 1; }
+    bool B4RMqttConnector::SocketUp() { return true; }
+    void B4RMqttConnector::SocketClose() {}
+#endif
+
+    Byte B4RMqttConnector::getState() {
+        return state;
+    }
+
+    bool B4RMqttConnector::getReady() {
+        return state == STATE_READY;
+    }
+
+    bool B4RMqttConnector::getWiFiConnected() {
+        return WiFiUp();
+    }
+
+    ULong B4RMqttConnector::getStateTime() {
+        return millis() - stateStart;
+    }
+
+    void B4RMqttConnector::setBackoffMin(ULong ms) {
+        backoffMin = ms > 0 ? ms : 1;
+    }
+
+    ULong B4RMqttConnector::getBackoffMin() {
+        return backoffMin;
+    }
+
+    void B4RMqttConnector::setBackoffMax(ULong ms) {
+        backoffMax = ms > 0 ? ms : 1;
+    }
+
+    ULong B4RMqttConnector::getBackoffMax() {
+        return backoffMax;
+    }
+
+    void B4RMqttConnector::setWiFiTimeout(ULong ms) {
+        wifiTimeout = ms;
+    }
+
+    ULong B4RMqttConnector::getWiFiTimeout() {
+        return wifiTimeout;
+    }
+
+    void B4RMqttConnector::setConnectTimeout(ULong ms) {
+        connectTimeout = ms;
+    }
+
+    ULong B4RMqttConnector::getConnectTimeout() {
+        return connectTimeout;
+    }
+
+    void B4RMqttConnector::setKeepAlive(ULong ms) {
+        keepAlive = ms;
+    }
+
+    ULong B4RMqttConnector::getKeepAlive() {
+        return keepAlive;
+    }
+
+    Byte B4RMqttConnector::getAttempts() {
+        return attempts;
+    }
+
+    ULong B4RMqttConnector::getLastDelay() {
+        return lastDelay;
+    }
+
+    ULong B4RMqttConnector::getFailCount() {
+        return failCount;
+    }
+
+    ULong B4RMqttConnector::getReadyCount() {
+        return readyCount;
+    }
+
+    ULong B4RMqttConnector::getPingCount() {
+        return pingCount;
+    }
+
+    void B4RMqttConnector::setConnackTimeout(ULong ms) {
+        connackTimeout = ms;
+    }
+
+    ULong B4RMqttConnector::getConnackTimeout() {
+        return connackTimeout;
+    }
+
+    ULong B4RMqttConnector::getMissedPingCount() {
+        return missedPingCount;
+    }
+
+    ULong B4RMqttConnector::getReceivedCount() {
+        return receivedCount;
+    }
+
+    ULong B4RMqttConnector::getDroppedCount() {
+        return droppedCount;
+    }
+
+    ULong B4RMqttConnector::getRejectedCount() {
+        return rejectedCount;
+    }
+
+    Byte B4RMqttConnector::getConnackCode() {
+        return connackCode;
+    }
+
+    ULong B4RMqttConnector::getLastConnectTime() {
+        return lastConnectTime;
+    }
+
+    void B4RMqttConnector::ResetCounters() {
+        failCount = 0;
+        readyCount = 0;
+        pingCount = 0;
+        missedPingCount = 0;
+        receivedCount = 0;
+        droppedCount = 0;
+        rejectedCount = 0;
+        lastConnectTime = 0;
+        lastDelay = 0;
+    }
+
+} // namespace B4R
@@ -0,0 +1,306 @@
+/**
+ * @file rMqttConnector.h
+ * @brief Non-blocking MQTT connection state machine for B4R.
+ *
+ * Brings the broker connection up in short steps run from a poller, so the
+ * device pollers (buttons, sensors, servos) keep running while the network
+ * is down or flapping:
+ *
+ *   WIFI      Wait for the WiFi association (WiFi.begin is not blocking).
+ *   TCP       Non-blocking TCP connect of the socket to the broker (ESP32 lwIP).
+ *   CONNACK   Writes CONNECT, then polls the socket for the CONNACK once per
+ *             pass. No CONNACK within ConnackTimeout, or a refused CONNECT,
+ *             fails the attempt.
+ *   SUBSCRIBE Step event once per main loop pass: the application subscribes
+ *             the next batch of topics (Subscribe) and calls Advance when all
+ *             are done.
+ *   READY     Connected. Watches the WiFi and the socket, and writes a PINGREQ
+ *             every KeepAlive ms on its own deadline. A PINGRESP still missing
+ *             at the next deadline fails the connection.
+ *   BACKOFF   Waits a jittered exponential delay, then starts over at WIFI.
+ *
+ * Backoff: the delay ceiling doubles per failed attempt from BackoffMin up to
+ * BackoffMax, the delay is a random value between half the ceiling and the
+ * ceiling ("equal jitter"), so devices of a home do not reconnect in lockstep
+ * after a broker restart. The attempt counter is reset in READY.
+ *
+ * The connector is the MQTT client of the connection: it reads the socket in
+ * CONNACK, SUBSCRIBE and READY, raises MessageArrived for incoming PUBLISH
+ * packets (QoS 1 is acknowledged with PUBACK) and owns the keepalive. The
+ * CONNECT keepalive is twice KeepAlive, so the broker drops a silent client
+ * only after two missed pings. Publishes are written by rMqttStream to the
+ * same socket.
+ *
+ * StateChanged is raised on every transition, Step while in SUBSCRIBE.
+ * All methods run in the B4R main loop.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+
+/** Maximum SSID and password lengths in bytes. */
+#ifndef RMQTTCONNECTOR_SSID_SIZE
+#define RMQTTCONNECTOR_SSID_SIZE 33
+#endif
+#ifndef RMQTTCONNECTOR_PASSWORD_SIZE
+#define RMQTTCONNECTOR_PASSWORD_SIZE 65
+#endif
+
+/** Maximum MQTT client id, username and password lengths in bytes. */
+#ifndef RMQTTCONNECTOR_CLIENTID_SIZE
+#define RMQTTCONNECTOR_CLIENTID_SIZE 33
+#endif
+#ifndef RMQTTCONNECTOR_USERNAME_SIZE
+#define RMQTTCONNECTOR_USERNAME_SIZE 65
+#endif
+
+/** Receive buffer: larger incoming packets are dropped (DroppedCount). */
+#ifndef RMQTTCONNECTOR_RX_SIZE
+#define RMQTTCONNECTOR_RX_SIZE 1024
+#endif
+
+/** Maximum topic length of a received or subscribed topic, including the terminator. */
+#ifndef RMQTTCONNECTOR_TOPIC_SIZE
+#define RMQTTCONNECTOR_TOPIC_SIZE 128
+#endif
+
+/** Bytes read from the socket per main loop pass. */
+#ifndef RMQTTCONNECTOR_READ_BUDGET
+#define RMQTTCONNECTOR_READ_BUDGET 512
+#endif
+
+//~Library: rMqttConnector
+//~Author: Robert W.B. Linn
+//~Brief: Non-blocking MQTT connection state machine with jittered exponential backoff.
+//~Version: 1.10
+
+namespace B4R {
+
+    //~shortname: MqttConnector
+    //~Event: StateChanged (State As Byte)
+    //~Event: Step (State As Byte)
+    //~Event: MessageArrived (Topic As String, Payload() As Byte)
+    typedef void (*SubVoidByte)(Byte state);
+    typedef void (*SubVoidStringArray)(B4RString* topic, ArrayByte* payload);
+
+    class B4RMqttConnector {
+    private:
+        B4RStream* socket = nullptr;
+        SubVoidByte StateChangedSub = nullptr;
+        SubVoidByte StepSub = nullptr;
+        SubVoidStringArray MessageArrivedSub = nullptr;
+
+        uint8_t brokerIp[4] = {0, 0, 0, 0};
+        uint16_t brokerPort = 1883;
+        char ssid[RMQTTCONNECTOR_SSID_SIZE] = {0};
+        char password[RMQTTCONNECTOR_PASSWORD_SIZE] = {0};
+        char clientId[RMQTTCONNECTOR_CLIENTID_SIZE] = {0};
+        char username[RMQTTCONNECTOR_USERNAME_SIZE] = {0};
+        char mqttPassword[RMQTTCONNECTOR_PASSWORD_SIZE] = {0};
+
+        uint8_t state = 0;
+        uint32_t stateStart = 0;
+        int socketFd = -1;
+
+        // Timing (ms)
+        uint32_t backoffMin = 1000;
+        uint32_t backoffMax = 60000;
+        uint32_t wifiTimeout = 20000;
+        uint32_t connectTimeout = 5000;
+        uint32_t keepAlive = 10000;
+        uint32_t connackTimeout = 5000;
+        uint32_t backoffUntil = 0;
+        uint32_t lastPing = 0;
+        uint32_t lastDelay = 0;
+        uint32_t seed = 1;
+        bool stepStarted = false;
+        bool pingOutstanding = false;
+        uint16_t packetId = 0;
+
+        // Receive: fixed header, remaining length, body (first RX_SIZE bytes kept)
+        uint8_t rx[RMQTTCONNECTOR_RX_SIZE];
+        char topic[RMQTTCONNECTOR_TOPIC_SIZE];
+        uint8_t rxPhase = 0;
+        uint8_t rxHeader = 0;
+        uint8_t rxShift = 0;
+        uint32_t rxTotal = 0;
+        uint32_t rxRemaining = 0;
+        uint16_t rxLength = 0;
+
+        // Counters
+        uint8_t attempts = 0;
+        uint32_t failCount = 0;
+        uint32_t readyCount = 0;
+        uint32_t pingCount = 0;
+        uint32_t missedPingCount = 0;
+        uint32_t receivedCount = 0;
+        uint32_t droppedCount = 0;
+        uint32_t rejectedCount = 0;
+        uint8_t connackCode = 0;
+        uint32_t lastConnectTime = 0;
+        uint32_t connectStart = 0;
+
+        void Enter(uint8_t newState);
+        uint32_t NextRandom();
+        bool WiFiUp();
+        void WiFiBegin();
+        bool TcpStart();
+        int8_t TcpPoll();
+        bool SocketUp();
+        void SocketClose();
+        void Ping();
+        bool SendConnect();
+        bool Send(const uint8_t* data, size_t length);
+        void Receive();
+        void Dispatch();
+
+        static void looper(void* b);
+
+    public:
+        /** Connection states */
+        static const Byte STATE_IDLE = 0;
+        static const Byte STATE_WIFI = 1;
+        static const Byte STATE_TCP = 2;
+        static const Byte STATE_CONNACK = 3;
+        static const Byte STATE_SUBSCRIBE = 4;
+        static const Byte STATE_READY = 5;
+        static const Byte STATE_BACKOFF = 6;
+
+        /**
+         * Initialize the connector and register the poller. The state is IDLE until Start.
+         * @param Socket Socket stream of the connection (WiFiSocket.Stream), shared with the publisher
+         * @param BrokerIP Broker IP address (4 bytes)
+         * @param BrokerPort Broker port
+         * @param StateChangedSub Raised on every state transition
+         * @param StepSub Raised once per main loop pass in SUBSCRIBE
+         * @param MessageArrivedSub Raised for each received PUBLISH packet
+         */
+        void Initialize(B4RStream* Socket, ArrayByte* BrokerIP, UInt BrokerPort,
+            SubVoidByte StateChangedSub, SubVoidByte StepSub, SubVoidStringArray MessageArrivedSub);
+
+        /**
+         * Set the MQTT credentials sent with CONNECT, used from the next attempt on.
+         * @param ClientId MQTT client id
+         * @param Username Username, empty for none
+         * @param Password Password, empty for none
+         */
+        void SetClient(B4RString* ClientId, B4RString* Username, B4RString* Password);
+
+        /**
+         * Start the WiFi association (not blocking) and the state machine.
+         * @param SSID WiFi network name
+         * @param Password WiFi password
+         */
+        void Start(B4RString* SSID, B4RString* Password);
+
+        /** Stop the state machine, write DISCONNECT and close the socket (state IDLE). */
+        void Stop();
+
+        /** Complete the SUBSCRIBE step and move to READY. */
+        void Advance();
+
+        /**
+         * Write a SUBSCRIBE packet, in SUBSCRIBE or READY. A failed write fails the connection.
+         * @param Topic Topic filter, wildcards allowed
+         * @param QoS Maximum QoS of the received messages, 0 or 1
+         * @return True if written, false if not connected, the topic is too long or the write failed
+         */
+        bool Subscribe(B4RString* Topic, Byte QoS);
+
+        /**
+         * Report a failed step or a lost connection: the socket is closed and
+         * the connector waits a jittered backoff delay before the next attempt.
+         */
+        void Fail();
+
+        /** Current state (STATE_...) */
+        Byte getState();
+
+        /** True in READY */
+        bool getReady();
+
+        /** True if the WiFi is associated */
+        bool getWiFiConnected();
+
+        /** Milliseconds in the current state */
+        ULong getStateTime();
+
+        /**
+         * Set/Get the first backoff delay ceiling in ms (default 1000).
+         */
+        void setBackoffMin(ULong ms);
+        ULong getBackoffMin();
+
+        /**
+         * Set/Get the maximum backoff delay in ms (default 60000).
+         */
+        void setBackoffMax(ULong ms);
+        ULong getBackoffMax();
+
+        /**
+         * Set/Get the WiFi association timeout in ms (default 20000).
+         */
+        void setWiFiTimeout(ULong ms);
+        ULong getWiFiTimeout();
+
+        /**
+         * Set/Get the TCP connect timeout in ms (default 5000).
+         */
+        void setConnectTimeout(ULong ms);
+        ULong getConnectTimeout();
+
+        /**
+         * Set/Get the PINGREQ interval in READY in ms, 0 disables (default 10000).
+         * The PINGRESP must arrive before the next ping. Sent in CONNECT as twice the interval.
+         */
+        void setKeepAlive(ULong ms);
+        ULong getKeepAlive();
+
+        /**
+         * Set/Get the CONNACK timeout in ms (default 5000).
+         */
+        void setConnackTimeout(ULong ms);
+        ULong getConnackTimeout();
+
+        /** Failed attempts since the last READY */
+        Byte getAttempts();
+
+        /** Last backoff delay in ms */
+        ULong getLastDelay();
+
+        /** Number of failed attempts and lost connections */
+        ULong getFailCount();
+
+        /** Number of times READY was reached */
+        ULong getReadyCount();
+
+        /** Number of PINGREQ packets written */
+        ULong getPingCount();
+
+        /** Number of PINGRESP packets missing at the next ping (each fails the connection) */
+        ULong getMissedPingCount();
+
+        /** Number of received PUBLISH packets raised as MessageArrived */
+        ULong getReceivedCount();
+
+        /** Number of received packets dropped: larger than the receive buffer or topic too long */
+        ULong getDroppedCount();
+
+        /** Number of subscriptions refused by the broker (SUBACK 0x80) */
+        ULong getRejectedCount();
+
+        /** Return code of the last CONNACK, 0 accepted (5 not authorized) */
+        Byte getConnackCode();
+
+        /** Duration of the last connect in ms, from Start or the connection loss to READY */
+        ULong getLastConnectTime();
+
+        /** Reset the counters */
+        void ResetCounters();
+    };
+
+} // namespace B4R
@@ -0,0 +1,197 @@
+/**
+ * @file rMqttStream.cpp
+ * @brief Zero-copy MQTT publish into the socket stream for B4R.
+ */
+
+#include "B4RDefines.h"
+#include "rMqttStream.h"
+
+#ifdef ESP32
+#include <WiFi.h>
+#endif
+
+namespace B4R {
+
+    void B4RMqttStream::Initialize(B4RStream* Stream) {
+        stream = Stream->wrappedStream;
+        open = false;
+        ResetCounters();
+    }
+
+    void B4RMqttStream::setChunkSize(UInt size) {
+        chunkSize = size > 0 ? size : RMQTTSTREAM_CHUNK_SIZE;
+    }
+
+    UInt B4RMqttStream::getChunkSize() {
+        return chunkSize;
+    }
+
+    /**
+     * @brief Write the fixed header (type, remaining length) and the topic of a QoS 0 PUBLISH.
+     */
+    bool B4RMqttStream::WriteHeader(const char* topic, uint16_t topicLength, uint32_t length, bool retain) {
+        uint8_t header[7];
+        uint8_t n = 0;
+        uint32_t remaining = 2 + topicLength + length;
+
+        header[n++] = 0x30 | (retain ? 0x01 : 0x00);
+        do {
+            uint8_t b = remaining & 0x7F;
+            remaining >>= 7;
+            header[n++] = remaining > 0 ? (b | 0x80) : b;
+        } while (remaining > 0 && n < 5);
+        header[n++] = topicLength >> 8;
+        header[n++] = topicLength & 0xFF;
+
+        return WriteBytes(header, n) && WriteBytes((const uint8_t*)topic, topicLength);
+    }
+
+    /**
+     * @brief Write bytes from the caller's memory in slices of at most chunkSize,
+     * or the free send window if the socket reports one.
+     */
+    bool B4RMqttStream::WriteBytes(const uint8_t* data, uint32_t length) {
+        while (length > 0) {
+            uint32_t slice = length < chunkSize ? length : chunkSize;
+            int window = stream->availableForWrite();
+            if (window > 0 && (uint32_t)window < slice) slice = window;
+
+            size_t n = stream->write(data, slice);
+            writeCalls++;
+            if (n == 0) return false;
+            bytesSent += n;
+            data += n;
+            length -= n;
+        }
+        return true;
+    }
+
+    void B4RMqttStream::Finish(bool ok) {
+        if (ok) publishCount++;
+        else errorCount++;
+        lastDuration = micros() - startUs;
+#ifdef ESP32
+        // ESP-IDF reports the high-water mark in bytes
+        stackFree = uxTaskGetStackHighWaterMark(NULL);
+#endif
+    }
+
+    /**
+     * @brief Close the client socket after a partial packet, so the broker never
+     * parses the following bytes as part of it.
+     */
+    void B4RMqttStream::Close() {
+        closeCount++;
+#ifdef ESP32
+        static_cast<WiFiClient*>(stream)->stop();
+#endif
+    }
+
+    bool B4RMqttStream::Publish(B4RString* Topic, ArrayByte* Payload, bool Retain) {
+        return PublishRaw(Topic->data, Topic->getLength(), (const uint8_t*)Payload->data, Payload->length, Retain);
+    }
+
+    bool B4RMqttStream::PublishRaw(const char* topic, uint16_t topicLength, const uint8_t* payload, uint32_t length, bool retain) {
+        if (!stream || open) return false;
+        startUs = micros();
+        b4rStack = StackMemory::cp;
+        if (b4rStack > b4rStackMax) b4rStackMax = b4rStack;
+
+        bool ok = WriteHeader(topic, topicLength, length, retain) && WriteBytes(payload, length);
+        if (!ok) Close();
+        Finish(ok);
+        return ok;
+    }
+
+    bool B4RMqttStream::Begin(B4RString* Topic, ULong Length, bool Retain) {
+        // The open packet would get the header of this one in its payload
+        if (!stream || open) return false;
+        startUs = micros();
+        b4rStack = StackMemory::cp;
+        if (b4rStack > b4rStackMax) b4rStackMax = b4rStack;
+
+        expected = Length;
+        written = 0;
+        failed = false;
+        if (!WriteHeader(Topic->data, Topic->getLength(), Length, Retain)) {
+            Close();
+            Finish(false);
+            return false;
+        }
+        open = true;
+        return true;
+    }
+
+    bool B4RMqttStream::Write(ArrayByte* Data) {
+        if (!open || failed) return false;
+        // More than announced would corrupt the next packet on the connection
+        if (written + Data->length > expected) {
+            failed = true;
+            Close();
+            return false;
+        }
+        written += Data->length;
+        if (!WriteBytes((const uint8_t*)Data->data, Data->length)) {
+            failed = true;
+            Close();
+        }
+        return !failed;
+    }
+
+    bool B4RMqttStream::EndPublish() {
+        if (!open) return false;
+        open = false;
+        // Short of Length: the broker still waits for the rest of the packet
+        if (!failed && written != expected) Close();
+        bool ok = !failed && written == expected;
+        Finish(ok);
+        return ok;
+    }
+
+    ULong B4RMqttStream::getPublishCount() {
+        return publishCount;
+    }
+
+    ULong B4RMqttStream::getErrorCount() {
+        return errorCount;
+    }
+
+    ULong B4RMqttStream::getCloseCount() {
+        return closeCount;
+    }
+
+    ULong B4RMqttStream::getBytesSent() {
+        return bytesSent;
+    }
+
+    ULong B4RMqttStream::getWriteCalls() {
+        return writeCalls;
+    }
+
+    ULong B4RMqttStream::getLastDuration() {
+        return lastDuration;
+    }
+
+    UInt B4RMqttStream::getB4RStack() {
+        return b4rStack;
+    }
+
+    UInt B4RMqttStream::getB4RStackMax() {
+        return b4rStackMax;
+    }
+
+    ULong B4RMqttStream::getStackFree() {
+        return stackFree;
+    }
+
+    void B4RMqttStream::ResetCounters() {
+        publishCount = 0;
+        errorCount = 0;
+        bytesSent = 0;
+        writeCalls = 0;
+        lastDuration = 0;
+        closeCount = 0;
+        b4rStackMax = 0;
+    }
+
+} // namespace B4R
@@ -0,0 +1,161 @@
+/**
+ * @file rMqttStream.h
+ * @brief Zero-copy MQTT publish into the socket stream for B4R.
+ *
+ * Writes QoS 0 PUBLISH packets directly to the stream of the MQTT connection
+ * (the one passed to MqttClient.Initialize), without the intermediate buffers
+ * of BeginPublish / WriteChunk:
+ * - Publish writes the fixed header, the topic from the string and the payload
+ *   from the caller's array. Nothing is copied.
+ * - Begin / Write / EndPublish let a serializer write the payload in parts
+ *   (e.g. template text and values), Length announced in Begin.
+ *
+ * The payload is written in slices of ChunkSize (default 1436, one TCP segment)
+ * or less if the socket reports less free send window (availableForWrite).
+ *
+ * A publish that fails after its header (socket write failed, Write beyond
+ * Length, EndPublish short of Length) leaves a partial packet on the connection,
+ * which the broker would read the next bytes into. The client socket is closed
+ * then, the connector (rMqttConnector) sees the lost connection and reconnects.
+ * Begin and Publish are rejected while a Begin/EndPublish packet is open.
+ *
+ * Stack usage is recorded per publish: B4RStack is the B4R stack buffer in use
+ * by the caller (payload strings built before the call), StackFree the lowest
+ * free native stack of the calling task (FreeRTOS high-water mark).
+ *
+ * The MqttClient keeps handling connect, subscribe, receive and keep-alive.
+ * All methods run in the B4R main loop, like the MqttClient.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+
+/** Default payload slice size in bytes (TCP MSS of the ESP32 lwIP stack). */
+#ifndef RMQTTSTREAM_CHUNK_SIZE
+#define RMQTTSTREAM_CHUNK_SIZE 1436
+#endif
+
+//~Library: rMqttStream
+//~Author: Robert W.B. Linn
+//~Brief: Zero-copy MQTT publish from byte arrays or a serializer into the socket stream.
+//~Version: 1.00
+
+namespace B4R {
+
+    //~shortname: MqttStream
+    class B4RMqttStream {
+    private:
+        Stream* stream = nullptr;
+        uint16_t chunkSize = RMQTTSTREAM_CHUNK_SIZE;
+
+        // Open Begin/EndPublish packet
+        bool open = false;
+        bool failed = false;
+        uint32_t expected = 0;
+        uint32_t written = 0;
+        uint32_t startUs = 0;
+
+        // Counters
+        uint32_t publishCount = 0;
+        uint32_t errorCount = 0;
+        uint32_t bytesSent = 0;
+        uint32_t writeCalls = 0;
+        uint32_t lastDuration = 0;
+        uint16_t b4rStack = 0;
+        uint16_t b4rStackMax = 0;
+        uint32_t stackFree = 0;
+        uint32_t closeCount = 0;
+
+        bool WriteHeader(const char* topic, uint16_t topicLength, uint32_t length, bool retain);
+        bool WriteBytes(const uint8_t* data, uint32_t length);
+        void Finish(bool ok);
+        void Close();
+
+    public:
+        /** Limits */
+        static const UInt MAX_TOPIC_LENGTH = 0xFFFF;
+
+        /**
+         * Initialize with the stream of the MQTT connection.
+         * @param Stream Socket stream, e.g. WiFiSocket.Stream
+         */
+        void Initialize(B4RStream* Stream);
+
+        /**
+         * Set/Get the maximum payload slice per socket write in bytes (default 1436).
+         */
+        void setChunkSize(UInt size);
+        UInt getChunkSize();
+
+        /**
+         * Publish a payload with QoS 0, written from the array without copying.
+         * @param Topic Topic
+         * @param Payload Payload
+         * @param Retain Retain flag
+         * @return False if the socket write failed or a Begin packet is open
+         */
+        bool Publish(B4RString* Topic, ArrayByte* Payload, bool Retain);
+
+        /**
+         * Start a QoS 0 publish written in parts with Write.
+         * @param Topic Topic
+         * @param Length Total payload length written with Write
+         * @param Retain Retain flag
+         * @return False if the socket write failed (nothing to Write or End)
+         * or the previous Begin was not ended
+         */
+        bool Begin(B4RString* Topic, ULong Length, bool Retain);
+
+        /**
+         * Write a part of the payload started with Begin.
+         * @param Data Bytes, written without copying
+         * @return False if the write failed or exceeds Length
+         */
+        bool Write(ArrayByte* Data);
+
+        /**
+         * End the publish started with Begin.
+         * @return False if a write failed or less than Length was written
+         */
+        bool EndPublish();
+
+        /** Number of packets published */
+        ULong getPublishCount();
+
+        /** Number of failed publishes */
+        ULong getErrorCount();
+
+        /** Number of times the socket was closed after a partial packet */
+        ULong getCloseCount();
+
+        /** Bytes written to the socket (headers, topics and payloads) */
+        ULong getBytesSent();
+
+        /** Number of socket write calls */
+        ULong getWriteCalls();
+
+        /** Duration of the last publish in us */
+        ULong getLastDuration();
+
+        /** B4R stack buffer bytes in use by the caller at the last publish */
+        UInt getB4RStack();
+
+        /** Highest B4R stack buffer bytes in use at a publish */
+        UInt getB4RStackMax();
+
+        /** Lowest free native stack of the publishing task in bytes */
+        ULong getStackFree();
+
+        /** Reset the counters */
+        void ResetCounters();
+
+        //~hide
+        // Publish from raw memory, for C++ callers (e.g. rOutbox)
+        bool PublishRaw(const char* topic, uint16_t topicLength, const uint8_t* payload, uint32_t length, bool retain);
+    };
+
+} // namespace B4R
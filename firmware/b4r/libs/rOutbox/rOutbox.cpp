@@ -0,0 +1,453 @@
+/**
+ * @file rOutbox.cpp
+ * @brief Store-and-forward queue of outbound MQTT messages for B4R.
+ */
+
+#include "B4RDefines.h"
+#include "rOutbox.h"
+
+#ifdef ROUTBOX_FLASH
+#include <stdio.h>
+#ifdef ESP32
+#include <LittleFS.h>
+#endif
+#endif
+
+namespace B4R {
+
+    /**
+     * @brief Initialize the outbox and register the replay poller.
+     */
+    void B4ROutbox::Initialize(B4RMqttStream* Publisher, Byte Depth, SubVoidULong ReplayedSub) {
+        this->publisher = Publisher;
+        this->ReplayedSub = ReplayedSub;
+        depth = (Depth == 0 || Depth > ROUTBOX_DEPTH_MAX) ? ROUTBOX_DEPTH_MAX : Depth;
+        head = 0;
+        count = 0;
+        latestCount = 0;
+        unconfirmedHead = 0;
+        unconfirmedCount = 0;
+        connected = false;
+        replaying = false;
+        ResetCounters();
+
+        FunctionUnion fu;
+        fu.PollerFunction = looper;
+        pollers.add(fu, this);
+    }
+
+    bool B4ROutbox::AddLatestOnly(B4RString* Topic) {
+        if (latestCount == ROUTBOX_LATEST_MAX) return false;
+        latest[latestCount++] = Hash(Topic->data, Topic->getLength());
+        return true;
+    }
+
+    void B4ROutbox::setConnected(bool state) {
+        if (!state && connected) Requeue();
+        if (state && !connected && (count > 0 || FlashPending() > 0)) {
+            replaying = true;
+            replayStart = millis();
+            replayCount = 0;
+        }
+        connected = state;
+    }
+
+    bool B4ROutbox::getConnected() {
+        return connected;
+    }
+
+    void B4ROutbox::setPolicy(Byte policy) {
+        this->policy = policy;
+    }
+
+    Byte B4ROutbox::getPolicy() {
+        return policy;
+    }
+
+    void B4ROutbox::setWindow(Byte window) {
+        this->window = window > 0 ? window : 1;
+    }
+
+    Byte B4ROutbox::getWindow() {
+        return window;
+    }
+
+    void B4ROutbox::setConfirmTime(ULong ms) {
+        confirmTime = ms;
+        if (ms == 0) unconfirmedCount = 0;
+    }
+
+    ULong B4ROutbox::getConfirmTime() {
+        return confirmTime;
+    }
+
+    /**
+     * @brief FNV-1a hash of a topic.
+     */
+    uint32_t B4ROutbox::Hash(const char* s, uint16_t len) {
+        uint32_t h = 2166136261u;
+        for (uint16_t i = 0; i < len; i++) {
+            h ^= (uint8_t)s[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    bool B4ROutbox::IsLatestOnly(uint32_t hash) {
+        for (uint8_t i = 0; i < latestCount; i++) {
+            if (latest[i] == hash) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Publish now if nothing is queued, else queue in publish order.
+     */
+    bool B4ROutbox::Publish(B4RString* Topic, ArrayByte* Payload, bool Retain) {
+        // Larger messages are sent if connected, but cannot be queued or kept
+        Entry e;
+        bool fits = Fill(e, Topic, Payload, Retain);
+        lastError = ERROR_NONE;
+
+        if (connected && count == 0 && FlashPending() == 0) {
+            if (publisher->PublishRaw(Topic->data, Topic->getLength(), (const uint8_t*)Payload->data, Payload->length, Retain)) {
+                sentCount++;
+                if (fits) Keep(e);
+                return true;
+            }
+        }
+
+        if (!fits) {
+            // Rejected rather than sent behind the queue: the replay order is kept
+            oversizeCount++;
+            lastError = ERROR_PAYLOAD_TOO_LARGE;
+            return false;
+        }
+        queuedCount++;
+        if ((e.flags & FLAG_LATEST) && Compact(e)) {
+            compactedCount++;
+            return true;
+        }
+        return Enqueue(e);
+    }
+
+    bool B4ROutbox::Fill(Entry& e, B4RString* topic, ArrayByte* payload, bool retain) {
+        uint16_t topicLength = topic->getLength();
+        if (topicLength > ROUTBOX_TOPIC_SIZE || payload->length > ROUTBOX_PAYLOAD_SIZE) return false;
+        e.topicLength = topicLength;
+        e.payloadLength = payload->length;
+        e.hash = Hash(topic->data, topicLength);
+        e.flags = (retain ? FLAG_RETAIN : 0) | (IsLatestOnly(e.hash) ? FLAG_LATEST : 0);
+        memcpy(e.topic, topic->data, topicLength);
+        memcpy(e.payload, payload->data, payload->length);
+        return true;
+    }
+
+    /**
+     * @brief Replace the payload of a queued message of the same latest-only topic.
+     * @return True if a queued message was replaced
+     */
+    bool B4ROutbox::Compact(const Entry& e) {
+        Entry* q = Find(e);
+        if (!q) return false;
+        q->flags = e.flags;
+        q->payloadLength = e.payloadLength;
+        memcpy(q->payload, e.payload, e.payloadLength);
+        return true;
+    }
+
+    /**
+     * @brief Queued message in RAM of the same topic, or nullptr.
+     */
+    B4ROutbox::Entry* B4ROutbox::Find(const Entry& e) {
+        for (uint8_t i = 0; i < count; i++) {
+            Entry& q = entries[(head + i) % depth];
+            if (q.hash == e.hash && q.topicLength == e.topicLength && memcmp(q.topic, e.topic, e.topicLength) == 0) return &q;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Append to the RAM ring, or to flash if records are waiting there or the ring is full.
+     */
+    bool B4ROutbox::Enqueue(const Entry& e) {
+        if (FlashPending() > 0) {
+            if (FlashAppend(e)) return true;
+            droppedCount++;
+            lastError = ERROR_QUEUE_FULL;
+            return false;
+        }
+        if (count == depth) {
+            if (FlashAppend(e)) return true;
+            if (policy != POLICY_DROP_OLDEST) {
+                droppedCount++;
+                lastError = ERROR_QUEUE_FULL;
+                return false;
+            }
+            DropHead();
+            droppedCount++;
+        }
+        entries[(head + count) % depth] = e;
+        count++;
+        if (count > highWater) highWater = count;
+        return true;
+    }
+
+    void B4ROutbox::DropHead() {
+        head = (head + 1) % depth;
+        count--;
+    }
+
+    bool B4ROutbox::Send(const Entry& e) {
+        return publisher->PublishRaw(e.topic, e.topicLength, e.payload, e.payloadLength, e.flags & FLAG_RETAIN);
+    }
+
+    /**
+     * @brief Send up to window queued messages, oldest first. A failed write stops the pass.
+     */
+    void B4ROutbox::Drain() {
+        if (FlashPending() > 0 && count < depth) FlashLoad();
+
+        for (uint8_t i = 0; i < window && count > 0; i++) {
+            if (!Send(entries[head])) break;
+            Keep(entries[head]);
+            DropHead();
+            sentCount++;
+            if (replaying) {
+                replayCount++;
+                replayedCount++;
+            }
+            if (count == 0 && FlashPending() > 0) FlashLoad();
+        }
+
+        if (replaying && count == 0 && FlashPending() == 0) {
+            replaying = false;
+            lastReplayTime = millis() - replayStart;
+            if (ReplayedSub) {
+                const UInt cp = B4R::StackMemory::cp;
+                ReplayedSub(replayCount);
+                B4R::StackMemory::cp = cp;
+            }
+        }
+    }
+
+    /**
+     * @brief Keep a sent message until confirmed, the oldest kept one is released
+     * when Window messages are kept.
+     */
+    void B4ROutbox::Keep(const Entry& e) {
+        if (confirmTime == 0) return;
+        uint8_t limit = window < ROUTBOX_UNCONFIRMED_MAX ? window : ROUTBOX_UNCONFIRMED_MAX;
+        while (unconfirmedCount >= limit) {
+            unconfirmedHead = (unconfirmedHead + 1) % ROUTBOX_UNCONFIRMED_MAX;
+            unconfirmedCount--;
+        }
+        uint8_t i = (unconfirmedHead + unconfirmedCount) % ROUTBOX_UNCONFIRMED_MAX;
+        unconfirmed[i] = e;
+        unconfirmedAt[i] = millis();
+        unconfirmedCount++;
+    }
+
+    /**
+     * @brief Release the kept messages the connection has outlived by ConfirmTime.
+     */
+    void B4ROutbox::Confirm() {
+        uint32_t now = millis();
+        while (unconfirmedCount > 0 && now - unconfirmedAt[unconfirmedHead] >= confirmTime) {
+            unconfirmedHead = (unconfirmedHead + 1) % ROUTBOX_UNCONFIRMED_MAX;
+            unconfirmedCount--;
+        }
+    }
+
+    /**
+     * @brief Connection lost: put the unconfirmed messages back in front of the queue,
+     * in send order. Without room in the RAM ring they are dropped, they are the oldest.
+     */
+    void B4ROutbox::Requeue() {
+        while (unconfirmedCount > 0) {
+            unconfirmedCount--;
+            const Entry& e = unconfirmed[(unconfirmedHead + unconfirmedCount) % ROUTBOX_UNCONFIRMED_MAX];
+            // A newer state of a latest-only topic is queued already
+            if ((e.flags & FLAG_LATEST) && Find(e)) continue;
+            if (count == depth) {
+                droppedCount++;
+                continue;
+            }
+            head = (head + depth - 1) % depth;
+            entries[head] = e;
+            count++;
+            resentCount++;
+        }
+        unconfirmedHead = 0;
+        if (count > highWater) highWater = count;
+    }
+
+    /**
+     * @brief Main loop poller: replay while connected, confirm sent messages.
+     */
+    void B4ROutbox::looper(void* b) {
+        B4ROutbox* me = (B4ROutbox*)b;
+        if (!me->connected) return;
+        if (me->count > 0 || me->FlashPending() > 0) me->Drain();
+        me->Confirm();
+    }
+
+#ifdef ROUTBOX_FLASH
+    bool B4ROutbox::EnableFlash() {
+#ifdef ESP32
+        if (!LittleFS.begin(true)) return false;
+#endif
+        flashEnabled = true;
+        flashRead = 0;
+        flashWrite = 0;
+        // Records left from before a reboot
+        FILE* f = fopen(ROUTBOX_FLASH_PATH, "rb");
+        if (f) {
+            fseek(f, 0, SEEK_END);
+            flashWrite = ftell(f) / sizeof(Entry);
+            fclose(f);
+        }
+        return true;
+    }
+
+    bool B4ROutbox::FlashAppend(const Entry& e) {
+        if (!flashEnabled || flashWrite - flashRead >= ROUTBOX_FLASH_RECORDS) return false;
+        FILE* f = fopen(ROUTBOX_FLASH_PATH, flashWrite == 0 ? "wb" : "r+b");
+        if (!f) return false;
+        bool ok = fseek(f, flashWrite * sizeof(Entry), SEEK_SET) == 0 && fwrite(&e, sizeof(Entry), 1, f) == 1;
+        fclose(f);
+        if (!ok) return false;
+        flashWrite++;
+        spilledCount++;
+        return true;
+    }
+
+    /**
+     * @brief Move records from flash to the RAM ring, they are newer than all RAM entries.
+     */
+    bool B4ROutbox::FlashLoad() {
+        FILE* f = fopen(ROUTBOX_FLASH_PATH, "rb");
+        if (!f) {
+            FlashReset();
+            return false;
+        }
+        fseek(f, flashRead * sizeof(Entry), SEEK_SET);
+        while (count < depth && flashRead < flashWrite) {
+            Entry& e = entries[(head + count) % depth];
+            if (fread(&e, sizeof(Entry), 1, f) != 1) {
+                flashWrite = flashRead;
+                break;
+            }
+            flashRead++;
+            count++;
+        }
+        fclose(f);
+        if (count > highWater) highWater = count;
+        if (flashRead >= flashWrite) FlashReset();
+        return true;
+    }
+
+    void B4ROutbox::FlashReset() {
+        remove(ROUTBOX_FLASH_PATH);
+        flashRead = 0;
+        flashWrite = 0;
+    }
+
+    uint32_t B4ROutbox::FlashPending() {
+        return flashWrite - flashRead;
+    }
+#else
+    bool B4ROutbox::EnableFlash() {
+        return false;
+    }
+
+    bool B4ROutbox::FlashAppend(const Entry&) {
+        return false;
+    }
+
+    bool B4ROutbox::FlashLoad() {
+        return false;
+    }
+
+    void B4ROutbox::FlashReset() {
+    }
+
+    uint32_t B4ROutbox::FlashPending() {
+        return 0;
+    }
+#endif
+
+    Byte B4ROutbox::getCount() {
+        return count;
+    }
+
+    ULong B4ROutbox::getFlashCount() {
+        return FlashPending();
+    }
+
+    Byte B4ROutbox::getDepth() {
+        return depth;
+    }
+
+    Byte B4ROutbox::getHighWater() {
+        return highWater;
+    }
+
+    ULong B4ROutbox::getQueuedCount() {
+        return queuedCount;
+    }
+
+    ULong B4ROutbox::getSentCount() {
+        return sentCount;
+    }
+
+    ULong B4ROutbox::getDroppedCount() {
+        return droppedCount;
+    }
+
+    ULong B4ROutbox::getOversizeCount() {
+        return oversizeCount;
+    }
+
+    Byte B4ROutbox::getLastError() {
+        return lastError;
+    }
+
+    ULong B4ROutbox::getCompactedCount() {
+        return compactedCount;
+    }
+
+    ULong B4ROutbox::getSpilledCount() {
+        return spilledCount;
+    }
+
+    ULong B4ROutbox::getReplayedCount() {
+        return replayedCount;
+    }
+
+    ULong B4ROutbox::getResentCount() {
+        return resentCount;
+    }
+
+    Byte B4ROutbox::getUnconfirmedCount() {
+        return unconfirmedCount;
+    }
+
+    ULong B4ROutbox::getLastReplayTime() {
+        return lastReplayTime;
+    }
+
+    void B4ROutbox::ResetCounters() {
+        queuedCount = 0;
+        sentCount = 0;
+        droppedCount = 0;
+        oversizeCount = 0;
+        compactedCount = 0;
+        spilledCount = 0;
+        replayedCount = 0;
+        resentCount = 0;
+        lastReplayTime = 0;
+        highWater = count;
+    }
+
+} // namespace B4R
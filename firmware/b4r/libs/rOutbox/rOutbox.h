@@ -0,0 +1,295 @@
+/**
+ * @file rOutbox.h
+ * @brief Store-and-forward queue of outbound MQTT messages for B4R.
+ *
+ * Messages published while the broker is unreachable are kept and replayed
+ * in publish order after the reconnect:
+ * - RAM ring of Depth entries (topic and payload copied).
+ * - Optional spill to a flash file when the ring is full (ROUTBOX_FLASH, LittleFS
+ *   on the ESP32). Once records are in flash, new messages are appended there
+ *   too so the order is kept. Records left in flash are replayed after a reboot.
+ * - Latest-only topics (AddLatestOnly), e.g. retained state topics: a newer
+ *   message replaces the payload of a queued message of the same topic in RAM
+ *   (compaction), so only the latest state is replayed. Event topics (RFID
+ *   scans, alarms) are never compacted.
+ * - Full queue policy: drop the oldest (default) or reject the newest message.
+ * - Messages larger than TOPIC_SIZE/PAYLOAD_SIZE are sent only directly
+ *   (connected, nothing queued). Otherwise they are rejected, never queued
+ *   out of order: Publish returns False, LastError is ERROR_PAYLOAD_TOO_LARGE
+ *   and OversizeCount counts them apart from the full queue drops.
+ *
+ * While connected and nothing is queued, Publish writes immediately through
+ * the MqttStream. A poller replays queued messages, at most Window messages
+ * per main loop pass, and stops at the first failed write (the message stays
+ * queued). Publishes are QoS 0, the MQTT client library does not report
+ * PUBACKs, so Window paces the replay instead of bounding unacknowledged QoS 1
+ * messages.
+ *
+ * Unconfirmed messages: a QoS 0 write succeeds once the bytes are in the socket
+ * buffer, so messages written just before an outage can be lost. The last
+ * Window sent messages (at most UNCONFIRMED_MAX) are kept until the connection
+ * has stayed up ConfirmTime ms after them, several answered pings of the
+ * connector. On disconnect they are put back
+ * in front of the queue and sent again after the reconnect, so a message can
+ * arrive twice but is not lost. A kept latest-only message is not sent again if
+ * a newer one of its topic is queued.
+ *
+ * Requires rMqttStream. All methods run in the B4R main loop.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+#include "rMqttStream.h"
+
+/** Maximum RAM ring depth (entries are allocated statically). */
+#ifndef ROUTBOX_DEPTH_MAX
+#define ROUTBOX_DEPTH_MAX 16
+#endif
+
+/** Maximum topic length in bytes. */
+#ifndef ROUTBOX_TOPIC_SIZE
+#define ROUTBOX_TOPIC_SIZE 48
+#endif
+
+/** Maximum payload length in bytes of a queued or kept message. */
+#ifndef ROUTBOX_PAYLOAD_SIZE
+#define ROUTBOX_PAYLOAD_SIZE 128
+#endif
+
+/** Maximum number of sent messages kept until confirmed. */
+#ifndef ROUTBOX_UNCONFIRMED_MAX
+#define ROUTBOX_UNCONFIRMED_MAX 8
+#endif
+
+/** Maximum number of latest-only topics. */
+#ifndef ROUTBOX_LATEST_MAX
+#define ROUTBOX_LATEST_MAX 16
+#endif
+
+/** Spill file path and maximum number of records in flash (define ROUTBOX_FLASH to enable). */
+#ifndef ROUTBOX_FLASH_PATH
+#define ROUTBOX_FLASH_PATH "/littlefs/outbox.bin"
+#endif
+#ifndef ROUTBOX_FLASH_RECORDS
+#define ROUTBOX_FLASH_RECORDS 256
+#endif
+
+//~Library: rOutbox
+//~Author: Robert W.B. Linn
+//~Brief: Store-and-forward queue of outbound MQTT messages with compaction and flash spill.
+//~Version: 1.00
+
+namespace B4R {
+
+    //~shortname: Outbox
+    //~Event: Replayed (Count As ULong)
+    typedef void (*SubVoidULong)(ULong count);
+
+    class B4ROutbox {
+    private:
+        struct Entry {
+            uint8_t flags;
+            uint8_t topicLength;
+            uint16_t payloadLength;
+            uint32_t hash;
+            char topic[ROUTBOX_TOPIC_SIZE];
+            uint8_t payload[ROUTBOX_PAYLOAD_SIZE];
+        };
+        static const uint8_t FLAG_RETAIN = 0x01;
+        static const uint8_t FLAG_LATEST = 0x02;
+
+        B4RMqttStream* publisher = nullptr;
+        SubVoidULong ReplayedSub = nullptr;
+
+        // RAM ring
+        Entry entries[ROUTBOX_DEPTH_MAX];
+        uint8_t depth = ROUTBOX_DEPTH_MAX;
+        uint8_t head = 0;
+        uint8_t count = 0;
+        uint8_t policy = 1;
+        uint8_t window = 4;
+        bool connected = false;
+
+        // Latest-only topic hashes
+        uint32_t latest[ROUTBOX_LATEST_MAX];
+        uint8_t latestCount = 0;
+
+        // Flash spill (record indexes in the spill file)
+        bool flashEnabled = false;
+        uint32_t flashRead = 0;
+        uint32_t flashWrite = 0;
+
+        // Sent messages not yet confirmed, oldest first
+        Entry unconfirmed[ROUTBOX_UNCONFIRMED_MAX];
+        uint32_t unconfirmedAt[ROUTBOX_UNCONFIRMED_MAX];
+        uint8_t unconfirmedHead = 0;
+        uint8_t unconfirmedCount = 0;
+        uint32_t confirmTime = 30000;
+
+        // Replay
+        bool replaying = false;
+        uint32_t replayStart = 0;
+        uint32_t replayCount = 0;
+
+        // Counters
+        uint32_t queuedCount = 0;
+        uint32_t sentCount = 0;
+        uint32_t droppedCount = 0;
+        uint32_t oversizeCount = 0;
+        uint8_t lastError = 0;
+        uint32_t compactedCount = 0;
+        uint32_t spilledCount = 0;
+        uint32_t replayedCount = 0;
+        uint32_t resentCount = 0;
+        uint32_t lastReplayTime = 0;
+        uint8_t highWater = 0;
+
+        static uint32_t Hash(const char* s, uint16_t len);
+        bool IsLatestOnly(uint32_t hash);
+        bool Fill(Entry& e, B4RString* topic, ArrayByte* payload, bool retain);
+        bool Compact(const Entry& e);
+        Entry* Find(const Entry& e);
+        bool Enqueue(const Entry& e);
+        void DropHead();
+        bool Send(const Entry& e);
+        void Drain();
+        void Keep(const Entry& e);
+        void Confirm();
+        void Requeue();
+
+        bool FlashAppend(const Entry& e);
+        bool FlashLoad();
+        void FlashReset();
+        uint32_t FlashPending();
+
+        static void looper(void* b);
+
+    public:
+        /** Full queue policies */
+        static const Byte POLICY_REJECT_NEWEST = 0;
+        static const Byte POLICY_DROP_OLDEST = 1;
+
+        /** Publish errors (LastError) */
+        static const Byte ERROR_NONE = 0;
+        static const Byte ERROR_QUEUE_FULL = 1;
+        static const Byte ERROR_PAYLOAD_TOO_LARGE = 2;
+
+        /** Limits */
+        static const Byte DEPTH_MAX = ROUTBOX_DEPTH_MAX;
+        static const UInt TOPIC_SIZE = ROUTBOX_TOPIC_SIZE;
+        static const UInt PAYLOAD_SIZE = ROUTBOX_PAYLOAD_SIZE;
+        static const Byte UNCONFIRMED_MAX = ROUTBOX_UNCONFIRMED_MAX;
+
+        /**
+         * Initialize the outbox and register the replay poller.
+         * @param Publisher MqttStream used to write the messages
+         * @param Depth RAM ring depth, 1 to DEPTH_MAX
+         * @param ReplayedSub Raised when a replay after reconnect is complete
+         */
+        void Initialize(B4RMqttStream* Publisher, Byte Depth, SubVoidULong ReplayedSub);
+
+        /**
+         * Enable the flash spill file (only with ROUTBOX_FLASH).
+         * Records left from before a reboot are queued for replay.
+         * @return False if the file system is not available
+         */
+        bool EnableFlash();
+
+        /**
+         * Mark a topic as latest-only: a queued message is replaced by a newer one.
+         * @param Topic Topic, e.g. a retained state topic
+         */
+        bool AddLatestOnly(B4RString* Topic);
+
+        /**
+         * Set/Get the connection state. Set True after connect, False on disconnect.
+         * Queued messages are replayed while connected. On disconnect the
+         * unconfirmed sent messages are queued again in front.
+         */
+        void setConnected(bool state);
+        bool getConnected();
+
+        /**
+         * Set/Get the full queue policy (default POLICY_DROP_OLDEST).
+         */
+        void setPolicy(Byte policy);
+        Byte getPolicy();
+
+        /**
+         * Set/Get the number of messages replayed per main loop pass (default 4).
+         * Also the number of sent messages kept until confirmed (at most UNCONFIRMED_MAX).
+         */
+        void setWindow(Byte window);
+        Byte getWindow();
+
+        /**
+         * Set/Get the time in ms the connection must stay up after a send before
+         * the message is confirmed (default 30000, above the keep-alive timeout).
+         * 0 confirms on send: nothing is sent again after a reconnect.
+         */
+        void setConfirmTime(ULong ms);
+        ULong getConfirmTime();
+
+        /**
+         * Publish a message: sent now if connected and nothing is queued, else queued.
+         * @param Topic Topic, at most TOPIC_SIZE bytes to be queued
+         * @param Payload Payload, at most PAYLOAD_SIZE bytes to be queued
+         * @param Retain Retain flag
+         * @return False if the message was dropped, see LastError
+         */
+        bool Publish(B4RString* Topic, ArrayByte* Payload, bool Retain);
+
+        /** Error of the last Publish (ERROR_...), ERROR_NONE if it was sent or queued */
+        Byte getLastError();
+
+        /** Number of messages queued in RAM */
+        Byte getCount();
+
+        /** Number of messages queued in flash */
+        ULong getFlashCount();
+
+        /** RAM ring depth */
+        Byte getDepth();
+
+        /** Highest number of messages queued in RAM */
+        Byte getHighWater();
+
+        /** Number of messages queued while disconnected or behind others */
+        ULong getQueuedCount();
+
+        /** Number of messages sent */
+        ULong getSentCount();
+
+        /** Number of messages dropped by a full queue */
+        ULong getDroppedCount();
+
+        /** Number of messages too large to be queued, rejected while disconnected or behind others */
+        ULong getOversizeCount();
+
+        /** Number of queued messages replaced by a newer one of a latest-only topic */
+        ULong getCompactedCount();
+
+        /** Number of messages written to flash */
+        ULong getSpilledCount();
+
+        /** Number of messages sent by replays */
+        ULong getReplayedCount();
+
+        /** Number of sent messages queued again because the connection was lost before confirmation */
+        ULong getResentCount();
+
+        /** Number of sent messages not yet confirmed */
+        Byte getUnconfirmedCount();
+
+        /** Duration of the last replay in ms (reconnect to queue empty) */
+        ULong getLastReplayTime();
+
+        /** Reset the counters */
+        void ResetCounters();
+    };
+
+} // namespace B4R
@@ -0,0 +1,289 @@
+/**
+ * @file rPayloadCodec.cpp
+ * @brief Per-topic MQTT payload format (JSON, CBOR, MessagePack) for B4R.
+ */
+
+#include "B4RDefines.h"
+#include "rPayloadCodec.h"
+
+namespace B4R {
+
+    // ---------------------------------------------------------------
+    // PayloadWriter
+    // ---------------------------------------------------------------
+
+    PayloadWriter::PayloadWriter(uint8_t* out, uint16_t size, uint8_t format) {
+        this->out = out;
+        this->size = size;
+        this->format = format;
+    }
+
+    void PayloadWriter::Put(uint8_t b) {
+        if (length < size) out[length++] = b;
+        else overflow = true;
+    }
+
+    void PayloadWriter::PutBig(uint32_t value, uint8_t bytes) {
+        for (int8_t shift = 8 * (bytes - 1); shift >= 0; shift -= 8) Put((uint8_t)(value >> shift));
+    }
+
+    /**
+     * @brief CBOR initial byte with the argument in the shortest form.
+     */
+    void PayloadWriter::CborHead(uint8_t major, uint32_t value) {
+        major <<= 5;
+        if (value < 24) {
+            Put(major | value);
+        } else if (value <= 0xFF) {
+            Put(major | 24);
+            Put((uint8_t)value);
+        } else if (value <= 0xFFFF) {
+            Put(major | 25);
+            PutBig(value, 2);
+        } else {
+            Put(major | 26);
+            PutBig(value, 4);
+        }
+    }
+
+    void PayloadWriter::Map(uint16_t count) {
+        if (format == B4RJsonIndex::FORMAT_CBOR) {
+            CborHead(5, count);
+        } else if (count < 16) {
+            Put(0x80 | count);
+        } else {
+            Put(0xDE);
+            PutBig(count, 2);
+        }
+    }
+
+    void PayloadWriter::TextHead(uint16_t textLength) {
+        if (format == B4RJsonIndex::FORMAT_CBOR) {
+            CborHead(3, textLength);
+        } else if (textLength < 32) {
+            Put(0xA0 | textLength);
+        } else if (textLength <= 0xFF) {
+            Put(0xD9);
+            Put((uint8_t)textLength);
+        } else {
+            Put(0xDA);
+            PutBig(textLength, 2);
+        }
+    }
+
+    void PayloadWriter::Text(const char* text, uint16_t textLength) {
+        TextHead(textLength);
+        Raw((const uint8_t*)text, textLength);
+    }
+
+    void PayloadWriter::Raw(const uint8_t* data, uint16_t dataLength) {
+        if (dataLength > size - length) {
+            overflow = true;
+            length = size;
+            return;
+        }
+        memcpy(out + length, data, dataLength);
+        length += dataLength;
+    }
+
+    /**
+     * @brief Integer in the shortest form (CBOR major 0/1, MessagePack fixint/int/uint).
+     */
+    void PayloadWriter::Integer(int32_t value) {
+        if (format == B4RJsonIndex::FORMAT_CBOR) {
+            if (value >= 0) CborHead(0, (uint32_t)value);
+            else CborHead(1, (uint32_t)(-1 - value));
+            return;
+        }
+        if (value >= 0) {
+            if (value < 128) {
+                Put((uint8_t)value);
+            } else if (value <= 0xFF) {
+                Put(0xCC);
+                Put((uint8_t)value);
+            } else if (value <= 0xFFFF) {
+                Put(0xCD);
+                PutBig((uint32_t)value, 2);
+            } else {
+                Put(0xCE);
+                PutBig((uint32_t)value, 4);
+            }
+        } else if (value >= -32) {
+            Put((uint8_t)(int8_t)value);
+        } else if (value >= -128) {
+            Put(0xD0);
+            Put((uint8_t)(int8_t)value);
+        } else if (value >= -32768) {
+            Put(0xD1);
+            PutBig((uint16_t)(int16_t)value, 2);
+        } else {
+            Put(0xD2);
+            PutBig((uint32_t)value, 4);
+        }
+    }
+
+    void PayloadWriter::Float(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, 4);
+        Put(format == B4RJsonIndex::FORMAT_CBOR ? 0xFA : 0xCA);
+        PutBig(bits, 4);
+    }
+
+    void PayloadWriter::Float64(double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, 8);
+        Put(format == B4RJsonIndex::FORMAT_CBOR ? 0xFB : 0xCB);
+        PutBig((uint32_t)(bits >> 32), 4);
+        PutBig((uint32_t)bits, 4);
+    }
+
+    void PayloadWriter::Bool(bool value) {
+        if (format == B4RJsonIndex::FORMAT_CBOR) Put(value ? 0xF5 : 0xF4);
+        else Put(value ? 0xC3 : 0xC2);
+    }
+
+    void PayloadWriter::Null() {
+        Put(format == B4RJsonIndex::FORMAT_CBOR ? 0xF6 : 0xC0);
+    }
+
+    // ---------------------------------------------------------------
+    // B4RPayloadCodec
+    // ---------------------------------------------------------------
+
+    void B4RPayloadCodec::Initialize() {
+        topicCount = 0;
+        defaultFormat = FORMAT_JSON;
+        ResetCounters();
+    }
+
+    /**
+     * @brief FNV-1a hash of a topic.
+     */
+    uint32_t B4RPayloadCodec::Hash(const char* s, uint16_t len) {
+        uint32_t h = 2166136261u;
+        for (uint16_t i = 0; i < len; i++) {
+            h ^= (uint8_t)s[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    bool B4RPayloadCodec::SetTopicFormat(B4RString* Topic, Byte Format) {
+        uint32_t h = Hash(Topic->data, Topic->getLength());
+        for (uint8_t i = 0; i < topicCount; i++) {
+            if (hashes[i] == h) {
+                formats[i] = Format;
+                return true;
+            }
+        }
+        if (topicCount == RPAYLOADCODEC_TOPICS_MAX) return false;
+        hashes[topicCount] = h;
+        formats[topicCount++] = Format;
+        return true;
+    }
+
+    Byte B4RPayloadCodec::TopicFormat(B4RString* Topic) {
+        if (topicCount == 0) return defaultFormat;
+        uint32_t h = Hash(Topic->data, Topic->getLength());
+        for (uint8_t i = 0; i < topicCount; i++) {
+            if (hashes[i] == h) return formats[i];
+        }
+        return defaultFormat;
+    }
+
+    void B4RPayloadCodec::setDefaultFormat(Byte format) {
+        defaultFormat = format;
+    }
+
+    Byte B4RPayloadCodec::getDefaultFormat() {
+        return defaultFormat;
+    }
+
+    Byte B4RPayloadCodec::Detect(ArrayByte* Payload) {
+        return B4RJsonIndex::DetectFormat((const uint8_t*)Payload->data, Payload->length);
+    }
+
+    /**
+     * @brief Index the JSON object and write its members in the binary format.
+     * Numbers with a fraction become float32, integers outside 32 bits float64.
+     */
+    uint16_t B4RPayloadCodec::TranscodeInto(const char* json, uint16_t length, uint8_t format, uint8_t* out, uint16_t size) {
+        if (format == FORMAT_JSON || !index.ParseBytes(json, length)) return 0;
+
+        PayloadWriter w(out, size, format);
+        uint8_t n = index.getCount();
+        w.Map(n);
+        for (uint8_t i = 0; i < n; i++) {
+            B4RJsonIndex::Member m;
+            index.MemberAt(i, m);
+            w.Text(m.key, m.keyLength);
+            switch (m.type) {
+                case B4RJsonIndex::TYPE_STRING: {
+                    char text[RJSONINDEX_TEXT_SIZE];
+                    w.Text(text, index.TextAt(i, text, sizeof(text)));
+                    break;
+                }
+                case B4RJsonIndex::TYPE_NUMBER:
+                    if (m.integer && m.doubleValue == (double)m.longValue) w.Integer(m.longValue);
+                    else if (m.integer) w.Float64(m.doubleValue);
+                    else w.Float((float)m.doubleValue);
+                    break;
+                case B4RJsonIndex::TYPE_BOOL:
+                    w.Bool(m.longValue != 0);
+                    break;
+                case B4RJsonIndex::TYPE_NULL:
+                    w.Null();
+                    break;
+                default:
+                    // Nested objects and arrays stay JSON
+                    return 0;
+            }
+        }
+        // More members than the index holds are not encoded
+        if (w.getOverflow() || n == B4RJsonIndex::MAX_FIELDS) return 0;
+        return w.getLength();
+    }
+
+    ArrayByte* B4RPayloadCodec::Transcode(ArrayByte* Json, Byte Format) {
+        ArrayByte* arr = CreateStackMemoryObject(ArrayByte);
+        arr->data = Json->data;
+        arr->length = Json->length;
+        if (Format == FORMAT_JSON) return arr;
+
+        uint16_t n = TranscodeInto((const char*)Json->data, Json->length, Format, buffer, sizeof(buffer));
+        if (n == 0) {
+            failCount++;
+            return arr;
+        }
+        encodeCount++;
+        jsonBytes += Json->length;
+        encodedBytes += n;
+        arr->data = buffer;
+        arr->length = n;
+        return arr;
+    }
+
+    ULong B4RPayloadCodec::getEncodeCount() {
+        return encodeCount;
+    }
+
+    ULong B4RPayloadCodec::getFailCount() {
+        return failCount;
+    }
+
+    ULong B4RPayloadCodec::getJsonBytes() {
+        return jsonBytes;
+    }
+
+    ULong B4RPayloadCodec::getEncodedBytes() {
+        return encodedBytes;
+    }
+
+    void B4RPayloadCodec::ResetCounters() {
+        encodeCount = 0;
+        failCount = 0;
+        jsonBytes = 0;
+        encodedBytes = 0;
+    }
+
+} // namespace B4R
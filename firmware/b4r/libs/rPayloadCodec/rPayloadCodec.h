@@ -0,0 +1,157 @@
+/**
+ * @file rPayloadCodec.h
+ * @brief Per-topic MQTT payload format (JSON, CBOR, MessagePack) for B4R.
+ *
+ * JSON stays the default. Topics set to CBOR (RFC 8949) or MessagePack are
+ * published as a binary map with the same one-letter keys and values, which
+ * is smaller and needs no number formatting on the board:
+ * - PayloadWriter (C++): streaming encoder into a caller buffer, used by
+ *   rPayloadTemplate.RenderAs to render templates directly in the format.
+ * - Transcode: a flat JSON object (e.g. a fixed payload such as {"s":"on"})
+ *   re-encoded member by member from its rJsonIndex spans.
+ * - Receiving: rJsonIndex.ParseAuto indexes JSON, CBOR and MessagePack maps
+ *   without allocation, the typed getters are the same for all formats.
+ *
+ * Encoding: integers in the smallest form, numbers with a fraction as
+ * float32 (7 significant digits, decoders round to that), NaN as null, text
+ * as UTF-8 text strings. The first byte tells the format apart: '{' JSON,
+ * 0xA0-0xBB CBOR map, 0x80-0x8F / 0xDE / 0xDF MessagePack map.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+#include "rJsonIndex.h"
+
+/** Maximum number of topics with a format other than DefaultFormat. */
+#ifndef RPAYLOADCODEC_TOPICS_MAX
+#define RPAYLOADCODEC_TOPICS_MAX 16
+#endif
+
+/** Size of the output buffer used by Transcode. */
+#ifndef RPAYLOADCODEC_BUFFER_SIZE
+#define RPAYLOADCODEC_BUFFER_SIZE 128
+#endif
+
+//~Library: rPayloadCodec
+//~Author: Robert W.B. Linn
+//~Brief: Per-topic MQTT payload format with streaming CBOR and MessagePack encoding.
+//~Version: 1.00
+
+namespace B4R {
+
+    //~hide
+    /**
+     * Streaming CBOR / MessagePack encoder into a fixed buffer.
+     * Writes past the end set Overflow, the length is then not valid.
+     */
+    class PayloadWriter {
+    private:
+        uint8_t* out;
+        uint16_t size;
+        uint16_t length = 0;
+        uint8_t format;
+        bool overflow = false;
+
+        void Put(uint8_t b);
+        void PutBig(uint32_t value, uint8_t bytes);
+        void CborHead(uint8_t major, uint32_t value);
+
+    public:
+        PayloadWriter(uint8_t* out, uint16_t size, uint8_t format);
+        void Map(uint16_t count);
+        void TextHead(uint16_t textLength);
+        void Text(const char* text, uint16_t textLength);
+        void Raw(const uint8_t* data, uint16_t dataLength);
+        void Integer(int32_t value);
+        void Float(float value);
+        void Float64(double value);
+        void Bool(bool value);
+        void Null();
+        uint16_t getLength() { return length; }
+        bool getOverflow() { return overflow; }
+    };
+
+    //~shortname: PayloadCodec
+    class B4RPayloadCodec {
+    private:
+        uint32_t hashes[RPAYLOADCODEC_TOPICS_MAX];
+        uint8_t formats[RPAYLOADCODEC_TOPICS_MAX];
+        uint8_t topicCount = 0;
+        uint8_t defaultFormat = 0;
+        B4RJsonIndex index;
+        uint8_t buffer[RPAYLOADCODEC_BUFFER_SIZE];
+
+        uint32_t encodeCount = 0;
+        uint32_t failCount = 0;
+        uint32_t jsonBytes = 0;
+        uint32_t encodedBytes = 0;
+
+        static uint32_t Hash(const char* s, uint16_t len);
+
+    public:
+        /** Payload formats */
+        static const Byte FORMAT_JSON = B4RJsonIndex::FORMAT_JSON;
+        static const Byte FORMAT_CBOR = B4RJsonIndex::FORMAT_CBOR;
+        static const Byte FORMAT_MSGPACK = B4RJsonIndex::FORMAT_MSGPACK;
+
+        /** Limits */
+        static const Byte TOPICS_MAX = RPAYLOADCODEC_TOPICS_MAX;
+        static const UInt BUFFER_SIZE = RPAYLOADCODEC_BUFFER_SIZE;
+
+        /** Clear the topic formats and the counters. */
+        void Initialize();
+
+        /**
+         * Set the format of a topic.
+         * @param Topic Topic
+         * @param Format FORMAT_JSON, FORMAT_CBOR or FORMAT_MSGPACK
+         * @return False if TOPICS_MAX topics are set
+         */
+        bool SetTopicFormat(B4RString* Topic, Byte Format);
+
+        /** Format of a topic, DefaultFormat if not set */
+        Byte TopicFormat(B4RString* Topic);
+
+        /**
+         * Set/Get the format of the topics without an own format (default FORMAT_JSON).
+         */
+        void setDefaultFormat(Byte format);
+        Byte getDefaultFormat();
+
+        /** Format of a payload from its first byte (FORMAT_JSON if not a binary map) */
+        Byte Detect(ArrayByte* Payload);
+
+        /**
+         * Re-encode a flat JSON object in a binary format.
+         * @param Json JSON payload
+         * @param Format FORMAT_CBOR or FORMAT_MSGPACK
+         * @return Encoded payload, valid until the next Transcode. The JSON payload unchanged
+         *         for FORMAT_JSON, nested values or a payload that does not fit BUFFER_SIZE.
+         */
+        ArrayByte* Transcode(ArrayByte* Json, Byte Format);
+
+        /** Number of payloads transcoded */
+        ULong getEncodeCount();
+
+        /** Number of payloads left as JSON (nested, invalid, too large) */
+        ULong getFailCount();
+
+        /** Total JSON bytes transcoded */
+        ULong getJsonBytes();
+
+        /** Total encoded bytes */
+        ULong getEncodedBytes();
+
+        /** Reset the counters */
+        void ResetCounters();
+
+        //~hide
+        // Transcode for C++ callers and host tools, returns 0 if not transcoded
+        uint16_t TranscodeInto(const char* json, uint16_t length, uint8_t format, uint8_t* out, uint16_t size);
+    };
+
+} // namespace B4R
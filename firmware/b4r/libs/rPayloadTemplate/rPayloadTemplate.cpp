@@ -0,0 +1,431 @@
+/**
+ * @file rPayloadTemplate.cpp
+ * @brief Precompiled payload templates rendered in one pass for B4R.
+ */
+
+#include "B4RDefines.h"
+#include "rPayloadTemplate.h"
+#include <stdlib.h>
+
+namespace B4R {
+
+    /**
+     * @brief Split the template into literal and field segments.
+     */
+    bool B4RPayloadTemplate::Initialize(B4RString* Template) {
+        segmentCount = 0;
+        fieldCount = 0;
+        error = ERROR_NONE;
+        memset(letters, 0xFF, sizeof(letters));
+
+        uint16_t length = Template->getLength();
+        if (length > RPAYLOADTEMPLATE_TEXT_SIZE) {
+            error = ERROR_TEMPLATE_TOO_LONG;
+            return false;
+        }
+        memcpy(text, Template->data, length);
+
+        uint8_t start = 0;
+        for (uint8_t i = 0; i < length; i++) {
+            if (text[i] != '#' || i + 1 >= length || text[i + 1] < 'A' || text[i + 1] > 'Z') continue;
+
+            if (i > start && !AddSegment(start, i - start, 0)) return false;
+
+            uint8_t letter = text[i + 1] - 'A';
+            if (letters[letter] == 0xFF) {
+                if (fieldCount == RPAYLOADTEMPLATE_MAX_FIELDS) {
+                    error = ERROR_TOO_MANY_FIELDS;
+                    return false;
+                }
+                values[fieldCount].type = TYPE_NONE;
+                letters[letter] = fieldCount++;
+            }
+            if (!AddSegment(0, 0, letters[letter])) return false;
+            i++;
+            start = i + 1;
+        }
+        if (length > start && !AddSegment(start, length - start, 0)) return false;
+        binary = CompileMembers((uint8_t)length);
+        return true;
+    }
+
+    /**
+     * @brief Compile a flat object template { "key" : value , ... } into members.
+     * A value is a literal (string, number, true, false, null), #X or "#X".
+     * @return False for other templates (nested values, fields inside text, escapes)
+     */
+    bool B4RPayloadTemplate::CompileMembers(uint8_t length) {
+        memberCount = 0;
+        uint8_t i = 0;
+        #define SKIP_WS() while (i < length && (text[i] == ' ' || text[i] == '\t' || text[i] == '\r' || text[i] == '\n')) i++
+
+        SKIP_WS();
+        if (i >= length || text[i++] != '{') return false;
+        SKIP_WS();
+        if (i < length && text[i] == '}') return ++i == length;
+
+        for (;;) {
+            if (memberCount == RPAYLOADTEMPLATE_MAX_MEMBERS) return false;
+            Member& m = members[memberCount];
+
+            SKIP_WS();
+            if (i >= length || text[i++] != '"') return false;
+            m.keyOffset = i;
+            while (i < length && text[i] != '"') {
+                if (text[i] == '\\' || text[i] == '#') return false;
+                i++;
+            }
+            if (i >= length) return false;
+            m.keyLength = i - m.keyOffset;
+            i++;
+            SKIP_WS();
+            if (i >= length || text[i++] != ':') return false;
+            SKIP_WS();
+            if (i >= length) return false;
+
+            m.field = 0xFF;
+            m.quoted = text[i] == '"';
+            uint8_t start = m.quoted ? i + 1 : i;
+            if (m.quoted) {
+                i++;
+                while (i < length && text[i] != '"') {
+                    if (text[i] == '\\') return false;
+                    i++;
+                }
+                if (i >= length) return false;
+                m.valueOffset = start;
+                m.valueLength = i - start;
+                i++;
+            } else {
+                if (text[i] == '{' || text[i] == '[') return false;
+                while (i < length && text[i] != ',' && text[i] != '}' && text[i] != ' ' && text[i] != '\t' && text[i] != '\r' && text[i] != '\n') i++;
+                m.valueOffset = start;
+                m.valueLength = i - start;
+            }
+
+            // A field is exactly #X, other text with # is not supported
+            const char* v = text + m.valueOffset;
+            if (m.valueLength == 2 && v[0] == '#' && v[1] >= 'A' && v[1] <= 'Z') {
+                m.field = letters[v[1] - 'A'];
+            } else {
+                for (uint8_t k = 0; k < m.valueLength; k++) if (v[k] == '#') return false;
+                if (m.quoted) {
+                    // Literal string, keep the quotes for WriteLiteral
+                    m.valueOffset--;
+                    m.valueLength += 2;
+                }
+            }
+            memberCount++;
+
+            SKIP_WS();
+            if (i >= length) return false;
+            if (text[i] == ',') {
+                i++;
+                continue;
+            }
+            if (text[i++] != '}') return false;
+            SKIP_WS();
+            return i == length;
+        }
+        #undef SKIP_WS
+    }
+
+    bool B4RPayloadTemplate::AddSegment(uint8_t offset, uint8_t length, uint8_t field) {
+        if (segmentCount == RPAYLOADTEMPLATE_MAX_SEGMENTS) {
+            error = ERROR_TOO_MANY_SEGMENTS;
+            return false;
+        }
+        Segment& s = segments[segmentCount++];
+        s.offset = offset;
+        s.length = length;
+        s.field = field;
+        return true;
+    }
+
+    Byte B4RPayloadTemplate::getError() {
+        return error;
+    }
+
+    Byte B4RPayloadTemplate::getFieldCount() {
+        return fieldCount;
+    }
+
+    /**
+     * @brief Field of a name "T" or "#T" (last character is the letter).
+     */
+    B4RPayloadTemplate::Value* B4RPayloadTemplate::Lookup(B4RString* name) {
+        uint16_t n = name->getLength();
+        if (n == 0) return nullptr;
+        char c = name->data[n - 1];
+        if (c < 'A' || c > 'Z') return nullptr;
+        uint8_t field = letters[c - 'A'];
+        return field == 0xFF ? nullptr : &values[field];
+    }
+
+    bool B4RPayloadTemplate::SetLong(B4RString* Name, Long Value) {
+        B4RPayloadTemplate::Value* v = Lookup(Name);
+        if (!v) return false;
+        v->type = TYPE_LONG;
+        v->l = Value;
+        return true;
+    }
+
+    bool B4RPayloadTemplate::SetFloat(B4RString* Name, Double Value, Byte Decimals) {
+        B4RPayloadTemplate::Value* v = Lookup(Name);
+        if (!v) return false;
+        v->type = TYPE_FLOAT;
+        v->d = Value;
+        v->decimals = Decimals > 6 ? 6 : Decimals;
+        return true;
+    }
+
+    bool B4RPayloadTemplate::SetHex(B4RString* Name, ArrayByte* Data) {
+        B4RPayloadTemplate::Value* v = Lookup(Name);
+        if (!v) return false;
+        v->type = TYPE_HEX;
+        v->p = (const uint8_t*)Data->data;
+        v->length = Data->length;
+        return true;
+    }
+
+    bool B4RPayloadTemplate::SetText(B4RString* Name, B4RString* Text) {
+        B4RPayloadTemplate::Value* v = Lookup(Name);
+        if (!v) return false;
+        v->type = TYPE_TEXT;
+        v->p = (const uint8_t*)Text->data;
+        v->length = Text->getLength();
+        return true;
+    }
+
+    bool B4RPayloadTemplate::SetBytes(B4RString* Name, ArrayByte* Data) {
+        B4RPayloadTemplate::Value* v = Lookup(Name);
+        if (!v) return false;
+        v->type = TYPE_TEXT;
+        v->p = (const uint8_t*)Data->data;
+        v->length = Data->length;
+        return true;
+    }
+
+    /**
+     * @brief Write a 32-bit integer in decimal.
+     * @return Number of characters (at most 11)
+     */
+    uint8_t B4RPayloadTemplate::FormatLong(int32_t value, char* out) {
+        char digits[10];
+        uint8_t n = 0, len = 0;
+        uint32_t u = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+        do {
+            digits[n++] = '0' + (u % 10);
+            u /= 10;
+        } while (u > 0);
+        if (value < 0) out[len++] = '-';
+        while (n > 0) out[len++] = digits[--n];
+        return len;
+    }
+
+    /**
+     * @brief Write a number with fixed decimals, rounded half away from zero.
+     * NaN and out-of-range values are written as null (e.g. a failed sensor read).
+     * @return Number of characters (at most 18)
+     */
+    uint8_t B4RPayloadTemplate::FormatDouble(double value, uint8_t decimals, char* out) {
+        static const uint32_t POW10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+        double scaled = value * POW10[decimals];
+        if (!(scaled > -2e9 * POW10[decimals] && scaled < 2e9 * POW10[decimals])) {
+            memcpy(out, "null", 4);
+            return 4;
+        }
+
+        bool negative = scaled < 0;
+        uint64_t u = (uint64_t)((negative ? -scaled : scaled) + 0.5);
+        uint32_t whole = (uint32_t)(u / POW10[decimals]);
+        uint32_t fraction = (uint32_t)(u % POW10[decimals]);
+
+        uint8_t len = 0;
+        if (negative && u > 0) out[len++] = '-';
+        len += FormatLong((int32_t)whole, out + len);
+        if (decimals > 0) {
+            out[len++] = '.';
+            for (int8_t i = decimals - 1; i >= 0; i--) {
+                out[len + i] = '0' + (fraction % 10);
+                fraction /= 10;
+            }
+            len += decimals;
+        }
+        return len;
+    }
+
+    /**
+     * @brief Write all segments in one pass.
+     * @return Bytes written, 0 if out is too small
+     */
+    uint16_t B4RPayloadTemplate::RenderInto(uint8_t* out, uint16_t size) {
+        static const char HEX_DIGITS[] = "0123456789ABCDEF";
+        uint16_t n = 0;
+        char number[20];
+        renderCount++;
+
+        for (uint8_t i = 0; i < segmentCount; i++) {
+            const Segment& s = segments[i];
+            const uint8_t* src;
+            uint16_t len;
+
+            if (s.length > 0) {
+                src = (const uint8_t*)text + s.offset;
+                len = s.length;
+            } else {
+                const Value& v = values[s.field];
+                switch (v.type) {
+                    case TYPE_LONG:
+                        len = FormatLong(v.l, number);
+                        src = (const uint8_t*)number;
+                        break;
+                    case TYPE_FLOAT:
+                        len = FormatDouble(v.d, v.decimals, number);
+                        src = (const uint8_t*)number;
+                        break;
+                    case TYPE_HEX:
+                        if (n + 2 * v.length > size) goto overflow;
+                        for (uint16_t k = 0; k < v.length; k++) {
+                            out[n++] = HEX_DIGITS[v.p[k] >> 4];
+                            out[n++] = HEX_DIGITS[v.p[k] & 0x0F];
+                        }
+                        continue;
+                    case TYPE_TEXT:
+                        src = v.p;
+                        len = v.length;
+                        break;
+                    default:
+                        continue;
+                }
+            }
+            if (n + len > size) goto overflow;
+            memcpy(out + n, src, len);
+            n += len;
+        }
+        return n;
+
+    overflow:
+        overflowCount++;
+        return 0;
+    }
+
+    /**
+     * @brief Write a JSON token as a binary value: "text", true, false, null or a number.
+     */
+    void B4RPayloadTemplate::WriteLiteral(PayloadWriter& w, const char* s, uint16_t length) {
+        if (length >= 2 && s[0] == '"' && s[length - 1] == '"') {
+            w.Text(s + 1, length - 2);
+        } else if (length == 4 && memcmp(s, "true", 4) == 0) {
+            w.Bool(true);
+        } else if (length == 5 && memcmp(s, "false", 5) == 0) {
+            w.Bool(false);
+        } else if (length == 0 || (length == 4 && memcmp(s, "null", 4) == 0)) {
+            w.Null();
+        } else {
+            char number[24];
+            uint16_t n = length < sizeof(number) - 1 ? length : sizeof(number) - 1;
+            memcpy(number, s, n);
+            number[n] = 0;
+            char* end;
+            long l = strtol(number, &end, 10);
+            if (*end == 0 && l >= INT32_MIN && l <= INT32_MAX) {
+                w.Integer((int32_t)l);
+                return;
+            }
+            double d = strtod(number, &end);
+            if (*end == 0) w.Float((float)d);
+            else w.Text(s, length);
+        }
+    }
+
+    /**
+     * @brief Write the members as a CBOR or MessagePack map in one pass.
+     * @return Bytes written, 0 if out is too small
+     */
+    uint16_t B4RPayloadTemplate::RenderFormatInto(uint8_t* out, uint16_t size, uint8_t format) {
+        static const uint32_t POW10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+        static const char HEX_DIGITS[] = "0123456789ABCDEF";
+        if (format == B4RPayloadCodec::FORMAT_JSON || !binary) return RenderInto(out, size);
+        renderCount++;
+
+        PayloadWriter w(out, size, format);
+        w.Map(memberCount);
+        for (uint8_t i = 0; i < memberCount; i++) {
+            const Member& m = members[i];
+            w.Text(text + m.keyOffset, m.keyLength);
+            if (m.field == 0xFF) {
+                WriteLiteral(w, text + m.valueOffset, m.valueLength);
+                continue;
+            }
+            const Value& v = values[m.field];
+            switch (v.type) {
+                case TYPE_LONG:
+                    w.Integer(v.l);
+                    break;
+                case TYPE_FLOAT: {
+                    // Same range and rounding (half away from zero) as the JSON text
+                    double scaled = v.d * POW10[v.decimals];
+                    if (!(scaled > -2e9 * POW10[v.decimals] && scaled < 2e9 * POW10[v.decimals])) {
+                        w.Null();
+                    } else {
+                        double r = (double)(int64_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+                        if (v.decimals == 0 && r >= INT32_MIN && r <= INT32_MAX) w.Integer((int32_t)r);
+                        else w.Float((float)(r / POW10[v.decimals]));
+                    }
+                    break;
+                }
+                case TYPE_HEX:
+                    w.TextHead(2 * v.length);
+                    for (uint16_t k = 0; k < v.length; k++) {
+                        uint8_t pair[2] = { (uint8_t)HEX_DIGITS[v.p[k] >> 4], (uint8_t)HEX_DIGITS[v.p[k] & 0x0F] };
+                        w.Raw(pair, 2);
+                    }
+                    break;
+                case TYPE_TEXT:
+                    if (m.quoted) w.Text((const char*)v.p, v.length);
+                    else WriteLiteral(w, (const char*)v.p, v.length);
+                    break;
+                default:
+                    w.Null();
+                    break;
+            }
+        }
+        if (w.getOverflow()) {
+            overflowCount++;
+            return 0;
+        }
+        return w.getLength();
+    }
+
+    ArrayByte* B4RPayloadTemplate::RenderAs(Byte Format) {
+        ArrayByte* arr = CreateStackMemoryObject(ArrayByte);
+        arr->data = buffer;
+        arr->length = RenderFormatInto(buffer, sizeof(buffer), Format);
+        return arr;
+    }
+
+    bool B4RPayloadTemplate::getBinary() {
+        return binary;
+    }
+
+    ArrayByte* B4RPayloadTemplate::Render() {
+        ArrayByte* arr = CreateStackMemoryObject(ArrayByte);
+        arr->data = buffer;
+        arr->length = RenderInto(buffer, sizeof(buffer));
+        return arr;
+    }
+
+    UInt B4RPayloadTemplate::RenderTo(ArrayByte* Buffer) {
+        return RenderInto((uint8_t*)Buffer->data, Buffer->length);
+    }
+
+    ULong B4RPayloadTemplate::getRenderCount() {
+        return renderCount;
+    }
+
+    ULong B4RPayloadTemplate::getOverflowCount() {
+        return overflowCount;
+    }
+
+} // namespace B4R
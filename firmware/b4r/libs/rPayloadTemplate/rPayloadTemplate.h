@@ -0,0 +1,225 @@
+/**
+ * @file rPayloadTemplate.h
+ * @brief Precompiled payload templates rendered in one pass for B4R.
+ *
+ * A template such as {"t":#T,"h":#H} is parsed once in Initialize into a
+ * segment list: literal text and fields. A field is # followed by an
+ * uppercase letter; the same letter may appear more than once.
+ * Field values are set typed (integer, float with fixed decimals, bytes as
+ * hex, text) and Render writes all segments in one pass into the output
+ * buffer of the template, or RenderTo into a caller buffer.
+ *
+ * Formatting is done without printf, heap or B4R stack: at most 10 digits per
+ * integer, the letter lookup is a 26-entry table. Text and hex values are
+ * referenced (not copied) and must stay valid until Render.
+ *
+ * A flat object template (values are literals, #X or "#X") is also compiled
+ * into a member list, RenderAs writes it as a CBOR or MessagePack map with
+ * the same keys through the rPayloadCodec writer: integers binary, floats as
+ * float32 rounded to their decimals, hex and text as text strings, unset
+ * fields and NaN as null. Other templates are rendered as JSON by RenderAs.
+ *
+ * Example (B4R):
+ *   Tpl.Initialize(MQTTTopics.PAYLOAD_DHT11_STATUS)
+ *   Tpl.SetFloat("T", temp, 1)
+ *   Tpl.SetFloat("H", hum, 1)
+ *   MQTTClient.PublishBytes(topic, Tpl.Render, True)
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+#include "rPayloadCodec.h"
+
+/** Maximum template length in bytes (the template is copied). */
+#ifndef RPAYLOADTEMPLATE_TEXT_SIZE
+#define RPAYLOADTEMPLATE_TEXT_SIZE 64
+#endif
+
+/** Maximum number of segments (literal text and fields). */
+#ifndef RPAYLOADTEMPLATE_MAX_SEGMENTS
+#define RPAYLOADTEMPLATE_MAX_SEGMENTS 24
+#endif
+
+/** Maximum number of distinct fields. */
+#ifndef RPAYLOADTEMPLATE_MAX_FIELDS
+#define RPAYLOADTEMPLATE_MAX_FIELDS 8
+#endif
+
+/** Maximum number of members of a flat object template (binary formats). */
+#ifndef RPAYLOADTEMPLATE_MAX_MEMBERS
+#define RPAYLOADTEMPLATE_MAX_MEMBERS 12
+#endif
+
+/** Size of the output buffer used by Render. */
+#ifndef RPAYLOADTEMPLATE_BUFFER_SIZE
+#define RPAYLOADTEMPLATE_BUFFER_SIZE 128
+#endif
+
+//~Library: rPayloadTemplate
+//~Author: Robert W.B. Linn
+//~Brief: Payload templates with #X fields, parsed once and rendered in one pass without allocation.
+//~Version: 1.01
+
+namespace B4R {
+
+    //~shortname: PayloadTemplate
+    class B4RPayloadTemplate {
+    private:
+        // Segment: literal text (offset/length into text) or a field (length 0, field index)
+        struct Segment {
+            uint8_t offset;
+            uint8_t length;
+            uint8_t field;
+        };
+
+        // Member of a flat object template: key and a literal value or a field
+        struct Member {
+            uint8_t keyOffset;
+            uint8_t keyLength;
+            uint8_t valueOffset;
+            uint8_t valueLength;
+            uint8_t field;                      // 0xFF for a literal
+            bool quoted;                        // "#X"
+        };
+
+        struct Value {
+            uint8_t type;
+            uint8_t decimals;
+            uint16_t length;
+            union {
+                int32_t l;
+                double d;
+                const uint8_t* p;
+            };
+        };
+
+        char text[RPAYLOADTEMPLATE_TEXT_SIZE];
+        Segment segments[RPAYLOADTEMPLATE_MAX_SEGMENTS];
+        Value values[RPAYLOADTEMPLATE_MAX_FIELDS];
+        uint8_t letters[26];                    // Letter A-Z to field index, 0xFF if not used
+        uint8_t segmentCount = 0;
+        uint8_t fieldCount = 0;
+        uint8_t error = 0;
+        Member members[RPAYLOADTEMPLATE_MAX_MEMBERS];
+        uint8_t memberCount = 0;
+        bool binary = false;
+        uint8_t buffer[RPAYLOADTEMPLATE_BUFFER_SIZE];
+        uint32_t renderCount = 0;
+        uint32_t overflowCount = 0;
+
+        Value* Lookup(B4RString* name);
+        bool AddSegment(uint8_t offset, uint8_t length, uint8_t field);
+        static uint8_t FormatLong(int32_t value, char* out);
+        static uint8_t FormatDouble(double value, uint8_t decimals, char* out);
+        bool CompileMembers(uint8_t length);
+        static void WriteLiteral(PayloadWriter& w, const char* s, uint16_t length);
+
+    public:
+        /** Value types */
+        static const Byte TYPE_NONE = 0;
+        static const Byte TYPE_LONG = 1;
+        static const Byte TYPE_FLOAT = 2;
+        static const Byte TYPE_HEX = 3;
+        static const Byte TYPE_TEXT = 4;
+
+        /** Error codes (Error) */
+        static const Byte ERROR_NONE = 0;
+        static const Byte ERROR_TEMPLATE_TOO_LONG = 1;
+        static const Byte ERROR_TOO_MANY_SEGMENTS = 2;
+        static const Byte ERROR_TOO_MANY_FIELDS = 3;
+
+        /** Limits */
+        static const Byte MAX_FIELDS = RPAYLOADTEMPLATE_MAX_FIELDS;
+        static const UInt BUFFER_SIZE = RPAYLOADTEMPLATE_BUFFER_SIZE;
+
+        /**
+         * Parse the template into segments. Fields start unset (rendered empty).
+         * @param Template Template with #A to #Z fields, e.g. {"t":#T,"h":#H}
+         * @return False if the template exceeds the limits (see Error)
+         */
+        bool Initialize(B4RString* Template);
+
+        /** Error of Initialize, ERROR_NONE if the template was parsed */
+        Byte getError();
+
+        /** Number of distinct fields */
+        Byte getFieldCount();
+
+        /**
+         * Set a field to an integer.
+         * @param Name Field letter, e.g. "T" (or "#T")
+         * @param Value Value
+         * @return False if the template has no such field
+         */
+        bool SetLong(B4RString* Name, Long Value);
+
+        /**
+         * Set a field to a number with fixed decimals (rounded).
+         * @param Name Field letter
+         * @param Value Value
+         * @param Decimals Number of decimals, 0 to 6
+         */
+        bool SetFloat(B4RString* Name, Double Value, Byte Decimals);
+
+        /**
+         * Set a field to bytes written as uppercase hex, e.g. an RFID UID. Not copied.
+         * @param Name Field letter
+         * @param Data Bytes
+         */
+        bool SetHex(B4RString* Name, ArrayByte* Data);
+
+        /**
+         * Set a field to text, written as is. Not copied.
+         * @param Name Field letter
+         * @param Text Text
+         */
+        bool SetText(B4RString* Name, B4RString* Text);
+
+        /**
+         * Set a field to bytes written as is. Not copied.
+         * @param Name Field letter
+         * @param Data Bytes
+         */
+        bool SetBytes(B4RString* Name, ArrayByte* Data);
+
+        /**
+         * Render into the output buffer of the template.
+         * @return Payload, valid until the next Render. Empty if the buffer is too small.
+         */
+        ArrayByte* Render();
+
+        /**
+         * Render into a caller buffer.
+         * @param Buffer Output buffer
+         * @return Number of bytes written, 0 if the buffer is too small
+         */
+        UInt RenderTo(ArrayByte* Buffer);
+
+        /**
+         * Render into the output buffer of the template in a payload format.
+         * @param Format PayloadCodec.FORMAT_JSON, FORMAT_CBOR or FORMAT_MSGPACK
+         * @return Payload, valid until the next Render. JSON if the template is not
+         *         a flat object (see Binary). Empty if the buffer is too small.
+         */
+        ArrayByte* RenderAs(Byte Format);
+
+        /** True if the template is a flat object that RenderAs can write as CBOR or MessagePack */
+        bool getBinary();
+
+        /** Number of renders */
+        ULong getRenderCount();
+
+        /** Number of renders that did not fit the buffer */
+        ULong getOverflowCount();
+
+        //~hide
+        // Render into any buffer, for C++ callers and host tools
+        uint16_t RenderInto(uint8_t* out, uint16_t size);
+        uint16_t RenderFormatInto(uint8_t* out, uint16_t size, uint8_t format);
+    };
+
+} // namespace B4R
@@ -0,0 +1,206 @@
+/**
+ * @file TimingWheel.cpp
+ * @brief Hierarchical timing wheel of rScheduler.
+ */
+
+#include "TimingWheel.h"
+
+void TimingWheel::begin(uint32_t now, MicrosClock micros) {
+    for (uint8_t l = 0; l < LEVELS; l++) {
+        for (uint8_t s = 0; s < SLOTS; s++) heads[l][s] = NONE;
+    }
+    for (uint8_t i = 0; i < JOBS_MAX; i++) {
+        jobs[i].fn = nullptr;
+        jobs[i].linked = false;
+    }
+    current = now;
+    staggerNext = 0;
+    this->micros = micros;
+    running = NONE;
+    jobCount = 0;
+    resetCounters();
+}
+
+uint8_t TimingWheel::add(JobFunction fn, void* arg, uint32_t period, uint32_t delay, uint32_t budget) {
+    if (fn == nullptr) return NONE;
+    uint8_t id = 0;
+    while (id < JOBS_MAX && jobs[id].fn != nullptr) id++;
+    if (id == JOBS_MAX) return NONE;
+
+    Job& j = jobs[id];
+    j.fn = fn;
+    j.arg = arg;
+    j.period = period;
+    j.budget = budget;
+    j.linked = false;
+    j.runs = j.overruns = j.missed = j.maxMicros = j.maxLate = 0;
+    if (delay == PHASE_AUTO) {
+        // Spread the first runs: each job is RSCHEDULER_STAGGER_MS later in its period
+        delay = period > 0 ? staggerNext % period : 0;
+        staggerNext += RSCHEDULER_STAGGER_MS;
+    }
+    jobCount++;
+    schedule(id, delay);
+    return id;
+}
+
+bool TimingWheel::schedule(uint8_t id, uint32_t delay) {
+    if (id >= JOBS_MAX || jobs[id].fn == nullptr) return false;
+    if (jobs[id].linked) unlink(id);
+    // The current tick has run
+    jobs[id].deadline = current + (delay > 0 ? delay : 1);
+    link(id);
+    if (id == running) rescheduled = true;
+    return true;
+}
+
+void TimingWheel::cancel(uint8_t id) {
+    if (id >= JOBS_MAX || jobs[id].fn == nullptr) return;
+    if (jobs[id].linked) unlink(id);
+    if (id == running) rescheduled = true;
+}
+
+void TimingWheel::remove(uint8_t id) {
+    if (id >= JOBS_MAX || jobs[id].fn == nullptr) return;
+    cancel(id);
+    jobs[id].fn = nullptr;
+    jobCount--;
+}
+
+void TimingWheel::setPeriod(uint8_t id, uint32_t period) {
+    if (id >= JOBS_MAX || jobs[id].fn == nullptr) return;
+    jobs[id].period = period;
+}
+
+void TimingWheel::link(uint8_t id) {
+    Job& j = jobs[id];
+    uint32_t delta = j.deadline - current;
+    if ((int32_t)delta < 0) delta = 0;
+    uint32_t expires = j.deadline;
+    uint8_t level;
+    if (delta < (1UL << SLOT_BITS)) {
+        level = 0;
+    } else if (delta < (1UL << (2 * SLOT_BITS))) {
+        level = 1;
+    } else if (delta < (1UL << (3 * SLOT_BITS))) {
+        level = 2;
+    } else {
+        // Longer than the wheel: cascaded early and linked again
+        if (delta >= (1UL << (4 * SLOT_BITS))) expires = current + (1UL << (4 * SLOT_BITS)) - 1;
+        level = 3;
+    }
+    uint8_t slot = (expires >> (level * SLOT_BITS)) & (SLOTS - 1);
+    j.level = level;
+    j.slot = slot;
+    j.prev = NONE;
+    j.next = heads[level][slot];
+    if (j.next != NONE) jobs[j.next].prev = id;
+    heads[level][slot] = id;
+    j.linked = true;
+}
+
+void TimingWheel::unlink(uint8_t id) {
+    Job& j = jobs[id];
+    if (j.prev != NONE) jobs[j.prev].next = j.next;
+    else heads[j.level][j.slot] = j.next;
+    if (j.next != NONE) jobs[j.next].prev = j.prev;
+    j.linked = false;
+}
+
+void TimingWheel::cascade(uint8_t level) {
+    uint8_t slot = (current >> (level * SLOT_BITS)) & (SLOTS - 1);
+    uint8_t id = heads[level][slot];
+    heads[level][slot] = NONE;
+    while (id != NONE) {
+        uint8_t next = jobs[id].next;
+        link(id);
+        id = next;
+    }
+}
+
+void TimingWheel::run(uint8_t id, uint32_t now) {
+    Job& j = jobs[id];
+    uint32_t late = now - j.deadline;
+    if (late > j.maxLate) j.maxLate = late;
+
+    running = id;
+    rescheduled = false;
+    uint32_t start = micros ? micros() : 0;
+    j.fn(j.arg);
+    uint32_t elapsed = micros ? micros() - start : 0;
+    running = NONE;
+
+    j.runs++;
+    runCount++;
+    if (elapsed > j.maxMicros) j.maxMicros = elapsed;
+    if (j.budget > 0 && elapsed > j.budget) {
+        j.overruns++;
+        overrunCount++;
+    }
+
+    // Removed, cancelled or scheduled by the job itself, or one-shot
+    if (rescheduled || j.fn == nullptr || j.period == 0) return;
+    uint32_t next = j.deadline + j.period;
+    if ((int32_t)(next - now) <= 0) {
+        // Periods passed without a run are skipped, not run in a burst
+        uint32_t behind = (now - next) / j.period + 1;
+        j.missed += behind;
+        missedCount += behind;
+        next += behind * j.period;
+    }
+    j.deadline = next;
+    link(id);
+}
+
+uint16_t TimingWheel::advance(uint32_t now) {
+    uint16_t ran = 0;
+    while ((int32_t)(now - current) > 0) {
+        current++;
+        tickCount++;
+        if ((current & (SLOTS - 1)) == 0) {
+            if ((current & ((1UL << (2 * SLOT_BITS)) - 1)) == 0) {
+                if ((current & ((1UL << (3 * SLOT_BITS)) - 1)) == 0) cascade(3);
+                cascade(2);
+            }
+            cascade(1);
+        }
+        uint8_t slot = current & (SLOTS - 1);
+        while (heads[0][slot] != NONE) {
+            uint8_t id = heads[0][slot];
+            unlink(id);
+            if ((int32_t)(jobs[id].deadline - current) > 0) {
+                link(id);
+                continue;
+            }
+            run(id, now);
+            ran++;
+        }
+    }
+    return ran;
+}
+
+uint32_t TimingWheel::nextDelay(uint32_t now) const {
+    uint32_t best = UINT32_MAX;
+    for (uint8_t i = 0; i < JOBS_MAX; i++) {
+        if (jobs[i].fn == nullptr || !jobs[i].linked) continue;
+        int32_t d = (int32_t)(jobs[i].deadline - now);
+        uint32_t delay = d > 0 ? (uint32_t)d : 0;
+        if (delay < best) best = delay;
+    }
+    return best;
+}
+
+const TimingWheel::Job* TimingWheel::job(uint8_t id) const {
+    if (id >= JOBS_MAX || jobs[id].fn == nullptr) return nullptr;
+    return &jobs[id];
+}
+
+void TimingWheel::resetCounters() {
+    runCount = 0;
+    overrunCount = 0;
+    missedCount = 0;
+    tickCount = 0;
+    for (uint8_t i = 0; i < JOBS_MAX; i++) {
+        jobs[i].runs = jobs[i].overruns = jobs[i].missed = jobs[i].maxMicros = jobs[i].maxLate = 0;
+    }
+}
@@ -0,0 +1,139 @@
+/**
+ * @file TimingWheel.h
+ * @brief Hierarchical timing wheel of rScheduler. Plain C++, no Arduino, tested on Linux with a
+ * virtual clock (bench/rScheduler).
+ *
+ * Time is counted in ticks of 1 ms. Four levels of 64 slots cover 2^24 ms (4.6 h):
+ *
+ *   level 0: deadline within 64 ms,        slot = deadline & 63
+ *   level 1: within 4 s,                   slot = (deadline >> 6) & 63
+ *   level 2: within 4.4 min,               slot = (deadline >> 12) & 63
+ *   level 3: within 4.6 h (longer clamped), slot = (deadline >> 18) & 63
+ *
+ * A job is linked into one slot list. advance(now) steps the ticks up to now: on
+ * each tick the level 0 slot is run, at a level boundary the next level slot is
+ * moved down (cascade). Adding, cancelling and running a job is O(1), a tick
+ * without due jobs is one list head check.
+ *
+ * Jobs have a deadline (absolute ms), a period (0 = one-shot) and a CPU budget
+ * in us. A run longer than the budget counts as overrun, periods passed without
+ * a run (main loop blocked) count as missed. Periodic jobs keep their phase:
+ * the next deadline is the previous deadline plus the period, not now plus the period.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include <stdint.h>
+
+/** Maximum number of jobs. */
+#ifndef RSCHEDULER_JOBS_MAX
+#define RSCHEDULER_JOBS_MAX 16
+#endif
+
+/** Offset in ms between the first deadlines of periodic jobs, so jobs with the same period do not fire in the same tick. */
+#ifndef RSCHEDULER_STAGGER_MS
+#define RSCHEDULER_STAGGER_MS 7
+#endif
+
+class TimingWheel {
+public:
+    typedef void (*JobFunction)(void* arg);
+    /** Microsecond clock for the run time of a job. */
+    typedef uint32_t (*MicrosClock)();
+
+    static const uint8_t LEVELS = 4;
+    static const uint8_t SLOT_BITS = 6;
+    static const uint8_t SLOTS = 1 << SLOT_BITS;
+    static const uint8_t JOBS_MAX = RSCHEDULER_JOBS_MAX;
+    /** Invalid job id. */
+    static const uint8_t NONE = 255;
+    /** First deadline of a periodic job chosen by the wheel (stagger). */
+    static const uint32_t PHASE_AUTO = 0xFFFFFFFF;
+
+    struct Job {
+        JobFunction fn;
+        void* arg;
+        uint32_t period;        // ms, 0 = one-shot
+        uint32_t deadline;      // ms
+        uint32_t budget;        // us, 0 = no budget
+        uint8_t next;
+        uint8_t prev;
+        uint8_t level;
+        uint8_t slot;
+        bool linked;
+        // Statistics
+        uint32_t runs;
+        uint32_t overruns;
+        uint32_t missed;
+        uint32_t maxMicros;
+        uint32_t maxLate;       // ms after the deadline
+    };
+
+    /**
+     * Start the wheel at time now (ms). Clears all jobs.
+     * @param micros Clock for the run time, nullptr = no budget accounting
+     */
+    void begin(uint32_t now, MicrosClock micros);
+
+    /**
+     * Add a job.
+     * @param period Period in ms, 0 = one-shot
+     * @param delay First run in ms from now, PHASE_AUTO = period plus a stagger
+     * @param budget CPU budget per run in us, 0 = none
+     * @return Job id, NONE if all slots are used
+     */
+    uint8_t add(JobFunction fn, void* arg, uint32_t period, uint32_t delay, uint32_t budget);
+
+    /**
+     * Run a job in delay ms (at least the next tick), also a one-shot that already ran.
+     * Called by the job itself it replaces the periodic deadline.
+     */
+    bool schedule(uint8_t id, uint32_t delay);
+
+    /** Stop a job, it keeps its id until remove. */
+    void cancel(uint8_t id);
+
+    /** Stop a job and free its id. */
+    void remove(uint8_t id);
+
+    /** Set the period of a job, applied from the next run. */
+    void setPeriod(uint8_t id, uint32_t period);
+
+    /**
+     * Run the jobs due up to now (ms).
+     * @return Number of jobs run
+     */
+    uint16_t advance(uint32_t now);
+
+    /** ms from now to the next deadline, 0 if due, UINT32_MAX without jobs. */
+    uint32_t nextDelay(uint32_t now) const;
+
+    /** Job of an id, nullptr if unused. */
+    const Job* job(uint8_t id) const;
+
+    /** Reset the statistics. */
+    void resetCounters();
+
+    uint8_t jobCount = 0;
+    uint32_t runCount = 0;
+    uint32_t overrunCount = 0;
+    uint32_t missedCount = 0;
+    uint32_t tickCount = 0;
+
+private:
+    Job jobs[JOBS_MAX];
+    uint8_t heads[LEVELS][SLOTS];
+    uint32_t current = 0;       // Last tick run
+    uint32_t staggerNext = 0;
+    MicrosClock micros = nullptr;
+    uint8_t running = NONE;
+    bool rescheduled = false;
+
+    void link(uint8_t id);
+    void unlink(uint8_t id);
+    void cascade(uint8_t level);
+    void run(uint8_t id, uint32_t now);
+};
@@ -0,0 +1,135 @@
+/**
+ * @file rScheduler.cpp
+ * @brief Timing-wheel job scheduler for B4R.
+ */
+
+#include "B4RDefines.h"
+#include "rScheduler.h"
+
+namespace B4R {
+
+    TimingWheel B4RScheduler::wheel;
+    bool B4RScheduler::started = false;
+    uint32_t B4RScheduler::idleSleepMax = 0;
+    uint32_t B4RScheduler::sleepCount = 0;
+    uint32_t B4RScheduler::sleptMillis = 0;
+
+    uint32_t B4RScheduler::Micros() {
+        return micros();
+    }
+
+    void B4RScheduler::Begin() {
+        if (started) return;
+        started = true;
+        wheel.begin(millis(), Micros);
+
+        FunctionUnion fu;
+        fu.PollerFunction = looper;
+        pollers.add(fu, nullptr);
+    }
+
+    void B4RScheduler::looper(void* b) {
+        uint32_t now = millis();
+        if (wheel.advance(now) > 0 || idleSleepMax == 0) return;
+        uint32_t wait = wheel.nextDelay(now);
+        if (wait > idleSleepMax) wait = idleSleepMax;
+        // Due in the next tick: no sleep
+        if (wait <= 1) return;
+        sleepCount++;
+        sleptMillis += wait;
+        delay(wait);
+    }
+
+    void B4RScheduler::Initialize() {
+        Begin();
+    }
+
+    Byte B4RScheduler::Every(TimingWheel::JobFunction fn, void* arg, uint32_t period, uint32_t budgetMicros) {
+        Begin();
+        return wheel.add(fn, arg, period, TimingWheel::PHASE_AUTO, budgetMicros);
+    }
+
+    Byte B4RScheduler::Once(TimingWheel::JobFunction fn, void* arg, uint32_t delay, uint32_t budgetMicros) {
+        Begin();
+        return wheel.add(fn, arg, 0, delay, budgetMicros);
+    }
+
+    bool B4RScheduler::Schedule(Byte id, uint32_t delay) {
+        return wheel.schedule(id, delay);
+    }
+
+    void B4RScheduler::SetPeriod(Byte id, uint32_t period) {
+        wheel.setPeriod(id, period);
+    }
+
+    void B4RScheduler::Cancel(Byte id) {
+        wheel.cancel(id);
+    }
+
+    Byte B4RScheduler::getJobCount() {
+        return wheel.jobCount;
+    }
+
+    ULong B4RScheduler::getRunCount() {
+        return wheel.runCount;
+    }
+
+    ULong B4RScheduler::getOverrunCount() {
+        return wheel.overrunCount;
+    }
+
+    ULong B4RScheduler::getMissedCount() {
+        return wheel.missedCount;
+    }
+
+    ULong B4RScheduler::getNextDeadline() {
+        return wheel.nextDelay(millis());
+    }
+
+    void B4RScheduler::setIdleSleepMax(ULong ms) {
+        idleSleepMax = ms;
+    }
+    ULong B4RScheduler::getIdleSleepMax() {
+        return idleSleepMax;
+    }
+
+    ULong B4RScheduler::getSleepCount() {
+        return sleepCount;
+    }
+
+    ULong B4RScheduler::getSleptMillis() {
+        return sleptMillis;
+    }
+
+    ULong B4RScheduler::JobRuns(Byte Id) {
+        const TimingWheel::Job* j = wheel.job(Id);
+        return j ? j->runs : 0;
+    }
+
+    ULong B4RScheduler::JobOverruns(Byte Id) {
+        const TimingWheel::Job* j = wheel.job(Id);
+        return j ? j->overruns : 0;
+    }
+
+    ULong B4RScheduler::JobMissed(Byte Id) {
+        const TimingWheel::Job* j = wheel.job(Id);
+        return j ? j->missed : 0;
+    }
+
+    ULong B4RScheduler::JobMaxMicros(Byte Id) {
+        const TimingWheel::Job* j = wheel.job(Id);
+        return j ? j->maxMicros : 0;
+    }
+
+    ULong B4RScheduler::JobMaxLate(Byte Id) {
+        const TimingWheel::Job* j = wheel.job(Id);
+        return j ? j->maxLate : 0;
+    }
+
+    void B4RScheduler::ResetCounters() {
+        wheel.resetCounters();
+        sleepCount = 0;
+        sleptMillis = 0;
+    }
+
+} // namespace B4R
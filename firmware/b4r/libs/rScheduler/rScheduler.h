@@ -0,0 +1,125 @@
+/**
+ * @file rScheduler.h
+ * @brief Timing-wheel job scheduler for B4R.
+ *
+ * Device libraries register periodic and one-shot jobs instead of a poller
+ * that runs on every main loop pass only to compare millis() with its last
+ * run. One poller advances the wheel (TimingWheel.h): a pass without due jobs
+ * costs a few compares, a job runs at its deadline.
+ *
+ * - Periodic jobs keep their phase; the first run of each job is staggered
+ *   (RSCHEDULER_STAGGER_MS), so the sensors do not all read in the same tick.
+ * - Each job has a CPU budget in us: longer runs are counted as overrun,
+ *   periods passed while the main loop was blocked as missed.
+ * - IdleSleepMax: without a due job the poller sleeps (delay, the CPU idles)
+ *   until the next deadline, at most IdleSleepMax ms. The other pollers
+ *   (BLE, MQTT) then also wait, so keep it short.
+ *
+ * C++ use (libraries):
+ *   jobId = B4RScheduler::Every(looper, this, 500, 300);   // every 500 ms, budget 300 us
+ *   B4RScheduler::Schedule(jobId, 20);                      // next run in 20 ms
+ *
+ * B4R use (statistics, sleep):
+ *   Scheduler.Initialize
+ *   Scheduler.IdleSleepMax = 2
+ *   Log("Jobs: ", Scheduler.JobCount, " overruns: ", Scheduler.OverrunCount)
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+#include "TimingWheel.h"
+
+//~Library: rScheduler
+//~Author: Robert W.B. Linn
+//~Brief: Timing-wheel scheduler for periodic and one-shot jobs of the device libraries, with CPU budget and idle sleep.
+//~Version: 1.00
+
+namespace B4R {
+
+    //~shortname: Scheduler
+    class B4RScheduler {
+    private:
+        // One wheel for all libraries, started by the first job or Initialize
+        static TimingWheel wheel;
+        static bool started;
+        static uint32_t idleSleepMax;
+        static uint32_t sleepCount;
+        static uint32_t sleptMillis;
+
+        static void Begin();
+        static uint32_t Micros();
+        static void looper(void* b);
+
+    public:
+        /** Start the scheduler (also started by the first library job). */
+        void Initialize();
+
+        /** Number of jobs. */
+        Byte getJobCount();
+
+        /** Number of job runs. */
+        ULong getRunCount();
+
+        /** Number of runs longer than the budget of the job. */
+        ULong getOverrunCount();
+
+        /** Number of periods skipped because the main loop was blocked. */
+        ULong getMissedCount();
+
+        /** ms to the next deadline. */
+        ULong getNextDeadline();
+
+        /**
+         * Set/Get the maximum sleep in ms when no job is due, 0 = off (default).
+         * The whole main loop sleeps: BLE and MQTT are handled up to this later.
+         */
+        void setIdleSleepMax(ULong ms);
+        ULong getIdleSleepMax();
+
+        /** Number of idle sleeps. */
+        ULong getSleepCount();
+
+        /** Total idle sleep in ms. */
+        ULong getSleptMillis();
+
+        /** Number of runs of a job. */
+        ULong JobRuns(Byte Id);
+
+        /** Number of runs of a job longer than its budget. */
+        ULong JobOverruns(Byte Id);
+
+        /** Number of periods of a job skipped. */
+        ULong JobMissed(Byte Id);
+
+        /** Longest run of a job in us. */
+        ULong JobMaxMicros(Byte Id);
+
+        /** Largest delay of a run after its deadline in ms. */
+        ULong JobMaxLate(Byte Id);
+
+        /** Reset the counters */
+        void ResetCounters();
+
+        /** Invalid job id. */
+        static const Byte INVALID_JOB = TimingWheel::NONE;
+        /** Limits */
+        static const Byte JOBS_MAX = RSCHEDULER_JOBS_MAX;
+
+        //~hide
+        // Run fn(arg) every period ms, first run staggered. Returns the job id, INVALID_JOB if full.
+        static Byte Every(TimingWheel::JobFunction fn, void* arg, uint32_t period, uint32_t budgetMicros);
+        // Run fn(arg) once in delay ms, run again with Schedule
+        static Byte Once(TimingWheel::JobFunction fn, void* arg, uint32_t delay, uint32_t budgetMicros);
+        // Next run of a job in delay ms (the job itself: instead of its period)
+        static bool Schedule(Byte id, uint32_t delay);
+        // Change the period of a job
+        static void SetPeriod(Byte id, uint32_t period);
+        // Stop a job, Schedule starts it again
+        static void Cancel(Byte id);
+    };
+
+} // namespace B4R
@@ -0,0 +1,191 @@
+/**
+ * @file rSensorFilter.cpp
+ * @brief Sensor value filter with deadband, hysteresis and report intervals for B4R.
+ */
+
+#include "B4RDefines.h"
+#include "rSensorFilter.h"
+
+namespace B4R {
+
+    void B4RSensorFilter::Initialize() {
+        medianSize = 1;
+        alpha = 1.0f;
+        absolute = 0;
+        relative = 0;
+        hysteresis = 0;
+        minInterval = 0;
+        maxInterval = 0;
+        Reset();
+        ResetCounters();
+    }
+
+    void B4RSensorFilter::SetMedian(Byte Size) {
+        if (Size < 1) Size = 1;
+        if (Size > RSENSORFILTER_MEDIAN_MAX) Size = RSENSORFILTER_MEDIAN_MAX;
+        // Odd, so the median is a sample
+        if ((Size & 1) == 0) Size--;
+        medianSize = Size;
+        sampleCount = 0;
+        sampleIndex = 0;
+    }
+
+    void B4RSensorFilter::SetDeadband(Double Absolute, Double Relative, Double Hysteresis) {
+        absolute = Absolute > 0 ? Absolute : 0;
+        relative = Relative > 0 ? Relative : 0;
+        hysteresis = Hysteresis > 0 ? Hysteresis : 0;
+    }
+
+    /**
+     * @brief Median of the samples in the window, insertion sort of at most MEDIAN_MAX values.
+     */
+    float B4RSensorFilter::Median() {
+        float sorted[RSENSORFILTER_MEDIAN_MAX];
+        for (uint8_t i = 0; i < sampleCount; i++) {
+            float v = samples[i];
+            uint8_t j = i;
+            while (j > 0 && sorted[j - 1] > v) {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = v;
+        }
+        return sorted[sampleCount / 2];
+    }
+
+    /**
+     * @brief Filter the sample, then check the deadband and the intervals.
+     */
+    bool B4RSensorFilter::Sample(float sample, uint32_t now) {
+        updateCount++;
+        heartbeat = false;
+
+        if (isnan(sample)) {
+            // Failed read: restart the filters with the next valid sample
+            sampleCount = 0;
+            sampleIndex = 0;
+            ema = NAN;
+            value = NAN;
+        } else {
+            samples[sampleIndex] = sample;
+            sampleIndex = (sampleIndex + 1) % medianSize;
+            if (sampleCount < medianSize) sampleCount++;
+            float m = medianSize > 1 ? Median() : sample;
+            ema = isnan(ema) ? m : ema + alpha * (m - ema);
+            value = ema;
+        }
+
+        if (!hasReported) return true;
+
+        bool changed;
+        if (isnan(value) || isnan(reported)) {
+            changed = isnan(value) != isnan(reported);
+        } else {
+            float delta = value - reported;
+            float band = relative * fabsf(reported);
+            if (band < absolute) band = absolute;
+            int8_t dir = delta > 0 ? 1 : (delta < 0 ? -1 : 0);
+            if (dir != 0 && dir == -direction) band += hysteresis;
+            changed = dir != 0 && fabsf(delta) >= band;
+        }
+
+        uint32_t elapsed = now - lastReport;
+        if (changed && elapsed >= minInterval) return true;
+        if (maxInterval > 0 && elapsed >= maxInterval) {
+            heartbeat = !changed;
+            return true;
+        }
+        return false;
+    }
+
+    void B4RSensorFilter::Commit(uint32_t now) {
+        if (hasReported && !isnan(value) && !isnan(reported) && value != reported) {
+            direction = value > reported ? 1 : -1;
+        }
+        reported = value;
+        hasReported = true;
+        lastReport = now;
+        emittedCount++;
+        if (heartbeat) heartbeatCount++;
+    }
+
+    bool B4RSensorFilter::UpdateAt(float sample, uint32_t now) {
+        if (!Sample(sample, now)) return false;
+        Commit(now);
+        return true;
+    }
+
+    bool B4RSensorFilter::Update(Double Value) {
+        return UpdateAt((float)Value, millis());
+    }
+
+    void B4RSensorFilter::setAlpha(Double Alpha) {
+        alpha = (Alpha > 0 && Alpha <= 1) ? Alpha : 1.0f;
+    }
+
+    Double B4RSensorFilter::getAlpha() {
+        return alpha;
+    }
+
+    void B4RSensorFilter::setMinInterval(ULong ms) {
+        minInterval = ms;
+    }
+
+    ULong B4RSensorFilter::getMinInterval() {
+        return minInterval;
+    }
+
+    void B4RSensorFilter::setMaxInterval(ULong ms) {
+        maxInterval = ms;
+    }
+
+    ULong B4RSensorFilter::getMaxInterval() {
+        return maxInterval;
+    }
+
+    Double B4RSensorFilter::getValue() {
+        return value;
+    }
+
+    Double B4RSensorFilter::getReported() {
+        return reported;
+    }
+
+    bool B4RSensorFilter::getHeartbeat() {
+        return heartbeat;
+    }
+
+    ULong B4RSensorFilter::getUpdateCount() {
+        return updateCount;
+    }
+
+    ULong B4RSensorFilter::getEmittedCount() {
+        return emittedCount;
+    }
+
+    ULong B4RSensorFilter::getSuppressedCount() {
+        return updateCount - emittedCount;
+    }
+
+    ULong B4RSensorFilter::getHeartbeatCount() {
+        return heartbeatCount;
+    }
+
+    void B4RSensorFilter::Reset() {
+        sampleCount = 0;
+        sampleIndex = 0;
+        ema = NAN;
+        value = NAN;
+        reported = NAN;
+        hasReported = false;
+        direction = 0;
+        heartbeat = false;
+    }
+
+    void B4RSensorFilter::ResetCounters() {
+        updateCount = 0;
+        emittedCount = 0;
+        heartbeatCount = 0;
+    }
+
+} // namespace B4R
@@ -0,0 +1,163 @@
+/**
+ * @file rSensorFilter.h
+ * @brief Sensor value filter with deadband, hysteresis and report intervals for B4R.
+ *
+ * Decides when a sensor value is worth an event, so the BLE, MQTT and LCD
+ * traffic follows real changes and not the noise of the sensor:
+ *
+ *   sample > median of N > EMA > deadband (+ hysteresis) > min / max interval > report
+ *
+ * - Median: the median of the last N samples (N odd, 1 = off) drops spikes.
+ * - EMA: exponential moving average, Alpha 1.0 = off, 0.25 = smooth.
+ * - Deadband: the filtered value is reported when it moved at least
+ *   max(Absolute, Relative * |reported value|) away from the last reported
+ *   value. A change against the direction of the last report needs Hysteresis
+ *   more, so a value on the edge of the band does not toggle.
+ * - MinInterval: no report within MinInterval ms of the last one (rate limit),
+ *   a change held back is reported once the interval has passed.
+ * - MaxInterval: a report at least every MaxInterval ms (heartbeat), 0 = off.
+ * - NaN (failed read) is reported once, the next valid sample restarts the
+ *   median and EMA.
+ *
+ * The default (all off, deadband 0) reports every change of the value.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+
+/** Maximum median window. */
+#ifndef RSENSORFILTER_MEDIAN_MAX
+#define RSENSORFILTER_MEDIAN_MAX 7
+#endif
+
+//~Library: rSensorFilter
+//~Author: Robert W.B. Linn
+//~Brief: Sensor value filter with median, EMA, deadband with hysteresis and report intervals.
+//~Version: 1.00
+
+namespace B4R {
+
+    //~shortname: SensorFilter
+    class B4RSensorFilter {
+    private:
+        // Median ring
+        float samples[RSENSORFILTER_MEDIAN_MAX];
+        uint8_t medianSize = 1;
+        uint8_t sampleCount = 0;
+        uint8_t sampleIndex = 0;
+
+        // EMA
+        float alpha = 1.0f;
+        float ema = NAN;
+
+        // Deadband
+        float absolute = 0;
+        float relative = 0;
+        float hysteresis = 0;
+
+        // Intervals (ms)
+        uint32_t minInterval = 0;
+        uint32_t maxInterval = 0;
+
+        float value = NAN;                      // Filtered value
+        float reported = NAN;
+        bool hasReported = false;
+        int8_t direction = 0;                   // Direction of the last report, -1 down, 1 up
+        uint32_t lastReport = 0;
+        bool heartbeat = false;
+
+        // Counters
+        uint32_t updateCount = 0;
+        uint32_t emittedCount = 0;
+        uint32_t heartbeatCount = 0;
+
+        float Median();
+
+    public:
+        /** Initialize with all filters off: every change is reported. */
+        void Initialize();
+
+        /**
+         * Set the median window.
+         * @param Size Number of samples, odd, 1 to MEDIAN_MAX (1 = off)
+         */
+        void SetMedian(Byte Size);
+
+        /**
+         * Set the deadband.
+         * @param Absolute Minimum change in sensor units, 0 = any change
+         * @param Relative Minimum change as fraction of the reported value, e.g. 0.02 = 2 %
+         * @param Hysteresis Extra change needed against the direction of the last report
+         */
+        void SetDeadband(Double Absolute, Double Relative, Double Hysteresis);
+
+        /**
+         * Set/Get the EMA factor 0 < Alpha <= 1, 1 = off (default).
+         */
+        void setAlpha(Double Alpha);
+        Double getAlpha();
+
+        /**
+         * Set/Get the minimum time between two reports in ms, 0 = off (default).
+         */
+        void setMinInterval(ULong ms);
+        ULong getMinInterval();
+
+        /**
+         * Set/Get the maximum time between two reports in ms (heartbeat), 0 = off (default).
+         */
+        void setMaxInterval(ULong ms);
+        ULong getMaxInterval();
+
+        /**
+         * Add a sample and report it if due.
+         * @param Value Sample, NaN for a failed read
+         * @return True if the value should be reported (Value is then the reported value)
+         */
+        bool Update(Double Value);
+
+        /** Filtered value, the reported value after Update returned True */
+        Double getValue();
+
+        /** Last reported value */
+        Double getReported();
+
+        /** True if the last report was a heartbeat (MaxInterval) without change */
+        bool getHeartbeat();
+
+        /** Number of samples */
+        ULong getUpdateCount();
+
+        /** Number of reports */
+        ULong getEmittedCount();
+
+        /** Number of samples not reported */
+        ULong getSuppressedCount();
+
+        /** Number of heartbeat reports */
+        ULong getHeartbeatCount();
+
+        /** Clear the samples and the reported value, the next sample is reported. */
+        void Reset();
+
+        /** Reset the counters */
+        void ResetCounters();
+
+        /** Limits */
+        static const Byte MEDIAN_MAX = RSENSORFILTER_MEDIAN_MAX;
+
+        //~hide
+        // Add a sample without reporting: True if due at time now (ms).
+        // Sensors with several values report all with Commit if one is due.
+        bool Sample(float sample, uint32_t now);
+        // Take the filtered value as reported at time now
+        void Commit(uint32_t now);
+        // Update at a given time, for host tools
+        bool UpdateAt(float sample, uint32_t now);
+    };
+
+} // namespace B4R
@@ -0,0 +1,271 @@
+/**
+ * @file rStateSnapshot.cpp
+ * @brief Home-wide state snapshot published as one retained MQTT message for B4R.
+ */
+
+#include "B4RDefines.h"
+#include "rStateSnapshot.h"
+
+namespace B4R {
+
+    static const uint32_t POW10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+    /**
+     * @brief Initialize the snapshot and register the poller.
+     */
+    void B4RStateSnapshot::Initialize(SubVoidULong DueSub) {
+        this->DueSub = DueSub;
+        fieldCount = 0;
+        changed = 0;
+        lastChanged = 0;
+        sequence = 0;
+        requested = false;
+        dueRaised = false;
+        now = millis();
+        lastSnapshot = now;
+        ResetCounters();
+
+        FunctionUnion fu;
+        fu.PollerFunction = looper;
+        pollers.add(fu, this);
+    }
+
+    Byte B4RStateSnapshot::Add(B4RString* Key, Byte Decimals) {
+        uint16_t n = Key->getLength();
+        if (fieldCount == RSTATESNAPSHOT_MAX_FIELDS || n == 0 || n >= RSTATESNAPSHOT_KEY_SIZE) return INVALID_FIELD;
+        Field& f = fields[fieldCount];
+        memcpy(f.key, Key->data, n);
+        f.keyLength = (uint8_t)n;
+        f.decimals = Decimals > 6 ? 6 : Decimals;
+        f.valid = false;
+        f.value = 0;
+        f.holdoff = 0;
+        return fieldCount++;
+    }
+
+    /**
+     * @brief Store a scaled value, flag the field if it differs from the stored one.
+     */
+    void B4RStateSnapshot::Store(Byte index, int32_t value, bool valid) {
+        if (index >= fieldCount) return;
+        Field& f = fields[index];
+        if (f.valid == valid && (!valid || f.value == value)) return;
+        f.valid = valid;
+        f.value = value;
+        changed |= 1UL << index;
+        changeCount++;
+    }
+
+    void B4RStateSnapshot::SetLong(Byte Index, Long Value) {
+        if (Index >= fieldCount) return;
+        Store(Index, Value * (int32_t)POW10[fields[Index].decimals], true);
+    }
+
+    void B4RStateSnapshot::SetFloat(Byte Index, Double Value) {
+        if (Index >= fieldCount) return;
+        double scaled = Value * POW10[fields[Index].decimals];
+        if (!(scaled > -2e9 && scaled < 2e9)) {
+            Store(Index, 0, false);
+            return;
+        }
+        // Rounded half away from zero as rPayloadTemplate
+        Store(Index, (int32_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5), true);
+    }
+
+    void B4RStateSnapshot::SetFieldHoldoff(Byte Index, ULong Ms) {
+        if (Index < fieldCount) fields[Index].holdoff = Ms;
+    }
+
+    /**
+     * @brief True if a changed field has reached its holdoff.
+     */
+    bool B4RStateSnapshot::ChangeDue(uint32_t elapsed) {
+        for (uint8_t i = 0; i < fieldCount; i++) {
+            if ((changed & (1UL << i)) && elapsed >= (fields[i].holdoff ? fields[i].holdoff : holdoff)) return true;
+        }
+        return false;
+    }
+
+    void B4RStateSnapshot::Request() {
+        requested = true;
+    }
+
+    /**
+     * @brief Write a scaled integer with fixed decimals.
+     * @return Number of characters (at most 12)
+     */
+    uint8_t B4RStateSnapshot::FormatFixed(int32_t value, uint8_t decimals, char* out) {
+        char digits[12];
+        uint8_t n = 0, len = 0;
+        // At least one digit before the point
+        uint8_t minimum = decimals > 0 ? decimals + 2 : 1;
+        uint32_t u = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+        do {
+            digits[n++] = '0' + (u % 10);
+            u /= 10;
+            if (n == decimals) digits[n++] = '.';
+        } while (u > 0 || n < minimum);
+        if (value < 0) out[len++] = '-';
+        while (n > 0) out[len++] = digits[--n];
+        return len;
+    }
+
+    void B4RStateSnapshot::Append(uint8_t* out, uint16_t size, uint16_t& length, const char* text, uint16_t textLength) {
+        if (length > size || textLength > size - length) {
+            length = size + 1;
+            return;
+        }
+        memcpy(out + length, text, textLength);
+        length += textLength;
+    }
+
+    /**
+     * @brief Render the snapshot in one pass: seq, chg, then the fields in the order added.
+     * @return Bytes written, 0 if out is too small (the snapshot is still taken)
+     */
+    uint16_t B4RStateSnapshot::RenderInto(uint8_t* out, uint16_t size, uint8_t format) {
+        sequence++;
+        lastChanged = changed;
+        changed = 0;
+        lastSnapshot = now;
+        snapshotCount++;
+
+        uint16_t length = 0;
+        if (format == B4RPayloadCodec::FORMAT_JSON) {
+            char number[16];
+            Append(out, size, length, "{\"seq\":", 7);
+            Append(out, size, length, number, FormatFixed((int32_t)sequence, 0, number));
+            Append(out, size, length, ",\"chg\":", 7);
+            // Bitmap as unsigned decimal
+            uint32_t u = lastChanged;
+            uint8_t n = sizeof(number);
+            do {
+                number[--n] = '0' + (u % 10);
+                u /= 10;
+            } while (u > 0);
+            Append(out, size, length, number + n, sizeof(number) - n);
+            for (uint8_t i = 0; i < fieldCount; i++) {
+                const Field& f = fields[i];
+                Append(out, size, length, ",\"", 2);
+                Append(out, size, length, f.key, f.keyLength);
+                Append(out, size, length, "\":", 2);
+                if (f.valid) Append(out, size, length, number, FormatFixed(f.value, f.decimals, number));
+                else Append(out, size, length, "null", 4);
+            }
+            Append(out, size, length, "}", 1);
+            if (length > size) length = 0;
+        } else {
+            PayloadWriter w(out, size, format);
+            w.Map(fieldCount + 2);
+            w.Text("seq", 3);
+            w.Integer((int32_t)sequence);
+            w.Text("chg", 3);
+            if (lastChanged <= INT32_MAX) w.Integer((int32_t)lastChanged);
+            else w.Float64((double)lastChanged);
+            for (uint8_t i = 0; i < fieldCount; i++) {
+                const Field& f = fields[i];
+                w.Text(f.key, f.keyLength);
+                if (!f.valid) w.Null();
+                else if (f.decimals == 0) w.Integer(f.value);
+                else w.Float((float)((double)f.value / POW10[f.decimals]));
+            }
+            length = w.getOverflow() ? 0 : w.getLength();
+        }
+
+        if (length == 0) overflowCount++;
+        lastLength = length;
+        return length;
+    }
+
+    ArrayByte* B4RStateSnapshot::Render(Byte Format) {
+        ArrayByte* arr = CreateStackMemoryObject(ArrayByte);
+        arr->data = buffer;
+        arr->length = RenderInto(buffer, sizeof(buffer), Format);
+        return arr;
+    }
+
+    /**
+     * @brief Raise Due on change (after Holdoff), periodically (Interval) or on Request.
+     * Due is raised again at most once per Holdoff if the snapshot is not rendered.
+     */
+    void B4RStateSnapshot::Poll(uint32_t now) {
+        this->now = now;
+        if (!DueSub) return;
+        bool due = requested
+            || (changed != 0 && ChangeDue(now - lastSnapshot))
+            || (interval > 0 && now - lastSnapshot >= interval);
+        if (!due) return;
+        if (!requested && dueRaised && now - lastDue < holdoff) return;
+
+        requested = false;
+        dueRaised = true;
+        lastDue = now;
+        const UInt cp = B4R::StackMemory::cp;
+        DueSub(changed);
+        B4R::StackMemory::cp = cp;
+    }
+
+    /**
+     * @brief Main loop poller.
+     */
+    void B4RStateSnapshot::looper(void* b) {
+        B4RStateSnapshot* me = (B4RStateSnapshot*)b;
+        me->Poll(millis());
+    }
+
+    void B4RStateSnapshot::setInterval(ULong ms) {
+        interval = ms;
+    }
+
+    ULong B4RStateSnapshot::getInterval() {
+        return interval;
+    }
+
+    void B4RStateSnapshot::setHoldoff(ULong ms) {
+        holdoff = ms;
+    }
+
+    ULong B4RStateSnapshot::getHoldoff() {
+        return holdoff;
+    }
+
+    Byte B4RStateSnapshot::getFieldCount() {
+        return fieldCount;
+    }
+
+    ULong B4RStateSnapshot::getChanged() {
+        return changed;
+    }
+
+    ULong B4RStateSnapshot::getLastChanged() {
+        return lastChanged;
+    }
+
+    ULong B4RStateSnapshot::getSequence() {
+        return sequence;
+    }
+
+    ULong B4RStateSnapshot::getSnapshotCount() {
+        return snapshotCount;
+    }
+
+    ULong B4RStateSnapshot::getChangeCount() {
+        return changeCount;
+    }
+
+    ULong B4RStateSnapshot::getOverflowCount() {
+        return overflowCount;
+    }
+
+    UInt B4RStateSnapshot::getLastLength() {
+        return lastLength;
+    }
+
+    void B4RStateSnapshot::ResetCounters() {
+        snapshotCount = 0;
+        changeCount = 0;
+        overflowCount = 0;
+        lastLength = 0;
+    }
+
+} // namespace B4R
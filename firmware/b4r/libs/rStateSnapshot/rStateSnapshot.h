@@ -0,0 +1,206 @@
+/**
+ * @file rStateSnapshot.h
+ * @brief Home-wide state snapshot published as one retained MQTT message for B4R.
+ *
+ * Keeps the last-known state of every device in a fixed field table and
+ * renders it as one flat object, so a dashboard gets the full home state
+ * from one retained message instead of waiting for every device topic:
+ *
+ *   {"seq":42,"chg":3,"led":1,"rgb":0,...,"t":21.5,"h":45.2,...}
+ *
+ * - seq: sequence number, +1 per snapshot. Restarts at 1 after a reboot.
+ * - chg: bitmap of the fields changed since the previous snapshot, bit n is
+ *   the n-th field added. 0 for a periodic snapshot without changes.
+ * - Fields are added once with a short key and a number of decimals, and set
+ *   by index (SetLong / SetFloat). A value is stored scaled to an integer, so
+ *   sensor noise below the decimals is not a change. Fields not yet set and
+ *   NaN are rendered as null.
+ *
+ * A poller raises Due when a snapshot should be published: on change, at
+ * most once per Holdoff ms (a burst of changes gives one snapshot), and every
+ * Interval ms without changes. Fields of fast sensors can get a longer own
+ * holdoff (SetFieldHoldoff), so a temperature read every 2 s is published
+ * with the next snapshot, while a door or motion change still goes out at
+ * once. The application renders it with Render in the payload format of the
+ * topic (rPayloadCodec) and publishes it.
+ *
+ * All methods run in the B4R main loop.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+#include "rPayloadCodec.h"
+
+/** Maximum number of fields (changed bitmap is 32 bits). */
+#ifndef RSTATESNAPSHOT_MAX_FIELDS
+#define RSTATESNAPSHOT_MAX_FIELDS 32
+#endif
+
+/** Maximum key length + 1. */
+#ifndef RSTATESNAPSHOT_KEY_SIZE
+#define RSTATESNAPSHOT_KEY_SIZE 8
+#endif
+
+/** Size of the output buffer used by Render. */
+#ifndef RSTATESNAPSHOT_BUFFER_SIZE
+#define RSTATESNAPSHOT_BUFFER_SIZE 128
+#endif
+
+//~Library: rStateSnapshot
+//~Author: Robert W.B. Linn
+//~Brief: Home-wide state snapshot with sequence number and changed-fields bitmap.
+//~Version: 1.00
+
+namespace B4R {
+
+    //~shortname: StateSnapshot
+    //~Event: Due (Changed As ULong)
+    typedef void (*SubVoidULong)(ULong count);
+
+    class B4RStateSnapshot {
+    private:
+        struct Field {
+            char key[RSTATESNAPSHOT_KEY_SIZE];
+            uint8_t keyLength;
+            uint8_t decimals;
+            bool valid;
+            int32_t value;                      // Scaled by 10^decimals
+            uint32_t holdoff;                   // 0: Holdoff
+        };
+
+        SubVoidULong DueSub = nullptr;
+        Field fields[RSTATESNAPSHOT_MAX_FIELDS];
+        uint8_t fieldCount = 0;
+        uint32_t changed = 0;
+        uint32_t lastChanged = 0;
+        uint32_t sequence = 0;
+        bool requested = false;
+
+        // Timing (ms)
+        uint32_t interval = 60000;
+        uint32_t holdoff = 1000;
+        uint32_t now = 0;                       // Time of the last poll
+        uint32_t lastSnapshot = 0;
+        uint32_t lastDue = 0;
+        bool dueRaised = false;
+
+        // Counters
+        uint32_t snapshotCount = 0;
+        uint32_t changeCount = 0;
+        uint32_t overflowCount = 0;
+        uint16_t lastLength = 0;
+
+        uint8_t buffer[RSTATESNAPSHOT_BUFFER_SIZE];
+
+        void Store(Byte index, int32_t value, bool valid);
+        bool ChangeDue(uint32_t elapsed);
+        static uint8_t FormatFixed(int32_t value, uint8_t decimals, char* out);
+        static void Append(uint8_t* out, uint16_t size, uint16_t& length, const char* text, uint16_t textLength);
+
+        static void looper(void* b);
+
+    public:
+        /** Limits */
+        static const Byte MAX_FIELDS = RSTATESNAPSHOT_MAX_FIELDS;
+        static const UInt BUFFER_SIZE = RSTATESNAPSHOT_BUFFER_SIZE;
+
+        /** Returned by Add if the table is full or the key too long */
+        static const Byte INVALID_FIELD = 255;
+
+        /**
+         * Initialize the snapshot and register the poller.
+         * @param DueSub Raised when a snapshot should be published, with the changed bitmap
+         */
+        void Initialize(SubVoidULong DueSub);
+
+        /**
+         * Add a field. The fields are rendered in the order added.
+         * @param Key Key in the payload, at most 7 characters
+         * @param Decimals Decimals of the value, 0 for integers and states (max 6)
+         * @return Field index (bit in the changed bitmap), INVALID_FIELD if full
+         */
+        Byte Add(B4RString* Key, Byte Decimals);
+
+        /**
+         * Set a field to an integer, e.g. a device state.
+         * @param Index Field index
+         * @param Value Value
+         */
+        void SetLong(Byte Index, Long Value);
+
+        /**
+         * Set a field to a number, rounded to the decimals of the field. NaN clears it (null).
+         * @param Index Field index
+         * @param Value Value
+         */
+        void SetFloat(Byte Index, Double Value);
+
+        /**
+         * Set the holdoff of a field, e.g. a sensor read every few seconds.
+         * A change of the field alone raises Due after this time, with other changes it is published at once.
+         * @param Index Field index
+         * @param Ms Holdoff in ms, 0 for Holdoff
+         */
+        void SetFieldHoldoff(Byte Index, ULong Ms);
+
+        /** Raise Due at the next main loop pass, e.g. after the broker connection is up. */
+        void Request();
+
+        /**
+         * Render the next snapshot: Sequence +1, the changed bitmap is cleared.
+         * @param Format PayloadCodec.FORMAT_JSON, FORMAT_CBOR or FORMAT_MSGPACK
+         * @return Payload, valid until the next Render. Empty if the buffer is too small.
+         */
+        ArrayByte* Render(Byte Format);
+
+        /**
+         * Set/Get the interval of the periodic snapshot in ms, 0 disables (default 60000).
+         */
+        void setInterval(ULong ms);
+        ULong getInterval();
+
+        /**
+         * Set/Get the minimum time between two snapshots on change in ms (default 1000).
+         */
+        void setHoldoff(ULong ms);
+        ULong getHoldoff();
+
+        /** Number of fields */
+        Byte getFieldCount();
+
+        /** Bitmap of the fields changed since the last snapshot */
+        ULong getChanged();
+
+        /** Changed bitmap of the last snapshot */
+        ULong getLastChanged();
+
+        /** Sequence number of the last snapshot, 0 before the first */
+        ULong getSequence();
+
+        /** Number of snapshots rendered */
+        ULong getSnapshotCount();
+
+        /** Number of value changes */
+        ULong getChangeCount();
+
+        /** Number of snapshots that did not fit the buffer */
+        ULong getOverflowCount();
+
+        /** Length of the last snapshot in bytes */
+        UInt getLastLength();
+
+        /** Reset the counters */
+        void ResetCounters();
+
+        //~hide
+        // Render into any buffer (as Render), for C++ callers and host tools
+        uint16_t RenderInto(uint8_t* out, uint16_t size, uint8_t format);
+        // Poll with a given time, for host tools
+        void Poll(uint32_t now);
+    };
+
+} // namespace B4R
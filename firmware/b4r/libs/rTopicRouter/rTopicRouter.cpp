@@ -0,0 +1,273 @@
+/**
+ * @file rTopicRouter.cpp
+ * @brief MQTT topic router with + and # wildcards for B4R.
+ */
+
+#include "B4RDefines.h"
+#include "rTopicRouter.h"
+
+namespace B4R {
+
+    /**
+     * @brief Clear the trie. Node 0 is the root (empty level text).
+     */
+    void B4RTopicRouter::Initialize(SubVoidByte ErrorSub) {
+        this->ErrorSub = ErrorSub;
+        nodeCount = 0;
+        textUsed = 0;
+        levelCount = 0;
+        captureCount = 0;
+        matchCount = 0;
+        missCount = 0;
+        NewNode("", 0);
+    }
+
+    /**
+     * @brief Cheap level signature: first and last character, no loop over the level.
+     */
+    uint8_t B4RTopicRouter::Hash(const char* s, uint8_t length) {
+        return length == 0 ? 0 : (uint8_t)(s[0] ^ (s[length - 1] << 3));
+    }
+
+    uint8_t B4RTopicRouter::NewNode(const char* s, uint8_t length) {
+        if (nodeCount >= RTOPICROUTER_MAX_NODES) {
+            HandleError(ERROR_NODES_FULL);
+            return NODE_NONE;
+        }
+        if (textUsed + length > RTOPICROUTER_TEXT_SIZE) {
+            HandleError(ERROR_TEXT_FULL);
+            return NODE_NONE;
+        }
+        Node& n = nodes[nodeCount];
+        n.text = textUsed;
+        n.length = length;
+        n.hash = Hash(s, length);
+        n.child = NODE_NONE;
+        n.sibling = NODE_NONE;
+        n.plus = NODE_NONE;
+        n.route = NOT_FOUND;
+        n.hashRoute = NOT_FOUND;
+        memcpy(text + textUsed, s, length);
+        textUsed += length;
+        return nodeCount++;
+    }
+
+    /**
+     * @brief Find the exact child of a node with the given level text.
+     */
+    uint8_t B4RTopicRouter::FindChild(uint8_t parent, const char* s, uint8_t length, uint8_t hash) {
+        for (uint8_t c = nodes[parent].child; c != NODE_NONE; c = nodes[c].sibling) {
+            const Node& n = nodes[c];
+            if (n.hash == hash && n.length == length && memcmp(text + n.text, s, length) == 0) {
+                return c;
+            }
+        }
+        return NODE_NONE;
+    }
+
+    /**
+     * @brief Split a topic into levels (pointers into the topic).
+     * @return Number of levels, 0 if the topic has too many levels or a level is too long.
+     */
+    uint8_t B4RTopicRouter::Split(const char* s, uint16_t length) {
+        uint8_t count = 0;
+        const char* p = s;
+        const char* end = s + length;
+        for (;;) {
+            const char* slash = (const char*)memchr(p, '/', end - p);
+            const char* levelEnd = slash ? slash : end;
+            uint16_t n = levelEnd - p;
+            if (count >= RTOPICROUTER_MAX_LEVELS || n > 255) return 0;
+            levels[count].start = p;
+            levels[count].length = (uint8_t)n;
+            levels[count].hash = Hash(p, (uint8_t)n);
+            count++;
+            if (!slash) return count;
+            p = slash + 1;
+        }
+    }
+
+    bool B4RTopicRouter::Add(B4RString* Filter, Byte Id) {
+        return AddFilter(Filter->data, Filter->getLength(), Id);
+    }
+
+    /**
+     * @brief Walk / extend the trie level by level and store the route id at the last level.
+     */
+    bool B4RTopicRouter::AddFilter(const char* filter, uint16_t length, uint8_t id) {
+        if (id == NOT_FOUND || length == 0) {
+            HandleError(ERROR_INVALID_FILTER);
+            return false;
+        }
+        uint8_t count = Split(filter, length);
+        if (count == 0) {
+            HandleError(ERROR_INVALID_FILTER);
+            return false;
+        }
+
+        uint8_t node = 0;
+        for (uint8_t l = 0; l < count; l++) {
+            const Level& lv = levels[l];
+            bool plus = lv.length == 1 && lv.start[0] == '+';
+            bool hash = lv.length == 1 && lv.start[0] == '#';
+
+            // Wildcards must be a complete level, # must be the last level
+            if ((!plus && !hash && (memchr(lv.start, '+', lv.length) || memchr(lv.start, '#', lv.length)))
+                || (hash && l != count - 1)) {
+                HandleError(ERROR_INVALID_FILTER);
+                return false;
+            }
+
+            if (hash) {
+                if (nodes[node].hashRoute != NOT_FOUND) {
+                    HandleError(ERROR_DUPLICATE);
+                    return false;
+                }
+                nodes[node].hashRoute = id;
+                return true;
+            }
+
+            uint8_t next;
+            if (plus) {
+                next = nodes[node].plus;
+                if (next == NODE_NONE) {
+                    next = NewNode("+", 1);
+                    if (next == NODE_NONE) return false;
+                    nodes[node].plus = next;
+                }
+            } else {
+                next = FindChild(node, lv.start, lv.length, lv.hash);
+                if (next == NODE_NONE) {
+                    next = NewNode(lv.start, lv.length);
+                    if (next == NODE_NONE) return false;
+                    nodes[next].sibling = nodes[node].child;
+                    nodes[node].child = next;
+                }
+            }
+            node = next;
+        }
+
+        if (nodes[node].route != NOT_FOUND) {
+            HandleError(ERROR_DUPLICATE);
+            return false;
+        }
+        nodes[node].route = id;
+        return true;
+    }
+
+    Byte B4RTopicRouter::Match(B4RString* Topic) {
+        return MatchTopic(Topic->data, Topic->getLength());
+    }
+
+    /**
+     * @brief Split the topic in place (no copy) and match it.
+     */
+    uint8_t B4RTopicRouter::MatchTopic(const char* s, uint16_t length) {
+        captureCount = 0;
+        hashCapture = 0xFF;
+        if (length >= RTOPICROUTER_TOPIC_SIZE) {
+            missCount++;
+            HandleError(ERROR_TOPIC_TOO_LONG);
+            return NOT_FOUND;
+        }
+        levelCount = Split(s, length);
+
+        uint8_t route = levelCount > 0 && nodeCount > 0 ? MatchLevel(0, 0, 0) : NOT_FOUND;
+        if (route == NOT_FOUND) {
+            captureCount = 0;
+            missCount++;
+        } else {
+            matchCount++;
+        }
+        return route;
+    }
+
+    /**
+     * @brief Match the levels from 'level' on below 'node': exact child first, then '+', then '#'.
+     * Backtracks only if the preferred branch has no match further down.
+     * @param depth Number of captures made so far on this path
+     */
+    uint8_t B4RTopicRouter::MatchLevel(uint8_t node, uint8_t level, uint8_t depth) {
+        if (level == levelCount) {
+            if (nodes[node].route != NOT_FOUND) {
+                captureCount = depth;
+                return nodes[node].route;
+            }
+            // "a/#" also matches "a"
+            if (nodes[node].hashRoute != NOT_FOUND) {
+                captureCount = depth;
+                return nodes[node].hashRoute;
+            }
+            return NOT_FOUND;
+        }
+
+        const Level& lv = levels[level];
+        uint8_t child = FindChild(node, lv.start, lv.length, lv.hash);
+        if (child != NODE_NONE) {
+            uint8_t route = MatchLevel(child, level + 1, depth);
+            if (route != NOT_FOUND) return route;
+        }
+
+        if (nodes[node].plus != NODE_NONE) {
+            captures[depth] = level;
+            uint8_t route = MatchLevel(nodes[node].plus, level + 1, depth + 1);
+            if (route != NOT_FOUND) return route;
+        }
+
+        if (nodes[node].hashRoute != NOT_FOUND) {
+            captures[depth] = level;
+            hashCapture = depth;
+            captureCount = depth + 1;
+            return nodes[node].hashRoute;
+        }
+        return NOT_FOUND;
+    }
+
+    Byte B4RTopicRouter::getWildcardCount() {
+        return captureCount;
+    }
+
+    ArrayByte* B4RTopicRouter::WildcardAt(Byte Index) {
+        ArrayByte* arr = CreateStackMemoryObject(ArrayByte);
+        arr->data = nullptr;
+        arr->length = 0;
+        if (Index >= captureCount) return arr;
+
+        const Level& lv = levels[captures[Index]];
+        arr->data = (void*)lv.start;
+        if (Index == hashCapture) {
+            // # captures the remaining levels
+            const Level& last = levels[levelCount - 1];
+            arr->length = (last.start + last.length) - lv.start;
+        } else {
+            arr->length = lv.length;
+        }
+        return arr;
+    }
+
+    Byte B4RTopicRouter::getNodeCount() {
+        return nodeCount;
+    }
+
+    UInt B4RTopicRouter::getTextUsed() {
+        return textUsed;
+    }
+
+    ULong B4RTopicRouter::getMatchCount() {
+        return matchCount;
+    }
+
+    ULong B4RTopicRouter::getMissCount() {
+        return missCount;
+    }
+
+    /**
+     * @brief Invokes the error callback.
+     */
+    void B4RTopicRouter::HandleError(uint8_t code) {
+        if (ErrorSub) {
+            ErrorSub(code);
+        }
+    }
+
+} // namespace B4R
@@ -0,0 +1,167 @@
+/**
+ * @file rTopicRouter.h
+ * @brief MQTT topic router with + and # wildcards for B4R.
+ *
+ * Topic filters are stored in a prefix trie with one node per topic level
+ * (static node pool and text pool, no heap). A topic is matched level by
+ * level in O(topic length): per level the children are compared by hash
+ * and length first (no hashing loop, no copy of the topic).
+ * Precedence per level: exact text, then '+', then '#'.
+ *
+ * Example:
+ *   Add("homekit32/home1/fan/set", 8)
+ *   Add("homekit32/+/fan/set", 20)         any home, WildcardAt(0) = home
+ *   Add("homekit32/home1/#", 30)           anything else below home1
+ *   Match("homekit32/home1/fan/set")   -> 8
+ *   Match("homekit32/home2/fan/set")   -> 20
+ *   Match("homekit32/home1/lcd/get")   -> 30
+ *
+ * All methods run in the B4R main loop.
+ *
+ * @author Robert W.B. Linn
+ * @date 2026
+ * @license MIT
+ */
+
+#pragma once
+#include "B4RDefines.h"
+
+/** Number of trie nodes (topic levels over all filters, shared prefixes count once). Max 254. */
+#ifndef RTOPICROUTER_MAX_NODES
+#define RTOPICROUTER_MAX_NODES 96
+#endif
+
+/** Bytes for the level texts of all nodes. */
+#ifndef RTOPICROUTER_TEXT_SIZE
+#define RTOPICROUTER_TEXT_SIZE 768
+#endif
+
+/** Maximum topic length and number of levels that can be matched. */
+#ifndef RTOPICROUTER_TOPIC_SIZE
+#define RTOPICROUTER_TOPIC_SIZE 128
+#endif
+#ifndef RTOPICROUTER_MAX_LEVELS
+#define RTOPICROUTER_MAX_LEVELS 8
+#endif
+
+//~Library: rTopicRouter
+//~Author: Robert W.B. Linn
+//~Brief: MQTT topic router with + and # wildcards, prefix trie matching in O(topic length).
+//~Version: 1.00
+
+namespace B4R {
+
+    //~shortname: TopicRouter
+    //~Event: Error (Code As Byte)
+    typedef void (*SubVoidByte)(Byte b);
+
+    class B4RTopicRouter {
+    private:
+        static const uint8_t NODE_NONE = 0xFF;
+
+        struct Node {
+            uint16_t text;          // Offset of the level text in the text pool
+            uint8_t length;         // Level text length
+            uint8_t hash;           // Level signature (first/last character), compared before the text
+            uint8_t child;          // First exact child
+            uint8_t sibling;        // Next exact sibling
+            uint8_t plus;           // '+' child
+            uint8_t route;          // Route id if a filter ends here
+            uint8_t hashRoute;      // Route id of a '#' child (matches this level and below)
+        };
+
+        Node nodes[RTOPICROUTER_MAX_NODES];
+        uint8_t nodeCount = 0;
+        char text[RTOPICROUTER_TEXT_SIZE];
+        uint16_t textUsed = 0;
+
+        // Levels of the topic being matched and the wildcard captures of the last match
+        struct Level {
+            const char* start;
+            uint8_t length;
+            uint8_t hash;
+        };
+        Level levels[RTOPICROUTER_MAX_LEVELS];
+        uint8_t levelCount = 0;
+        uint8_t captures[RTOPICROUTER_MAX_LEVELS];
+        uint8_t captureCount = 0;
+        uint8_t hashCapture = 0xFF;
+
+        uint32_t matchCount = 0;
+        uint32_t missCount = 0;
+
+        SubVoidByte ErrorSub = nullptr;
+
+        static uint8_t Hash(const char* s, uint8_t length);
+        uint8_t NewNode(const char* s, uint8_t length);
+        uint8_t FindChild(uint8_t parent, const char* s, uint8_t length, uint8_t hash);
+        uint8_t Split(const char* s, uint16_t length);
+        uint8_t MatchLevel(uint8_t node, uint8_t level, uint8_t depth);
+        void HandleError(uint8_t code);
+
+    public:
+        /** Returned by Match if no filter matches */
+        static const Byte NOT_FOUND = 0xFF;
+
+        /** Error codes */
+        static const Byte ERROR_NODES_FULL = 1;
+        static const Byte ERROR_TEXT_FULL = 2;
+        static const Byte ERROR_INVALID_FILTER = 3;
+        static const Byte ERROR_DUPLICATE = 4;
+        static const Byte ERROR_TOPIC_TOO_LONG = 5;
+
+        /** Limits */
+        static const Byte MAX_NODES = RTOPICROUTER_MAX_NODES;
+        static const Byte MAX_LEVELS = RTOPICROUTER_MAX_LEVELS;
+
+        /**
+         * Initialize (clear) the router.
+         * @param ErrorSub Raised on errors
+         */
+        void Initialize(SubVoidByte ErrorSub);
+
+        /**
+         * Add a topic filter.
+         * @param Filter Topic or filter with + (one level) and # (last level, this level and below)
+         * @param Id Route id returned by Match, 0-254
+         * @return False on error (invalid filter, duplicate, pool full)
+         */
+        bool Add(B4RString* Filter, Byte Id);
+
+        /**
+         * Match a topic against the filters.
+         * @param Topic Topic of a received message (no wildcards)
+         * @return Route id or NOT_FOUND
+         */
+        Byte Match(B4RString* Topic);
+
+        /** Number of levels captured by + and # in the last match */
+        Byte getWildcardCount();
+
+        /**
+         * Text captured by a wildcard in the last match, e.g. the home of "homekit32/+/fan/set".
+         * A # capture holds the remaining levels. Points into the matched topic,
+         * use it while the topic is valid (e.g. in MQTT_MessageArrived).
+         * @param Index 0 to WildcardCount - 1
+         */
+        ArrayByte* WildcardAt(Byte Index);
+
+        /** Number of trie nodes used */
+        Byte getNodeCount();
+
+        /** Bytes of the text pool used */
+        UInt getTextUsed();
+
+        /** Number of matched topics */
+        ULong getMatchCount();
+
+        /** Number of topics without a matching filter */
+        ULong getMissCount();
+
+        //~hide
+        // Same as Add / Match for C++ callers and host tools
+        bool AddFilter(const char* filter, uint16_t length, uint8_t id);
+        uint8_t MatchTopic(const char* topic, uint16_t length);
+    };
+
+} // namespace B4R